@@ -7,14 +7,13 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
-#include <wiringPi.h>
-#include <wiringPiI2C.h>
+#include "Hal.h"
 #include "Arduino.h"
 
 //------------------------------------------------------------------------------
 Arduino::Arduino()
 {
-
+	i2c_fd = -1;
 }
 
 //------------------------------------------------------------------------------
@@ -22,9 +21,7 @@ bool Arduino::Init( U8 i2c_addr )
 {
 	bool bStatus = true;
 
-	// We're using wiringPi here on an RPi, we need to init the library for each i2c device
-
-	if( (i2c_fd = wiringPiI2CSetup( i2c_addr )) < 0)
+	if( (i2c_fd = HAL_I2cOpen( i2c_addr )) < 0)
 	{
 		fprintf (stderr, "Unable to open Arduino I2C: %s\n", strerror (errno)) ;
 		bStatus = false;
@@ -33,16 +30,26 @@ bool Arduino::Init( U8 i2c_addr )
 	return bStatus;
 }
 
+//------------------------------------------------------------------------------
+void Arduino::Close( void )
+{
+	if( i2c_fd >= 0 )
+	{
+		HAL_I2cClose( i2c_fd );
+		i2c_fd = -1;
+	}
+}
+
 //------------------------------------------------------------------------------
 void Arduino::SetReg( E_ARDUINO_REG reg, U8 val )
 {
-	if( wiringPiI2CWrite( i2c_fd, (U8)reg | 0x80 ) < 0 )
+	if( HAL_I2cWrite( i2c_fd, (U8)reg | 0x80 ) < 0 )
 	{
 		fprintf (stderr, "Arduino SetReg error: %s\n", strerror (errno)) ;
 	}
 	else
 	{
-		wiringPiI2CWrite( i2c_fd, val );
+		HAL_I2cWrite( i2c_fd, val );
 	}
 }
 
@@ -51,13 +58,13 @@ U8 Arduino::GetReg( E_ARDUINO_REG reg )
 {
 	U8 data = 0;
 
-	if( wiringPiI2CWrite( i2c_fd, (U8)reg ) < 0 )
+	if( HAL_I2cWrite( i2c_fd, (U8)reg ) < 0 )
 	{
 		fprintf (stderr, "Arduino GetReg error: %s\n", strerror (errno)) ;
 	}
 	else
 	{
-		data = wiringPiI2CRead( i2c_fd );
+		data = HAL_I2cRead( i2c_fd );
 	}
 	//data = wiringPiI2CRead( i2c_fd );
 //	data = wiringPiI2CReadReg8( i2c_fd, (U8)reg );
@@ -25,6 +25,7 @@ class Arduino
 	public:
 		Arduino();
 		bool Init( U8 i2c_addr );
+		void Close( void );
 		void SetReg( E_ARDUINO_REG reg, U8 val );
 		U8 GetReg( E_ARDUINO_REG reg );
 	private:
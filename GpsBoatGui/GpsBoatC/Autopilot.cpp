@@ -0,0 +1,1217 @@
+// Autopilot.cpp
+// One boat's nav loop and its state. See Autopilot.h.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include "includes.h"
+#include "Hal.h"
+#include "config.h" // defines I/O pins, operational parameters, etc.
+#include "HMC6343.h"
+#include "Autopilot.h"
+#include "Recorder.h"
+
+//-------------------------------------------
+// Local defines
+
+#define LED_PIN		2
+#define LED_ON		HAL_DigitalWrite (LED_PIN, HAL_HIGH) ;	// On
+#define LED_OFF		HAL_DigitalWrite (LED_PIN, HAL_LOW) ;	// Off
+
+typedef enum
+{
+  E_GO_LEFT,
+  E_GO_RIGHT,
+  E_GO_STRAIGHT
+} E_DIRECTION;
+
+#if DO_GPS_TEST
+#define NAV_STABLE_STATE	E_NAV_IDLE					// GPS test, no navigating
+#else
+#define NAV_STABLE_STATE	E_NAV_SET_NEXT_WAYPOINT
+#endif
+
+#define NAV_MAX_TRANSITIONS	3
+
+//-------------------------------------------
+// Local types
+
+typedef void (*tNAV_ACTION)( tAUTOPILOT *ptAp );
+typedef bool (*tNAV_GUARD)( tAUTOPILOT *ptAp );
+
+typedef struct
+{
+	tNAV_GUARD pfnGuard;		// NULL ends the list
+	E_NAV_STATE eTo;
+} tNAV_TRANSITION;
+
+// Each tick the state's guards are tried in order and the first that passes
+// is taken: its exit action, then the next state's entry action. That state's
+// guards are tried in turn, so a tick can pass through several. Then the state
+// it ends in gets its tick action.
+typedef struct
+{
+	E_NAV_STATE eState;			// its index, checked below
+	const char *pName;
+	bool bTracking;				// range and bearing to the target updated before its guards
+	tNAV_ACTION pfnEntry;		// NULL == none
+	tNAV_ACTION pfnTick;
+	tNAV_ACTION pfnExit;
+	tNAV_TRANSITION atTransition[NAV_MAX_TRANSITIONS];
+} tNAV_STATE_DEF;
+
+//-------------------------------------------
+// Local prototypes
+
+static void			*GpsThread( void *pArg );
+static void			Log( tAUTOPILOT *ptAp, const char *pFormat, ... );
+static void			Wait( tAUTOPILOT *ptAp, U32 ms );
+static bool			Waiting( tAUTOPILOT *ptAp );
+static E_DIRECTION	DirectionToBearing( float DestinationBearing, float CurrentBearing, float BearingTolerance );
+static void			SetSpeed( tAUTOPILOT *ptAp, int new_setting );
+static void			SetRudder( tAUTOPILOT *ptAp, int new_setting );
+static float		GetCompassHeading( tAUTOPILOT *ptAp, float declination );
+static void			UpdateRangeAndBearing( tAUTOPILOT *ptAp, int wp );
+static float		PathCourse( tAUTOPILOT *ptAp, double dAlong );
+static void			UpdatePosition( tAUTOPILOT *ptAp );
+static void			UpdateEstimate( tAUTOPILOT *ptAp );
+static void			RunStates( tAUTOPILOT *ptAp );
+static void			Charge( tAUTOPILOT *ptAp, E_NAV_STATE eState, struct timespec *ptFrom );
+
+// State actions
+static void			ExitInit( tAUTOPILOT *ptAp );
+static void			EnterStabilize( tAUTOPILOT *ptAp );
+static void			ExitStabilize( tAUTOPILOT *ptAp );
+static void			EnterSetNextWaypoint( tAUTOPILOT *ptAp );
+static void			TickStart( tAUTOPILOT *ptAp );
+static void			EnterRun( tAUTOPILOT *ptAp );
+static void			TickRun( tAUTOPILOT *ptAp );
+static void			ExitRun( tAUTOPILOT *ptAp );
+static void			EnterStop( tAUTOPILOT *ptAp );
+static void			EnterFenceBreach( tAUTOPILOT *ptAp );
+static void			TickFenceBreach( tAUTOPILOT *ptAp );
+static void			ExitResume( tAUTOPILOT *ptAp );
+
+// Guards
+static bool			Always( tAUTOPILOT *ptAp );
+static bool			Locked( tAUTOPILOT *ptAp );
+static bool			Unlocked( tAUTOPILOT *ptAp );
+static bool			Stable( tAUTOPILOT *ptAp );
+static bool			Breached( tAUTOPILOT *ptAp );
+static bool			TargetOutside( tAUTOPILOT *ptAp );
+static bool			BackInside( tAUTOPILOT *ptAp );
+static bool			OnBearing( tAUTOPILOT *ptAp );
+static bool			Arrived( tAUTOPILOT *ptAp );
+
+//-------------------------------------------
+// Local data
+
+// The nav state machine, indexed by E_NAV_STATE
+static constexpr tNAV_STATE_DEF gatNavState[E_NAV_MAX] =
+{
+	{ E_NAV_INIT,					"Init",						false,
+	  NULL,					NULL,				ExitInit,
+	  { { Always, E_NAV_WAIT_FOR_GPS_LOCK } } },
+	{ E_NAV_WAIT_FOR_GPS_LOCK,		"Wait for GPS Lock",		false,
+	  NULL,					NULL,				NULL,
+	  { { Locked, E_NAV_WAIT_FOR_GPS_STABLIZE } } },
+	{ E_NAV_WAIT_FOR_GPS_STABLIZE,	"Wait for GPS to Stabalize",	false,
+	  EnterStabilize,		NULL,				ExitStabilize,
+	  { { Stable, NAV_STABLE_STATE } } },
+	{ E_NAV_WAIT_FOR_GPS_RELOCK,	"Wait for GPS Relock",		false,
+	  NULL,					NULL,				ExitResume,
+	  { { Locked, E_NAV_START } } },
+	{ E_NAV_SET_NEXT_WAYPOINT,		"Set Next Waypoint",		false,
+	  EnterSetNextWaypoint,	NULL,				NULL,
+	  { { TargetOutside, E_NAV_FENCE_BREACH }, { Always, E_NAV_START } } },
+	{ E_NAV_START,					"Start",					true,
+	  NULL,					TickStart,			NULL,
+	  { { Breached, E_NAV_FENCE_BREACH }, { OnBearing, E_NAV_RUN } } },
+	{ E_NAV_RUN,					"Run",						true,
+	  EnterRun,				TickRun,			ExitRun,
+	  { { Breached, E_NAV_FENCE_BREACH }, { Unlocked, E_NAV_STOP }, { Arrived, E_NAV_SET_NEXT_WAYPOINT } } },
+	{ E_NAV_STOP,					"Stop",						false,
+	  EnterStop,			NULL,				NULL,
+	  { { Unlocked, E_NAV_WAIT_FOR_GPS_RELOCK }, { Always, E_NAV_IDLE } } },
+	{ E_NAV_IDLE,					"Idle",						false,
+	  NULL,					NULL,				NULL,
+	  { } },
+	{ E_NAV_FENCE_BREACH,			"Fence Breach",				false,
+	  EnterFenceBreach,		TickFenceBreach,	ExitResume,
+	  { { BackInside, E_NAV_START } } },
+};
+
+static constexpr bool NavTransitionsOk( E_NAV_STATE eState, int i )
+{
+	return i == NAV_MAX_TRANSITIONS || gatNavState[eState].atTransition[i].pfnGuard == NULL ||
+		(gatNavState[eState].atTransition[i].eTo != eState && NavTransitionsOk( eState, i + 1 ));
+}
+
+static constexpr bool NavTableOk( int i )
+{
+	return i == E_NAV_MAX ||
+		(gatNavState[i].eState == i && gatNavState[i].pName && NavTransitionsOk( (E_NAV_STATE)i, 0 ) && NavTableOk( i + 1 ));
+}
+
+static_assert( NavTableOk( 0 ), "Nav state table is out of order, unnamed or has a state going to itself" );
+
+//-----------------------------------------------------------------------------
+// The config.h ports and steering, a GPS thread, messages on stdout
+void AUTOPILOT_DefaultConfig( tAUTOPILOT_CONFIG *ptConfig )
+{
+	ptConfig->pGpsDevice = "/dev/ttyAMA0";
+	ptConfig->pCompassDevice = "/dev/ttyUSB0";
+	ptConfig->fBearingTolerance = DEGREES_TO_BEARING_TOLERANCE;
+	ptConfig->fSwitchDistance = SWITCH_WAYPOINT_DISTANCE;
+	ptConfig->eSteering = HELM_BANG_BANG ? E_STEER_BANG_BANG : E_STEER_PID;
+	ptConfig->eGuidance = NAV_PATH_FOLLOWING ? E_GUIDE_PATH : E_GUIDE_POINT;
+	ptConfig->ePosition = NAV_DEAD_RECKONING ? E_POS_PREDICT : E_POS_FIX;
+	ptConfig->tHelmGains.fKp = HELM_KP;
+	ptConfig->tHelmGains.fKi = HELM_KI;
+	ptConfig->tHelmGains.fKd = HELM_KD;
+	ptConfig->tHelmGains.fIntegralMax = HELM_INTEGRAL_MAX;
+	ptConfig->tHelmGains.fSlew = HELM_SLEW;
+	ptConfig->tHelmGains.fRateTau = HELM_RATE_TAU;
+	ptConfig->bGpsThread = true;
+	ptConfig->fpLog = stdout;
+}
+
+//-----------------------------------------------------------------------------
+// Powered off: no ports open, empty route and fence, nav state machine at
+// E_NAV_INIT. The route (and fence) go in before AUTOPILOT_Setup().
+void AUTOPILOT_Init( tAUTOPILOT *ptAp, const tAUTOPILOT_CONFIG *ptConfig )
+{
+	ptAp->tConfig = *ptConfig;
+
+	ptAp->eNavState = E_NAV_INIT;
+	ptAp->targetWP = 0;
+	ptAp->fInitialDist = 0.0;
+	HELM_Init( &ptAp->tHelm, &ptConfig->tHelmGains );
+	memset( &ptAp->tLeg, 0, sizeof(tENU_LEG) );
+	ptAp->legWP = -1;
+	ptAp->fCrossIntegral = 0.0;
+	ptAp->u32CrossMs = 0;
+	DR_Init( &ptAp->tDeadReckon, NAV_PREDICT_MAX_MS );
+	ptAp->u32WaitStart = 0;
+	ptAp->u32WaitMs = 0;
+	memset( &ptAp->tNavInfo, 0, sizeof(tNAV_INFO) );
+	ptAp->tNavInfo.nearestWP = -1;
+
+	ptAp->u32StateSince = 0;
+	memset( ptAp->atStateStats, 0, sizeof(ptAp->atStateStats) );
+	memset( ptAp->aau32Transitions, 0, sizeof(ptAp->aau32Transitions) );
+	ptAp->atStateStats[E_NAV_INIT].u32Entries = 1;
+
+	memset( &ptAp->tRoute, 0, sizeof(tROUTE) );
+	memset( &ptAp->tFence, 0, sizeof(tFENCE) );
+	memset( &ptAp->tGeoEngine, 0, sizeof(tGEO_ENGINE) );
+
+	ptAp->cGpsReader = GpsReader();
+	ptAp->cGps = TinyGPS();
+	memset( &ptAp->tGpsSnapshot, 0, sizeof(tGPS_SNAPSHOT) );
+	memset( &ptAp->tGpsInfo, 0, sizeof(tGPS_INFO) );
+	ptAp->u32LastFixSeq = 0;
+	ptAp->u32GpsFixTime = TinyGPS::GPS_INVALID_FIX_TIME;
+	ptAp->bGpsThread = false;
+
+	ptAp->compassFd = -1;
+	ptAp->cArduino = Arduino();
+}
+
+//-----------------------------------------------------------------------------
+// Opens the ports, tests the servos and starts the GPS thread (if the config
+// has one). Returns false if the GPS or compass can't be opened.
+bool AUTOPILOT_Setup( tAUTOPILOT *ptAp )
+{
+    LED_ON;
+
+	//-----------------------
+	Log( ptAp, "I/O Pins ... ");
+
+    HAL_PinMode(LED_PIN, HAL_OUTPUT);
+
+	Log( ptAp, "OK\n");
+
+#if USE_ARDUINO
+	//-----------------------
+	Log( ptAp, "Arduino ...\n");
+
+	ptAp->cArduino.Init( ARDUINO_I2C_ADDR );
+
+	Log( ptAp, "\tArduino version: 0x%X\n", ptAp->cArduino.GetReg( ARDUINO_REG_VERSION ) );
+
+    // Init servos
+	Log( ptAp, "Servo Test:\n");
+	ptAp->cArduino.SetReg( ARDUINO_REG_EXTRA_LED, 1 );
+
+	Log( ptAp, "Left ... ");
+    SetRudder( ptAp, RUDDER_FULL_LEFT );
+    HAL_Delay(1000);
+	Log( ptAp, "Center ... ");
+    SetRudder( ptAp, RUDDER_CENTER );
+    HAL_Delay(1000);
+	Log( ptAp, "Right ... ");
+    SetRudder( ptAp, RUDDER_FULL_RIGHT );
+    HAL_Delay(1000);
+	Log( ptAp, "Center ...\n");
+    SetRudder( ptAp, RUDDER_CENTER );
+    HAL_Delay(1000);
+
+	ptAp->cArduino.SetReg( ARDUINO_REG_EXTRA_LED, 0 );
+
+	Log( ptAp, "OK\n");
+#endif	// USE_ARDUINO
+
+	//-----------------------
+	Log( ptAp, "Geodesy ... ");
+
+	GEOENG_Init( &ptAp->tGeoEngine, GEO_ERROR_BOUND_M );
+
+	Log( ptAp, "OK\n");
+
+	//-----------------------
+	Log( ptAp, "GPS ...\n");
+
+	if (!ptAp->cGpsReader.Open (ptAp->tConfig.pGpsDevice, GPS_BAUD))
+	{
+		return false;
+	}
+
+	Log( ptAp, "\tComm port to GPS opened. GPS Baud: %i\n", GPS_BAUD);
+
+	if( ptAp->tConfig.bGpsThread )
+	{
+		if( !HAL_ThreadCreate( &ptAp->tGpsThread, GpsThread, ptAp ) )
+		{
+			return false;
+		}
+
+		ptAp->bGpsThread = true;
+	}
+
+	Log( ptAp, "OK\n");
+
+	//-----------------------
+	Log( ptAp, "Compass ... ");
+
+	if( (ptAp->compassFd = HMC6343_Setup( ptAp->tConfig.pCompassDevice )) < 0 )
+	{
+		return false;
+	}
+
+	Log( ptAp, "OK\n");
+
+    // Navigation state machine init
+    ptAp->eNavState = E_NAV_INIT;
+    ptAp->u32StateSince = HAL_Millis();
+
+    LED_OFF;
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// One pass of the nav loop
+void AUTOPILOT_Tick( tAUTOPILOT *ptAp )
+{
+    // **********************************
+    // Navigation State Machine variables
+    // **********************************
+    tNAV_INFO *ptNavInfo = &ptAp->tNavInfo;
+    const tGPS_INFO *ptGpsInfo = &ptAp->tGpsInfo;
+
+    // Set LED on
+    LED_ON;
+
+    // *******************************************
+    // Update cGps Data/Status
+	// This is updated by the GPS thread (or the owner),
+	// take one consistent copy of it for this pass
+    // *******************************************
+	GPSINFO_Read( &ptAp->tGpsSnapshot, &ptAp->tGpsInfo );
+
+	// **********************
+	// Update compass heading
+	// **********************
+
+//      if( ptGpsInfo->fmph > 3.0 )
+//      {
+//        current_heading = ptGpsInfo->fcourse;
+//      }
+//      else
+	{
+		ptNavInfo->current_heading = GetCompassHeading( ptAp, MAG_VAR );
+	}
+
+	// Dead reckon up to now, then lay any new fix against it
+	DR_Update( &ptAp->tDeadReckon, ptNavInfo->current_heading, HAL_Millis() );
+
+	// Project each new fix into the route's local frame and check the fence, once
+	if( ptGpsInfo->u32FixSeq != ptAp->u32LastFixSeq )
+	{
+		ptAp->u32LastFixSeq = ptGpsInfo->u32FixSeq;
+		UpdatePosition( ptAp );
+	}
+	UpdateEstimate( ptAp );
+
+	// ******************
+	// Main State Machine
+	// ******************
+	RunStates( ptAp );
+
+    // set the LED off
+    LED_OFF;
+}
+
+//-----------------------------------------------------------------------------
+// Waits up to timeout_ms (-1 == forever) for the GPS, and publishes the fix
+// if a sentence completed. The GPS thread's loop, or called by an owner that
+// runs without one (the simulator, as each burst is sent). Returns as
+// GpsReader::Read().
+int AUTOPILOT_ReadGps( tAUTOPILOT *ptAp, int timeout_ms )
+{
+    tGPS_INFO tGpsInfo = {0};
+    unsigned long fix_age;
+	U32 u32FixTime;
+	int status;
+
+	// *******************************
+	// Wait for GPS data on the serial input
+	// *******************************
+	if( (status = ptAp->cGpsReader.Read( &ptAp->cGps, timeout_ms )) <= 0 )
+	{
+		return status;
+	}
+
+	// ********************
+	// Process new cGps info
+	// ********************
+
+    // GPS Position
+    // retrieves +/- lat/long in 100000ths of a degree
+    ptAp->cGps.f_get_position( &tGpsInfo.flat, &tGpsInfo.flon, &fix_age);
+    // and in millionths of a degree for the fixed point nav math
+    ptAp->cGps.get_position( &tGpsInfo.lat, &tGpsInfo.lon );
+
+    if (fix_age == TinyGPS::GPS_INVALID_AGE)
+    {
+        tGpsInfo.bGpsLocked = false;
+    }
+    else
+    {
+        tGpsInfo.bGpsLocked = true;
+    }
+
+#if USE_GPS_TIME_INFO
+    // GPS Time
+    int year;
+    char month, day, hour, minute, second, hundredths;
+
+    ptAp->cGps.crack_datetime(&year, &month, &day, &hour, &minute, &second, &hundredths, &fix_age);
+    tGpsInfo.hour = hour;
+    tGpsInfo.minute = minute;
+    tGpsInfo.second = second;
+#endif // USE_GPS_TIME_INFO
+
+    // GPS Speed
+    tGpsInfo.fmph = ptAp->cGps.f_speed_mph(); // speed in miles/hr
+    tGpsInfo.fmps = ptAp->cGps.f_speed_mps();
+    if( tGpsInfo.fmps == TinyGPS::GPS_INVALID_F_SPEED )
+    {
+        tGpsInfo.fmps = 0.0;
+    }
+    // course in 100ths of a degree
+    tGpsInfo.fcourse = ptAp->cGps.f_course();
+
+	// When it was taken: before the burst it came in started
+	tGpsInfo.u32FixMs = ptAp->cGpsReader.BurstStart() - GPS_FIX_LATENCY_MS;
+
+	// Hand it to the readers, as a new fix only if a sentence brought a position
+	u32FixTime = ptAp->cGps.position_fix_time();
+	GPSINFO_Publish( &ptAp->tGpsSnapshot, &tGpsInfo, u32FixTime != ptAp->u32GpsFixTime );
+	ptAp->u32GpsFixTime = u32FixTime;
+	RECORDER_Fix( &tGpsInfo );
+
+	return status;
+}
+
+//-----------------------------------------------------------------------------
+// Stops the GPS thread and closes the ports, route and fence
+void AUTOPILOT_Close( tAUTOPILOT *ptAp )
+{
+	if( ptAp->bGpsThread )
+	{
+		// Blocked in poll(), a cancellation point
+		HAL_ThreadStop( ptAp->tGpsThread );
+		ptAp->bGpsThread = false;
+	}
+
+	ptAp->cGpsReader.Close();
+	ptAp->cArduino.Close();
+
+	if( ptAp->compassFd >= 0 )
+	{
+		HAL_SerialClose( ptAp->compassFd );
+		ptAp->compassFd = -1;
+	}
+
+	ROUTE_Close( &ptAp->tRoute );
+	FENCE_Close( &ptAp->tFence );
+}
+
+//-----------------------------------------------------------------------------
+const char *AUTOPILOT_StateName( E_NAV_STATE eState )
+{
+	return ((unsigned)eState < E_NAV_MAX) ? gatNavState[eState].pName : "?";
+}
+
+//-----------------------------------------------------------------------------
+const char *AUTOPILOT_SteeringName( E_STEERING eSteering )
+{
+	switch( eSteering )
+	{
+	case E_STEER_BANG_BANG:		return "bangbang";
+	case E_STEER_PID:			return "pid";
+	default:					return "?";
+	}
+}
+
+//-----------------------------------------------------------------------------
+const char *AUTOPILOT_GuidanceName( E_GUIDANCE eGuidance )
+{
+	switch( eGuidance )
+	{
+	case E_GUIDE_POINT:			return "point";
+	case E_GUIDE_PATH:			return "path";
+	default:					return "?";
+	}
+}
+
+//-----------------------------------------------------------------------------
+const char *AUTOPILOT_PositionName( E_POSITION ePosition )
+{
+	switch( ePosition )
+	{
+	case E_POS_FIX:				return "fix";
+	case E_POS_PREDICT:			return "predict";
+	default:					return "?";
+	}
+}
+
+//-----------------------------------------------------------------------------
+// ms spent in a state, the visit going on included
+U32 AUTOPILOT_StateTime( const tAUTOPILOT *ptAp, E_NAV_STATE eState )
+{
+	U32 u32Time = ptAp->atStateStats[eState].u32TimeMs;
+
+	if( eState == ptAp->eNavState )
+	{
+		u32Time += HAL_Millis() - ptAp->u32StateSince;
+	}
+
+	return u32Time;
+}
+
+//-----------------------------------------------------------------------------
+// Each state's profile, then the transitions taken
+void AUTOPILOT_PrintProfile( const tAUTOPILOT *ptAp, FILE *fp )
+{
+	const tNAV_STATE_STATS *ptStats;
+	int i;
+	int j;
+
+	fprintf( fp, "%-26s  entries    ticks     time s  cost us/tick   max us\n", "state" );
+
+	for( i = 0; i < E_NAV_MAX; i++ )
+	{
+		ptStats = &ptAp->atStateStats[i];
+
+		if( ptStats->u32Entries == 0 )
+		{
+			continue;
+		}
+
+		fprintf( fp, "%-26s %8lu %8lu %10.1f %13.2f %8lu\n", gatNavState[i].pName, ptStats->u32Entries,
+				 ptStats->u32Ticks, AUTOPILOT_StateTime( ptAp, (E_NAV_STATE)i ) / 1000.0,
+				 ptStats->u32Ticks ? ptStats->dCostUs / ptStats->u32Ticks : 0.0, ptStats->u32CostMaxUs );
+	}
+
+	fprintf( fp, "\n" );
+
+	for( i = 0; i < E_NAV_MAX; i++ )
+	{
+		for( j = 0; j < E_NAV_MAX; j++ )
+		{
+			if( ptAp->aau32Transitions[i][j] )
+			{
+				fprintf( fp, "%-26s > %-26s %6lu\n", gatNavState[i].pName, gatNavState[j].pName,
+						 ptAp->aau32Transitions[i][j] );
+			}
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Feeds the nav loop fixes as the GPS sends them
+void *GpsThread( void *pArg )
+{
+	tAUTOPILOT *ptAp = (tAUTOPILOT *)pArg;
+
+	Log( ptAp, "GPS thread started\n");
+
+	while( true )
+	{
+		// Port error, don't spin on it
+		if( AUTOPILOT_ReadGps( ptAp, -1 ) < 0 )
+		{
+			HAL_Delay( 1000 );
+		}
+	}
+
+	return NULL;
+}
+
+//-----------------------------------------------------------------------------
+// printf() to the config's log, if it has one
+void Log( tAUTOPILOT *ptAp, const char *pFormat, ... )
+{
+	va_list args;
+
+	if( !ptAp->tConfig.fpLog )
+	{
+		return;
+	}
+
+	va_start( args, pFormat );
+	vfprintf( ptAp->tConfig.fpLog, pFormat, args );
+	va_end( args );
+}
+
+//-----------------------------------------------------------------------------
+// Starts a state's wait, Waiting() until ms have gone. Nothing sleeps, the
+// state looks each tick.
+void Wait( tAUTOPILOT *ptAp, U32 ms )
+{
+	ptAp->u32WaitStart = HAL_Millis();
+	ptAp->u32WaitMs = ms;
+}
+
+//-----------------------------------------------------------------------------
+bool Waiting( tAUTOPILOT *ptAp )
+{
+	return HAL_Millis() - ptAp->u32WaitStart < ptAp->u32WaitMs;
+}
+
+//-----------------------------------------------------------------------------
+float GetCompassHeading( tAUTOPILOT *ptAp, float declination )
+{
+	S16 raw = HMC6343_GetHeading( ptAp->compassFd );
+	float heading = (float)raw / 10.0;
+
+    // If you have an EAST declination, use + declinationAngle, if you
+    // have a WEST declination, use - declinationAngle
+
+	heading -= declination;
+
+    // Correct for when signs are reversed.
+    if( heading < 0.0 )
+    {
+		heading += 360.0;
+    }
+
+    // Check for wrap due to addition of declination.
+    if( heading > 360.0 )
+    {
+    	heading -= 360.0;
+    }
+
+	RECORDER_Compass( raw, heading );
+
+	return heading;
+}
+
+//-----------------------------------------------------------------------------
+// Updates range (meters), bearing (degrees, North == 0), the course to steer,
+// cross and along track and hazards near the track to a waypoint from where
+// the boat is now, see UpdateEstimate(). Inside the local frame this is plane math on positions projected
+// once, and the leg from the waypoint before is worked out once for the
+// waypoint; outside it the geodesy engine picks the cheapest formula inside
+// GEO_ERROR_BOUND_M for the leg from the last fix, the boat steers straight
+// for the waypoint and hazards aren't checked.
+void UpdateRangeAndBearing( tAUTOPILOT *ptAp, int wp )
+{
+	tROUTE *ptRoute = &ptAp->tRoute;
+	tNAV_INFO *ptNavInfo = &ptAp->tNavInfo;
+	tENU_POS tWayPoint;
+	tENU_POS tLastWayPoint;
+	tGEOENG_POINT tBoat;
+	tGEOENG_RESULT tResult;
+	double dClosest = 0.0;
+	double dAlong;
+	double dCross;
+
+	// Copies, not pointers into the route's cache: a later lookup may reuse
+	// an earlier one's entry
+	tWayPoint = *ROUTE_GetEnu( ptRoute, wp );
+
+	if( ENU_InRange( &ptNavInfo->tEstimate ) && ENU_InRange( &tWayPoint ) )
+	{
+		if( ptAp->legWP != wp )
+		{
+			tLastWayPoint = *ROUTE_GetEnu( ptRoute, (wp + ptRoute->count - 1) % ptRoute->count );
+			ENU_SetLeg( &ptAp->tLeg, &tLastWayPoint, &tWayPoint );
+			ptAp->legWP = wp;
+		}
+
+		ENU_LegOffset( &ptAp->tLeg, &ptNavInfo->tEstimate, &dAlong, &dCross );
+
+		ptNavInfo->dist_to_waypoint = ENU_Distance( &ptNavInfo->tEstimate, &tWayPoint );
+		ptNavInfo->bear_to_waypoint = ENU_Bearing( &ptRoute->tFrame, &ptNavInfo->tEstimate, &tWayPoint );
+		ptNavInfo->cross_track = dCross;
+		ptNavInfo->along_track = dAlong;
+		ptNavInfo->course_to_steer = (ptAp->tConfig.eGuidance == E_GUIDE_PATH) ? PathCourse( ptAp, dAlong )
+																				  : ptNavInfo->bear_to_waypoint;
+		ptNavInfo->hazards = ROUTE_HazardsNearTrack( ptRoute, &ptNavInfo->tEstimate, &tWayPoint, HAZARD_CLEARANCE_M,
+													 NULL, 0, &dClosest );
+		ptNavInfo->hazard_dist = dClosest;
+		return;
+	}
+
+	// Only the boat's own trig is worked out here, the waypoint's is cached
+	GEOENG_SetPoint( &tBoat, ptAp->tGpsInfo.lat, ptAp->tGpsInfo.lon );
+	GEOENG_RangeAndBearing( &ptAp->tGeoEngine, &tBoat, ROUTE_GetEnginePoint( ptRoute, wp ), &tResult );
+
+	ptNavInfo->dist_to_waypoint = tResult.dDist;
+	ptNavInfo->bear_to_waypoint = tResult.dCourse;
+	ptNavInfo->course_to_steer = tResult.dCourse;
+	ptNavInfo->cross_track = 0.0;
+	ptNavInfo->along_track = 0.0;
+	ptNavInfo->hazards = 0;
+}
+
+//-----------------------------------------------------------------------------
+// E_GUIDE_PATH: the bearing to a point NAV_LOOKAHEAD_M further along the leg
+// than the boat, the waypoint itself over the last NAV_LOOKAHEAD_M. A boat
+// off the leg heads back onto it at a slant, not straight for the waypoint.
+// A current or wind that holds it off builds up fCrossIntegral, which moves
+// the point to the far side of the leg until the boat holds the leg,
+// fading out over the last NAV_LOOKAHEAD_M so the waypoint is still reached.
+float PathCourse( tAUTOPILOT *ptAp, double dAlong )
+{
+	const tENU_LEG *ptLeg = &ptAp->tLeg;
+	double dAim = min( max( dAlong, 0.0 ) + NAV_LOOKAHEAD_M, ptLeg->dLength );
+	double dShift = constrain( NAV_CROSS_TRACK_KI * ptAp->fCrossIntegral, -NAV_LOOKAHEAD_M / 2, NAV_LOOKAHEAD_M / 2 );
+	double dFade = constrain( (ptLeg->dLength - dAlong) / NAV_LOOKAHEAD_M, 0.0, 1.0 );
+	tENU_POS tAim;
+
+	ENU_LegPoint( ptLeg, dAim, -dShift * dFade, &tAim );
+
+	return ENU_Bearing( &ptAp->tRoute.tFrame, &ptAp->tNavInfo.tEstimate, &tAim );
+}
+
+//-----------------------------------------------------------------------------
+// Projects the last fix into the route's local frame, checks it against the
+// geofence, finds the waypoint nearest it and ties the dead reckoning down
+// to it
+void UpdatePosition( tAUTOPILOT *ptAp )
+{
+	const tGPS_INFO *ptGpsInfo = &ptAp->tGpsInfo;
+	U32 u32Dist = 0;
+
+	ENU_FromGeodetic( &ptAp->tRoute.tFrame, ptGpsInfo->lat, ptGpsInfo->lon, &ptAp->tNavInfo.tPosition );
+	FENCE_Check( &ptAp->tFence, &ptAp->tNavInfo.tPosition, &ptAp->tNavInfo.tFence );
+
+	ptAp->tNavInfo.nearestWP = ptGpsInfo->bGpsLocked ? ROUTE_Nearest( &ptAp->tRoute, ptGpsInfo->lat, ptGpsInfo->lon, &u32Dist ) : -1;
+	ptAp->tNavInfo.nearest_dist = u32Dist / 100.0;
+
+	if( ptGpsInfo->bGpsLocked )
+	{
+		DR_Fix( &ptAp->tDeadReckon, &ptAp->tNavInfo.tPosition, ptGpsInfo->fmps, ptGpsInfo->u32FixMs );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Where the boat is now: E_POS_PREDICT's dead reckoning from the last fix, or
+// the fix. The fence is only ever checked against fixes, a breach is one the
+// GPS saw.
+void UpdateEstimate( tAUTOPILOT *ptAp )
+{
+	tNAV_INFO *ptNavInfo = &ptAp->tNavInfo;
+	U32 u32Now = HAL_Millis();
+
+	ptNavInfo->fix_age = (S32)(u32Now - ptAp->tGpsInfo.u32FixMs) / 1000.0;
+
+	if( ptAp->tConfig.ePosition != E_POS_PREDICT ||
+		!DR_Estimate( &ptAp->tDeadReckon, u32Now, &ptNavInfo->tEstimate ) )
+	{
+		ptNavInfo->tEstimate = ptNavInfo->tPosition;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Gradually sets the new ESC speed setting unless its STOP
+// Assumes LOWER settings == faster
+void SetSpeed( tAUTOPILOT *ptAp, int new_setting )
+{
+	RECORDER_Setting( E_REC_SPEED, new_setting );
+
+#if USE_ARDUINO
+	ptAp->cArduino.SetReg( ARDUINO_REG_ESC, new_setting);
+#endif
+/*
+  int last_setting;
+  int step_and_dir;
+
+  if( new_setting == SPEED_STOP )
+  {
+    gEscServo.write( SPEED_STOP );
+    return;
+  }
+
+  // Get the last value written to the servo
+  last_setting = gEscServo.read();
+
+   // Which direction to go?
+  step_and_dir = (new_setting > last_setting) ? SPEED_STEP_SIZE : SPEED_STEP_SIZE * -1;
+
+  // Move to new setting gradually
+  for( ; (step_and_dir > 0 ) ? (last_setting < new_setting) : (last_setting > new_setting); last_setting += step_and_dir )
+  {
+    if( last_setting > SPEED_BACKUP )  // don't let servo setting go negative!
+    {
+      break;
+    }
+    gEscServo.write(last_setting);
+    HAL_Delay(SPEED_STEP_DELAY);
+  }
+*/
+}
+
+//-----------------------------------------------------------------------------
+// Gradually sets the new rudder position
+// Assums Right == Higher setting, Left == Lower setting
+void SetRudder( tAUTOPILOT *ptAp, int new_setting )
+{
+#if RUDDER_REVERSE
+	new_setting = 180 - new_setting;
+#endif
+
+	RECORDER_Setting( E_REC_RUDDER, new_setting );
+
+#if USE_ARDUINO
+	ptAp->cArduino.SetReg( ARDUINO_REG_STEERING, new_setting);
+#endif
+	return;
+/*
+	int last_setting;
+	int step_and_dir;
+
+  // Get the last value written to the servo
+  last_setting = gRudderServo.read();
+
+  // Which direction to go?
+  step_and_dir = (new_setting > last_setting) ? RUDDER_STEP_SIZE : RUDDER_STEP_SIZE * -1;
+
+  // Move to new setting gradually
+  for( ; (step_and_dir > 0 ) ? (last_setting < new_setting) : (last_setting > new_setting); last_setting += step_and_dir )
+  {
+    if( last_setting < 0 )  // don't let servo setting go negative!
+    {
+      break;
+    }
+    gRudderServo.write(last_setting);
+    HAL_Delay(RUDDER_STEP_DELAY);
+  }
+
+  // SoftSerial turns off interrupts and screws up the Servo lib! Need to detach!
+//  gRudderServo.detach();
+*/
+}
+
+//-----------------------------------------------------------------------------
+// One tick of the nav state machine, see tNAV_STATE_DEF. A chain of
+// transitions is cut short at E_NAV_MAX, the rest waits for the next tick.
+void RunStates( tAUTOPILOT *ptAp )
+{
+	const tNAV_STATE_DEF *ptDef;
+	const tNAV_TRANSITION *ptTransition;
+	E_NAV_STATE eFrom;
+	struct timespec tFrom;
+	U32 u32Now;
+	int hops;
+	int i;
+
+	clock_gettime( CLOCK_MONOTONIC, &tFrom );
+
+	for( hops = 0; hops < E_NAV_MAX; hops++ )
+	{
+		ptDef = &gatNavState[ptAp->eNavState];
+		ptTransition = NULL;
+
+		if( ptDef->bTracking )
+		{
+			UpdateRangeAndBearing( ptAp, ptAp->targetWP );
+		}
+
+		for( i = 0; i < NAV_MAX_TRANSITIONS && ptDef->atTransition[i].pfnGuard; i++ )
+		{
+			if( ptDef->atTransition[i].pfnGuard( ptAp ) )
+			{
+				ptTransition = &ptDef->atTransition[i];
+				break;
+			}
+		}
+
+		if( !ptTransition )
+		{
+			break;
+		}
+
+		if( ptDef->pfnExit )
+		{
+			ptDef->pfnExit( ptAp );
+		}
+
+		eFrom = ptAp->eNavState;
+		Charge( ptAp, eFrom, &tFrom );
+
+		u32Now = HAL_Millis();
+		ptAp->atStateStats[eFrom].u32TimeMs += u32Now - ptAp->u32StateSince;
+		ptAp->u32StateSince = u32Now;
+		ptAp->aau32Transitions[eFrom][ptTransition->eTo]++;
+		ptAp->atStateStats[ptTransition->eTo].u32Entries++;
+		ptAp->eNavState = ptTransition->eTo;
+
+		ptDef = &gatNavState[ptAp->eNavState];
+
+		if( ptDef->pfnEntry )
+		{
+			ptDef->pfnEntry( ptAp );
+		}
+
+		RECORDER_State( eFrom, ptAp->eNavState, ptAp->targetWP );
+	}
+
+	ptDef = &gatNavState[ptAp->eNavState];
+
+	if( ptDef->pfnTick )
+	{
+		ptDef->pfnTick( ptAp );
+	}
+
+	Charge( ptAp, ptAp->eNavState, &tFrom );
+}
+
+//-----------------------------------------------------------------------------
+// Adds the time since *ptFrom to a state's cost for this tick, and restarts
+// *ptFrom. The real clock, so the handlers are profiled on a virtual one too.
+void Charge( tAUTOPILOT *ptAp, E_NAV_STATE eState, struct timespec *ptFrom )
+{
+	tNAV_STATE_STATS *ptStats = &ptAp->atStateStats[eState];
+	struct timespec tNow;
+	double dCostUs;
+
+	clock_gettime( CLOCK_MONOTONIC, &tNow );
+
+	dCostUs = (tNow.tv_sec - ptFrom->tv_sec) * 1000000.0 + (tNow.tv_nsec - ptFrom->tv_nsec) / 1000.0;
+	*ptFrom = tNow;
+
+	ptStats->u32Ticks++;
+	ptStats->dCostUs += dCostUs;
+	ptStats->u32CostMaxUs = max( ptStats->u32CostMaxUs, (U32)ceil( dCostUs ) );
+}
+
+//-----------------------------------------------------------------------------
+// Initialize wheels, motors, rudder, comms, etc. Then the first way point.
+void ExitInit( tAUTOPILOT *ptAp )
+{
+	ptAp->targetWP = 0;
+}
+
+//-----------------------------------------------------------------------------
+void EnterStabilize( tAUTOPILOT *ptAp )
+{
+	Wait( ptAp, GPS_STABALIZE_LOCK_TIME * 1000 );
+}
+
+//-----------------------------------------------------------------------------
+void ExitStabilize( tAUTOPILOT *ptAp )
+{
+	if( ptAp->tRoute.bHomeAtLock )
+	{
+		// Save current GPS location as the "Home" waypoint
+		ROUTE_SetHome( &ptAp->tRoute, ptAp->tGpsInfo.lat, ptAp->tGpsInfo.lon );
+
+		// The frame moved with home, so the fence and the fix have to be projected again
+		FENCE_SetFrame( &ptAp->tFence, &ptAp->tRoute.tFrame );
+		UpdatePosition( ptAp );
+		UpdateEstimate( ptAp );
+		ptAp->legWP = -1;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// The waypoint after the one reached, or after any the boat is already at,
+// i.e. survey points closer together than the switch distance. Home, the
+// route's end, is never passed over.
+void EnterSetNextWaypoint( tAUTOPILOT *ptAp )
+{
+	const tROUTE *ptRoute = &ptAp->tRoute;
+	const tENU_POS *ptBoat = &ptAp->tNavInfo.tEstimate;
+	int wp = (ptAp->targetWP + 1) % ptRoute->count;
+
+	if( ENU_InRange( ptBoat ) )
+	{
+		while( wp != 0 && ROUTE_FirstWithin( ptRoute, ptBoat, ptAp->tConfig.fSwitchDistance, wp ) == wp )
+		{
+			Log( ptAp, "Already at waypoint %i\n", wp );
+			wp = (wp + 1) % ptRoute->count;
+		}
+	}
+
+	ptAp->targetWP = wp;
+}
+
+//-----------------------------------------------------------------------------
+// Use motors, rudder and compass to turn towards the waypoint. A turn is held
+// START_TURN_MS before it's looked at again. The waypoint itself, even
+// following the leg: turning on the spot swings the boat about too much to
+// chase a point NAV_LOOKAHEAD_M away, and Run brings it onto the leg.
+void TickStart( tAUTOPILOT *ptAp )
+{
+	if( Waiting( ptAp ) )
+	{
+		return;
+	}
+
+	// Which way to turn? Straight is OnBearing(), and the run.
+	switch( DirectionToBearing( ptAp->tNavInfo.bear_to_waypoint, ptAp->tNavInfo.current_heading, ptAp->tConfig.fBearingTolerance ) )
+	{
+	case E_GO_LEFT:
+		Log( ptAp, "Go LEFT\n");
+		SetRudder( ptAp, RUDDER_FULL_LEFT );
+		SetSpeed( ptAp, SPEED_25_PERCENT );
+		Wait( ptAp, START_TURN_MS );
+		break;
+	case E_GO_RIGHT:
+		Log( ptAp, "Go RIGHT\n");
+		SetRudder( ptAp, RUDDER_FULL_RIGHT );
+		SetSpeed( ptAp, SPEED_25_PERCENT );
+		Wait( ptAp, START_TURN_MS );
+		break;
+	default:
+		break;
+	}
+}
+
+//-----------------------------------------------------------------------------
+void EnterRun( tAUTOPILOT *ptAp )
+{
+	Log( ptAp, "Go STRAIGHT\n");
+	SetRudder( ptAp, RUDDER_CENTER );
+	SetSpeed( ptAp, SPEED_50_PERCENT );
+
+	HELM_Reset( &ptAp->tHelm );
+	ptAp->fCrossIntegral = 0.0;
+	ptAp->u32CrossMs = HAL_Millis();
+
+	// Initial distance to the waypoint, range and bearing are up to date
+	ptAp->fInitialDist = ptAp->tNavInfo.dist_to_waypoint;
+	Log( ptAp, "Distance to waypoint: %f\n", ptAp->tNavInfo.dist_to_waypoint);
+}
+
+//-----------------------------------------------------------------------------
+// Correct track to waypoint (if needed), with the helm or bang-bang
+void TickRun( tAUTOPILOT *ptAp )
+{
+	const tNAV_INFO *ptNavInfo = &ptAp->tNavInfo;
+	float bearing_tolerance;
+	E_DIRECTION eDirToGo;
+	U32 u32Now = HAL_Millis();
+
+	// Held off the leg, see PathCourse(). No more than can move its point.
+	if( ptAp->tConfig.eGuidance == E_GUIDE_PATH )
+	{
+		ptAp->fCrossIntegral = constrain( ptAp->fCrossIntegral + ptNavInfo->cross_track * (u32Now - ptAp->u32CrossMs) / 1000.0,
+										  -NAV_LOOKAHEAD_M / 2 / NAV_CROSS_TRACK_KI, NAV_LOOKAHEAD_M / 2 / NAV_CROSS_TRACK_KI );
+	}
+	ptAp->u32CrossMs = u32Now;
+
+	// Adjust bearing to target tolerance for more refined direction pointing
+	if( ptNavInfo->dist_to_waypoint <= (ptAp->fInitialDist * 0.10) )
+	{
+		bearing_tolerance = ptAp->tConfig.fBearingTolerance * 0.5;
+	}
+	else
+	{
+		bearing_tolerance = ptAp->tConfig.fBearingTolerance;
+	}
+
+	eDirToGo = DirectionToBearing( ptNavInfo->course_to_steer, ptNavInfo->current_heading, bearing_tolerance );
+
+	switch( ptAp->tConfig.eSteering )
+	{
+	case E_STEER_PID:
+		SetRudder( ptAp, HELM_Update( &ptAp->tHelm, ptNavInfo->course_to_steer, ptNavInfo->current_heading, u32Now ) );
+		break;
+	default:
+		switch( eDirToGo )
+		{
+		case E_GO_LEFT:
+			SetRudder( ptAp, RUDDER_LEFT );
+			break;
+		case E_GO_RIGHT:
+			SetRudder( ptAp, RUDDER_RIGHT );
+			break;
+		case E_GO_STRAIGHT:
+			SetRudder( ptAp, RUDDER_CENTER );
+			break;
+		}
+		break;
+	}
+
+	// Full speed once on the bearing
+	if( eDirToGo == E_GO_STRAIGHT )
+	{
+		SetSpeed( ptAp, SPEED_100_PERCENT );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Whatever ended the run, the motor stops
+void ExitRun( tAUTOPILOT *ptAp )
+{
+	SetSpeed( ptAp, SPEED_STOP );
+}
+
+//-----------------------------------------------------------------------------
+// Stop navigation and wait to resume
+void EnterStop( tAUTOPILOT *ptAp )
+{
+	SetSpeed( ptAp, SPEED_STOP );
+}
+
+//-----------------------------------------------------------------------------
+// A fence breach stops the boat wherever it was headed
+void EnterFenceBreach( tAUTOPILOT *ptAp )
+{
+	SetSpeed( ptAp, SPEED_STOP );
+	SetRudder( ptAp, RUDDER_CENTER );
+}
+
+//-----------------------------------------------------------------------------
+// Motor off until the boat is back inside (drifted, towed) and so is its waypoint
+void TickFenceBreach( tAUTOPILOT *ptAp )
+{
+	SetSpeed( ptAp, SPEED_STOP );
+}
+
+//-----------------------------------------------------------------------------
+// Back from a stop, GPS lost or fence breached: the boat may have been
+// carried on along the route meanwhile, so it carries on from the leg it's
+// on now, never one behind it, as long as that leg's waypoint is inside
+// the fence
+void ExitResume( tAUTOPILOT *ptAp )
+{
+	tFENCE_STATUS tTargetFence;
+	int wp = ROUTE_Leg( &ptAp->tRoute, ptAp->tGpsInfo.lat, ptAp->tGpsInfo.lon, ptAp->targetWP );
+
+	if( wp != ptAp->targetWP && !FENCE_Check( &ptAp->tFence, ROUTE_GetEnu( &ptAp->tRoute, wp ), &tTargetFence ) )
+	{
+		Log( ptAp, "Resuming on the leg to waypoint %i\n", wp );
+		ptAp->targetWP = wp;
+	}
+}
+
+//-----------------------------------------------------------------------------
+bool Always( tAUTOPILOT *ptAp )
+{
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+bool Locked( tAUTOPILOT *ptAp )
+{
+	return ptAp->tGpsInfo.bGpsLocked;
+}
+
+//-----------------------------------------------------------------------------
+bool Unlocked( tAUTOPILOT *ptAp )
+{
+	return !ptAp->tGpsInfo.bGpsLocked;
+}
+
+//-----------------------------------------------------------------------------
+bool Stable( tAUTOPILOT *ptAp )
+{
+	return !Waiting( ptAp );
+}
+
+//-----------------------------------------------------------------------------
+bool Breached( tAUTOPILOT *ptAp )
+{
+	return ptAp->tNavInfo.tFence.bBreach;
+}
+
+//-----------------------------------------------------------------------------
+// Never head for a waypoint outside the fence, i.e. a typo in config.h
+bool TargetOutside( tAUTOPILOT *ptAp )
+{
+	tFENCE_STATUS tTargetFence;
+
+	return FENCE_Check( &ptAp->tFence, ROUTE_GetEnu( &ptAp->tRoute, ptAp->targetWP ), &tTargetFence );
+}
+
+//-----------------------------------------------------------------------------
+bool BackInside( tAUTOPILOT *ptAp )
+{
+	return !Breached( ptAp ) && !TargetOutside( ptAp );
+}
+
+//-----------------------------------------------------------------------------
+// Pointed at the waypoint, once a turn's been held
+bool OnBearing( tAUTOPILOT *ptAp )
+{
+	return !Waiting( ptAp ) && E_GO_STRAIGHT == DirectionToBearing( ptAp->tNavInfo.bear_to_waypoint,
+			ptAp->tNavInfo.current_heading, ptAp->tConfig.fBearingTolerance );
+}
+
+//-----------------------------------------------------------------------------
+// Are we there yet?
+bool Arrived( tAUTOPILOT *ptAp )
+{
+	return ptAp->tNavInfo.dist_to_waypoint <= ptAp->tConfig.fSwitchDistance;
+}
+
+//-----------------------------------------------------------------------------
+E_DIRECTION DirectionToBearing( float DestinationBearing, float CurrentBearing, float BearingTolerance )
+{
+	E_DIRECTION eDirToGo;
+	float Diff = DestinationBearing - CurrentBearing;
+	float AbsDiff = abs(Diff);
+	bool bNeg = (Diff < 0);
+	bool bBig = (AbsDiff > 180.0);
+
+	if( AbsDiff <= BearingTolerance )
+	{
+		// We're with-in a few degrees of the target. Just go straight!
+		eDirToGo = E_GO_STRAIGHT;
+	}
+	else
+	{
+		if( !bNeg && !bBig )
+		  eDirToGo = E_GO_RIGHT;
+		if( !bNeg && bBig )
+		  eDirToGo = E_GO_LEFT;
+		if( bNeg && !bBig )
+		  eDirToGo = E_GO_LEFT;
+		if( bNeg && bBig )
+		  eDirToGo = E_GO_RIGHT;
+	}
+
+	return eDirToGo;
+}
@@ -0,0 +1,193 @@
+// Autopilot.h
+// One boat's nav loop and everything it keeps: its GPS, compass and servo
+// ports, route, fence and nav state machine. Nothing is global, so a process
+// can run as many as it likes (simboat runs one per mission, on a thread
+// each). gpsboat is one of them plus the status screen.
+//
+//   AUTOPILOT_Init()         config, empty route and fence
+//   load tRoute (and tFence) as main.cpp does
+//   AUTOPILOT_Setup()        ports, servo test, GPS thread, after the
+//                            process's one HAL_Init()
+//   AUTOPILOT_Tick()         one pass of the nav loop, CONTROL_RATE_HZ times a
+//                            second (see Sched.h)
+//
+// AUTOPILOT_Tick() only touches its own tAUTOPILOT. Each one is ticked from
+// one thread; its GPS thread, if started, shares only tGpsSnapshot with it.
+// A tick never sleeps out a state's wait, the state looks at the clock each
+// tick instead, so the rate holds whatever state the boat is in.
+//
+// The nav states are one table in Autopilot.cpp: each state's name, entry,
+// tick and exit actions and its guarded transitions. Each state keeps its
+// entries, ticks, time in it and what its handlers cost, and each transition
+// a count; AUTOPILOT_PrintProfile() lists them.
+
+#ifndef AUTOPILOT_H
+#define AUTOPILOT_H
+
+#include <stdio.h>
+#include "includes.h"
+#include "Hal.h"
+#include "TinyGPS.h"
+#include "GpsReader.h"
+#include "GpsInfo.h"
+#include "Route.h"
+#include "GeoEngine.h"
+#include "LocalFrame.h"
+#include "Geofence.h"
+#include "Helm.h"
+#include "DeadReckon.h"
+#include "Arduino.h"
+
+//-------------------------------------------
+// Global defines
+
+// Program State Machine states
+typedef enum
+{
+    E_NAV_INIT,
+    E_NAV_WAIT_FOR_GPS_LOCK,    // progresses to E_NAV_SET_NEXT_WAYPOINT
+    E_NAV_WAIT_FOR_GPS_STABLIZE,
+    E_NAV_WAIT_FOR_GPS_RELOCK,  // resumes navigation state to E_NAV_START if GPS loses lock
+    E_NAV_SET_NEXT_WAYPOINT,
+    E_NAV_START,
+    E_NAV_RUN,
+    E_NAV_STOP,
+    E_NAV_IDLE,
+    E_NAV_FENCE_BREACH,         // stopped outside the geofence, or the waypoint is
+
+    E_NAV_MAX
+} E_NAV_STATE;
+
+// How E_NAV_RUN steers for the waypoint
+typedef enum
+{
+	E_STEER_BANG_BANG,			// full left, full right or center
+	E_STEER_PID,				// the helm, see Helm.h
+
+	E_STEER_MAX
+} E_STEERING;
+
+// What E_NAV_RUN steers for
+typedef enum
+{
+	E_GUIDE_POINT,				// straight at the waypoint
+	E_GUIDE_PATH,				// along the leg from the last waypoint, NAV_LOOKAHEAD_M ahead
+
+	E_GUIDE_MAX
+} E_GUIDANCE;
+
+// Where the nav loop takes the boat to be
+typedef enum
+{
+	E_POS_FIX,					// the last fix, as it came
+	E_POS_PREDICT,				// the last fix carried forward to now, see DeadReckon.h
+
+	E_POS_MAX
+} E_POSITION;
+
+// One state's profile. Cost is real time, even on a virtual clock.
+typedef struct
+{
+	U32 u32Entries;
+	U32 u32Ticks;				// its handlers ran in, passing through counts
+	U32 u32TimeMs;				// in it, visits over, HAL_Millis()
+	double dCostUs;				// guards, actions, all ticks
+	U32 u32CostMaxUs;			// one tick's
+} tNAV_STATE_STATS;
+
+typedef struct
+{
+	float dist_to_waypoint;
+	float bear_to_waypoint;
+	float course_to_steer;		// the guidance's, bear_to_waypoint or along the leg
+	float cross_track;			// meters off the leg to the waypoint, + == right
+	float along_track;			// meters along it from the last waypoint
+	float current_heading;
+	tENU_POS tPosition;			// last fix in the route's local frame
+	tENU_POS tEstimate;			// where the boat is now, range, bearing and track are from it
+	float fix_age;				// seconds since the last fix was taken
+	int nearestWP;				// to the last fix, home included, -1 == not known
+	float nearest_dist;			// meters from the last fix to it
+	int hazards;				// hazards within HAZARD_CLEARANCE_M of the track to the waypoint
+	float hazard_dist;			// meters from the track to the closest of them
+	tFENCE_STATUS tFence;		// last fix against the geofence
+} tNAV_INFO;
+
+typedef struct
+{
+	const char *pGpsDevice;		// i.e. "/dev/ttyAMA0"
+	const char *pCompassDevice;	// SC18IM700 bridge, i.e. "/dev/ttyUSB0"
+	float fBearingTolerance;	// DEGREES_TO_BEARING_TOLERANCE
+	float fSwitchDistance;		// SWITCH_WAYPOINT_DISTANCE
+	E_STEERING eSteering;		// HELM_BANG_BANG or the helm
+	E_GUIDANCE eGuidance;		// NAV_PATH_FOLLOWING or point to point
+	E_POSITION ePosition;		// NAV_DEAD_RECKONING or the fix
+	tHELM_GAINS tHelmGains;		// HELM_KP etc.
+	bool bGpsThread;			// false == the owner calls AUTOPILOT_ReadGps() itself
+	FILE *fpLog;				// setup and nav messages, NULL == none
+} tAUTOPILOT_CONFIG;
+
+typedef struct
+{
+	tAUTOPILOT_CONFIG tConfig;
+
+	// Navigation state machine
+	E_NAV_STATE eNavState;
+	int targetWP;
+	float fInitialDist;			// to the target when the boat straightened up for it
+	tHELM tHelm;				// E_STEER_PID's, reset for each run
+	tENU_LEG tLeg;				// to targetWP, from the waypoint before
+	int legWP;					// tLeg's target, -1 == none
+	float fCrossIntegral;		// E_GUIDE_PATH's, meter seconds, reset for each run
+	U32 u32CrossMs;				// when it was last added to
+	tDEAD_RECKON tDeadReckon;	// E_POS_PREDICT's
+	U32 u32WaitStart;			// a state's wait, HAL_Millis(), see Waiting()
+	U32 u32WaitMs;
+	tNAV_INFO tNavInfo;
+
+	// Nav state machine profile
+	U32 u32StateSince;			// HAL_Millis() eNavState was entered
+	tNAV_STATE_STATS atStateStats[E_NAV_MAX];
+	U32 aau32Transitions[E_NAV_MAX][E_NAV_MAX];		// [from][to]
+
+	// Way points to navigate to, and the operating area (empty unless loaded)
+	tROUTE tRoute;
+	tFENCE tFence;
+
+	// Range and bearing math, with its per tier stats
+	tGEO_ENGINE tGeoEngine;
+
+	// GPS info is published to tGpsSnapshot, the nav loop takes a consistent
+	// copy of it into tGpsInfo once per pass
+	GpsReader cGpsReader;
+	TinyGPS cGps;
+	tGPS_SNAPSHOT tGpsSnapshot;
+	tGPS_INFO tGpsInfo;
+	U32 u32LastFixSeq;			// last fix projected and fence checked
+	U32 u32GpsFixTime;			// cGps.position_fix_time() last published, the GPS thread's
+	tHAL_THREAD tGpsThread;
+	bool bGpsThread;			// running
+
+	// Compass port, Arduino on I2C bus
+	int compassFd;
+	Arduino cArduino;
+} tAUTOPILOT;
+
+//-------------------------------------------
+// Function prototypes
+
+void	AUTOPILOT_DefaultConfig( tAUTOPILOT_CONFIG *ptConfig );
+void	AUTOPILOT_Init( tAUTOPILOT *ptAp, const tAUTOPILOT_CONFIG *ptConfig );
+bool	AUTOPILOT_Setup( tAUTOPILOT *ptAp );
+void	AUTOPILOT_Tick( tAUTOPILOT *ptAp );
+int		AUTOPILOT_ReadGps( tAUTOPILOT *ptAp, int timeout_ms );
+void	AUTOPILOT_Close( tAUTOPILOT *ptAp );
+
+const char *AUTOPILOT_StateName( E_NAV_STATE eState );
+const char *AUTOPILOT_SteeringName( E_STEERING eSteering );
+const char *AUTOPILOT_GuidanceName( E_GUIDANCE eGuidance );
+const char *AUTOPILOT_PositionName( E_POSITION ePosition );
+U32		AUTOPILOT_StateTime( const tAUTOPILOT *ptAp, E_NAV_STATE eState );
+void	AUTOPILOT_PrintProfile( const tAUTOPILOT *ptAp, FILE *fp );
+
+#endif
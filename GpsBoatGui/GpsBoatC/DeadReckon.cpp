@@ -0,0 +1,118 @@
+// DeadReckon.cpp
+// Last fix carried forward on heading and speed. See DeadReckon.h.
+
+#include <string.h>
+#include <math.h>
+#include "DeadReckon.h"
+
+//-------------------------------------------
+// Local prototypes
+
+static void			TrackAt( const tDEAD_RECKON *ptDr, U32 u32Ms, tENU_POS *ptPos );
+
+//-----------------------------------------------------------------------------
+void DR_Init( tDEAD_RECKON *ptDr, U32 u32MaxAgeMs )
+{
+	memset( ptDr, 0, sizeof(tDEAD_RECKON) );
+
+	ptDr->u32MaxAgeMs = u32MaxAgeMs;
+}
+
+//-----------------------------------------------------------------------------
+// Extends the track to u32NowMs on fHeading (degrees true) at the last fix's
+// speed
+void DR_Update( tDEAD_RECKON *ptDr, float fHeading, U32 u32NowMs )
+{
+	const tDR_POINT *ptLast = &ptDr->atTrack[ptDr->newest];
+	tDR_POINT tNext = { u32NowMs, { 0.0, 0.0 } };
+	double dMeters;
+
+	if( ptDr->count > 0 )
+	{
+		if( u32NowMs == ptLast->u32Ms )
+		{
+			return;
+		}
+
+		dMeters = ptDr->fSpeed * (U32)(u32NowMs - ptLast->u32Ms) / 1000.0;
+		tNext.tPos.dEast = ptLast->tPos.dEast + dMeters * sin( fHeading * DEG_TO_RAD );
+		tNext.tPos.dNorth = ptLast->tPos.dNorth + dMeters * cos( fHeading * DEG_TO_RAD );
+	}
+
+	ptDr->newest = (ptDr->newest + 1) % DR_HISTORY;
+	ptDr->atTrack[ptDr->newest] = tNext;
+	ptDr->count = min( ptDr->count + 1, DR_HISTORY );
+}
+
+//-----------------------------------------------------------------------------
+// A fix taken at u32FixMs, and the speed over the ground (m/s) it came with
+void DR_Fix( tDEAD_RECKON *ptDr, const tENU_POS *ptFix, float fSpeed, U32 u32FixMs )
+{
+	tENU_POS tThen;
+
+	TrackAt( ptDr, u32FixMs, &tThen );
+
+	ptDr->tOffset.dEast = ptFix->dEast - tThen.dEast;
+	ptDr->tOffset.dNorth = ptFix->dNorth - tThen.dNorth;
+	ptDr->u32FixMs = u32FixMs;
+	ptDr->fSpeed = fSpeed;
+	ptDr->bFix = true;
+}
+
+//-----------------------------------------------------------------------------
+// Where the boat is at u32NowMs, false before the first fix
+bool DR_Estimate( const tDEAD_RECKON *ptDr, U32 u32NowMs, tENU_POS *ptPos )
+{
+	tENU_POS tTrack;
+
+	if( !ptDr->bFix )
+	{
+		return false;
+	}
+
+	if( (S32)(u32NowMs - ptDr->u32FixMs) > (S32)ptDr->u32MaxAgeMs )
+	{
+		u32NowMs = ptDr->u32FixMs + ptDr->u32MaxAgeMs;
+	}
+
+	TrackAt( ptDr, u32NowMs, &tTrack );
+
+	ptPos->dEast = tTrack.dEast + ptDr->tOffset.dEast;
+	ptPos->dNorth = tTrack.dNorth + ptDr->tOffset.dNorth;
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// The track at u32Ms, between the points either side of it. Before the oldest
+// it's the oldest, after the newest the newest.
+void TrackAt( const tDEAD_RECKON *ptDr, U32 u32Ms, tENU_POS *ptPos )
+{
+	const tDR_POINT *ptAfter = &ptDr->atTrack[ptDr->newest];
+	const tDR_POINT *ptBefore;
+	double dFraction;
+	int i;
+
+	if( ptDr->count == 0 || (S32)(u32Ms - ptAfter->u32Ms) >= 0 )
+	{
+		*ptPos = ptAfter->tPos;
+		return;
+	}
+
+	for( i = 1; i < ptDr->count; i++ )
+	{
+		ptBefore = &ptDr->atTrack[(ptDr->newest + DR_HISTORY - i) % DR_HISTORY];
+
+		if( (S32)(u32Ms - ptBefore->u32Ms) >= 0 )
+		{
+			dFraction = (double)(U32)(u32Ms - ptBefore->u32Ms) / (U32)(ptAfter->u32Ms - ptBefore->u32Ms);
+			ptPos->dEast = ptBefore->tPos.dEast + dFraction * (ptAfter->tPos.dEast - ptBefore->tPos.dEast);
+			ptPos->dNorth = ptBefore->tPos.dNorth + dFraction * (ptAfter->tPos.dNorth - ptBefore->tPos.dNorth);
+			return;
+		}
+
+		ptAfter = ptBefore;
+	}
+
+	*ptPos = ptAfter->tPos;
+}
@@ -0,0 +1,59 @@
+// DeadReckon.h
+// Where the boat is now, not where it was at the last fix. The GPS gives a
+// fix a second, already a few hundred ms old when the last of it is read at
+// 4800 baud; the compass is read every tick. Between fixes the boat's track
+// is dead reckoned from the compass heading and the GPS speed, and each fix
+// ties it down: the offset between the fix and where the track had the boat
+// when the fix was taken is added to the track from then on.
+//
+//   DR_Init( &tDr, NAV_PREDICT_MAX_MS );
+//   each tick:
+//       DR_Update( &tDr, heading, HAL_Millis() );
+//       a new fix:  DR_Fix( &tDr, &tFixPos, tGpsInfo.fmps, tGpsInfo.u32FixMs );
+//       DR_Estimate( &tDr, HAL_Millis(), &tPos );
+//
+// Because the track is kept, the fix is laid against where the boat was when
+// it was taken, turns made since included, not against where it is. The
+// track runs on the heading, so current, leeway and compass bias are only
+// made up for at the next fix. Positions are in the route's local frame.
+
+#ifndef DEADRECKON_H
+#define DEADRECKON_H
+
+#include "includes.h"
+#include "LocalFrame.h"
+
+//-------------------------------------------
+// Global defines
+
+// Track points kept, 3.2 s at CONTROL_RATE_HZ. A fix older than that is laid
+// against the oldest.
+#define DR_HISTORY			64
+
+typedef struct
+{
+	U32 u32Ms;					// HAL_Millis()
+	tENU_POS tPos;				// heading and speed alone, from wherever it began
+} tDR_POINT;
+
+typedef struct
+{
+	U32 u32MaxAgeMs;			// carried no further past the fix than this
+	tDR_POINT atTrack[DR_HISTORY];		// a ring
+	int newest;
+	int count;
+	bool bFix;
+	U32 u32FixMs;
+	float fSpeed;				// m/s over the ground, the last fix's
+	tENU_POS tOffset;			// last fix less the track when it was taken
+} tDEAD_RECKON;
+
+//-------------------------------------------
+// Function prototypes
+
+void	DR_Init( tDEAD_RECKON *ptDr, U32 u32MaxAgeMs );
+void	DR_Update( tDEAD_RECKON *ptDr, float fHeading, U32 u32NowMs );
+void	DR_Fix( tDEAD_RECKON *ptDr, const tENU_POS *ptFix, float fSpeed, U32 u32FixMs );
+bool	DR_Estimate( const tDEAD_RECKON *ptDr, U32 u32NowMs, tENU_POS *ptPos );
+
+#endif
@@ -0,0 +1,334 @@
+// GeoEngine.cpp
+// Tiered range and bearing on the WGS84 ellipsoid. See GeoEngine.h for the
+// tiers and their error bounds.
+
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include "GeoEngine.h"
+
+//-------------------------------------------
+// WGS84
+
+#define WGS84_A			6378137.0
+#define WGS84_F			(1.0 / 298.257223563)
+#define WGS84_B			(WGS84_A * (1.0 - WGS84_F))
+#define WGS84_E2		(WGS84_F * (2.0 - WGS84_F))
+
+// Mean radius used by the tier error bounds
+#define GEO_MEAN_R		6371008.8
+
+#define VINCENTY_MAX_ITERATIONS	100
+#define VINCENTY_TOLERANCE		1e-12	// radians, ~0.006 mm
+
+#define RADIANS_PER_MILLIONTH	(M_PI / 180000000.0)
+#define DEGREES_PER_RADIAN		(180.0 / M_PI)
+
+//-------------------------------------------
+// Local prototypes
+
+static void		Flat( const tGEOENG_POINT *ptFrom, const tGEOENG_POINT *ptTo, double *pdDist, double *pdAz );
+static void		Sphere( const tGEOENG_POINT *ptFrom, const tGEOENG_POINT *ptTo, double *pdDist, double *pdAz );
+static bool		Vincenty( const tGEOENG_POINT *ptFrom, const tGEOENG_POINT *ptTo, double *pdDist, double *pdAz );
+static double	WrapLon( double dLon );
+static void		MidLatitude( const tGEOENG_POINT *ptFrom, const tGEOENG_POINT *ptTo, double *pdSin, double *pdCos );
+static uint64_t	Nanos( void );
+
+//-----------------------------------------------------------------------------
+void GEOENG_Init( tGEO_ENGINE *ptEngine, double dErrorBound )
+{
+	ptEngine->dErrorBound = dErrorBound;
+	GEOENG_ResetStats( ptEngine );
+}
+
+//-----------------------------------------------------------------------------
+void GEOENG_ResetStats( tGEO_ENGINE *ptEngine )
+{
+	memset( &ptEngine->tStats, 0, sizeof(tGEOENG_STATS) );
+}
+
+//-----------------------------------------------------------------------------
+const char *GEOENG_TierName( E_GEO_TIER eTier )
+{
+	switch( eTier )
+	{
+	case E_GEO_TIER_FLAT:		return "flat";
+	case E_GEO_TIER_SPHERE:		return "sphere";
+	case E_GEO_TIER_ELLIPSOID:	return "ellipsoid";
+	default:					return "?";
+	}
+}
+
+//-----------------------------------------------------------------------------
+// lat/lon in millionths of a degree
+void GEOENG_SetPoint( tGEOENG_POINT *ptPoint, long lat, long lon )
+{
+	double dTanU;
+
+	ptPoint->dLat = lat * RADIANS_PER_MILLIONTH;
+	ptPoint->dLon = lon * RADIANS_PER_MILLIONTH;
+	ptPoint->dSinLat = sin( ptPoint->dLat );
+	ptPoint->dCosLat = cos( ptPoint->dLat );
+
+	dTanU = (1.0 - WGS84_F) * tan( ptPoint->dLat );
+	ptPoint->dCosU = 1.0 / sqrt( 1.0 + dTanU * dTanU );
+	ptPoint->dSinU = dTanU * ptPoint->dCosU;
+}
+
+//-----------------------------------------------------------------------------
+// Tries the tiers cheapest first, stopping at the first whose error bound for
+// this leg length is inside the engine's bound. Returns the tier used.
+E_GEO_TIER GEOENG_RangeAndBearing( tGEO_ENGINE *ptEngine, const tGEOENG_POINT *ptFrom, const tGEOENG_POINT *ptTo,
+								   tGEOENG_RESULT *ptResult )
+{
+	uint64_t u64Start = Nanos();
+	double dDist;
+	double dAz;
+	double dD3R2;
+	double dSin2;
+	double dTan2;
+	double dError;
+	E_GEO_TIER eTier;
+
+	// Flat first, it also gives the leg length the other bounds need
+	Flat( ptFrom, ptTo, &dDist, &dAz );
+
+	dD3R2 = dDist * dDist * dDist / (GEO_MEAN_R * GEO_MEAN_R);
+	// tan^2 of the end nearer a pole
+	dSin2 = fmax( ptFrom->dSinLat * ptFrom->dSinLat, ptTo->dSinLat * ptTo->dSinLat );
+	dTan2 = dSin2 / (1.0 - dSin2 + 1e-12);
+	dError = (1.0 + 2.0 * dTan2) * dD3R2 / 24.0;
+	eTier = E_GEO_TIER_FLAT;
+
+	if( dError > ptEngine->dErrorBound )
+	{
+		dError = dD3R2 / 300.0;
+
+		if( dError <= ptEngine->dErrorBound )
+		{
+			Sphere( ptFrom, ptTo, &dDist, &dAz );
+			eTier = E_GEO_TIER_SPHERE;
+		}
+		else if( Vincenty( ptFrom, ptTo, &dDist, &dAz ) )
+		{
+			dError = 0.001;
+			eTier = E_GEO_TIER_ELLIPSOID;
+		}
+		else
+		{
+			Sphere( ptFrom, ptTo, &dDist, &dAz );
+			eTier = E_GEO_TIER_SPHERE;
+			ptEngine->tStats.u32Fallbacks++;
+		}
+	}
+
+	dAz *= DEGREES_PER_RADIAN;
+	if( dAz < 0.0 )
+	{
+		dAz += 360.0;
+	}
+
+	ptResult->dDist = dDist;
+	ptResult->dCourse = dAz;
+	ptResult->dError = dError;
+	ptResult->eTier = eTier;
+
+	ptEngine->tStats.au32Calls[eTier]++;
+	ptEngine->tStats.au64Nanos[eTier] += Nanos() - u64Start;
+	ptEngine->tStats.eLastTier = eTier;
+
+	return eTier;
+}
+
+//-----------------------------------------------------------------------------
+// sin/cos of the mid latitude from the cached ends, without calling libm.
+// Half the latitude difference is small wherever the flat/sphere tiers are
+// used, so a short series for its sin/cos is exact to double precision.
+void MidLatitude( const tGEOENG_POINT *ptFrom, const tGEOENG_POINT *ptTo, double *pdSin, double *pdCos )
+{
+	double h = 0.5 * (ptTo->dLat - ptFrom->dLat);
+	double h2 = h * h;
+	double dSinH = h * (1.0 - h2 / 6.0 * (1.0 - h2 / 20.0));
+	double dCosH = 1.0 - h2 / 2.0 * (1.0 - h2 / 12.0);
+
+	*pdSin = ptFrom->dSinLat * dCosH + ptFrom->dCosLat * dSinH;
+	*pdCos = ptFrom->dCosLat * dCosH - ptFrom->dSinLat * dSinH;
+}
+
+//-----------------------------------------------------------------------------
+// Wraps a longitude difference to +/- PI
+double WrapLon( double dLon )
+{
+	if( dLon > M_PI )
+	{
+		dLon -= 2.0 * M_PI;
+	}
+	else if( dLon < -M_PI )
+	{
+		dLon += 2.0 * M_PI;
+	}
+
+	return dLon;
+}
+
+//-----------------------------------------------------------------------------
+// Equirectangular on the local radii of curvature. The bearing is corrected
+// for meridian convergence from the mid point back to the start.
+void Flat( const tGEOENG_POINT *ptFrom, const tGEOENG_POINT *ptTo, double *pdDist, double *pdAz )
+{
+	double dSinM;
+	double dCosM;
+	double w;
+	double N;		// prime vertical radius
+	double M;		// meridian radius
+	double dLon = WrapLon( ptTo->dLon - ptFrom->dLon );
+	double dNorth;
+	double dEast;
+
+	MidLatitude( ptFrom, ptTo, &dSinM, &dCosM );
+
+	w = 1.0 - WGS84_E2 * dSinM * dSinM;
+	N = WGS84_A / sqrt( w );
+	M = N * (1.0 - WGS84_E2) / w;
+
+	dNorth = (ptTo->dLat - ptFrom->dLat) * M;
+	dEast = dLon * N * dCosM;
+
+	*pdDist = sqrt( dNorth * dNorth + dEast * dEast );
+	*pdAz = atan2( dEast, dNorth ) - 0.5 * dLon * dSinM;
+}
+
+//-----------------------------------------------------------------------------
+// Haversine on the sphere of radius N at the mid latitude, with latitudes
+// pulled towards the mid point by M/N so north-south distances match the
+// ellipsoid too.
+void Sphere( const tGEOENG_POINT *ptFrom, const tGEOENG_POINT *ptTo, double *pdDist, double *pdAz )
+{
+	double dSinM;
+	double dCosM;
+	double w;
+	double N;
+	double k;
+	double dMid = 0.5 * (ptFrom->dLat + ptTo->dLat);
+	double dHalf;
+	double p1;
+	double p2;
+	double dLon = WrapLon( ptTo->dLon - ptFrom->dLon );
+	double dSinDp;
+	double dSinDl;
+	double a;
+	double dCos1;
+	double dCos2;
+	double dSin1;
+	double dSin2;
+
+	MidLatitude( ptFrom, ptTo, &dSinM, &dCosM );
+
+	w = 1.0 - WGS84_E2 * dSinM * dSinM;
+	N = WGS84_A / sqrt( w );
+	k = (1.0 - WGS84_E2) / w;		// M / N
+
+	dHalf = 0.5 * (ptTo->dLat - ptFrom->dLat) * k;
+	p1 = dMid - dHalf;
+	p2 = dMid + dHalf;
+
+	dSin1 = sin( p1 );
+	dCos1 = cos( p1 );
+	dSin2 = sin( p2 );
+	dCos2 = cos( p2 );
+
+	dSinDp = sin( dHalf );
+	dSinDl = sin( 0.5 * dLon );
+	a = dSinDp * dSinDp + dCos1 * dCos2 * dSinDl * dSinDl;
+
+	*pdDist = 2.0 * N * asin( sqrt( a ) );
+	*pdAz = atan2( sin( dLon ) * dCos2, dCos1 * dSin2 - dSin1 * dCos2 * cos( dLon ) );
+}
+
+//-----------------------------------------------------------------------------
+// Vincenty's inverse formula. Returns false if it does not converge.
+bool Vincenty( const tGEOENG_POINT *ptFrom, const tGEOENG_POINT *ptTo, double *pdDist, double *pdAz )
+{
+	double L = WrapLon( ptTo->dLon - ptFrom->dLon );
+	double dSinU1 = ptFrom->dSinU;
+	double dCosU1 = ptFrom->dCosU;
+	double dSinU2 = ptTo->dSinU;
+	double dCosU2 = ptTo->dCosU;
+	double dLambda = L;
+	double dLambdaPrev;
+	double dSinLambda;
+	double dCosLambda;
+	double dSinSigma;
+	double dCosSigma;
+	double dSigma;
+	double dSinAlpha;
+	double dCos2Alpha;
+	double dCos2SigmaM;
+	double C;
+	double u2;
+	double A;
+	double B;
+	double dDeltaSigma;
+	int i;
+
+	for( i = 0; i < VINCENTY_MAX_ITERATIONS; i++ )
+	{
+		dSinLambda = sin( dLambda );
+		dCosLambda = cos( dLambda );
+
+		dSinSigma = sqrt( (dCosU2 * dSinLambda) * (dCosU2 * dSinLambda) +
+						  (dCosU1 * dSinU2 - dSinU1 * dCosU2 * dCosLambda) *
+						  (dCosU1 * dSinU2 - dSinU1 * dCosU2 * dCosLambda) );
+		if( dSinSigma == 0.0 )
+		{
+			// Same point
+			*pdDist = 0.0;
+			*pdAz = 0.0;
+			return true;
+		}
+
+		dCosSigma = dSinU1 * dSinU2 + dCosU1 * dCosU2 * dCosLambda;
+		dSigma = atan2( dSinSigma, dCosSigma );
+		dSinAlpha = dCosU1 * dCosU2 * dSinLambda / dSinSigma;
+		dCos2Alpha = 1.0 - dSinAlpha * dSinAlpha;
+
+		// Equatorial line
+		dCos2SigmaM = (dCos2Alpha != 0.0) ? dCosSigma - 2.0 * dSinU1 * dSinU2 / dCos2Alpha : 0.0;
+
+		C = WGS84_F / 16.0 * dCos2Alpha * (4.0 + WGS84_F * (4.0 - 3.0 * dCos2Alpha));
+		dLambdaPrev = dLambda;
+		dLambda = L + (1.0 - C) * WGS84_F * dSinAlpha *
+				  (dSigma + C * dSinSigma * (dCos2SigmaM + C * dCosSigma * (-1.0 + 2.0 * dCos2SigmaM * dCos2SigmaM)));
+
+		if( fabs( dLambda - dLambdaPrev ) <= VINCENTY_TOLERANCE )
+		{
+			break;
+		}
+	}
+
+	if( i == VINCENTY_MAX_ITERATIONS )
+	{
+		return false;
+	}
+
+	u2 = dCos2Alpha * (WGS84_A * WGS84_A - WGS84_B * WGS84_B) / (WGS84_B * WGS84_B);
+	A = 1.0 + u2 / 16384.0 * (4096.0 + u2 * (-768.0 + u2 * (320.0 - 175.0 * u2)));
+	B = u2 / 1024.0 * (256.0 + u2 * (-128.0 + u2 * (74.0 - 47.0 * u2)));
+	dDeltaSigma = B * dSinSigma * (dCos2SigmaM + B / 4.0 * (dCosSigma * (-1.0 + 2.0 * dCos2SigmaM * dCos2SigmaM) -
+				  B / 6.0 * dCos2SigmaM * (-3.0 + 4.0 * dSinSigma * dSinSigma) * (-3.0 + 4.0 * dCos2SigmaM * dCos2SigmaM)));
+
+	*pdDist = WGS84_B * A * (dSigma - dDeltaSigma);
+	*pdAz = atan2( dCosU2 * dSinLambda, dCosU1 * dSinU2 - dSinU1 * dCosU2 * dCosLambda );
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+uint64_t Nanos( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
@@ -0,0 +1,86 @@
+// GeoEngine.h
+// Range and bearing on the WGS84 ellipsoid. For each leg it picks the cheapest
+// formula whose error stays inside a configured bound:
+//
+//   E_GEO_TIER_FLAT       equirectangular with the local radii of curvature
+//                         at the mid latitude. No trig beyond one atan2.
+//                         error <= (1 + 2 tan^2(lat)) * d^3 / (24 R^2)
+//   E_GEO_TIER_SPHERE     haversine in double on the osculating sphere at the
+//                         mid latitude. Latitudes are rescaled by M/N so the
+//                         meridian matches the ellipsoid.
+//                         error <= d^3 / (300 R^2)
+//   E_GEO_TIER_ELLIPSOID  Vincenty inverse, sub-millimeter. Falls back to the
+//                         sphere if it does not converge (nearly antipodal).
+//
+// Error means position error at the far end, measured against Vincenty. It
+// covers both the range and the cross track caused by a bearing error. The
+// bounds were fitted with margin over 0 - 85 degrees latitude and leg lengths
+// of 10 m - 3000 km.
+// With the 1 cm GEO_ERROR_BOUND_M in config.h:
+//   - The flat tier covers legs up to ~4.5 km at the equator and ~2 km at
+//     60 degrees.
+//   - The sphere tier covers legs up to ~49 km.
+// Every leg this boat runs is a flat leg.
+
+#ifndef GEOENGINE_H
+#define GEOENGINE_H
+
+#include <stdint.h>
+#include "includes.h"
+
+//-------------------------------------------
+// Global defines
+
+typedef enum
+{
+	E_GEO_TIER_FLAT = 0,
+	E_GEO_TIER_SPHERE,
+	E_GEO_TIER_ELLIPSOID,
+
+	E_GEO_TIER_MAX
+} E_GEO_TIER;
+
+// A position with the terms every tier needs worked out once
+typedef struct
+{
+	double dLat;		// radians
+	double dLon;
+	double dSinLat;
+	double dCosLat;
+	double dSinU;		// reduced latitude, for Vincenty
+	double dCosU;
+} tGEOENG_POINT;
+
+typedef struct
+{
+	double dDist;		// meters
+	double dCourse;		// degrees, North == 0
+	double dError;		// error bound of the tier used (meters)
+	E_GEO_TIER eTier;
+} tGEOENG_RESULT;
+
+typedef struct
+{
+	U32 au32Calls[E_GEO_TIER_MAX];		// legs answered by each tier
+	uint64_t au64Nanos[E_GEO_TIER_MAX];	// time spent on them, including the cheaper tiers tried first
+	U32 u32Fallbacks;					// Vincenty did not converge, answered by the sphere
+	E_GEO_TIER eLastTier;
+} tGEOENG_STATS;
+
+typedef struct
+{
+	double dErrorBound;		// meters
+	tGEOENG_STATS tStats;
+} tGEO_ENGINE;
+
+//-------------------------------------------
+// Function prototypes
+
+void		GEOENG_Init( tGEO_ENGINE *ptEngine, double dErrorBound );
+void		GEOENG_SetPoint( tGEOENG_POINT *ptPoint, long lat, long lon );
+E_GEO_TIER	GEOENG_RangeAndBearing( tGEO_ENGINE *ptEngine, const tGEOENG_POINT *ptFrom, const tGEOENG_POINT *ptTo,
+									tGEOENG_RESULT *ptResult );
+void		GEOENG_ResetStats( tGEO_ENGINE *ptEngine );
+const char *GEOENG_TierName( E_GEO_TIER eTier );
+
+#endif
@@ -0,0 +1,487 @@
+// Geodesy.cpp
+// Fixed-point range and bearing between positions given in millionths of a
+// degree. See Geodesy.h for the error bounds.
+
+#include "Geodesy.h"
+
+//-----------------------------------------------------------------------------
+// local defines
+
+// Internally angles carry 16 more fraction bits than the public 32 bit
+// binary angle (2^48 == 360 degrees), so a one millionth of a degree
+// difference (~11.9 units of 2^32) keeps its precision through halving
+// and the sine table lookup
+#define FINE_BITS				16
+
+// Sine table resolution: 512 entries per quadrant (9 bits of a 46 bit
+// quadrant angle), the remaining 37 bits interpolate
+#define SINE_TABLE_BITS			9
+#define SINE_FRAC_BITS			(30 + FINE_BITS - SINE_TABLE_BITS)
+
+// Fine angle units per millionth of a degree: 2^48 / 360e6, Q12
+#define FINE_PER_MILLIONTH_Q12	3202559735LL
+#define FINE_QUARTER			((uint64_t)1 << (30 + FINE_BITS))
+#define FINE_MASK				(((uint64_t)1 << (32 + FINE_BITS)) - 1)
+
+// Centimeters of great circle per binary angle unit: 2*PI*R*100 / 2^32, Q32
+#define CM_PER_ANGLE_Q32		4004145191ULL
+
+// CORDIC atan table fraction bits below one binary angle unit
+#define ATAN_FRAC_BITS			8
+
+//-----------------------------------------------------------------------------
+// local data
+
+// sin(i * 90 / 512 degrees) in Q30, i = 0..512
+static const S32 gas32SineTable[(1 << SINE_TABLE_BITS) + 1] = {
+	0, 3294193, 6588356, 9882456, 13176464, 16470347,
+	19764076, 23057618, 26350943, 29644021, 32936819, 36229307,
+	39521455, 42813230, 46104602, 49395541, 52686014, 55975992,
+	59265442, 62554335, 65842639, 69130324, 72417357, 75703709,
+	78989349, 82274245, 85558366, 88841683, 92124163, 95405776,
+	98686491, 101966277, 105245103, 108522939, 111799753, 115075515,
+	118350194, 121623759, 124896179, 128167423, 131437462, 134706263,
+	137973796, 141240030, 144504935, 147768480, 151030634, 154291367,
+	157550647, 160808445, 164064728, 167319468, 170572633, 173824192,
+	177074115, 180322371, 183568930, 186813762, 190056834, 193298119,
+	196537583, 199775198, 203010932, 206244756, 209476638, 212706549,
+	215934457, 219160334, 222384147, 225605867, 228825464, 232042906,
+	235258165, 238471210, 241682010, 244890535, 248096755, 251300640,
+	254502159, 257701283, 260897982, 264092224, 267283981, 270473223,
+	273659918, 276844038, 280025552, 283204430, 286380643, 289554160,
+	292724951, 295892988, 299058239, 302220676, 305380268, 308536985,
+	311690799, 314841679, 317989595, 321134518, 324276419, 327415267,
+	330551034, 333683689, 336813204, 339939549, 343062693, 346182609,
+	349299266, 352412636, 355522689, 358629395, 361732726, 364832652,
+	367929144, 371022173, 374111709, 377197725, 380280190, 383359076,
+	386434353, 389505993, 392573967, 395638246, 398698801, 401755603,
+	404808624, 407857835, 410903207, 413944711, 416982319, 420016002,
+	423045732, 426071480, 429093217, 432110916, 435124548, 438134084,
+	441139496, 444140756, 447137835, 450130706, 453119340, 456103710,
+	459083786, 462059541, 465030947, 467997976, 470960600, 473918791,
+	476872522, 479821764, 482766489, 485706671, 488642281, 491573292,
+	494499676, 497421405, 500338453, 503250791, 506158392, 509061229,
+	511959275, 514852502, 517740883, 520624391, 523502998, 526376678,
+	529245404, 532109148, 534967884, 537821584, 540670223, 543513772,
+	546352205, 549185496, 552013618, 554836544, 557654248, 560466703,
+	563273883, 566075761, 568872310, 571663506, 574449320, 577229728,
+	580004702, 582774218, 585538248, 588296766, 591049748, 593797166,
+	596538995, 599275210, 602005783, 604730691, 607449906, 610163404,
+	612871159, 615573145, 618269338, 620959711, 623644239, 626322897,
+	628995660, 631662503, 634323400, 636978327, 639627258, 642270169,
+	644907034, 647537830, 650162530, 652781111, 655393548, 657999816,
+	660599890, 663193747, 665781362, 668362709, 670937767, 673506508,
+	676068911, 678624950, 681174602, 683717842, 686254647, 688784993,
+	691308855, 693826211, 696337036, 698841307, 701339000, 703830092,
+	706314559, 708792378, 711263525, 713727978, 716185713, 718636707,
+	721080937, 723518380, 725949013, 728372813, 730789757, 733199822,
+	735602987, 737999228, 740388522, 742770848, 745146182, 747514503,
+	749875788, 752230015, 754577161, 756917205, 759250125, 761575898,
+	763894504, 766205919, 768510122, 770807092, 773096806, 775379244,
+	777654384, 779922204, 782182683, 784435800, 786681534, 788919863,
+	791150767, 793374223, 795590213, 797798714, 799999706, 802193167,
+	804379079, 806557419, 808728167, 810891304, 813046808, 815194659,
+	817334838, 819467323, 821592095, 823709135, 825818421, 827919934,
+	830013654, 832099562, 834177638, 836247863, 838310216, 840364679,
+	842411232, 844449856, 846480531, 848503239, 850517961, 852524677,
+	854523370, 856514019, 858496606, 860471112, 862437520, 864395810,
+	866345964, 868287963, 870221790, 872147426, 874064853, 875974054,
+	877875009, 879767701, 881652112, 883528225, 885396022, 887255485,
+	889106597, 890949341, 892783698, 894609652, 896427186, 898236282,
+	900036924, 901829095, 903612776, 905387953, 907154608, 908912725,
+	910662286, 912403276, 914135678, 915859476, 917574653, 919281194,
+	920979082, 922668302, 924348837, 926020672, 927683790, 929338177,
+	930983817, 932620694, 934248793, 935868098, 937478595, 939080267,
+	940673101, 942257081, 943832191, 945398418, 946955747, 948504163,
+	950043650, 951574196, 953095785, 954608403, 956112036, 957606670,
+	959092290, 960568883, 962036435, 963494932, 964944360, 966384706,
+	967815955, 969238095, 970651112, 972054994, 973449725, 974835295,
+	976211688, 977578894, 978936898, 980285688, 981625251, 982955574,
+	984276646, 985588453, 986890984, 988184225, 989468165, 990742793,
+	992008094, 993264059, 994510675, 995747930, 996975812, 998194311,
+	999403415, 1000603111, 1001793390, 1002974239, 1004145648, 1005307605,
+	1006460100, 1007603122, 1008736660, 1009860704, 1010975242, 1012080264,
+	1013175761, 1014261721, 1015338134, 1016404991, 1017462281, 1018509994,
+	1019548121, 1020576651, 1021595575, 1022604883, 1023604567, 1024594615,
+	1025575020, 1026545772, 1027506862, 1028458280, 1029400018, 1030332067,
+	1031254418, 1032167062, 1033069992, 1033963197, 1034846671, 1035720404,
+	1036584389, 1037438617, 1038283080, 1039117770, 1039942680, 1040757802,
+	1041563127, 1042358649, 1043144360, 1043920252, 1044686319, 1045442553,
+	1046188946, 1046925492, 1047652185, 1048369016, 1049075980, 1049773069,
+	1050460278, 1051137599, 1051805027, 1052462555, 1053110176, 1053747885,
+	1054375676, 1054993543, 1055601479, 1056199480, 1056787540, 1057365653,
+	1057933813, 1058492016, 1059040255, 1059578527, 1060106826, 1060625146,
+	1061133483, 1061631833, 1062120190, 1062598550, 1063066909, 1063525261,
+	1063973603, 1064411931, 1064840240, 1065258526, 1065666786, 1066065015,
+	1066453210, 1066831367, 1067199483, 1067557554, 1067905576, 1068243547,
+	1068571464, 1068889322, 1069197120, 1069494854, 1069782521, 1070060120,
+	1070327646, 1070585099, 1070832474, 1071069770, 1071296985, 1071514117,
+	1071721163, 1071918122, 1072104991, 1072281769, 1072448455, 1072605046,
+	1072751542, 1072887940, 1073014240, 1073130440, 1073236540, 1073332538,
+	1073418433, 1073494225, 1073559913, 1073615496, 1073660973, 1073696345,
+	1073721611, 1073736771, 1073741824,};
+
+// atan(2^-i) in binary angle units, with ATAN_FRAC_BITS extra fraction bits
+static const uint64_t gau64AtanTable[32] = {
+	137438953472ULL, 81134951838ULL, 42869480287ULL, 21761217566ULL,
+	10922836750ULL, 5466743129ULL, 2734038620ULL, 1367102738ULL,
+	683561799ULL, 341782203ULL, 170891265ULL, 85445653ULL,
+	42722829ULL, 21361415ULL, 10680707ULL, 5340354ULL,
+	2670177ULL, 1335088ULL, 667544ULL, 333772ULL,
+	166886ULL, 83443ULL, 41722ULL, 20861ULL,
+	10430ULL, 5215ULL, 2608ULL, 1304ULL,
+	652ULL, 326ULL, 163ULL, 81ULL,};
+
+//-----------------------------------------------------------------------------
+// local function prototypes
+
+static uint64_t	FineAngle( long millionths );
+static int64_t	FineDiff( uint64_t a, uint64_t b );
+static S32		FineSin( uint64_t angle );
+static uint64_t	FineAtan2( int64_t y, int64_t x );
+static int64_t	MulQ30( int64_t a, int64_t b );
+static U32		Isqrt64( uint64_t value );
+static uint64_t	Haversine( const tGEO_POINT *ptFrom, const tGEO_POINT *ptTo, int64_t *ps64SinHalfLon );
+static U32		HaversineToCm( uint64_t u64Hav );
+static void		RangeAndBearing( const tGEO_POINT *ptFrom, const tGEO_POINT *ptTo, U32 *pu32Dist, U32 *pu32Course );
+
+//-----------------------------------------------------------------------------
+// Converts millionths of a degree to a binary angle (2^32 == 360 degrees)
+U32 GEO_MillionthsToAngle( long millionths )
+{
+	return (U32)(FineAngle( millionths ) >> FINE_BITS);
+}
+
+//-----------------------------------------------------------------------------
+// sin() of a binary angle, Q30 result
+S32 GEO_Sin( U32 angle )
+{
+	return FineSin( (uint64_t)angle << FINE_BITS );
+}
+
+//-----------------------------------------------------------------------------
+// cos() of a binary angle, Q30 result
+S32 GEO_Cos( U32 angle )
+{
+	return GEO_Sin( angle + (1UL << 30) );
+}
+
+//-----------------------------------------------------------------------------
+// atan2() of any scale of y and x, binary angle result
+U32 GEO_Atan2( int64_t y, int64_t x )
+{
+	return (U32)((FineAtan2( y, x ) + (1 << (ATAN_FRAC_BITS - 1))) >> ATAN_FRAC_BITS);
+}
+
+//-----------------------------------------------------------------------------
+// Works out a position's trig terms once
+void GEO_SetPoint( tGEO_POINT *ptPoint, long lat, long lon )
+{
+	ptPoint->u64Lat = FineAngle( lat );
+	ptPoint->u64Lon = FineAngle( lon );
+	ptPoint->s32SinLat = FineSin( ptPoint->u64Lat );
+	ptPoint->s32CosLat = FineSin( ptPoint->u64Lat + FINE_QUARTER );
+}
+
+//-----------------------------------------------------------------------------
+// Great circle distance in centimeters
+U32 GEO_DistanceBetween( long lat1, long lon1, long lat2, long lon2 )
+{
+	tGEO_POINT tFrom;
+	tGEO_POINT tTo;
+	U32 u32Dist;
+
+	GEO_SetPoint( &tFrom, lat1, lon1 );
+	GEO_SetPoint( &tTo, lat2, lon2 );
+	RangeAndBearing( &tFrom, &tTo, &u32Dist, 0 );
+
+	return u32Dist;
+}
+
+//-----------------------------------------------------------------------------
+// Initial great circle course in hundredths of a degree (North == 0, East == 9000)
+U32 GEO_CourseTo( long lat1, long lon1, long lat2, long lon2 )
+{
+	tGEO_POINT tFrom;
+	tGEO_POINT tTo;
+	U32 u32Course;
+
+	GEO_SetPoint( &tFrom, lat1, lon1 );
+	GEO_SetPoint( &tTo, lat2, lon2 );
+	RangeAndBearing( &tFrom, &tTo, 0, &u32Course );
+
+	return u32Course;
+}
+
+//-----------------------------------------------------------------------------
+// Distance (cm) and course (hundredths of a degree) in one go; the terms the
+// two have in common are only worked out once
+void GEO_RangeAndBearing( const tGEO_POINT *ptFrom, const tGEO_POINT *ptTo, U32 *pu32Dist, U32 *pu32Course )
+{
+	RangeAndBearing( ptFrom, ptTo, pu32Dist, pu32Course );
+}
+
+//-----------------------------------------------------------------------------
+// Range and bearing from one position to each of count positions given as
+// separate latitude and longitude arrays (millionths of a degree).
+// The origin's terms are shared by every point and each point's terms are
+// shared by its range and bearing. Either output array may be NULL.
+void GEO_RangeAndBearingBatch( const tGEO_POINT *ptFrom, const long *plLat, const long *plLon, int count,
+							   U32 *pu32Dist, U32 *pu32Course )
+{
+	tGEO_POINT tTo;
+	int i;
+
+	for( i = 0; i < count; i++ )
+	{
+		tTo.u64Lat = FineAngle( plLat[i] );
+		tTo.u64Lon = FineAngle( plLon[i] );
+		tTo.s32CosLat = FineSin( tTo.u64Lat + FINE_QUARTER );
+		// sin(lat2) is never used: the course formula below works from
+		// sin(dlat) instead
+
+		RangeAndBearing( ptFrom, &tTo, pu32Dist ? &pu32Dist[i] : 0, pu32Course ? &pu32Course[i] : 0 );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Index of the position (separate latitude and longitude arrays) closest to
+// ptFrom, -1 if count is 0. Compares haversines, which grow with distance,
+// so the square roots and atan2 are only paid for the winner.
+int GEO_Nearest( const tGEO_POINT *ptFrom, const long *plLat, const long *plLon, int count, U32 *pu32Dist )
+{
+	tGEO_POINT tTo;
+	uint64_t u64Best = ~(uint64_t)0;
+	uint64_t u64Hav;
+	int best = -1;
+	int i;
+
+	for( i = 0; i < count; i++ )
+	{
+		tTo.u64Lat = FineAngle( plLat[i] );
+		tTo.u64Lon = FineAngle( plLon[i] );
+		tTo.s32CosLat = FineSin( tTo.u64Lat + FINE_QUARTER );
+
+		u64Hav = Haversine( ptFrom, &tTo, 0 );
+		if( u64Hav < u64Best )
+		{
+			u64Best = u64Hav;
+			best = i;
+		}
+	}
+
+	if( best >= 0 && pu32Dist )
+	{
+		*pu32Dist = HaversineToCm( u64Best );
+	}
+
+	return best;
+}
+
+//-----------------------------------------------------------------------------
+// hav(c) = sin^2(dlat / 2) + cos(lat1) cos(lat2) sin^2(dlon / 2), Q60.
+// Optionally hands back sin(dlon / 2), which the course needs as well.
+uint64_t Haversine( const tGEO_POINT *ptFrom, const tGEO_POINT *ptTo, int64_t *ps64SinHalfLon )
+{
+	int64_t s64SinLat = FineSin( (uint64_t)(FineDiff( ptTo->u64Lat, ptFrom->u64Lat ) / 2) );
+	int64_t s64SinLon = FineSin( (uint64_t)(FineDiff( ptTo->u64Lon, ptFrom->u64Lon ) / 2) );
+	int64_t s64CosCos = ((int64_t)ptFrom->s32CosLat * ptTo->s32CosLat) >> 30;
+	uint64_t u64Hav;
+
+	u64Hav = (uint64_t)(s64SinLat * s64SinLat) +
+			 (uint64_t)MulQ30( s64SinLon * s64SinLon, s64CosCos );
+
+	if( ps64SinHalfLon )
+	{
+		*ps64SinHalfLon = s64SinLon;
+	}
+
+	return (u64Hav > ((uint64_t)1 << 60)) ? ((uint64_t)1 << 60) : u64Hav;
+}
+
+//-----------------------------------------------------------------------------
+// Great circle distance in centimeters from hav(c):
+//   c = 2 * atan2( sqrt(hav(c)), sqrt(1 - hav(c)) )
+// The haversine form stays well conditioned down to the last centimeter.
+U32 HaversineToCm( uint64_t u64Hav )
+{
+	// Central angle in binary angle units with ATAN_FRAC_BITS of fraction
+	uint64_t u64Central = 2 * FineAtan2( Isqrt64( u64Hav ), Isqrt64( ((uint64_t)1 << 60) - u64Hav ) );
+
+	return (U32)(((u64Central >> ATAN_FRAC_BITS) * CM_PER_ANGLE_Q32 +
+				 (((u64Central & ((1 << ATAN_FRAC_BITS) - 1)) * CM_PER_ANGLE_Q32) >> ATAN_FRAC_BITS) +
+				 (1ULL << 31)) >> 32);
+}
+
+//-----------------------------------------------------------------------------
+// Shared range and bearing kernel. Course:
+//   y = sin(dlon) cos(lat2)
+//   x = cos(lat1) sin(lat2) - sin(lat1) cos(lat2) cos(dlon)
+//     = sin(dlat) + sin(lat1) cos(lat2) * 2 sin^2(dlon / 2)
+// The second form of x has nothing to cancel on short legs.
+void RangeAndBearing( const tGEO_POINT *ptFrom, const tGEO_POINT *ptTo, U32 *pu32Dist, U32 *pu32Course )
+{
+	int64_t s64SinHalf;
+	uint64_t u64Hav;
+	int64_t y;
+	int64_t x;
+	U32 course;
+
+	u64Hav = Haversine( ptFrom, ptTo, &s64SinHalf );
+
+	if( pu32Dist )
+	{
+		*pu32Dist = HaversineToCm( u64Hav );
+	}
+
+	if( pu32Course )
+	{
+		y = (int64_t)FineSin( ptTo->u64Lon - ptFrom->u64Lon ) * ptTo->s32CosLat;
+		x = ((int64_t)FineSin( ptTo->u64Lat - ptFrom->u64Lat ) << 30) +
+			2 * MulQ30( s64SinHalf * s64SinHalf, ((int64_t)ptFrom->s32SinLat * ptTo->s32CosLat) >> 30 );
+
+		course = (U32)(((uint64_t)GEO_Atan2( y, x ) * 36000 + (1ULL << 31)) >> 32);
+
+		*pu32Course = (course >= 36000) ? course - 36000 : course;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Signed difference a - b of two fine angles, in [-180, 180) degrees
+int64_t FineDiff( uint64_t a, uint64_t b )
+{
+	return (int64_t)((a - b) << (64 - 32 - FINE_BITS)) >> (64 - 32 - FINE_BITS);
+}
+
+//-----------------------------------------------------------------------------
+// Millionths of a degree to a fine angle (2^48 == 360 degrees)
+uint64_t FineAngle( long millionths )
+{
+	return (uint64_t)(((int64_t)millionths * FINE_PER_MILLIONTH_Q12) >> 12) & FINE_MASK;
+}
+
+//-----------------------------------------------------------------------------
+// sin() of a fine angle, Q30 result
+S32 FineSin( uint64_t angle )
+{
+	U32 quadrant = (U32)(angle >> (30 + FINE_BITS)) & 3;
+	uint64_t x = angle & (FINE_QUARTER - 1);
+	U32 index;
+	uint64_t frac;
+	S32 s32Lo;
+	S32 s32Result;
+
+	// sin() is mirrored in the second and fourth quadrants
+	if( quadrant & 1 )
+	{
+		x = FINE_QUARTER - x;
+	}
+
+	index = (U32)(x >> SINE_FRAC_BITS);
+	frac = x & (((uint64_t)1 << SINE_FRAC_BITS) - 1);
+	s32Lo = gas32SineTable[index];
+
+	s32Result = s32Lo;
+	if( frac )
+	{
+		s32Result += (S32)((((int64_t)(gas32SineTable[index + 1] - s32Lo) * (int64_t)frac) +
+							((int64_t)1 << (SINE_FRAC_BITS - 1))) >> SINE_FRAC_BITS);
+	}
+
+	// and negative in the bottom half
+	return (quadrant & 2) ? -s32Result : s32Result;
+}
+
+//-----------------------------------------------------------------------------
+// atan2() by CORDIC vectoring. Result in binary angle units with
+// ATAN_FRAC_BITS of fraction.
+uint64_t FineAtan2( int64_t y, int64_t x )
+{
+	uint64_t u64Angle = 0;
+	int64_t xn;
+	int i;
+
+	if( x == 0 && y == 0 )
+	{
+		return 0;
+	}
+
+	// Rotate into the right half plane
+	if( x < 0 )
+	{
+		x = -x;
+		y = -y;
+		u64Angle = (uint64_t)1 << (31 + ATAN_FRAC_BITS);
+	}
+
+	// Normalise so the shifts below keep full precision; CORDIC gain is
+	// ~1.65 so leave headroom under 2^62
+	while( (x < ((int64_t)1 << 59)) && (y < ((int64_t)1 << 59)) && (y > -((int64_t)1 << 59)) )
+	{
+		x <<= 1;
+		y <<= 1;
+	}
+
+	for( i = 0; i < 32; i++ )
+	{
+		if( y > 0 )
+		{
+			xn = x + (y >> i);
+			y -= (x >> i);
+			u64Angle += gau64AtanTable[i];
+		}
+		else
+		{
+			xn = x - (y >> i);
+			y += (x >> i);
+			u64Angle -= gau64AtanTable[i];
+		}
+		x = xn;
+	}
+
+	return u64Angle & (((uint64_t)1 << (32 + ATAN_FRAC_BITS)) - 1);
+}
+
+//-----------------------------------------------------------------------------
+// (a * b) >> 30 for a Q60 a and a Q30 b without overflowing or dropping the
+// low bits of a small a
+int64_t MulQ30( int64_t a, int64_t b )
+{
+	return (a >> 30) * b + (((a & ((1L << 30) - 1)) * b) >> 30);
+}
+
+//-----------------------------------------------------------------------------
+// Integer square root, rounded to nearest
+U32 Isqrt64( uint64_t value )
+{
+	uint64_t root = 0;
+	uint64_t bit = (uint64_t)1 << 62;
+	uint64_t rem = value;
+
+	while( bit > rem )
+	{
+		bit >>= 2;
+	}
+
+	while( bit )
+	{
+		if( rem >= root + bit )
+		{
+			rem -= root + bit;
+			root = (root >> 1) + bit;
+		}
+		else
+		{
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+
+	// floor(sqrt) -> nearest: round up when value > root^2 + root
+	if( rem > root )
+	{
+		root++;
+	}
+
+	return (U32)root;
+}
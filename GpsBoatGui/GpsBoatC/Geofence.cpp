@@ -0,0 +1,625 @@
+// Geofence.cpp
+// Keep-in and keep-out polygons. See Geofence.h.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include "config.h"
+#include "Geofence.h"
+
+//-------------------------------------------
+// Local defines
+
+typedef int32_t tFENCE_MASK __attribute__ ((vector_size (FENCE_LANES * sizeof(int32_t))));
+
+// Where unused lanes are parked, far enough to never cross or be nearest
+// and near enough that its distance squared is still a float
+#define FENCE_PARKED			1e18f
+
+// Thinner bands than this only add blocks to step over in the distance check
+#define FENCE_MIN_BAND_M		(FENCE_MARGIN_M / 4.0)
+
+// An edge copy in a band, keyed by its west end for sorting
+typedef struct
+{
+	float fEast;
+	uint32_t u32Edge;
+} tBAND_EDGE;
+
+// Long edges are copied into every band they span. Fewer bands are used if
+// that would take more than this many copies per edge.
+#define FENCE_MAX_COPIES		8
+
+//-------------------------------------------
+// Local prototypes
+
+static bool		AddVertex( tFENCE *ptFence, double lat, double lon );
+static bool		AddPolygon( tFENCE *ptFence, bool bKeepOut );
+static bool		BuildBands( tFENCE_POLYGON *ptPolygon, const float *pfEast, const float *pfNorth );
+static int		CompareEast( const void *p1, const void *p2 );
+static int		Band( const tFENCE_POLYGON *ptPolygon, float fNorth );
+static void		SetLane( tFENCE_BLOCK *ptBlock, int lane, float fEast0, float fNorth0, float fEast1, float fNorth1 );
+static bool		Inside( const tFENCE_POLYGON *ptPolygon, float fEast, float fNorth );
+static float	NearestEdge2( const tFENCE_POLYGON *ptPolygon, float fEast, float fNorth, float fMargin );
+static void		FreeBands( tFENCE_POLYGON *ptPolygon );
+
+//-----------------------------------------------------------------------------
+// Reads a fence file (see Geofence.h). Returns false, with no fence, if it
+// can't be used. Checks only start once FENCE_SetFrame() is called.
+bool FENCE_LoadFile( tFENCE *ptFence, const char *pFileName )
+{
+	char acLine[256];
+	char *p;
+	char *pEnd;
+	double lat;
+	double lon;
+	int line = 0;
+	int i;
+	FILE *fp;
+
+	memset( ptFence, 0, sizeof(tFENCE) );
+
+	fp = fopen( pFileName, "r" );
+	if( !fp )
+	{
+		fprintf( stderr, "Unable to open fence %s: %s\n", pFileName, strerror( errno ) );
+		return false;
+	}
+
+	while( fgets( acLine, sizeof(acLine), fp ) )
+	{
+		line++;
+
+		for( p = acLine; isspace( (unsigned char)*p ); p++ )
+		{
+		}
+
+		if( 0 == strncasecmp( p, "keepin", 6 ) || 0 == strncasecmp( p, "keepout", 7 ) )
+		{
+			if( !AddPolygon( ptFence, 0 == strncasecmp( p, "keepout", 7 ) ) )
+			{
+				break;
+			}
+			continue;
+		}
+
+		// Headers, comments, blank lines
+		if( !isdigit( (unsigned char)*p ) && *p != '-' && *p != '+' && *p != '.' )
+		{
+			continue;
+		}
+
+		lat = strtod( p, &pEnd );
+		while( isspace( (unsigned char)*pEnd ) )
+		{
+			pEnd++;
+		}
+
+		if( (*pEnd != ',' && *pEnd != ';') || ptFence->polygonCount == 0 )
+		{
+			fprintf( stderr, "Fence %s line %i: expected lat,lon after keepin or keepout\n", pFileName, line );
+			break;
+		}
+
+		lon = strtod( pEnd + 1, NULL );
+
+		if( lat < -90.0 || lat > 90.0 || lon < -180.0 || lon > 180.0 )
+		{
+			fprintf( stderr, "Fence %s line %i: lat/lon out of range\n", pFileName, line );
+			break;
+		}
+
+		if( !AddVertex( ptFence, lat, lon ) )
+		{
+			break;
+		}
+	}
+
+	if( !feof( fp ) )
+	{
+		fclose( fp );
+		FENCE_Close( ptFence );
+		return false;
+	}
+
+	fclose( fp );
+
+	for( i = 0; i < ptFence->polygonCount; i++ )
+	{
+		tFENCE_POLYGON *ptPolygon = &ptFence->ptPolygons[i];
+		const tFENCE_VERTEX *ptFirst = &ptFence->ptVertices[ptPolygon->firstVertex];
+		const tFENCE_VERTEX *ptLast = ptFirst + ptPolygon->vertexCount - 1;
+
+		// Closed on the first vertex, the last edge is implied
+		if( ptPolygon->vertexCount > 1 && ptFirst->s32Lat == ptLast->s32Lat && ptFirst->s32Lon == ptLast->s32Lon )
+		{
+			ptPolygon->vertexCount--;
+		}
+
+		if( ptPolygon->vertexCount < 3 )
+		{
+			fprintf( stderr, "Fence %s: polygon %i needs at least 3 vertices\n", pFileName, i + 1 );
+			FENCE_Close( ptFence );
+			return false;
+		}
+
+		if( !ptPolygon->bKeepOut )
+		{
+			ptFence->keepInCount++;
+		}
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+void FENCE_Close( tFENCE *ptFence )
+{
+	int i;
+
+	for( i = 0; i < ptFence->polygonCount; i++ )
+	{
+		FreeBands( &ptFence->ptPolygons[i] );
+	}
+
+	free( ptFence->ptPolygons );
+	free( ptFence->ptVertices );
+	memset( ptFence, 0, sizeof(tFENCE) );
+}
+
+//-----------------------------------------------------------------------------
+// Projects the polygons into a frame and builds their bands. Called again
+// whenever the frame moves (i.e. home taken at GPS lock). Returns false,
+// with checks off, if out of memory.
+bool FENCE_SetFrame( tFENCE *ptFence, const tENU_FRAME *ptFrame )
+{
+	tENU_POS tPos;
+	float *pfEast;
+	float *pfNorth;
+	int i;
+	int v;
+
+	ptFence->bReady = false;
+
+	if( ptFence->polygonCount == 0 )
+	{
+		return true;
+	}
+
+	pfEast = (float *)malloc( ptFence->vertexCount * sizeof(float) );
+	pfNorth = (float *)malloc( ptFence->vertexCount * sizeof(float) );
+
+	for( i = 0; pfEast && pfNorth && i < ptFence->polygonCount; i++ )
+	{
+		tFENCE_POLYGON *ptPolygon = &ptFence->ptPolygons[i];
+
+		for( v = 0; v < ptPolygon->vertexCount; v++ )
+		{
+			const tFENCE_VERTEX *ptVertex = &ptFence->ptVertices[ptPolygon->firstVertex + v];
+
+			ENU_FromGeodetic( ptFrame, ptVertex->s32Lat, ptVertex->s32Lon, &tPos );
+			pfEast[v] = tPos.dEast;
+			pfNorth[v] = tPos.dNorth;
+		}
+
+		if( !BuildBands( ptPolygon, pfEast, pfNorth ) )
+		{
+			break;
+		}
+	}
+
+	free( pfEast );
+	free( pfNorth );
+
+	if( i < ptFence->polygonCount )
+	{
+		fprintf( stderr, "Fence: out of memory\n" );
+		return false;
+	}
+
+	ptFence->bReady = true;
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Checks a position in the fence's frame. Returns true on a breach, with the
+// details in *ptStatus. Nothing is a breach before FENCE_SetFrame().
+bool FENCE_Check( const tFENCE *ptFence, const tENU_POS *ptPos, tFENCE_STATUS *ptStatus )
+{
+	float fEast = ptPos->dEast;
+	float fNorth = ptPos->dNorth;
+	float fMargin2 = FENCE_MARGIN_M * FENCE_MARGIN_M;
+	bool bInKeepIn = false;
+	int i;
+
+	ptStatus->bBreach = false;
+	ptStatus->polygon = -1;
+	ptStatus->fMargin = FENCE_MARGIN_M;
+
+	if( !ptFence->bReady )
+	{
+		return false;
+	}
+
+	for( i = 0; i < ptFence->polygonCount; i++ )
+	{
+		const tFENCE_POLYGON *ptPolygon = &ptFence->ptPolygons[i];
+
+		fMargin2 = NearestEdge2( ptPolygon, fEast, fNorth, sqrtf( fMargin2 ) );
+
+		if( Inside( ptPolygon, fEast, fNorth ) )
+		{
+			if( ptPolygon->bKeepOut )
+			{
+				ptStatus->bBreach = true;
+				ptStatus->polygon = i;
+			}
+			else
+			{
+				bInKeepIn = true;
+			}
+		}
+	}
+
+	if( ptFence->keepInCount && !bInKeepIn )
+	{
+		ptStatus->bBreach = true;
+	}
+
+	ptStatus->fMargin = sqrtf( fMargin2 );
+
+	return ptStatus->bBreach;
+}
+
+//-----------------------------------------------------------------------------
+// Decimal degrees to the end of the last polygon
+bool AddVertex( tFENCE *ptFence, double lat, double lon )
+{
+	tFENCE_VERTEX *ptVertices;
+
+	// Grown in powers of 2
+	if( (ptFence->vertexCount & (ptFence->vertexCount - 1)) == 0 )
+	{
+		ptVertices = (tFENCE_VERTEX *)realloc( ptFence->ptVertices, max( ptFence->vertexCount * 2, 1 ) * sizeof(tFENCE_VERTEX) );
+		if( !ptVertices )
+		{
+			fprintf( stderr, "Fence: out of memory\n" );
+			return false;
+		}
+		ptFence->ptVertices = ptVertices;
+	}
+
+	ptFence->ptVertices[ptFence->vertexCount].s32Lat = (int32_t)lround( lat * 1000000.0 );
+	ptFence->ptVertices[ptFence->vertexCount].s32Lon = (int32_t)lround( lon * 1000000.0 );
+	ptFence->vertexCount++;
+	ptFence->ptPolygons[ptFence->polygonCount - 1].vertexCount++;
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Starts a new polygon at the next vertex
+bool AddPolygon( tFENCE *ptFence, bool bKeepOut )
+{
+	tFENCE_POLYGON *ptPolygons;
+
+	ptPolygons = (tFENCE_POLYGON *)realloc( ptFence->ptPolygons, (ptFence->polygonCount + 1) * sizeof(tFENCE_POLYGON) );
+	if( !ptPolygons )
+	{
+		fprintf( stderr, "Fence: out of memory\n" );
+		return false;
+	}
+
+	ptFence->ptPolygons = ptPolygons;
+	memset( &ptPolygons[ptFence->polygonCount], 0, sizeof(tFENCE_POLYGON) );
+	ptPolygons[ptFence->polygonCount].bKeepOut = bKeepOut;
+	ptPolygons[ptFence->polygonCount].firstVertex = ptFence->vertexCount;
+	ptFence->polygonCount++;
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Bands for one polygon from its projected vertices. Each band's edges are
+// sorted by their west end and its run of blocks padded out with parked
+// lanes.
+bool BuildBands( tFENCE_POLYGON *ptPolygon, const float *pfEast, const float *pfNorth )
+{
+	int edges = ptPolygon->vertexCount;
+	tBAND_EDGE *ptSorted;
+	tFENCE_BLOCK *ptBlock;
+	uint32_t *pu32End;
+	uint32_t copies;
+	uint32_t first;
+	uint32_t k;
+	int b0;
+	int b1;
+	int b;
+	int i;
+	int j;
+
+	FreeBands( ptPolygon );
+
+	ptPolygon->fEast0 = ptPolygon->fEast1 = pfEast[0];
+	ptPolygon->fNorth0 = ptPolygon->fNorth1 = pfNorth[0];
+
+	for( i = 1; i < edges; i++ )
+	{
+		ptPolygon->fEast0 = fminf( ptPolygon->fEast0, pfEast[i] );
+		ptPolygon->fEast1 = fmaxf( ptPolygon->fEast1, pfEast[i] );
+		ptPolygon->fNorth0 = fminf( ptPolygon->fNorth0, pfNorth[i] );
+		ptPolygon->fNorth1 = fmaxf( ptPolygon->fNorth1, pfNorth[i] );
+	}
+
+	// As many bands as keeps the copies of long edges down, and no thinner
+	// than a distance check needs
+	ptPolygon->bands = min( edges / FENCE_EDGES_PER_BAND, (int)((ptPolygon->fNorth1 - ptPolygon->fNorth0) / FENCE_MIN_BAND_M) );
+	ptPolygon->bands = max( ptPolygon->bands, 1 );
+
+	for( ;; )
+	{
+		ptPolygon->fInvBandHeight = ptPolygon->bands / fmaxf( ptPolygon->fNorth1 - ptPolygon->fNorth0, 0.001f );
+
+		for( copies = 0, i = 0; i < edges; i++ )
+		{
+			j = (i + 1) % edges;
+			copies += Band( ptPolygon, fmaxf( pfNorth[i], pfNorth[j] ) ) - Band( ptPolygon, fminf( pfNorth[i], pfNorth[j] ) ) + 1;
+		}
+
+		if( copies <= (uint32_t)edges * FENCE_MAX_COPIES || ptPolygon->bands == 1 )
+		{
+			break;
+		}
+		ptPolygon->bands /= 2;
+	}
+
+	ptPolygon->pu32BandStart = (uint32_t *)calloc( ptPolygon->bands + 1, sizeof(uint32_t) );
+	pu32End = (uint32_t *)calloc( ptPolygon->bands + 1, sizeof(uint32_t) );
+	ptSorted = (tBAND_EDGE *)malloc( copies * sizeof(tBAND_EDGE) );
+
+	if( !ptPolygon->pu32BandStart || !pu32End || !ptSorted )
+	{
+		free( pu32End );
+		free( ptSorted );
+		FreeBands( ptPolygon );
+		return false;
+	}
+
+	// Counting sort of edge copies by band. Afterwards pu32End[b] is where
+	// band b ends, and b + 1 starts.
+	for( i = 0; i < edges; i++ )
+	{
+		j = (i + 1) % edges;
+		b0 = Band( ptPolygon, fminf( pfNorth[i], pfNorth[j] ) );
+		b1 = Band( ptPolygon, fmaxf( pfNorth[i], pfNorth[j] ) );
+
+		for( b = b0; b <= b1; b++ )
+		{
+			pu32End[b + 1]++;
+		}
+	}
+
+	for( b = 0; b < ptPolygon->bands; b++ )
+	{
+		pu32End[b + 1] += pu32End[b];
+	}
+
+	for( i = 0; i < edges; i++ )
+	{
+		j = (i + 1) % edges;
+		b0 = Band( ptPolygon, fminf( pfNorth[i], pfNorth[j] ) );
+		b1 = Band( ptPolygon, fmaxf( pfNorth[i], pfNorth[j] ) );
+
+		for( b = b0; b <= b1; b++ )
+		{
+			ptSorted[pu32End[b]].fEast = fminf( pfEast[i], pfEast[j] );
+			ptSorted[pu32End[b]].u32Edge = i;
+			pu32End[b]++;
+		}
+	}
+
+	// West to east within each band, so neighbouring blocks are near each other
+	for( b = 0; b < ptPolygon->bands; b++ )
+	{
+		first = b ? pu32End[b - 1] : 0;
+		qsort( &ptSorted[first], pu32End[b] - first, sizeof(tBAND_EDGE), CompareEast );
+
+		ptPolygon->pu32BandStart[b + 1] = ptPolygon->pu32BandStart[b] + (pu32End[b] - first + FENCE_LANES - 1) / FENCE_LANES;
+	}
+
+	ptPolygon->ptBlocks = (tFENCE_BLOCK *)malloc( ptPolygon->pu32BandStart[ptPolygon->bands] * sizeof(tFENCE_BLOCK) );
+	if( !ptPolygon->ptBlocks )
+	{
+		free( pu32End );
+		free( ptSorted );
+		FreeBands( ptPolygon );
+		return false;
+	}
+
+	for( b = 0; b < ptPolygon->bands; b++ )
+	{
+		first = b ? pu32End[b - 1] : 0;
+
+		for( k = 0; k < (ptPolygon->pu32BandStart[b + 1] - ptPolygon->pu32BandStart[b]) * FENCE_LANES; k++ )
+		{
+			ptBlock = &ptPolygon->ptBlocks[ptPolygon->pu32BandStart[b] + k / FENCE_LANES];
+
+			if( k % FENCE_LANES == 0 )
+			{
+				ptBlock->fEastMin = FENCE_PARKED;
+				ptBlock->fEastMax = -FENCE_PARKED;
+			}
+
+			if( first + k < pu32End[b] )
+			{
+				i = ptSorted[first + k].u32Edge;
+				j = (i + 1) % edges;
+
+				SetLane( ptBlock, k % FENCE_LANES, pfEast[i], pfNorth[i], pfEast[j], pfNorth[j] );
+				ptBlock->fEastMin = fminf( ptBlock->fEastMin, fminf( pfEast[i], pfEast[j] ) );
+				ptBlock->fEastMax = fmaxf( ptBlock->fEastMax, fmaxf( pfEast[i], pfEast[j] ) );
+			}
+			else
+			{
+				SetLane( ptBlock, k % FENCE_LANES, FENCE_PARKED, FENCE_PARKED, FENCE_PARKED, FENCE_PARKED );
+			}
+		}
+	}
+
+	free( pu32End );
+	free( ptSorted );
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// qsort() order for tBAND_EDGE
+int CompareEast( const void *p1, const void *p2 )
+{
+	float fEast1 = ((const tBAND_EDGE *)p1)->fEast;
+	float fEast2 = ((const tBAND_EDGE *)p2)->fEast;
+
+	return (fEast1 > fEast2) - (fEast1 < fEast2);
+}
+
+//-----------------------------------------------------------------------------
+// Band a north position falls in, clamped to the polygon
+int Band( const tFENCE_POLYGON *ptPolygon, float fNorth )
+{
+	int band = (int)((fNorth - ptPolygon->fNorth0) * ptPolygon->fInvBandHeight);
+
+	return constrain( band, 0, ptPolygon->bands - 1 );
+}
+
+//-----------------------------------------------------------------------------
+void SetLane( tFENCE_BLOCK *ptBlock, int lane, float fEast0, float fNorth0, float fEast1, float fNorth1 )
+{
+	float fDEast = fEast1 - fEast0;
+	float fDNorth = fNorth1 - fNorth0;
+	float fLength2 = fDEast * fDEast + fDNorth * fDNorth;
+
+	ptBlock->vEast[lane] = fEast0;
+	ptBlock->vNorth[lane] = fNorth0;
+	ptBlock->vDEast[lane] = fDEast;
+	ptBlock->vDNorth[lane] = fDNorth;
+	ptBlock->vInvLength2[lane] = (fLength2 > 0.0f) ? 1.0f / fLength2 : 0.0f;
+	ptBlock->vSlope[lane] = (fDNorth != 0.0f) ? fDEast / fDNorth : 0.0f;
+}
+
+//-----------------------------------------------------------------------------
+// Even-odd crossing test over the edges in the point's band: counts edges
+// that straddle the point's north (half open, so a vertex is counted once)
+// and cross it to the east of the point. Blocks wholly west of the point
+// can't cross.
+bool Inside( const tFENCE_POLYGON *ptPolygon, float fEast, float fNorth )
+{
+	const tFENCE_BLOCK *ptBlock;
+	const tFENCE_BLOCK *ptEnd;
+	tFENCE_MASK vCount = { 0 };
+	int crossings = 0;
+	int band;
+	int lane;
+
+	if( fEast < ptPolygon->fEast0 || fEast > ptPolygon->fEast1 ||
+		fNorth < ptPolygon->fNorth0 || fNorth > ptPolygon->fNorth1 )
+	{
+		return false;
+	}
+
+	band = Band( ptPolygon, fNorth );
+	ptBlock = &ptPolygon->ptBlocks[ptPolygon->pu32BandStart[band]];
+	ptEnd = &ptPolygon->ptBlocks[ptPolygon->pu32BandStart[band + 1]];
+
+	for( ; ptBlock < ptEnd; ptBlock++ )
+	{
+		// Crossings are only counted east of the point
+		if( ptBlock->fEastMax < fEast )
+		{
+			continue;
+		}
+
+		// Each hit is -1
+		vCount += ((ptBlock->vNorth > fNorth) ^ (ptBlock->vNorth + ptBlock->vDNorth > fNorth)) &
+				  (fEast < ptBlock->vEast + (fNorth - ptBlock->vNorth) * ptBlock->vSlope);
+	}
+
+	for( lane = 0; lane < FENCE_LANES; lane++ )
+	{
+		crossings -= vCount[lane];
+	}
+
+	return (crossings & 1) != 0;
+}
+
+//-----------------------------------------------------------------------------
+// Squared distance to the polygon's nearest edge if it is under fMargin,
+// otherwise fMargin squared. Only bands within fMargin are looked at, they
+// are one run of blocks, and only blocks within fMargin east or west.
+float NearestEdge2( const tFENCE_POLYGON *ptPolygon, float fEast, float fNorth, float fMargin )
+{
+	const tFENCE_BLOCK *ptBlock;
+	const tFENCE_BLOCK *ptEnd;
+	const tFENCE_VEC vZero = { 0.0f };
+	const tFENCE_VEC vOne = vZero + 1.0f;
+	tFENCE_VEC vBest = vZero + fMargin * fMargin;
+	tFENCE_VEC vPE;
+	tFENCE_VEC vPN;
+	tFENCE_VEC vT;
+	tFENCE_VEC vD2;
+	float fBest2;
+	int lane;
+
+	if( fEast < ptPolygon->fEast0 - fMargin || fEast > ptPolygon->fEast1 + fMargin ||
+		fNorth < ptPolygon->fNorth0 - fMargin || fNorth > ptPolygon->fNorth1 + fMargin )
+	{
+		return fMargin * fMargin;
+	}
+
+	ptBlock = &ptPolygon->ptBlocks[ptPolygon->pu32BandStart[Band( ptPolygon, fNorth - fMargin )]];
+	ptEnd = &ptPolygon->ptBlocks[ptPolygon->pu32BandStart[Band( ptPolygon, fNorth + fMargin ) + 1]];
+
+	for( ; ptBlock < ptEnd; ptBlock++ )
+	{
+		if( ptBlock->fEastMin > fEast + fMargin || ptBlock->fEastMax < fEast - fMargin )
+		{
+			continue;
+		}
+
+		vPE = fEast - ptBlock->vEast;
+		vPN = fNorth - ptBlock->vNorth;
+
+		// Closest point along the edge, clamped to its ends
+		vT = (vPE * ptBlock->vDEast + vPN * ptBlock->vDNorth) * ptBlock->vInvLength2;
+		vT = (vT < vZero) ? vZero : vT;
+		vT = (vT > vOne) ? vOne : vT;
+
+		vPE -= vT * ptBlock->vDEast;
+		vPN -= vT * ptBlock->vDNorth;
+		vD2 = vPE * vPE + vPN * vPN;
+
+		vBest = (vD2 < vBest) ? vD2 : vBest;
+	}
+
+	fBest2 = vBest[0];
+	for( lane = 1; lane < FENCE_LANES; lane++ )
+	{
+		fBest2 = fminf( fBest2, vBest[lane] );
+	}
+
+	return fBest2;
+}
+
+//-----------------------------------------------------------------------------
+void FreeBands( tFENCE_POLYGON *ptPolygon )
+{
+	free( ptPolygon->pu32BandStart );
+	free( ptPolygon->ptBlocks );
+	ptPolygon->pu32BandStart = NULL;
+	ptPolygon->ptBlocks = NULL;
+	ptPolygon->bands = 0;
+}
@@ -0,0 +1,99 @@
+// Geofence.h
+// Keep-in and keep-out polygons for the boat's operating area. The boat
+// must stay inside at least one keep-in, if there are any, and outside
+// every keep-out.
+//
+// Fence file (CSV, decimal degrees):
+//   keepin						starts a polygon, or "keepout"
+//   33.700000,-117.800000		one vertex per line, closing it is optional
+//   ...
+// Lines starting with # are comments.
+//
+// Polygons are held as loaded until the route's local frame is known.
+// Then each is projected into it and cut into horizontal bands of about
+// FENCE_EDGES_PER_BAND edges. Each band keeps every edge whose north extent
+// overlaps it, sorted west to east, in blocks of FENCE_LANES edges laid out
+// as one vector per term. A check is then one band of crossing tests for
+// point in polygon, plus the bands within FENCE_MARGIN_M for the distance to
+// the nearest edge. Blocks whose east extent rules them out are skipped, so
+// the work follows the edges near the boat rather than the fence size. Each
+// block is a handful of SIMD ops (NEON on the Pi 2/3, SSE on a PC, plain
+// code otherwise).
+
+#ifndef GEOFENCE_H
+#define GEOFENCE_H
+
+#include <stdint.h>
+#include "includes.h"
+#include "LocalFrame.h"
+
+//-------------------------------------------
+// Global defines
+
+#define FENCE_LANES				4
+#define FENCE_EDGES_PER_BAND	2
+
+typedef float tFENCE_VEC __attribute__ ((vector_size (FENCE_LANES * sizeof(float))));
+
+typedef struct
+{
+	int32_t s32Lat;		// millionths of a degree
+	int32_t s32Lon;
+} tFENCE_VERTEX;
+
+// FENCE_LANES edges, unused lanes are parked far away
+typedef struct
+{
+	float fEastMin;			// east extent of the block's edges, for pruning
+	float fEastMax;
+	tFENCE_VEC vEast;		// start, meters
+	tFENCE_VEC vNorth;
+	tFENCE_VEC vDEast;		// end - start
+	tFENCE_VEC vDNorth;
+	tFENCE_VEC vInvLength2;	// 1 / length^2, 0 for a zero length edge
+	tFENCE_VEC vSlope;		// east per north, 0 for a level edge
+} tFENCE_BLOCK;
+
+typedef struct
+{
+	bool bKeepOut;
+	int firstVertex;		// into tFENCE.ptVertices
+	int vertexCount;
+
+	// Local frame, set by FENCE_SetFrame()
+	float fEast0;			// bounding box
+	float fNorth0;
+	float fEast1;
+	float fNorth1;
+	float fInvBandHeight;
+	int bands;
+	uint32_t *pu32BandStart;	// bands + 1 entries, in blocks
+	tFENCE_BLOCK *ptBlocks;
+} tFENCE_POLYGON;
+
+typedef struct
+{
+	bool bReady;			// projected, checks are live
+	int keepInCount;
+	int polygonCount;
+	tFENCE_POLYGON *ptPolygons;
+	int vertexCount;
+	tFENCE_VERTEX *ptVertices;
+} tFENCE;
+
+typedef struct
+{
+	bool bBreach;
+	int polygon;			// keep-out the boat is in, -1 if outside every keep-in
+	float fMargin;			// meters to the nearest fence edge, FENCE_MARGIN_M if further
+} tFENCE_STATUS;
+
+//-------------------------------------------
+// Function prototypes
+
+bool	FENCE_LoadFile( tFENCE *ptFence, const char *pFileName );
+void	FENCE_Close( tFENCE *ptFence );
+bool	FENCE_SetFrame( tFENCE *ptFence, const tENU_FRAME *ptFrame );
+bool	FENCE_Check( const tFENCE *ptFence, const tENU_POS *ptPos, tFENCE_STATUS *ptStatus );
+
+#endif
@@ -0,0 +1,53 @@
+// GpsInfo.cpp
+// GPS fix data shared between the GPS thread and its readers (nav loop, GUI)
+
+#include <string.h>
+#include "GpsInfo.h"
+
+//-----------------------------------------------------------------------------
+// Writer side. Only ever called from the GPS thread.
+// Copies ptInfo into the snapshot. Only a new position (bNewFix) gets the
+// next fix sequence number and its u32FixMs, otherwise the last position's
+// are kept.
+void GPSINFO_Publish( tGPS_SNAPSHOT *ptSnapshot, const tGPS_INFO *ptInfo, bool bNewFix )
+{
+	U32 u32Seq = __atomic_load_n( &ptSnapshot->u32Sequence, __ATOMIC_RELAXED );
+	U32 u32FixSeq = ptSnapshot->tInfo.u32FixSeq;
+	U32 u32FixMs = ptSnapshot->tInfo.u32FixMs;
+
+	if( bNewFix )
+	{
+		u32FixSeq++;
+		u32FixMs = ptInfo->u32FixMs;
+	}
+
+	// Mark the write as in progress before touching the data
+	__atomic_store_n( &ptSnapshot->u32Sequence, u32Seq + 1, __ATOMIC_RELAXED );
+	__atomic_thread_fence( __ATOMIC_RELEASE );
+
+	memcpy( &ptSnapshot->tInfo, ptInfo, sizeof(tGPS_INFO) );
+	ptSnapshot->tInfo.u32FixSeq = u32FixSeq;
+	ptSnapshot->tInfo.u32FixMs = u32FixMs;
+
+	// Data is complete, let readers have it
+	__atomic_store_n( &ptSnapshot->u32Sequence, u32Seq + 2, __ATOMIC_RELEASE );
+}
+
+//-----------------------------------------------------------------------------
+// Reader side. Never blocks the writer; retries if a publish overlapped the copy.
+void GPSINFO_Read( tGPS_SNAPSHOT *ptSnapshot, tGPS_INFO *ptInfo )
+{
+	U32 u32Before;
+	U32 u32After;
+
+	do
+	{
+		u32Before = __atomic_load_n( &ptSnapshot->u32Sequence, __ATOMIC_ACQUIRE );
+
+		memcpy( ptInfo, &ptSnapshot->tInfo, sizeof(tGPS_INFO) );
+
+		__atomic_thread_fence( __ATOMIC_ACQUIRE );
+		u32After = __atomic_load_n( &ptSnapshot->u32Sequence, __ATOMIC_RELAXED );
+
+	} while( (u32Before & 1) || (u32Before != u32After) );
+}
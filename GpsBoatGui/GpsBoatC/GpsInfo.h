@@ -0,0 +1,45 @@
+// GpsInfo.h
+// GPS fix data shared between the GPS thread and its readers (nav loop, GUI)
+// Note: Uses a sequence lock. The single writer (the GPS thread) never waits,
+//       readers retry their copy if a write was in progress, so a reader can
+//       never see the lat from one fix and the lon from another.
+
+#ifndef GPSINFO_H
+#define GPSINFO_H
+
+#include "includes.h"
+
+//-------------------------------------------
+// Global defines
+
+typedef struct
+{
+	float flat;
+	float flon;
+	long lat;			// millionths of a degree, as TinyGPS::get_position()
+	long lon;
+	float fmph;
+	float fmps;			// the same speed in m/s, 0 if the GPS gave none
+	float fcourse;
+	U8 hour;
+	U8 minute;
+	U8 second;
+	bool bGpsLocked;
+	U32 u32FixMs;		// HAL_Millis() the position was taken, its burst's start less GPS_FIX_LATENCY_MS
+	U32 u32FixSeq;		// bumped when a sentence brings a new position (TinyGPS's position
+						// fix time moved), not for GSV, VTG, ZDA etc. 0 == no position yet
+} tGPS_INFO;
+
+typedef struct
+{
+	U32 u32Sequence;	// odd while a write is in progress
+	tGPS_INFO tInfo;
+} tGPS_SNAPSHOT;
+
+//-------------------------------------------
+// Function prototypes
+
+void	GPSINFO_Publish( tGPS_SNAPSHOT *ptSnapshot, const tGPS_INFO *ptInfo, bool bNewFix );
+void	GPSINFO_Read( tGPS_SNAPSHOT *ptSnapshot, tGPS_INFO *ptInfo );
+
+#endif
@@ -0,0 +1,186 @@
+// GpsReader.cpp
+// Event driven reader for the GPS serial port
+// Note: Blocks in HAL_WaitFd() until the GPS has sent something, then reads everything
+//       that is waiting in one go and hands it to TinyGPS as a single block
+//       Each sentence read goes to the flight recorder (Recorder.h)
+//       Keeps when the GPS started sending its latest burst, BurstStart(), which
+//       is as close to the fix's own time as the port can tell
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "config.h"
+#include "Hal.h"
+#include "GpsReader.h"
+
+//------------------------------------------------------------------------------
+GpsReader::GpsReader()
+{
+	fd = -1;
+	lineLength = 0;
+	baud = GPS_BAUD;
+	bReading = false;
+	lastReadMs = 0;
+	burstMs = 0;
+}
+
+//------------------------------------------------------------------------------
+// Opens and configures the serial device (i.e. "/dev/ttyAMA0")
+bool GpsReader::Open( const char *device, int baud )
+{
+	int serial_fd;
+
+	if( (serial_fd = HAL_SerialOpen( device, baud )) < 0 )
+	{
+		fprintf (stderr, "Unable to open GPS serial device: %s\n", strerror (errno)) ;
+		return false;
+	}
+
+	this->baud = baud;
+
+	return Attach( serial_fd );
+}
+
+//------------------------------------------------------------------------------
+// Uses an already open descriptor, i.e. the slave side of a pty standing in
+// for the GPS serial port
+bool GpsReader::Attach( int new_fd )
+{
+	int flags;
+
+	// HAL_WaitFd() does the waiting, so read() must never block
+	if( (flags = fcntl( new_fd, F_GETFL )) < 0 ||
+		fcntl( new_fd, F_SETFL, flags | O_NONBLOCK ) < 0 )
+	{
+		fprintf (stderr, "GpsReader Attach error: %s\n", strerror (errno)) ;
+		return false;
+	}
+
+	fd = new_fd;
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+void GpsReader::Close( void )
+{
+	if( fd >= 0 )
+	{
+		HAL_SerialClose( fd );
+		fd = -1;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Waits up to timeout_ms (-1 == forever) for data from the GPS, then drains
+// everything available and parses it.
+// Returns the number of valid sentences parsed, 0 on timeout or if there was
+// nothing to read after all, -1 on error or if the other end hung up
+int GpsReader::Read( TinyGPS *pGps, int timeout_ms )
+{
+	int sentences = 0;
+	int status;
+	ssize_t len;
+	ssize_t total = 0;
+
+	if( (status = HAL_WaitFd( fd, timeout_ms )) < 0 )
+	{
+		fprintf (stderr, "GpsReader wait error: %s\n", strerror (errno)) ;
+		return -1;
+	}
+
+	if( status == 0 )
+	{
+		// Timeout
+		return 0;
+	}
+
+	// Drain the port. A short read means there is nothing more waiting.
+	do
+	{
+		len = read( fd, buffer, sizeof(buffer) );
+		if( len > 0 )
+		{
+			if( total == 0 )
+			{
+				Time( buffer, len );
+			}
+			total += len;
+#if DO_GPS_TEST
+			fwrite( buffer, 1, len, stdout );
+			fflush( stdout );
+#endif
+			sentences += pGps->encode( buffer, len );
+			Record( buffer, len );
+		}
+	} while( len == sizeof(buffer) );
+
+	if( len < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR )
+	{
+		fprintf (stderr, "GpsReader read error: %s\n", strerror (errno)) ;
+		// Still report anything parsed before the error
+		return (sentences > 0) ? sentences : -1;
+	}
+
+	if( total == 0 )
+	{
+		// Said readable but there was nothing there: end of file is the
+		// other end hanging up, EAGAIN or EINTR only a wake for nothing
+		return (len == 0) ? -1 : 0;
+	}
+
+	return sentences;
+}
+
+//------------------------------------------------------------------------------
+// Records each sentence as its line ends, one read can end several and start
+// the next. Lines longer than a sentence are cut short.
+void GpsReader::Record( const char *pData, int length )
+{
+	const char *pEnd = pData + length;
+	const char *pEol;
+	int count;
+	int copy;
+
+	while( pData < pEnd )
+	{
+		pEol = (const char *)memchr( pData, '\n', pEnd - pData );
+		count = (pEol ? pEol + 1 : pEnd) - pData;
+
+		copy = min( count, RECORDER_MAX_DATA - lineLength );
+		memcpy( line + lineLength, pData, copy );
+		lineLength += copy;
+
+		if( pEol )
+		{
+			RECORDER_Nmea( line, lineLength );
+			lineLength = 0;
+		}
+
+		pData += count;
+	}
+}
+
+//------------------------------------------------------------------------------
+// The first read after a quiet spell starts a burst. It began a line's worth
+// of characters ago: the reader is woken as bytes arrive, by the time the
+// first sentence has ended at the latest, however much came with it (a
+// replayed read can hold more or less than the one recorded).
+void GpsReader::Time( const char *pData, int length )
+{
+	U32 now = HAL_Millis();
+	const char *pEol = (const char *)memchr( pData, '\n', length );
+	U32 count = pEol ? pEol + 1 - pData : length;
+
+	if( !bReading || now - lastReadMs > GPS_READER_BURST_GAP_MS )
+	{
+		// 10 bits a character, start and stop included
+		burstMs = now - count * 10000 / baud;
+	}
+
+	bReading = true;
+	lastReadMs = now;
+}
@@ -0,0 +1,47 @@
+// GpsReader.h
+// Event driven reader for the GPS serial port
+// Note: Blocks in HAL_WaitFd() until the GPS has sent something, then reads everything
+//       that is waiting in one go and hands it to TinyGPS as a single block
+//       Each sentence read goes to the flight recorder (Recorder.h)
+//       Keeps when the GPS started sending its latest burst, BurstStart(), which
+//       is as close to the fix's own time as the port can tell
+
+#ifndef GPSREADER_h
+#define GPSREADER_h
+
+#include "includes.h"
+#include "TinyGPS.h"
+#include "Recorder.h"
+
+// Big enough for a full second of NMEA at 9600 baud
+#define GPS_READER_BUFFER_SIZE		1024
+
+// Quiet for longer than this, the next byte starts a new burst
+#define GPS_READER_BURST_GAP_MS		50
+
+//------------------------------------------------------------------------------
+class GpsReader
+{
+	public:
+		GpsReader();
+		bool Open( const char *device, int baud );
+		bool Attach( int fd );
+		void Close( void );
+		int  Read( TinyGPS *pGps, int timeout_ms );
+		int  GetFd( void ) { return fd; }
+		U32  BurstStart( void ) { return burstMs; }
+	private:
+		void Record( const char *pData, int length );
+		void Time( const char *pData, int length );
+
+		int fd;
+		char buffer[GPS_READER_BUFFER_SIZE];
+		char line[RECORDER_MAX_DATA];	// sentence so far, for the flight recorder
+		int lineLength;
+		int baud;
+		bool bReading;					// has read anything yet
+		U32 lastReadMs;					// HAL_Millis()
+		U32 burstMs;
+};
+
+#endif
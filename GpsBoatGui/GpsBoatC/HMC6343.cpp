@@ -31,10 +31,8 @@
 #include <string.h>
 #include <errno.h>
 
-#include <wiringPi.h>
-#include <wiringSerial.h>
-
 #include "includes.h"
+#include "Hal.h"
 #include "HMC6343.h"
 
 //*** local defines and typedefs *********************************************
@@ -47,17 +45,14 @@ typedef struct
 	U8	u8Setup;
 } REGISTER_SETUP;
 
-//*** global variable definitions ********************************************
-int gfd;
-
 //*** local function declarations ********************************************
 
-static bool SendCommand( U8 cmd, U8 arg1, U8 arg2, U8 size);
+static bool SendCommand( int fd, U8 cmd, U8 arg1, U8 arg2, U8 size);
 
-static bool ReadResponseBytes( U8 *pBuffer, U8 size);
+static bool ReadResponseBytes( int fd, U8 *pBuffer, U8 size);
 
 //*** local function definitions ********************************************
-bool SendCommand( U8 cmd, U8 arg1, U8 arg2, U8 size)
+bool SendCommand( int fd, U8 cmd, U8 arg1, U8 arg2, U8 size)
 {
 	U8 au8CommandStream[HMC6343__MAX_CMD_SIZE];
 	int i;
@@ -76,23 +71,24 @@ bool SendCommand( U8 cmd, U8 arg1, U8 arg2, U8 size)
 	}
 
 	// Start
-	serialPutchar( gfd, 'S' );
+	HAL_SerialPutchar( fd, 'S' );
 
 	// I2C Address
-	serialPutchar( gfd, (U8)HMC6343__ADDRESS );
+	HAL_SerialPutchar( fd, (U8)HMC6343__ADDRESS );
 
 	// Size
-	serialPutchar( gfd, (U8)size + 1 );
+	HAL_SerialPutchar( fd, (U8)size + 1 );
 
 	// Data
 	for(i=0; i<size; i++ )
 	{
-		serialPutchar( gfd, (U8)au8CommandStream[i] );
+		HAL_SerialPutchar( fd, (U8)au8CommandStream[i] );
 	}
 
 	// Stop
-	serialPutchar( gfd, 'P' );
+	HAL_SerialPutchar( fd, 'P' );
 
+	return true;
 }
 
 //*****************************************************************************
@@ -102,6 +98,7 @@ bool SendCommand( U8 cmd, U8 arg1, U8 arg2, U8 size)
 //	Reads bytes from a previously sent command via SendCommand()
 //
 //	Parameters:
+//		fd - compass serial port
 //		buffer - pointer to U8 buffer to fill
 //		size - number of expected return bytes
 //
@@ -109,34 +106,34 @@ bool SendCommand( U8 cmd, U8 arg1, U8 arg2, U8 size)
 //		nothing
 //
 //*****************************************************************************
-bool ReadResponseBytes( U8 *pBuffer, U8 size)
+bool ReadResponseBytes( int fd, U8 *pBuffer, U8 size)
 {
 	int i;
 	int size_avail;
 	bool bStatus = false;
 
 	// Start
-	serialPutchar( gfd, 'S' );
+	HAL_SerialPutchar( fd, 'S' );
 
 	// I2C Address
-	serialPutchar( gfd, (U8)HMC6343__ADDRESS | 0x01 );
+	HAL_SerialPutchar( fd, (U8)HMC6343__ADDRESS | 0x01 );
 
 	// Size
-	serialPutchar( gfd, (U8)size );
+	HAL_SerialPutchar( fd, (U8)size );
 
 	// Stop
-	serialPutchar( gfd, 'P' );
+	HAL_SerialPutchar( fd, 'P' );
 
-	delay(5);
+	HAL_Delay(5);
 
-	size_avail = serialDataAvail( gfd );
+	size_avail = HAL_SerialDataAvail( fd );
 
 	if( size_avail == size )
 	{
 		// Get Data
 		for(i=0; i<size_avail; i++ )
 		{
-			*pBuffer++ = serialGetchar ( gfd );
+			*pBuffer++ = HAL_SerialGetchar ( fd );
 		}
 
 		bStatus = true;
@@ -145,7 +142,7 @@ bool ReadResponseBytes( U8 *pBuffer, U8 size)
 	if( !bStatus )
 	{
 		printf("ReadResponseBytes failed. Bytes available: %i\n", size_avail);
-		serialFlush( gfd );
+		HAL_SerialFlush( fd );
 	}
 
 	return bStatus;
@@ -160,6 +157,7 @@ bool ReadResponseBytes( U8 *pBuffer, U8 size)
 //	Sends the requested single byte compass command
 //
 //	Parameters:
+//		fd - port from HMC6343_Setup()
 //		available commands:
 //			HMC6343__RESET_CPU__CMD					-	Reset the Processor
 //
@@ -179,9 +177,9 @@ bool ReadResponseBytes( U8 *pBuffer, U8 size)
 //		nothing
 //
 //*****************************************************************************
-void HMC6343_SendCommand( U8 cmd )
+void HMC6343_SendCommand( int fd, U8 cmd )
 {
-	SendCommand(cmd, 0, 0, 1);
+	SendCommand(fd, cmd, 0, 0, 1);
 }
 
 //*****************************************************************************
@@ -191,13 +189,13 @@ void HMC6343_SendCommand( U8 cmd )
 //	Initializes the default state of the compass.
 //
 //	Parameters:
-//		none
+//		pDevice - serial port of the SC18IM700 bridge, i.e. "/dev/ttyUSB0"
 //
 //	Returns:
-//		nothing
+//		int - port to pass to the other calls, -1 on failure
 //
 //*****************************************************************************
-void HMC6343_Setup( void )
+int HMC6343_Setup( const char *pDevice )
 {
 	static const REGISTER_SETUP atRegisterSetup[] =
 	{
@@ -208,27 +206,28 @@ void HMC6343_Setup( void )
 	REGISTER_SETUP const* ptRegisterSetup;
 	S16 s16Size;
 	U8 u8RegData;
+	int fd;
 
-	// Open the WiringPi serial port to SC18IM700 (Master I2C controller with uart interface)
+	// Open the serial port to SC18IM700 (Master I2C controller with uart interface)
 	printf("Opening serial port ... ");
-	gfd = serialOpen( "/dev/ttyUSB0" , 9600 );
+	fd = HAL_SerialOpen( pDevice , 9600 );
 
-	if( !gfd )
+	if( fd < 0 )
 	{
 		fprintf (stderr, "Unable to open serial port: %s\n", strerror (errno)) ;
-		return;
+		return -1;
 	}
 	else
 	{
 		printf("Serial Port opened\n");
-		serialFlush( gfd );
+		HAL_SerialFlush( fd );
 	}
 
 	// reset the compass
-	HMC6343_SendCommand( HMC6343__RESET_CPU__CMD );
+	HMC6343_SendCommand( fd, HMC6343__RESET_CPU__CMD );
 
 	// per chip spec, wait 500ms after reset
-	delay( 500 );
+	HAL_Delay( 500 );
 
 	// Verify operational mode registers are set correctly
 	for (
@@ -239,15 +238,15 @@ void HMC6343_Setup( void )
 	)
 	{
 		// Read
-		SendCommand(
+		SendCommand( fd,
 			HMC6343__READ_EEPROM__CMD,
 			ptRegisterSetup->u8Register, 0,
 			HMC6343__READ_EEPROM__CMD_SIZE );
 
 		// EEPROM read/writes need 10ms delay per spec
-		delay( 10 );
+		HAL_Delay( 10 );
 
-		ReadResponseBytes(
+		ReadResponseBytes( fd,
 			&u8RegData,
 			HMC6343__READ_EEPROM__DATA_SIZE );
 
@@ -255,21 +254,23 @@ void HMC6343_Setup( void )
 		if( ptRegisterSetup->u8Setup != u8RegData )
 		{
 			// Update
-			SendCommand(
+			SendCommand( fd,
 				HMC6343__WRITE_EEPROM__CMD,
 				ptRegisterSetup->u8Register,
 				ptRegisterSetup->u8Setup,
 				HMC6343__WRITE_EEPROM__CMD_SIZE
 			);
 
-			delay(10);
+			HAL_Delay(10);
 		}
 	}
 
-	SendCommand(
+	SendCommand( fd,
 			HMC6343__SET_UP_SIDEWAYS_ORIENT__CMD, 0, 0,
 			HMC6343__SET_UP_SIDEWAYS_ORIENT__CMD_SIZE
 	);
+
+	return fd;
 }
 
 //*****************************************************************************
@@ -279,15 +280,15 @@ void HMC6343_Setup( void )
 //	Shuts down the compass chip
 //
 //	Parameters:
-//		none
+//		fd - port from HMC6343_Setup()
 //
 //	Returns:
 //		none
 //
 //*****************************************************************************
-void HMC6343_Shutdown( void )
+void HMC6343_Shutdown( int fd )
 {
-	HMC6343_SendCommand( HMC6343__ENTER_SLEEP_MODE__CMD );
+	HMC6343_SendCommand( fd, HMC6343__ENTER_SLEEP_MODE__CMD );
 }
 
 //*****************************************************************************
@@ -297,26 +298,26 @@ void HMC6343_Shutdown( void )
 //	Gets current compass heading in tenths degrees
 //
 //	Parameters:
-//		none
+//		fd - port from HMC6343_Setup()
 //
 //	Returns:
 //		U16 - Heading
 //
 //*****************************************************************************
-S16 HMC6343_GetHeading( void )
+S16 HMC6343_GetHeading( int fd )
 {
 	U8 u8HeadPitchRoll[HMC6343__GET_HEADING_DATA__DATA_SIZE];
 	S16 s16Heading = COMPASS_HEADING_INVALID;
 
-	if (SendCommand(
+	if (SendCommand( fd,
 			HMC6343__GET_HEADING_DATA__CMD, 0, 0,
 			HMC6343__GET_HEADING_DATA__CMD_SIZE
 		)
 	)
 	{
-		delay(1);
+		HAL_Delay(1);
 
-		if( ReadResponseBytes( u8HeadPitchRoll, HMC6343__GET_HEADING_DATA__DATA_SIZE) )
+		if( ReadResponseBytes( fd, u8HeadPitchRoll, HMC6343__GET_HEADING_DATA__DATA_SIZE) )
 		{
 			s16Heading = (U16)(u8HeadPitchRoll[0]<<8 | u8HeadPitchRoll[1]);
 		}
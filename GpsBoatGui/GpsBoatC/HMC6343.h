@@ -429,9 +429,9 @@ Byte
 
 //*** global function prototypes *********************************************
 
-void	HMC6343_Setup( void );
-void	HMC6343_Shutdown( void );
-void	HMC6343_SendCommand( U8 cmd );
-S16		HMC6343_GetHeading( void );
+int		HMC6343_Setup( const char *pDevice );
+void	HMC6343_Shutdown( int fd );
+void	HMC6343_SendCommand( int fd, U8 cmd );
+S16		HMC6343_GetHeading( int fd );
 
 #endif // _HMC6343_H
@@ -0,0 +1,169 @@
+// Hal.cpp
+// The clock in use, and threads, the same on every backend. See Hal.h.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include "Hal.h"
+
+//-------------------------------------------
+// Local types
+
+typedef struct tTHREAD_START
+{
+	void *(*pfnThread)( void *pArg );
+	void *pArg;
+	const tHAL_CLOCK *ptClock;
+	void *pClockThread;				// the clock's handle, NULL if it has none
+} tTHREAD_START;
+
+//-------------------------------------------
+// Local data
+
+static const tHAL_CLOCK *gptClock = &gtHalBackendClock;
+
+//-------------------------------------------
+// Local prototypes
+
+static void		*ThreadMain( void *pArg );
+
+//-----------------------------------------------------------------------------
+// Set before any thread that uses the clock is started
+void HAL_SetClock( const tHAL_CLOCK *ptClock )
+{
+	gptClock = ptClock ? ptClock : &gtHalBackendClock;
+}
+
+//-----------------------------------------------------------------------------
+U32 HAL_Millis( void )
+{
+	return gptClock->pfnMillis();
+}
+
+//-----------------------------------------------------------------------------
+U32 HAL_Micros( void )
+{
+	return gptClock->pfnMicros();
+}
+
+//-----------------------------------------------------------------------------
+void HAL_Delay( U32 ms )
+{
+	gptClock->pfnDelay( ms );
+}
+
+//-----------------------------------------------------------------------------
+void HAL_DelayUntil( U32 us )
+{
+	long remaining;
+
+	if( gptClock->pfnDelayUntil )
+	{
+		gptClock->pfnDelayUntil( us );
+		return;
+	}
+
+	// A clock without one waits the rest in whole ms, rounded up
+	if( (remaining = HAL_US_DIFF( us, HAL_Micros() )) > 0 )
+	{
+		gptClock->pfnDelay( (remaining + 999) / 1000 );
+	}
+}
+
+//-----------------------------------------------------------------------------
+int HAL_WaitFd( int fd, int timeout_ms )
+{
+	struct pollfd tPoll;
+	int status;
+
+	if( gptClock->pfnWaitFd )
+	{
+		return gptClock->pfnWaitFd( fd, timeout_ms );
+	}
+
+	tPoll.fd = fd;
+	tPoll.events = POLLIN;
+
+	do
+	{
+		status = poll( &tPoll, 1, timeout_ms );
+	} while( status < 0 && errno == EINTR );
+
+	return status;
+}
+
+//-----------------------------------------------------------------------------
+// Starts pfnThread( pArg ). Returns false if it couldn't be.
+bool HAL_ThreadCreate( tHAL_THREAD *ptThread, void *(*pfnThread)( void *pArg ), void *pArg )
+{
+	tTHREAD_START *ptStart;
+	int status;
+
+	if( !(ptStart = (tTHREAD_START *)malloc( sizeof(tTHREAD_START) )) )
+	{
+		fprintf (stderr, "Unable to start thread: %s\n", strerror (errno)) ;
+		return false;
+	}
+
+	ptStart->pfnThread = pfnThread;
+	ptStart->pArg = pArg;
+	ptStart->ptClock = gptClock;
+	ptStart->pClockThread = NULL;
+
+	// The clock hears of the thread now, before the creator can wait on it
+	if( gptClock->pfnThreadAdd && !(ptStart->pClockThread = gptClock->pfnThreadAdd()) )
+	{
+		free( ptStart );
+		return false;
+	}
+
+	if( (status = pthread_create( ptThread, NULL, ThreadMain, ptStart )) != 0 )
+	{
+		fprintf (stderr, "Unable to start thread: %s\n", strerror (status)) ;
+
+		if( ptStart->pClockThread )
+		{
+			ptStart->ptClock->pfnThreadEnd( ptStart->pClockThread );
+		}
+
+		free( ptStart );
+		return false;
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Stops a thread at its next blocking call (poll(), sleeps, ...) and waits
+// for it to go
+void HAL_ThreadStop( tHAL_THREAD tThread )
+{
+	pthread_cancel( tThread );
+	pthread_join( tThread, NULL );
+}
+
+//-----------------------------------------------------------------------------
+// Runs a thread from HAL_ThreadCreate(), between the clock's begin and end
+void *ThreadMain( void *pArg )
+{
+	tTHREAD_START tStart = *(tTHREAD_START *)pArg;
+	void *pResult;
+
+	free( pArg );
+
+	if( !tStart.pClockThread )
+	{
+		return tStart.pfnThread( tStart.pArg );
+	}
+
+	// Begin may wait, and so be cancelled, so it's inside too
+	pthread_cleanup_push( tStart.ptClock->pfnThreadEnd, tStart.pClockThread );
+	tStart.ptClock->pfnThreadBegin( tStart.pClockThread );
+	pResult = tStart.pfnThread( tStart.pArg );
+	pthread_cleanup_pop( 1 );
+
+	return pResult;
+}
@@ -0,0 +1,105 @@
+// Hal.h
+// Hardware abstraction: the clock, serial ports, I2C devices, GPIO pins and
+// threads the boat code uses, and no more. One backend is linked in:
+//   HalPi.cpp     wiringPi on the Raspberry Pi (make)
+//   HalHost.cpp   a Linux PC (make HAL=host): serial ports are ptys, I2C
+//                 devices are in-memory register files, GPIO is virtual
+//   Sim.cpp       the simulated boat (make simboat), see Sim.h
+// Threads are POSIX on all of them (Hal.cpp).
+//
+// Serial ports and I2C devices are handles returned by the open calls, -1
+// on failure with errno set. Serial handles are file descriptors that can
+// be read() once HAL_WaitFd() says so (GpsReader does); I2C handles are only
+// for the HAL_I2c calls.
+//
+// Time comes from the backend's clock unless HAL_SetClock() swaps in another,
+// i.e. the virtual clock replays run on (VClock.h). Everything that waits,
+// HAL_Delay(), HAL_DelayUntil() and HAL_WaitFd(), goes through the clock, so a clock that
+// schedules threads always knows which are waiting.
+
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "includes.h"
+
+//-------------------------------------------
+// Global defines
+
+#define HAL_LOW			0
+#define HAL_HIGH		1
+
+#define HAL_INPUT		0
+#define HAL_OUTPUT		1
+
+// Microseconds from HAL_Micros() reading b to a, across a wrap. wiringPi's
+// micros() is 32 bits even where U32 is 64, and wraps every 71.6 minutes, so
+// clock differences are taken in 32 bits: right up to 35 minutes apart.
+#define HAL_US_DIFF(a, b)	((int32_t)(uint32_t)((a) - (b)))
+
+typedef pthread_t tHAL_THREAD;
+
+typedef struct tHAL_CLOCK
+{
+	U32		(*pfnMillis)( void );
+	U32		(*pfnMicros)( void );
+	void	(*pfnDelay)( U32 ms );
+	void	(*pfnDelayUntil)( U32 us );					// NULL: pfnDelay() the rest
+	int		(*pfnWaitFd)( int fd, int timeout_ms );		// NULL: poll()
+
+	// Told about threads from HAL_ThreadCreate(), NULL if it needn't be
+	void	*(*pfnThreadAdd)( void );					// in the creator
+	void	(*pfnThreadBegin)( void *pThread );			// first in the thread
+	void	(*pfnThreadEnd)( void *pThread );			// last, or on cancel
+} tHAL_CLOCK;
+
+//-------------------------------------------
+// Global data
+
+// Each backend's own clock
+extern const tHAL_CLOCK gtHalBackendClock;
+
+//-------------------------------------------
+// Function prototypes
+
+bool	HAL_Init( void );
+
+// Clock: ms (us) since HAL_Init(), delays in ms. HAL_DelayUntil() waits for
+// HAL_Micros() to reach us, at once if it has. HAL_WaitFd() is poll() for
+// one descriptor: >0 readable (or hung up), 0 timed out, -1 error.
+void	HAL_SetClock( const tHAL_CLOCK *ptClock );		// NULL: the backend's
+U32		HAL_Millis( void );
+U32		HAL_Micros( void );
+void	HAL_Delay( U32 ms );
+void	HAL_DelayUntil( U32 us );
+int		HAL_WaitFd( int fd, int timeout_ms );
+
+// Serial ports, i.e. "/dev/ttyAMA0"
+int		HAL_SerialOpen( const char *pDevice, int baud );
+void	HAL_SerialClose( int fd );
+void	HAL_SerialFlush( int fd );
+void	HAL_SerialPutchar( int fd, U8 c );
+int		HAL_SerialDataAvail( int fd );
+int		HAL_SerialGetchar( int fd );
+
+// Host backend only: HAL_SerialOpen( pDevice ) gets a dup() of fd (a pipe or
+// socket end) instead of the device, so a replay can play it
+bool	HAL_HostSerialBind( const char *pDevice, int fd );
+
+// I2C devices by 7 bit address, one byte transfers
+int		HAL_I2cOpen( int address );
+void	HAL_I2cClose( int fd );
+int		HAL_I2cRead( int fd );
+int		HAL_I2cWrite( int fd, U8 data );
+
+// GPIO, wiringPi pin numbers
+void	HAL_PinMode( int pin, int mode );
+void	HAL_DigitalWrite( int pin, int value );
+int		HAL_DigitalRead( int pin );
+
+// Threads
+bool	HAL_ThreadCreate( tHAL_THREAD *ptThread, void *(*pfnThread)( void *pArg ), void *pArg );
+void	HAL_ThreadStop( tHAL_THREAD tThread );
+
+#endif
@@ -0,0 +1,546 @@
+// HalHost.cpp
+// Hardware abstraction on a Linux PC, so gpsboat, test and the GUI run on a
+// dev box (make HAL=host). See Hal.h.
+//
+// Serial  A device that exists (a USB GPS, say) is opened raw at the baud
+//         rate. One that doesn't becomes a pty, linked as HAL_HOST_PTY_DIR
+//         plus the device's name, so another program can play the GPS or
+//         the compass bridge:  cat nmea.log > /tmp/gpsboat/ttyAMA0
+//         In-process players (replay) bind a device to a descriptor of
+//         their own with HAL_HostSerialBind() instead.
+// I2C     Each address is an in-memory file of 256 registers, read and
+//         written the way the Arduino sketch is: a register number, 0x80
+//         set for a write, then the value for a write.
+// GPIO    Virtual pins that read back what was written.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include "Hal.h"
+
+//-------------------------------------------
+// Local defines
+
+#define HAL_HOST_PTY_DIR		"/tmp/gpsboat/"
+
+#define HAL_HOST_MAX_SERIAL		8
+#define HAL_HOST_MAX_BINDS		4
+#define HAL_HOST_MAX_I2C		8
+#define HAL_HOST_MAX_PINS		64
+
+// I2C handles, well clear of real file descriptors
+#define HAL_HOST_I2C_FD_BASE	0x4000
+
+#define SERIAL_TIMEOUT_MS		10000		// wiringPi's serialGetchar()
+
+//-------------------------------------------
+// Local types
+
+typedef struct tHOST_SERIAL
+{
+	bool bOpen;
+	int fd;
+	int slaveFd;							// held open so the pty never hangs up
+	char acLink[64];						// pty link, "" for a real device
+} tHOST_SERIAL;
+
+typedef struct tHOST_BIND
+{
+	const char *pDevice;					// NULL when free
+	int fd;
+} tHOST_BIND;
+
+typedef struct tHOST_I2C
+{
+	bool bOpen;
+	int address;
+	U8 reg;
+	bool bWrite;							// the next byte is a value
+	U8 au8Reg[256];
+} tHOST_I2C;
+
+//-------------------------------------------
+// Local data
+
+static pthread_mutex_t gtLock = PTHREAD_MUTEX_INITIALIZER;
+static struct timespec gtEpoch;
+
+static tHOST_SERIAL gatSerial[HAL_HOST_MAX_SERIAL];
+static tHOST_BIND gatBind[HAL_HOST_MAX_BINDS];
+static tHOST_I2C gatI2c[HAL_HOST_MAX_I2C];
+
+static U8 gau8PinMode[HAL_HOST_MAX_PINS];
+static U8 gau8PinValue[HAL_HOST_MAX_PINS];
+
+//-------------------------------------------
+// Local prototypes
+
+static U32			Millis( void );
+static U32			Micros( void );
+static void			Delay( U32 ms );
+static void			DelayUntil( U32 us );
+static double		Elapsed( void );
+static speed_t		BaudToSpeed( int baud );
+static int			OpenTty( const char *pDevice, int baud );
+static int			OpenPty( const char *pDevice, tHOST_SERIAL *ptSerial );
+static tHOST_I2C	*I2cDevice( int fd );
+
+//-------------------------------------------
+// Global data
+
+const tHAL_CLOCK gtHalBackendClock = { Millis, Micros, Delay, DelayUntil, NULL, NULL, NULL, NULL };
+
+//-----------------------------------------------------------------------------
+bool HAL_Init( void )
+{
+	clock_gettime( CLOCK_MONOTONIC, &gtEpoch );
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+int HAL_SerialOpen( const char *pDevice, int baud )
+{
+	tHOST_SERIAL *ptSerial = NULL;
+	int fd;
+	int i;
+
+	pthread_mutex_lock( &gtLock );
+
+	for( i = 0; i < HAL_HOST_MAX_SERIAL; i++ )
+	{
+		if( !gatSerial[i].bOpen )
+		{
+			ptSerial = &gatSerial[i];
+			break;
+		}
+	}
+
+	if( !ptSerial )
+	{
+		pthread_mutex_unlock( &gtLock );
+		errno = EMFILE;
+		return -1;
+	}
+
+	ptSerial->slaveFd = -1;
+	ptSerial->acLink[0] = 0;
+
+	for( i = 0; i < HAL_HOST_MAX_BINDS; i++ )
+	{
+		if( gatBind[i].pDevice && 0 == strcmp( gatBind[i].pDevice, pDevice ) )
+		{
+			break;
+		}
+	}
+
+	if( i < HAL_HOST_MAX_BINDS )
+	{
+		fd = dup( gatBind[i].fd );
+	}
+	else if( access( pDevice, F_OK ) == 0 )
+	{
+		fd = OpenTty( pDevice, baud );
+	}
+	else
+	{
+		fd = OpenPty( pDevice, ptSerial );
+	}
+
+	ptSerial->bOpen = (fd >= 0);
+	ptSerial->fd = fd;
+
+	pthread_mutex_unlock( &gtLock );
+
+	return fd;
+}
+
+//-----------------------------------------------------------------------------
+void HAL_SerialClose( int fd )
+{
+	int i;
+
+	pthread_mutex_lock( &gtLock );
+
+	for( i = 0; i < HAL_HOST_MAX_SERIAL; i++ )
+	{
+		if( gatSerial[i].bOpen && gatSerial[i].fd == fd )
+		{
+			if( gatSerial[i].slaveFd >= 0 )
+			{
+				close( gatSerial[i].slaveFd );
+			}
+
+			if( gatSerial[i].acLink[0] )
+			{
+				unlink( gatSerial[i].acLink );
+			}
+
+			gatSerial[i].bOpen = false;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock( &gtLock );
+
+	close( fd );
+}
+
+//-----------------------------------------------------------------------------
+void HAL_SerialFlush( int fd )
+{
+	tcflush( fd, TCIOFLUSH );
+}
+
+//-----------------------------------------------------------------------------
+// A pty nobody is reading drops the byte, as an unplugged line would
+void HAL_SerialPutchar( int fd, U8 c )
+{
+	if( write( fd, &c, 1 ) != 1 && errno != EAGAIN )
+	{
+		fprintf (stderr, "Serial write failed: %s\n", strerror (errno)) ;
+	}
+}
+
+//-----------------------------------------------------------------------------
+int HAL_SerialDataAvail( int fd )
+{
+	int avail;
+
+	if( ioctl( fd, FIONREAD, &avail ) < 0 )
+	{
+		return -1;
+	}
+
+	return avail;
+}
+
+//-----------------------------------------------------------------------------
+// Waits up to SERIAL_TIMEOUT_MS for a byte, -1 if none came
+int HAL_SerialGetchar( int fd )
+{
+	U8 c;
+
+	if( HAL_WaitFd( fd, SERIAL_TIMEOUT_MS ) <= 0 || read( fd, &c, 1 ) != 1 )
+	{
+		return -1;
+	}
+
+	return c;
+}
+
+//-----------------------------------------------------------------------------
+// pDevice is kept, not copied. Bind before the device is opened.
+bool HAL_HostSerialBind( const char *pDevice, int fd )
+{
+	bool bStatus = false;
+	int i;
+
+	pthread_mutex_lock( &gtLock );
+
+	for( i = 0; i < HAL_HOST_MAX_BINDS; i++ )
+	{
+		if( !gatBind[i].pDevice )
+		{
+			gatBind[i].pDevice = pDevice;
+			gatBind[i].fd = fd;
+			bStatus = true;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock( &gtLock );
+
+	return bStatus;
+}
+
+//-----------------------------------------------------------------------------
+// Opening an address again gets the same registers back
+int HAL_I2cOpen( int address )
+{
+	tHOST_I2C *ptDevice = NULL;
+	int i;
+
+	pthread_mutex_lock( &gtLock );
+
+	for( i = 0; i < HAL_HOST_MAX_I2C; i++ )
+	{
+		if( gatI2c[i].bOpen && gatI2c[i].address == address )
+		{
+			ptDevice = &gatI2c[i];
+			break;
+		}
+
+		if( !gatI2c[i].bOpen && !ptDevice )
+		{
+			ptDevice = &gatI2c[i];
+		}
+	}
+
+	if( !ptDevice )
+	{
+		pthread_mutex_unlock( &gtLock );
+		errno = EMFILE;
+		return -1;
+	}
+
+	if( !ptDevice->bOpen )
+	{
+		memset( ptDevice, 0, sizeof(tHOST_I2C) );
+		ptDevice->bOpen = true;
+		ptDevice->address = address;
+	}
+
+	ptDevice->bWrite = false;
+
+	pthread_mutex_unlock( &gtLock );
+
+	return HAL_HOST_I2C_FD_BASE + (int)(ptDevice - gatI2c);
+}
+
+//-----------------------------------------------------------------------------
+// The registers are kept for the next open
+void HAL_I2cClose( int fd )
+{
+}
+
+//-----------------------------------------------------------------------------
+int HAL_I2cRead( int fd )
+{
+	tHOST_I2C *ptDevice;
+
+	if( !(ptDevice = I2cDevice( fd )) )
+	{
+		return -1;
+	}
+
+	return ptDevice->au8Reg[ptDevice->reg];
+}
+
+//-----------------------------------------------------------------------------
+int HAL_I2cWrite( int fd, U8 data )
+{
+	tHOST_I2C *ptDevice;
+
+	if( !(ptDevice = I2cDevice( fd )) )
+	{
+		return -1;
+	}
+
+	if( ptDevice->bWrite )
+	{
+		ptDevice->au8Reg[ptDevice->reg] = data;
+		ptDevice->bWrite = false;
+	}
+	else
+	{
+		ptDevice->reg = data & 0x7F;
+		ptDevice->bWrite = (data & 0x80) != 0;
+	}
+
+	return 0;
+}
+
+//-----------------------------------------------------------------------------
+void HAL_PinMode( int pin, int mode )
+{
+	if( pin >= 0 && pin < HAL_HOST_MAX_PINS )
+	{
+		gau8PinMode[pin] = (U8)mode;
+	}
+}
+
+//-----------------------------------------------------------------------------
+void HAL_DigitalWrite( int pin, int value )
+{
+	if( pin >= 0 && pin < HAL_HOST_MAX_PINS && gau8PinMode[pin] == HAL_OUTPUT )
+	{
+		gau8PinValue[pin] = value ? HAL_HIGH : HAL_LOW;
+	}
+}
+
+//-----------------------------------------------------------------------------
+int HAL_DigitalRead( int pin )
+{
+	return (pin >= 0 && pin < HAL_HOST_MAX_PINS) ? gau8PinValue[pin] : HAL_LOW;
+}
+
+//-----------------------------------------------------------------------------
+U32 Millis( void )
+{
+	return (U32)(Elapsed() * 1000.0);
+}
+
+//-----------------------------------------------------------------------------
+U32 Micros( void )
+{
+	return (U32)(Elapsed() * 1000000.0);
+}
+
+//-----------------------------------------------------------------------------
+void Delay( U32 ms )
+{
+	struct timespec tWait;
+
+	tWait.tv_sec = ms / 1000;
+	tWait.tv_nsec = (ms % 1000) * 1000000L;
+
+	while( nanosleep( &tWait, &tWait ) < 0 && errno == EINTR )
+		;
+}
+
+//-----------------------------------------------------------------------------
+// Sleeps to a CLOCK_MONOTONIC time, so a signal and a restart don't make it
+// late
+void DelayUntil( U32 us )
+{
+	struct timespec tWake;
+	long remaining = HAL_US_DIFF( us, Micros() );
+
+	if( remaining <= 0 )
+	{
+		return;
+	}
+
+	clock_gettime( CLOCK_MONOTONIC, &tWake );
+	tWake.tv_sec += remaining / 1000000;
+	tWake.tv_nsec += (remaining % 1000000) * 1000L;
+	if( tWake.tv_nsec >= 1000000000L )
+	{
+		tWake.tv_sec++;
+		tWake.tv_nsec -= 1000000000L;
+	}
+
+	while( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &tWake, NULL ) == EINTR )
+		;
+}
+
+//-----------------------------------------------------------------------------
+// Seconds since HAL_Init()
+double Elapsed( void )
+{
+	struct timespec tNow;
+
+	clock_gettime( CLOCK_MONOTONIC, &tNow );
+
+	return (tNow.tv_sec - gtEpoch.tv_sec) + (tNow.tv_nsec - gtEpoch.tv_nsec) * 1e-9;
+}
+
+//-----------------------------------------------------------------------------
+speed_t BaudToSpeed( int baud )
+{
+	switch( baud )
+	{
+	case 4800:		return B4800;
+	case 9600:		return B9600;
+	case 19200:		return B19200;
+	case 38400:		return B38400;
+	case 57600:		return B57600;
+	case 115200:	return B115200;
+	default:		return 0;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// A real port, 8N1 raw like wiringPi's serialOpen()
+int OpenTty( const char *pDevice, int baud )
+{
+	struct termios tOptions;
+	speed_t speed;
+	int fd;
+
+	if( (speed = BaudToSpeed( baud )) == 0 )
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	if( (fd = open( pDevice, O_RDWR | O_NOCTTY )) < 0 )
+	{
+		return -1;
+	}
+
+	if( tcgetattr( fd, &tOptions ) == 0 )
+	{
+		cfmakeraw( &tOptions );
+		cfsetispeed( &tOptions, speed );
+		cfsetospeed( &tOptions, speed );
+		tOptions.c_cflag |= (CLOCAL | CREAD);
+		tcsetattr( fd, TCSANOW, &tOptions );
+	}
+
+	return fd;
+}
+
+//-----------------------------------------------------------------------------
+// A pty standing in for a missing device, linked where another program can
+// find it
+int OpenPty( const char *pDevice, tHOST_SERIAL *ptSerial )
+{
+	struct termios tOptions;
+	const char *pName;
+	char *pSlave;
+	int fd;
+
+	// Non-blocking, so writes nobody reads can't stall the caller once the
+	// pty's buffer fills
+	if( (fd = posix_openpt( O_RDWR | O_NOCTTY | O_NONBLOCK )) < 0 )
+	{
+		return -1;
+	}
+
+	if( grantpt( fd ) < 0 || unlockpt( fd ) < 0 || !(pSlave = ptsname( fd ))
+		|| (ptSerial->slaveFd = open( pSlave, O_RDWR | O_NOCTTY )) < 0 )
+	{
+		close( fd );
+		return -1;
+	}
+
+	// No echo or line editing in either direction
+	if( tcgetattr( ptSerial->slaveFd, &tOptions ) == 0 )
+	{
+		cfmakeraw( &tOptions );
+		tcsetattr( ptSerial->slaveFd, TCSANOW, &tOptions );
+	}
+
+	pName = strrchr( pDevice, '/' ) ? strrchr( pDevice, '/' ) + 1 : pDevice;
+	snprintf( ptSerial->acLink, sizeof(ptSerial->acLink), "%s%s", HAL_HOST_PTY_DIR, pName );
+
+	mkdir( HAL_HOST_PTY_DIR, 0777 );
+	unlink( ptSerial->acLink );
+
+	if( symlink( pSlave, ptSerial->acLink ) < 0 )
+	{
+		fprintf (stderr, "Unable to link %s: %s\n", ptSerial->acLink, strerror (errno)) ;
+		ptSerial->acLink[0] = 0;
+		fprintf( stderr, "%s is not here, using pty %s\n", pDevice, pSlave );
+	}
+	else
+	{
+		fprintf( stderr, "%s is not here, using pty %s\n", pDevice, ptSerial->acLink );
+	}
+
+	return fd;
+}
+
+//-----------------------------------------------------------------------------
+tHOST_I2C *I2cDevice( int fd )
+{
+	int slot = fd - HAL_HOST_I2C_FD_BASE;
+
+	if( slot < 0 || slot >= HAL_HOST_MAX_I2C || !gatI2c[slot].bOpen )
+	{
+		errno = EBADF;
+		return NULL;
+	}
+
+	return &gatI2c[slot];
+}
@@ -0,0 +1,152 @@
+// HalPi.cpp
+// Hardware abstraction on the Raspberry Pi, straight onto wiringPi. See Hal.h.
+
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <wiringPi.h>
+#include <wiringSerial.h>
+#include <wiringPiI2C.h>
+#include "Hal.h"
+
+//-------------------------------------------
+// Local prototypes
+
+static U32		Millis( void );
+static U32		Micros( void );
+static void		Delay( U32 ms );
+static void		DelayUntil( U32 us );
+
+//-------------------------------------------
+// Global data
+
+const tHAL_CLOCK gtHalBackendClock = { Millis, Micros, Delay, DelayUntil, NULL, NULL, NULL, NULL };
+
+//-----------------------------------------------------------------------------
+bool HAL_Init( void )
+{
+	return wiringPiSetup() >= 0;
+}
+
+//-----------------------------------------------------------------------------
+int HAL_SerialOpen( const char *pDevice, int baud )
+{
+	return serialOpen( pDevice, baud );
+}
+
+//-----------------------------------------------------------------------------
+void HAL_SerialClose( int fd )
+{
+	serialClose( fd );
+}
+
+//-----------------------------------------------------------------------------
+void HAL_SerialFlush( int fd )
+{
+	serialFlush( fd );
+}
+
+//-----------------------------------------------------------------------------
+void HAL_SerialPutchar( int fd, U8 c )
+{
+	serialPutchar( fd, c );
+}
+
+//-----------------------------------------------------------------------------
+int HAL_SerialDataAvail( int fd )
+{
+	return serialDataAvail( fd );
+}
+
+//-----------------------------------------------------------------------------
+int HAL_SerialGetchar( int fd )
+{
+	return serialGetchar( fd );
+}
+
+//-----------------------------------------------------------------------------
+int HAL_I2cOpen( int address )
+{
+	return wiringPiI2CSetup( address );
+}
+
+//-----------------------------------------------------------------------------
+void HAL_I2cClose( int fd )
+{
+	close( fd );
+}
+
+//-----------------------------------------------------------------------------
+int HAL_I2cRead( int fd )
+{
+	return wiringPiI2CRead( fd );
+}
+
+//-----------------------------------------------------------------------------
+int HAL_I2cWrite( int fd, U8 data )
+{
+	return wiringPiI2CWrite( fd, data );
+}
+
+//-----------------------------------------------------------------------------
+void HAL_PinMode( int pin, int mode )
+{
+	pinMode( pin, (mode == HAL_OUTPUT) ? OUTPUT : INPUT );
+}
+
+//-----------------------------------------------------------------------------
+void HAL_DigitalWrite( int pin, int value )
+{
+	digitalWrite( pin, value ? HIGH : LOW );
+}
+
+//-----------------------------------------------------------------------------
+int HAL_DigitalRead( int pin )
+{
+	return (digitalRead( pin ) == HIGH) ? HAL_HIGH : HAL_LOW;
+}
+
+//-----------------------------------------------------------------------------
+U32 Millis( void )
+{
+	return millis();
+}
+
+//-----------------------------------------------------------------------------
+U32 Micros( void )
+{
+	return micros();
+}
+
+//-----------------------------------------------------------------------------
+void Delay( U32 ms )
+{
+	delay( ms );
+}
+
+//-----------------------------------------------------------------------------
+// Sleeps to a CLOCK_MONOTONIC time, so a signal and a restart don't make it
+// late
+void DelayUntil( U32 us )
+{
+	struct timespec tWake;
+	long remaining = HAL_US_DIFF( us, Micros() );
+
+	if( remaining <= 0 )
+	{
+		return;
+	}
+
+	clock_gettime( CLOCK_MONOTONIC, &tWake );
+	tWake.tv_sec += remaining / 1000000;
+	tWake.tv_nsec += (remaining % 1000000) * 1000L;
+	if( tWake.tv_nsec >= 1000000000L )
+	{
+		tWake.tv_sec++;
+		tWake.tv_nsec -= 1000000000L;
+	}
+
+	while( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &tWake, NULL ) == EINTR )
+		;
+}
@@ -0,0 +1,99 @@
+// Helm.cpp
+// PID heading controller. See Helm.h.
+
+#include <string.h>
+#include <math.h>
+#include "Helm.h"
+#include "config.h"
+
+//-------------------------------------------
+// Local defines
+
+#define HELM_MAX_GAP_MS		500			// longer between updates starts the rate afresh
+
+//-----------------------------------------------------------------------------
+void HELM_Init( tHELM *ptHelm, const tHELM_GAINS *ptGains )
+{
+	memset( ptHelm, 0, sizeof(tHELM) );
+
+	ptHelm->tGains = *ptGains;
+}
+
+//-----------------------------------------------------------------------------
+// Forgets the last run: rudder centered, nothing integrated, no turn rate
+void HELM_Reset( tHELM *ptHelm )
+{
+	ptHelm->bStarted = false;
+	ptHelm->fRate = 0.0;
+	ptHelm->fError = 0.0;
+	ptHelm->fIntegral = 0.0;
+	ptHelm->fOutput = 0.0;
+}
+
+//-----------------------------------------------------------------------------
+// The rudder setting to bring fHeading round to fBearing (degrees true, both)
+int HELM_Update( tHELM *ptHelm, float fBearing, float fHeading, U32 u32NowMs )
+{
+	const tHELM_GAINS *ptGains = &ptHelm->tGains;
+	float dt = 0.0;
+	float fIntegral;
+	float fOutput;
+	U32 u32Gap = u32NowMs - ptHelm->u32LastMs;
+
+	ptHelm->fError = HELM_HeadingError( fBearing, fHeading );
+
+	if( !ptHelm->bStarted || u32Gap > HELM_MAX_GAP_MS )
+	{
+		ptHelm->fRate = 0.0;
+	}
+	else if( u32Gap > 0 )
+	{
+		dt = u32Gap / 1000.0;
+		ptHelm->fRate += (HELM_HeadingError( fHeading, ptHelm->fLastHeading ) / dt - ptHelm->fRate)
+						 * min( dt / ptGains->fRateTau, 1.0f );
+	}
+
+	ptHelm->bStarted = true;
+	ptHelm->u32LastMs = u32NowMs;
+	ptHelm->fLastHeading = fHeading;
+
+	fIntegral = constrain( ptHelm->fIntegral + ptGains->fKi * ptHelm->fError * dt,
+						   -ptGains->fIntegralMax, ptGains->fIntegralMax );
+
+	fOutput = ptGains->fKp * ptHelm->fError + fIntegral - ptGains->fKd * ptHelm->fRate;
+
+	// Anti-windup: pinned, and the error pushing it further, the integral holds
+	if( fabs( fOutput ) < 1.0 || (fOutput > 0.0) != (ptHelm->fError > 0.0) )
+	{
+		ptHelm->fIntegral = fIntegral;
+	}
+
+	fOutput = constrain( fOutput, -1.0f, 1.0f );
+	ptHelm->fOutput += constrain( fOutput - ptHelm->fOutput, -ptGains->fSlew * dt, ptGains->fSlew * dt );
+
+	if( ptHelm->fOutput >= 0.0 )
+	{
+		return RUDDER_CENTER + round( ptHelm->fOutput * (RUDDER_FULL_RIGHT - RUDDER_CENTER) );
+	}
+
+	return RUDDER_CENTER + round( ptHelm->fOutput * (RUDDER_CENTER - RUDDER_FULL_LEFT) );
+}
+
+//-----------------------------------------------------------------------------
+// Degrees from fHeading to fBearing the shortest way round, -180 .. 180,
+// + == right
+float HELM_HeadingError( float fBearing, float fHeading )
+{
+	float fError = fmod( fBearing - fHeading, 360.0f );
+
+	if( fError > 180.0 )
+	{
+		fError -= 360.0;
+	}
+	else if( fError <= -180.0 )
+	{
+		fError += 360.0;
+	}
+
+	return fError;
+}
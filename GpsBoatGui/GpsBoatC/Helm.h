@@ -0,0 +1,59 @@
+// Helm.h
+// PID heading controller: steers the boat onto a bearing with a rudder
+// setting anywhere from RUDDER_FULL_LEFT to RUDDER_FULL_RIGHT, instead of
+// full left, full right or center.
+//
+//   HELM_Init( &tHelm, &tGains );
+//   HELM_Reset( &tHelm );				// a new run, rudder centered
+//   each tick:
+//       SetRudder( HELM_Update( &tHelm, bearing, heading, HAL_Millis() ) );
+//
+// The error is the shortest way round to the bearing, so 350 to 10 is 20
+// degrees right. The derivative term works on the compass's turn rate, not
+// the error, so a new bearing doesn't kick the rudder, and the rate is
+// filtered over fRateTau against compass noise. The integral term
+// (current, wind, a bent rudder) is held to fIntegralMax, and stops growing
+// while the output is pinned the way the error would push it. The output
+// moves at most fSlew a second.
+//
+// Terms are in fractions of full rudder, -1 (left) .. 1 (right).
+
+#ifndef HELM_H
+#define HELM_H
+
+#include "includes.h"
+
+//-------------------------------------------
+// Global defines
+
+typedef struct
+{
+	float fKp;					// per degree of error
+	float fKi;					// per degree second
+	float fKd;					// per degree/s turning toward the bearing
+	float fIntegralMax;
+	float fSlew;				// per second
+	float fRateTau;				// s, turn rate filter
+} tHELM_GAINS;
+
+typedef struct
+{
+	tHELM_GAINS tGains;
+	bool bStarted;				// has a heading to take the rate from
+	U32 u32LastMs;
+	float fLastHeading;
+	float fRate;				// degrees/s, filtered, + == turning right
+	float fError;				// degrees, last, + == bearing to the right
+	float fIntegral;
+	float fOutput;
+} tHELM;
+
+//-------------------------------------------
+// Function prototypes
+
+void	HELM_Init( tHELM *ptHelm, const tHELM_GAINS *ptGains );
+void	HELM_Reset( tHELM *ptHelm );
+int		HELM_Update( tHELM *ptHelm, float fBearing, float fHeading, U32 u32NowMs );
+float	HELM_HeadingError( float fBearing, float fHeading );
+
+#endif
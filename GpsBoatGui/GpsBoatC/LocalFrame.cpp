@@ -0,0 +1,269 @@
+// LocalFrame.cpp
+// Local East-North-Up navigation frame. See LocalFrame.h.
+
+#include <math.h>
+#include <string.h>
+#include "LocalFrame.h"
+
+//-------------------------------------------
+// WGS84
+
+#define WGS84_A			6378137.0
+#define WGS84_F			(1.0 / 298.257223563)
+#define WGS84_E2		(WGS84_F * (2.0 - WGS84_F))
+
+#define RADIANS_PER_MILLIONTH	(M_PI / 180000000.0)
+#define DEGREES_PER_RADIAN		(180.0 / M_PI)
+
+#define MILLIONTHS_360			360000000L
+
+// Newton steps for ENU_ToGeodetic(), 3 reaches 1e-9 m inside 10 km
+#define ENU_INVERSE_STEPS		3
+
+//-------------------------------------------
+// Local prototypes
+
+static void		SinCosSmall( double h, double *pdSin, double *pdCos );
+static long		WrapMillionths( long delta );
+static double	Atan2Deg( double y, double x );
+static void		Project( const tENU_FRAME *ptFrame, double dLat, double dLon, tENU_POS *ptPos );
+
+//-----------------------------------------------------------------------------
+// Anchors the frame, lat0/lon0 in millionths of a degree
+void ENU_Init( tENU_FRAME *ptFrame, long lat0, long lon0 )
+{
+	double dLat = lat0 * RADIANS_PER_MILLIONTH;
+	double w;
+	double N;
+
+	memset( ptFrame, 0, sizeof(tENU_FRAME) );
+
+	ptFrame->lat0 = lat0;
+	ptFrame->lon0 = lon0;
+	ptFrame->dSinLat0 = sin( dLat );
+	ptFrame->dCosLat0 = cos( dLat );
+
+	w = 1.0 - WGS84_E2 * ptFrame->dSinLat0 * ptFrame->dSinLat0;
+	N = WGS84_A / sqrt( w );
+
+	ptFrame->dX0 = N * ptFrame->dCosLat0;
+	ptFrame->dZ0 = N * (1.0 - WGS84_E2) * ptFrame->dSinLat0;
+	ptFrame->dM0 = N * (1.0 - WGS84_E2) / w;
+	ptFrame->dP0 = N * ptFrame->dCosLat0;
+	ptFrame->dConvergence = ptFrame->dSinLat0 / ptFrame->dP0 * DEGREES_PER_RADIAN;
+
+	ptFrame->bValid = true;
+}
+
+//-----------------------------------------------------------------------------
+// lat/lon in millionths of a degree to the plane
+void ENU_FromGeodetic( const tENU_FRAME *ptFrame, long lat, long lon, tENU_POS *ptPos )
+{
+	Project( ptFrame, (lat - ptFrame->lat0) * RADIANS_PER_MILLIONTH,
+			 WrapMillionths( lon - ptFrame->lon0 ) * RADIANS_PER_MILLIONTH, ptPos );
+}
+
+//-----------------------------------------------------------------------------
+// The plane back to lat/lon in millionths of a degree (the point on the
+// ellipsoid below/above ptPos). Newton steps on the forward projection.
+void ENU_ToGeodetic( const tENU_FRAME *ptFrame, const tENU_POS *ptPos, long *plLat, long *plLon )
+{
+	double dLat = ptPos->dNorth / ptFrame->dM0;
+	double dLon = ptPos->dEast / ptFrame->dP0;
+	tENU_POS tGuess;
+	int i;
+
+	for( i = 0; i < ENU_INVERSE_STEPS; i++ )
+	{
+		Project( ptFrame, dLat, dLon, &tGuess );
+		dLat += (ptPos->dNorth - tGuess.dNorth) / ptFrame->dM0;
+		dLon += (ptPos->dEast - tGuess.dEast) / ptFrame->dP0;
+	}
+
+	*plLat = ptFrame->lat0 + lround( dLat / RADIANS_PER_MILLIONTH );
+	*plLon = ptFrame->lon0 + WrapMillionths( lround( dLon / RADIANS_PER_MILLIONTH ) );
+}
+
+//-----------------------------------------------------------------------------
+// Is the plane good enough to navigate at this position?
+bool ENU_InRange( const tENU_POS *ptPos )
+{
+	return (ptPos->dEast * ptPos->dEast + ptPos->dNorth * ptPos->dNorth) <= (ENU_MAX_RADIUS_M * ENU_MAX_RADIUS_M);
+}
+
+//-----------------------------------------------------------------------------
+double ENU_Distance( const tENU_POS *ptFrom, const tENU_POS *ptTo )
+{
+	double dEast = ptTo->dEast - ptFrom->dEast;
+	double dNorth = ptTo->dNorth - ptFrom->dNorth;
+
+	return sqrt( dEast * dEast + dNorth * dNorth );
+}
+
+//-----------------------------------------------------------------------------
+double ENU_Bearing( const tENU_FRAME *ptFrame, const tENU_POS *ptFrom, const tENU_POS *ptTo )
+{
+	double dBearing = Atan2Deg( ptTo->dEast - ptFrom->dEast, ptTo->dNorth - ptFrom->dNorth ) +
+					  ptFrom->dEast * ptFrame->dConvergence;
+
+	if( dBearing < 0.0 )
+	{
+		dBearing += 360.0;
+	}
+	else if( dBearing >= 360.0 )
+	{
+		dBearing -= 360.0;
+	}
+
+	return dBearing;
+}
+
+//-----------------------------------------------------------------------------
+// Distance (meters) of ptPos from the track ptStart -> ptEnd, positive when
+// right of track. Distance from ptStart if the track has no length.
+double ENU_CrossTrack( const tENU_POS *ptStart, const tENU_POS *ptEnd, const tENU_POS *ptPos )
+{
+	double dTrackE = ptEnd->dEast - ptStart->dEast;
+	double dTrackN = ptEnd->dNorth - ptStart->dNorth;
+	double dLength = sqrt( dTrackE * dTrackE + dTrackN * dTrackN );
+
+	if( dLength == 0.0 )
+	{
+		return ENU_Distance( ptStart, ptPos );
+	}
+
+	return ((ptPos->dEast - ptStart->dEast) * dTrackN - (ptPos->dNorth - ptStart->dNorth) * dTrackE) / dLength;
+}
+
+//-----------------------------------------------------------------------------
+void ENU_SetLeg( tENU_LEG *ptLeg, const tENU_POS *ptStart, const tENU_POS *ptEnd )
+{
+	ptLeg->tStart = *ptStart;
+	ptLeg->dLength = ENU_Distance( ptStart, ptEnd );
+
+	if( ptLeg->dLength == 0.0 )
+	{
+		ptLeg->dUnitE = 0.0;
+		ptLeg->dUnitN = 1.0;
+		return;
+	}
+
+	ptLeg->dUnitE = (ptEnd->dEast - ptStart->dEast) / ptLeg->dLength;
+	ptLeg->dUnitN = (ptEnd->dNorth - ptStart->dNorth) / ptLeg->dLength;
+}
+
+//-----------------------------------------------------------------------------
+// Meters along the leg from its start, and across it, positive when right of
+// track as ENU_CrossTrack()
+void ENU_LegOffset( const tENU_LEG *ptLeg, const tENU_POS *ptPos, double *pdAlong, double *pdCross )
+{
+	double dEast = ptPos->dEast - ptLeg->tStart.dEast;
+	double dNorth = ptPos->dNorth - ptLeg->tStart.dNorth;
+
+	*pdAlong = dEast * ptLeg->dUnitE + dNorth * ptLeg->dUnitN;
+	*pdCross = dEast * ptLeg->dUnitN - dNorth * ptLeg->dUnitE;
+}
+
+//-----------------------------------------------------------------------------
+// The point dAlong the leg and dCross right of it
+void ENU_LegPoint( const tENU_LEG *ptLeg, double dAlong, double dCross, tENU_POS *ptPos )
+{
+	ptPos->dEast = ptLeg->tStart.dEast + dAlong * ptLeg->dUnitE + dCross * ptLeg->dUnitN;
+	ptPos->dNorth = ptLeg->tStart.dNorth + dAlong * ptLeg->dUnitN - dCross * ptLeg->dUnitE;
+}
+
+//-----------------------------------------------------------------------------
+// dLat/dLon are offsets from the anchor in radians. ECEF of the point,
+// relative to the anchor, rotated into east/north. The ECEF frame is turned
+// to the anchor's longitude, so only the offset's sin/cos are needed.
+void Project( const tENU_FRAME *ptFrame, double dLat, double dLon, tENU_POS *ptPos )
+{
+	double dSinD;
+	double dCosD;
+	double dSinLat;
+	double dCosLat;
+	double dSinLon;
+	double dCosLon;
+	double N;
+	double dX;
+	double dZ;
+
+	SinCosSmall( dLat, &dSinD, &dCosD );
+	dSinLat = ptFrame->dSinLat0 * dCosD + ptFrame->dCosLat0 * dSinD;
+	dCosLat = ptFrame->dCosLat0 * dCosD - ptFrame->dSinLat0 * dSinD;
+
+	SinCosSmall( dLon, &dSinLon, &dCosLon );
+
+	N = WGS84_A / sqrt( 1.0 - WGS84_E2 * dSinLat * dSinLat );
+
+	dX = N * dCosLat * dCosLon - ptFrame->dX0;
+	dZ = N * (1.0 - WGS84_E2) * dSinLat - ptFrame->dZ0;
+
+	ptPos->dEast = N * dCosLat * dSinLon;
+	ptPos->dNorth = ptFrame->dCosLat0 * dZ - ptFrame->dSinLat0 * dX;
+}
+
+//-----------------------------------------------------------------------------
+// sin/cos by Taylor series, for |h| up to ~0.15 rad (~1000 km)
+void SinCosSmall( double h, double *pdSin, double *pdCos )
+{
+	double h2 = h * h;
+
+	*pdSin = h * (1.0 - h2 / 6.0 * (1.0 - h2 / 20.0 * (1.0 - h2 / 42.0 * (1.0 - h2 / 72.0))));
+	*pdCos = 1.0 - h2 / 2.0 * (1.0 - h2 / 12.0 * (1.0 - h2 / 30.0 * (1.0 - h2 / 56.0)));
+}
+
+//-----------------------------------------------------------------------------
+// Longitude difference to +/- 180 degrees
+long WrapMillionths( long delta )
+{
+	if( delta > MILLIONTHS_360 / 2 )
+	{
+		delta -= MILLIONTHS_360;
+	}
+	else if( delta < -MILLIONTHS_360 / 2 )
+	{
+		delta += MILLIONTHS_360;
+	}
+
+	return delta;
+}
+
+//-----------------------------------------------------------------------------
+// Compass bearing of (east, north) in degrees, 0 - 360. Polynomial atan on
+// the octant, max error 0.0006 degrees, multiply-adds only.
+double Atan2Deg( double y, double x )
+{
+	double ax = fabs( x );
+	double ay = fabs( y );
+	double t;
+	double t2;
+	double a;
+
+	if( ax == 0.0 && ay == 0.0 )
+	{
+		return 0.0;
+	}
+
+	// atan of the smaller over the larger, 0 - 45 degrees
+	t = (ay < ax) ? ay / ax : ax / ay;
+	t2 = t * t;
+	a = t * (0.99997726 + t2 * (-0.33262347 + t2 * (0.19354346 + t2 * (-0.11643287 +
+		t2 * (0.05265332 + t2 * -0.01172120))))) * DEGREES_PER_RADIAN;
+
+	// Unfold: y is east, x is north
+	if( ay > ax )
+	{
+		a = 90.0 - a;
+	}
+	if( x < 0.0 )
+	{
+		a = 180.0 - a;
+	}
+	if( y < 0.0 )
+	{
+		a = 360.0 - a;
+	}
+
+	return (a >= 360.0) ? a - 360.0 : a;
+}
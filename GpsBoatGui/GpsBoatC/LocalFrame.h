@@ -0,0 +1,79 @@
+// LocalFrame.h
+// Local East-North-Up navigation frame in meters, anchored at home.
+// Fixes and waypoints are projected into it once. After that, range,
+// bearing, cross track and arrival are a few multiply-adds on the plane.
+//
+// The frame is the true local tangent plane: WGS84 ECEF rotated to the
+// anchor, with points taken at zero height. Projection does no libm calls.
+// Instead it uses the anchor's cached sin/cos and a short series for the
+// latitude/longitude offset, plus one sqrt. The series is exact to double
+// precision out to ~1000 km.
+//
+// Plane geometry against Vincenty, for points within ENU_MAX_RADIUS_M of
+// the anchor:
+//   range    <= 1 cm (tangent plane vs ellipsoid)
+//   bearing  <= 0.0002 degrees at 34N, 0.003 up to 80N, beyond 10 m of the
+//               target. This is the bearing from true north at ptFrom: the
+//               plane's north is the anchor's, so the meridian convergence
+//               at ptFrom is added back.
+// ENU_ToGeodetic() round trips to within the millionth-of-a-degree output
+// rounding.
+
+#ifndef LOCALFRAME_H
+#define LOCALFRAME_H
+
+#include "includes.h"
+
+//-------------------------------------------
+// Global defines
+
+// Beyond this the tangent plane is not used for navigation
+#define ENU_MAX_RADIUS_M		10000.0
+
+typedef struct
+{
+	double dEast;		// meters
+	double dNorth;
+} tENU_POS;
+
+typedef struct
+{
+	bool bValid;
+	long lat0;			// anchor, millionths of a degree
+	long lon0;
+	double dSinLat0;
+	double dCosLat0;
+	double dX0;			// anchor in ECEF, meters (Y0 == 0, longitude is taken from lon0)
+	double dZ0;
+	double dM0;			// meridian and parallel scale at the anchor, meters per radian
+	double dP0;
+	double dConvergence;	// degrees true north turns per meter east of the anchor
+} tENU_FRAME;
+
+// A track from one point to another, worked out once so that where a position
+// is along and across it is two dot products
+typedef struct
+{
+	tENU_POS tStart;
+	double dUnitE;		// along the track, a zero length one points north
+	double dUnitN;
+	double dLength;		// meters
+} tENU_LEG;
+
+//-------------------------------------------
+// Function prototypes
+
+void	ENU_Init( tENU_FRAME *ptFrame, long lat0, long lon0 );
+void	ENU_FromGeodetic( const tENU_FRAME *ptFrame, long lat, long lon, tENU_POS *ptPos );
+void	ENU_ToGeodetic( const tENU_FRAME *ptFrame, const tENU_POS *ptPos, long *plLat, long *plLon );
+bool	ENU_InRange( const tENU_POS *ptPos );
+
+double	ENU_Distance( const tENU_POS *ptFrom, const tENU_POS *ptTo );
+double	ENU_Bearing( const tENU_FRAME *ptFrame, const tENU_POS *ptFrom, const tENU_POS *ptTo );	// degrees, true North == 0
+double	ENU_CrossTrack( const tENU_POS *ptStart, const tENU_POS *ptEnd, const tENU_POS *ptPos );
+
+void	ENU_SetLeg( tENU_LEG *ptLeg, const tENU_POS *ptStart, const tENU_POS *ptEnd );
+void	ENU_LegOffset( const tENU_LEG *ptLeg, const tENU_POS *ptPos, double *pdAlong, double *pdCross );
+void	ENU_LegPoint( const tENU_LEG *ptLeg, double dAlong, double dCross, tENU_POS *ptPos );
+
+#endif
@@ -0,0 +1,440 @@
+// Recorder.cpp
+// Flight recorder. See Recorder.h.
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "Recorder.h"
+#include "Hal.h"
+
+//-------------------------------------------
+// Local defines
+
+#define RECORDER_BATCH_SIZE		(64 * 1024)
+#define RECORDER_NO_RING		0xFF		// tREC_DROPPED u8Ring: threads past RECORDER_MAX_RINGS
+
+//-------------------------------------------
+// Local types
+
+typedef struct
+{
+	tREC_HEADER tHeader;
+	U8 au8Data[RECORDER_MAX_DATA];
+} tREC_SLOT;
+
+// One thread's records. The head is only written by the thread, the tail
+// only by the writer, each on its own cache line.
+typedef struct
+{
+	U32 u32Head __attribute__(( aligned(64) ));	// next slot to fill
+	U32 u32Dropped;								// ring was full, ever
+	U32 u32Tail __attribute__(( aligned(64) ));	// next slot to drain
+	U32 u32DroppedSeen;							// drops already recorded
+	tREC_SLOT atSlot[RECORDER_RING_SIZE];
+} tREC_RING;
+
+typedef struct
+{
+	bool bOpen;
+	int fd;
+	tHAL_THREAD tWriter;
+	U32 u32Rings;					// claimed, can pass RECORDER_MAX_RINGS
+	U32 u32Unringed;				// records from threads without a ring
+	U32 u32UnringedSeen;
+	bool bWriteFailed;				// said so once
+
+	// The writer's last clock reading, stamps carry HAL_Micros() past 32 bits
+	// from it. Sequence locked as tGPS_SNAPSHOT is.
+	U32 u32BaseSeq;
+	uint64_t u64BaseUs;
+
+	int batchLength;
+	U8 au8Batch[RECORDER_BATCH_SIZE];
+
+	tREC_RING atRing[RECORDER_MAX_RINGS];
+} tRECORDER;
+
+//-------------------------------------------
+// Local prototypes
+
+static tREC_RING	*ClaimRing( void );
+static uint64_t		Now( void );
+static void			SetBase( void );
+static void			*Writer( void *pArg );
+static void			Drain( void );
+static void			DrainDropped( U32 *pu32Seen, U32 u32Dropped, U8 u8Ring );
+static void			Batch( const tREC_HEADER *ptHeader, const void *pData );
+static void			Flush( void );
+
+//-------------------------------------------
+// Local data
+
+static tRECORDER gtRecorder;
+
+// The thread's own ring, NULL until it first records
+static __thread tREC_RING *gptRing = NULL;
+
+//-----------------------------------------------------------------------------
+// Starts a new recording in pFileName. Returns false if it couldn't be made.
+bool RECORDER_Open( const char *pFileName )
+{
+	tREC_FILE_HEADER tFileHeader;
+	int i;
+
+	if( gtRecorder.bOpen )
+	{
+		RECORDER_Close();
+	}
+
+	if( (gtRecorder.fd = open( pFileName, O_WRONLY | O_CREAT | O_TRUNC, 0644 )) < 0 )
+	{
+		fprintf (stderr, "Unable to open %s: %s\n", pFileName, strerror (errno)) ;
+		return false;
+	}
+
+	memset( &tFileHeader, 0, sizeof(tFileHeader) );
+	tFileHeader.u32Magic = REC_FILE_MAGIC;
+	tFileHeader.u16Version = REC_FILE_VERSION;
+	tFileHeader.u16HeaderSize = sizeof(tREC_HEADER);
+
+	gtRecorder.bWriteFailed = false;
+	memcpy( gtRecorder.au8Batch, &tFileHeader, sizeof(tFileHeader) );
+	gtRecorder.batchLength = sizeof(tFileHeader);
+
+	// Left over from a recording before, dropped
+	for( i = 0; i < RECORDER_MAX_RINGS; i++ )
+	{
+		gtRecorder.atRing[i].u32Tail = __atomic_load_n( &gtRecorder.atRing[i].u32Head, __ATOMIC_ACQUIRE );
+		gtRecorder.atRing[i].u32DroppedSeen = __atomic_load_n( &gtRecorder.atRing[i].u32Dropped, __ATOMIC_RELAXED );
+	}
+	gtRecorder.u32UnringedSeen = __atomic_load_n( &gtRecorder.u32Unringed, __ATOMIC_RELAXED );
+
+	gtRecorder.u64BaseUs = HAL_Micros();
+
+	if( !HAL_ThreadCreate( &gtRecorder.tWriter, Writer, NULL ) )
+	{
+		close( gtRecorder.fd );
+		return false;
+	}
+
+	__atomic_store_n( &gtRecorder.bOpen, true, __ATOMIC_RELEASE );
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Writes out what's recorded and closes the file. Records made while it's
+// closing may be lost.
+void RECORDER_Close( void )
+{
+	if( !gtRecorder.bOpen )
+	{
+		return;
+	}
+
+	__atomic_store_n( &gtRecorder.bOpen, false, __ATOMIC_RELEASE );
+
+	HAL_ThreadStop( gtRecorder.tWriter );
+
+	Drain();
+
+	if( fdatasync( gtRecorder.fd ) < 0 || close( gtRecorder.fd ) < 0 )
+	{
+		fprintf (stderr, "Unable to close the recording: %s\n", strerror (errno)) ;
+	}
+
+	gtRecorder.fd = -1;
+}
+
+//-----------------------------------------------------------------------------
+// Copies a record into the thread's ring, never waits. Data past
+// RECORDER_MAX_DATA is cut off.
+void RECORDER_Record( E_REC_TYPE eType, const void *pData, int size )
+{
+	tREC_RING *ptRing = gptRing;
+	tREC_SLOT *ptSlot;
+	U32 u32Head;
+
+	if( !__atomic_load_n( &gtRecorder.bOpen, __ATOMIC_RELAXED ) )
+	{
+		return;
+	}
+
+	if( !ptRing && !(ptRing = ClaimRing()) )
+	{
+		__atomic_fetch_add( &gtRecorder.u32Unringed, 1, __ATOMIC_RELAXED );
+		return;
+	}
+
+	u32Head = ptRing->u32Head;
+
+	if( u32Head - __atomic_load_n( &ptRing->u32Tail, __ATOMIC_ACQUIRE ) >= RECORDER_RING_SIZE )
+	{
+		__atomic_store_n( &ptRing->u32Dropped, ptRing->u32Dropped + 1, __ATOMIC_RELAXED );
+		return;
+	}
+
+	size = min( size, RECORDER_MAX_DATA );
+
+	ptSlot = &ptRing->atSlot[u32Head & (RECORDER_RING_SIZE - 1)];
+	ptSlot->tHeader.u64TimeUs = Now();
+	ptSlot->tHeader.u16Size = size;
+	ptSlot->tHeader.u8Type = eType;
+	ptSlot->tHeader.u32Seq = u32Head + ptRing->u32Dropped;
+	memcpy( ptSlot->au8Data, pData, size );
+
+	// The slot is complete before the writer can see it
+	__atomic_store_n( &ptRing->u32Head, u32Head + 1, __ATOMIC_RELEASE );
+}
+
+//-----------------------------------------------------------------------------
+void RECORDER_Nmea( const char *pSentence, int length )
+{
+	RECORDER_Record( E_REC_NMEA, pSentence, length );
+}
+
+//-----------------------------------------------------------------------------
+void RECORDER_Fix( const tGPS_INFO *ptInfo )
+{
+	tREC_FIX tFix;
+
+	memset( &tFix, 0, sizeof(tFix) );
+	tFix.s32Lat = ptInfo->lat;
+	tFix.s32Lon = ptInfo->lon;
+	tFix.fMph = ptInfo->fmph;
+	tFix.fCourse = ptInfo->fcourse;
+	tFix.u8Locked = ptInfo->bGpsLocked;
+
+	RECORDER_Record( E_REC_FIX, &tFix, sizeof(tFix) );
+}
+
+//-----------------------------------------------------------------------------
+void RECORDER_Compass( S16 raw, float fHeading )
+{
+	tREC_COMPASS tCompass;
+
+	memset( &tCompass, 0, sizeof(tCompass) );
+	tCompass.s16Raw = raw;
+	tCompass.fHeading = fHeading;
+
+	RECORDER_Record( E_REC_COMPASS, &tCompass, sizeof(tCompass) );
+}
+
+//-----------------------------------------------------------------------------
+void RECORDER_State( int from, int to, int targetWP )
+{
+	tREC_STATE tState;
+
+	tState.u8From = from;
+	tState.u8To = to;
+	tState.s16TargetWP = targetWP;
+
+	RECORDER_Record( E_REC_STATE, &tState, sizeof(tState) );
+}
+
+//-----------------------------------------------------------------------------
+// E_REC_RUDDER or E_REC_SPEED
+void RECORDER_Setting( E_REC_TYPE eType, int setting )
+{
+	tREC_SETTING tSetting;
+
+	tSetting.s16Setting = setting;
+	tSetting.s16Pad = 0;
+
+	RECORDER_Record( eType, &tSetting, sizeof(tSetting) );
+}
+
+//-----------------------------------------------------------------------------
+// The calling thread's ring from now on, NULL once they're all taken
+tREC_RING *ClaimRing( void )
+{
+	U32 u32Ring;
+
+	if( __atomic_load_n( &gtRecorder.u32Rings, __ATOMIC_RELAXED ) >= RECORDER_MAX_RINGS )
+	{
+		return NULL;
+	}
+
+	if( (u32Ring = __atomic_fetch_add( &gtRecorder.u32Rings, 1, __ATOMIC_ACQ_REL )) >= RECORDER_MAX_RINGS )
+	{
+		return NULL;
+	}
+
+	gptRing = &gtRecorder.atRing[u32Ring];
+
+	return gptRing;
+}
+
+//-----------------------------------------------------------------------------
+// HAL_Micros() carried past 32 bits from the writer's last reading, which is
+// never more than a flush old
+uint64_t Now( void )
+{
+	U32 u32Before;
+	U32 u32After;
+	uint64_t u64Base;
+	uint32_t u32Now;
+
+	do
+	{
+		u32Before = __atomic_load_n( &gtRecorder.u32BaseSeq, __ATOMIC_ACQUIRE );
+
+		u64Base = gtRecorder.u64BaseUs;
+
+		__atomic_thread_fence( __ATOMIC_ACQUIRE );
+		u32After = __atomic_load_n( &gtRecorder.u32BaseSeq, __ATOMIC_RELAXED );
+
+	} while( (u32Before & 1) || (u32Before != u32After) );
+
+	// Read after the base, so never behind it
+	u32Now = (uint32_t)HAL_Micros();
+
+	return u64Base + (uint32_t)(u32Now - (uint32_t)u64Base);
+}
+
+//-----------------------------------------------------------------------------
+// Writer side of the base
+void SetBase( void )
+{
+	uint64_t u64Now = Now();
+	U32 u32Seq = __atomic_load_n( &gtRecorder.u32BaseSeq, __ATOMIC_RELAXED );
+
+	__atomic_store_n( &gtRecorder.u32BaseSeq, u32Seq + 1, __ATOMIC_RELAXED );
+	__atomic_thread_fence( __ATOMIC_RELEASE );
+
+	gtRecorder.u64BaseUs = u64Now;
+
+	__atomic_store_n( &gtRecorder.u32BaseSeq, u32Seq + 2, __ATOMIC_RELEASE );
+}
+
+//-----------------------------------------------------------------------------
+// Drains the rings every RECORDER_FLUSH_MS. Stopped only while waiting, so
+// a batch is never half written.
+void *Writer( void *pArg )
+{
+	int state;
+
+	while( true )
+	{
+		HAL_Delay( RECORDER_FLUSH_MS );
+
+		pthread_setcancelstate( PTHREAD_CANCEL_DISABLE, &state );
+		SetBase();
+		Drain();
+		pthread_setcancelstate( state, NULL );
+	}
+
+	return NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Everything recorded so far to the file, ring by ring
+void Drain( void )
+{
+	U32 u32Rings = min( __atomic_load_n( &gtRecorder.u32Rings, __ATOMIC_ACQUIRE ), (U32)RECORDER_MAX_RINGS );
+	tREC_RING *ptRing;
+	tREC_SLOT *ptSlot;
+	U32 u32Head;
+	U32 u32Tail;
+	U32 i;
+
+	for( i = 0; i < u32Rings; i++ )
+	{
+		ptRing = &gtRecorder.atRing[i];
+		u32Head = __atomic_load_n( &ptRing->u32Head, __ATOMIC_ACQUIRE );
+
+		for( u32Tail = ptRing->u32Tail; u32Tail != u32Head; u32Tail++ )
+		{
+			ptSlot = &ptRing->atSlot[u32Tail & (RECORDER_RING_SIZE - 1)];
+			ptSlot->tHeader.u8Ring = i;
+			Batch( &ptSlot->tHeader, ptSlot->au8Data );
+		}
+
+		// Hands the slots back
+		__atomic_store_n( &ptRing->u32Tail, u32Tail, __ATOMIC_RELEASE );
+
+		DrainDropped( &ptRing->u32DroppedSeen, __atomic_load_n( &ptRing->u32Dropped, __ATOMIC_RELAXED ), i );
+	}
+
+	DrainDropped( &gtRecorder.u32UnringedSeen, __atomic_load_n( &gtRecorder.u32Unringed, __ATOMIC_RELAXED ),
+				  RECORDER_NO_RING );
+
+	Flush();
+}
+
+//-----------------------------------------------------------------------------
+// Records the drops since the last time, if any
+void DrainDropped( U32 *pu32Seen, U32 u32Dropped, U8 u8Ring )
+{
+	tREC_HEADER tHeader;
+	tREC_DROPPED tDropped;
+
+	if( u32Dropped == *pu32Seen )
+	{
+		return;
+	}
+
+	memset( &tHeader, 0, sizeof(tHeader) );
+	memset( &tDropped, 0, sizeof(tDropped) );
+
+	tDropped.u32Count = u32Dropped - *pu32Seen;
+	tDropped.u8Ring = u8Ring;
+
+	tHeader.u64TimeUs = Now();
+	tHeader.u16Size = sizeof(tDropped);
+	tHeader.u8Type = E_REC_DROPPED;
+	tHeader.u8Ring = RECORDER_NO_RING;
+
+	Batch( &tHeader, &tDropped );
+
+	*pu32Seen = u32Dropped;
+}
+
+//-----------------------------------------------------------------------------
+void Batch( const tREC_HEADER *ptHeader, const void *pData )
+{
+	if( gtRecorder.batchLength + (int)sizeof(tREC_HEADER) + ptHeader->u16Size > RECORDER_BATCH_SIZE )
+	{
+		Flush();
+	}
+
+	memcpy( gtRecorder.au8Batch + gtRecorder.batchLength, ptHeader, sizeof(tREC_HEADER) );
+	gtRecorder.batchLength += sizeof(tREC_HEADER);
+
+	memcpy( gtRecorder.au8Batch + gtRecorder.batchLength, pData, ptHeader->u16Size );
+	gtRecorder.batchLength += ptHeader->u16Size;
+}
+
+//-----------------------------------------------------------------------------
+// One write() for the whole batch, unless the file takes it in pieces
+void Flush( void )
+{
+	ssize_t written;
+	int offset = 0;
+
+	while( offset < gtRecorder.batchLength )
+	{
+		if( (written = write( gtRecorder.fd, gtRecorder.au8Batch + offset, gtRecorder.batchLength - offset )) < 0 )
+		{
+			if( errno == EINTR )
+			{
+				continue;
+			}
+
+			// Full or gone, the boat carries on without it
+			if( !gtRecorder.bWriteFailed )
+			{
+				fprintf (stderr, "Unable to write the recording: %s\n", strerror (errno)) ;
+				gtRecorder.bWriteFailed = true;
+			}
+			break;
+		}
+
+		offset += written;
+	}
+
+	gtRecorder.batchLength = 0;
+}
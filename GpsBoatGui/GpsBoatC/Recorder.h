@@ -0,0 +1,116 @@
+// Recorder.h
+// Flight recorder: raw NMEA, fixes, compass samples, nav state changes and
+// rudder/speed settings, each stamped with the HAL clock in microseconds,
+// written to a binary file while the boat runs.
+//
+// Recording is cheap enough to leave on. Each thread that records gets its
+// own ring the first time it does, so recording takes no lock: a record is
+// copied into the ring and the head moved on. A writer thread drains every
+// ring each RECORDER_FLUSH_MS into one buffer and write()s it in a batch,
+// so the nav loop never waits on the SD card. A full ring drops the record
+// rather than wait; drops are counted and recorded when there's room.
+// Nothing is recorded while the recorder isn't open. Open it after
+// HAL_Init(), the clock may start over then.
+//
+// Recording file (little-endian, native layout as tREC_FILE_HEADER etc.):
+//   tREC_FILE_HEADER
+//   { tREC_HEADER, u16Size bytes of data }...	in the order drained, so only
+//												in time order per thread
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <stdint.h>
+#include "includes.h"
+#include "GpsInfo.h"
+
+//-------------------------------------------
+// Global defines
+
+#define REC_FILE_MAGIC			0x52464247	// "GBFR"
+#define REC_FILE_VERSION		1
+
+#define RECORDER_MAX_RINGS		8			// threads that can record
+#define RECORDER_RING_SIZE		256			// records per ring, must be a power of 2
+#define RECORDER_FLUSH_MS		100
+#define RECORDER_MAX_DATA		100			// bytes, longer NMEA lines are cut short
+
+typedef enum
+{
+	E_REC_NMEA = 1,				// a sentence as read, "$...*hh\r\n"
+	E_REC_FIX,					// tREC_FIX
+	E_REC_COMPASS,				// tREC_COMPASS
+	E_REC_STATE,				// tREC_STATE
+	E_REC_RUDDER,				// tREC_SETTING, after RUDDER_REVERSE
+	E_REC_SPEED,				// tREC_SETTING
+	E_REC_DROPPED,				// tREC_DROPPED
+
+	E_REC_MAX
+} E_REC_TYPE;
+
+typedef struct
+{
+	uint32_t u32Magic;
+	uint16_t u16Version;
+	uint16_t u16HeaderSize;		// sizeof(tREC_HEADER)
+} tREC_FILE_HEADER;
+
+typedef struct
+{
+	uint64_t u64TimeUs;			// HAL_Micros(), carried past 32 bits
+	uint16_t u16Size;			// data bytes that follow
+	uint8_t u8Type;				// E_REC_TYPE
+	uint8_t u8Ring;				// the thread that recorded it
+	uint32_t u32Seq;			// the ring's record count, a gap is drops
+} tREC_HEADER;
+
+typedef struct
+{
+	int32_t s32Lat;				// millionths of a degree
+	int32_t s32Lon;
+	float fMph;
+	float fCourse;
+	uint8_t u8Locked;
+	uint8_t au8Pad[3];
+} tREC_FIX;
+
+typedef struct
+{
+	int16_t s16Raw;				// HMC6343 heading, tenths of a degree magnetic, -1 == no reading
+	int16_t s16Pad;
+	float fHeading;				// degrees true, as steered by
+} tREC_COMPASS;
+
+typedef struct
+{
+	uint8_t u8From;				// E_NAV_STATE
+	uint8_t u8To;
+	int16_t s16TargetWP;
+} tREC_STATE;
+
+typedef struct
+{
+	int16_t s16Setting;			// servo degrees
+	int16_t s16Pad;
+} tREC_SETTING;
+
+typedef struct
+{
+	uint32_t u32Count;			// records lost since the last drop record
+	uint8_t u8Ring;
+	uint8_t au8Pad[3];
+} tREC_DROPPED;
+
+//-------------------------------------------
+// Function prototypes
+
+bool	RECORDER_Open( const char *pFileName );
+void	RECORDER_Close( void );
+void	RECORDER_Record( E_REC_TYPE eType, const void *pData, int size );
+void	RECORDER_Nmea( const char *pSentence, int length );
+void	RECORDER_Fix( const tGPS_INFO *ptInfo );
+void	RECORDER_Compass( S16 raw, float fHeading );
+void	RECORDER_State( int from, int to, int targetWP );
+void	RECORDER_Setting( E_REC_TYPE eType, int setting );
+
+#endif
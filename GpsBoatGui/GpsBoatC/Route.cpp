@@ -0,0 +1,440 @@
+// Route.cpp
+// The list of waypoints to navigate, from config.h or a mission file
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "config.h"
+#include "Route.h"
+
+//-------------------------------------------
+// Local data
+
+// The config.h route, waypoint 0 is home
+static const tROUTE_WAY_POINT gatConfigRoute[] = {
+	{ GEO_DEGREES(WAYPOINT_HOME_LAT), GEO_DEGREES(WAYPOINT_HOME_LON) },
+	{ GEO_DEGREES(WAYPOINT_A_LAT), GEO_DEGREES(WAYPOINT_A_LON) },
+	{ GEO_DEGREES(WAYPOINT_B_LAT), GEO_DEGREES(WAYPOINT_B_LON) },
+	{ GEO_DEGREES(WAYPOINT_C_LAT), GEO_DEGREES(WAYPOINT_C_LON) },
+	{ GEO_DEGREES(WAYPOINT_D_LAT), GEO_DEGREES(WAYPOINT_D_LON) },
+	{ GEO_DEGREES(WAYPOINT_E_LAT), GEO_DEGREES(WAYPOINT_E_LON) },
+	{ GEO_DEGREES(WAYPOINT_F_LAT), GEO_DEGREES(WAYPOINT_F_LON) },
+	{ GEO_DEGREES(WAYPOINT_G_LAT), GEO_DEGREES(WAYPOINT_G_LON) },
+	{ GEO_DEGREES(WAYPOINT_H_LAT), GEO_DEGREES(WAYPOINT_H_LON) },
+	{ GEO_DEGREES(WAYPOINT_I_LAT), GEO_DEGREES(WAYPOINT_I_LON) },
+	{ GEO_DEGREES(WAYPOINT_J_LAT), GEO_DEGREES(WAYPOINT_J_LON) },
+};
+
+//-------------------------------------------
+// Local prototypes
+
+static void					Init( tROUTE *ptRoute, const tROUTE_WAY_POINT *ptWayPoints, int count, bool bHomeAtLock );
+static const tROUTE_CACHE	*GetCache( tROUTE *ptRoute, int wp );
+static void					BuildHazardIndex( tROUTE *ptRoute );
+static void					BuildWayPointIndex( tROUTE *ptRoute );
+static void					BuildArrays( tROUTE *ptRoute );
+static void					SetLeg( tROUTE *ptRoute, int wp );
+
+//-----------------------------------------------------------------------------
+// Loads the NUM_WAY_POINTS waypoints programmed in config.h.
+// Home is a placeholder until the GPS locks unless USE_HOME_POSITION is set.
+void ROUTE_LoadConfig( tROUTE *ptRoute )
+{
+	int count = NUM_WAY_POINTS;
+
+	if( count > (int)(sizeof(gatConfigRoute) / sizeof(gatConfigRoute[0])) )
+	{
+		count = sizeof(gatConfigRoute) / sizeof(gatConfigRoute[0]);
+	}
+
+	Init( ptRoute, gatConfigRoute, count, !USE_HOME_POSITION );
+	BuildArrays( ptRoute );
+}
+
+//-----------------------------------------------------------------------------
+// Maps a binary mission file (see Route.h) and uses it in place.
+// Returns false, with the route left empty, if it can't be used.
+bool ROUTE_LoadFile( tROUTE *ptRoute, const char *pFileName )
+{
+	const tROUTE_FILE_HEADER *ptHeader;
+	struct stat tStat;
+	void *pMap;
+	int fd;
+
+	Init( ptRoute, NULL, 0, false );
+
+	fd = open( pFileName, O_RDONLY );
+	if( fd < 0 )
+	{
+		fprintf( stderr, "Unable to open mission %s: %s\n", pFileName, strerror( errno ) );
+		return false;
+	}
+
+	if( fstat( fd, &tStat ) < 0 || tStat.st_size < (off_t)sizeof(tROUTE_FILE_HEADER) )
+	{
+		fprintf( stderr, "Mission %s is not a route file\n", pFileName );
+		close( fd );
+		return false;
+	}
+
+	pMap = mmap( NULL, tStat.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+	close( fd );
+
+	if( pMap == MAP_FAILED )
+	{
+		fprintf( stderr, "Unable to map mission %s: %s\n", pFileName, strerror( errno ) );
+		return false;
+	}
+
+	ptHeader = (const tROUTE_FILE_HEADER *)pMap;
+
+	if( ptHeader->u32Magic != ROUTE_FILE_MAGIC ||
+		ptHeader->u16Version != ROUTE_FILE_VERSION ||
+		ptHeader->u32Count < 2 ||
+		(uint64_t)tStat.st_size != sizeof(tROUTE_FILE_HEADER) +
+			((uint64_t)ptHeader->u32Count + ptHeader->u32HazardCount) * sizeof(tROUTE_WAY_POINT) )
+	{
+		fprintf( stderr, "Mission %s is not a version %i route file\n", pFileName, ROUTE_FILE_VERSION );
+		munmap( pMap, tStat.st_size );
+		return false;
+	}
+
+	Init( ptRoute, (const tROUTE_WAY_POINT *)(ptHeader + 1), ptHeader->u32Count,
+		  (ptHeader->u16Flags & ROUTE_FLAG_HOME_AT_LOCK) != 0 );
+	ptRoute->pMap = pMap;
+	ptRoute->mapLength = tStat.st_size;
+	BuildArrays( ptRoute );
+
+	ptRoute->ptHazards = ptRoute->ptWayPoints + ptHeader->u32Count;
+	ptRoute->hazardCount = ptHeader->u32HazardCount;
+
+	// Otherwise indexed once home is known
+	if( !ptRoute->bHomeAtLock )
+	{
+		BuildHazardIndex( ptRoute );
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+void ROUTE_Close( tROUTE *ptRoute )
+{
+	if( ptRoute->pMap )
+	{
+		munmap( ptRoute->pMap, ptRoute->mapLength );
+	}
+
+	INDEX_Free( &ptRoute->tHazardIndex );
+	INDEX_Free( &ptRoute->tWayPointIndex );
+	free( ptRoute->plLat );
+	free( ptRoute->plLon );
+	free( ptRoute->pu32LegCm );
+	free( ptRoute->pu32RangeCm );
+	Init( ptRoute, NULL, 0, false );
+}
+
+//-----------------------------------------------------------------------------
+// Moves home (i.e. captured at GPS lock). Re-anchors the local frame, which
+// drops every cached waypoint and re-indexes the waypoints and hazards.
+void ROUTE_SetHome( tROUTE *ptRoute, long lat, long lon )
+{
+	int i;
+
+	ptRoute->lHomeLat = lat;
+	ptRoute->lHomeLon = lon;
+
+	ENU_Init( &ptRoute->tFrame, lat, lon );
+
+	if( ptRoute->plLat )
+	{
+		ptRoute->plLat[0] = lat;
+		ptRoute->plLon[0] = lon;
+		SetLeg( ptRoute, 0 );
+		SetLeg( ptRoute, 1 );
+	}
+
+	for( i = 0; i < ROUTE_CACHE_SIZE; i++ )
+	{
+		ptRoute->atCache[i].wp = -1;
+		ptRoute->atCache[i].u32Used = 0;
+	}
+
+	BuildWayPointIndex( ptRoute );
+	BuildHazardIndex( ptRoute );
+}
+
+//-----------------------------------------------------------------------------
+// Waypoint position in millionths of a degree
+long ROUTE_GetLat( const tROUTE *ptRoute, int wp )
+{
+	return (wp == 0) ? ptRoute->lHomeLat : ptRoute->ptWayPoints[wp].s32Lat;
+}
+
+//-----------------------------------------------------------------------------
+long ROUTE_GetLon( const tROUTE *ptRoute, int wp )
+{
+	return (wp == 0) ? ptRoute->lHomeLon : ptRoute->ptWayPoints[wp].s32Lon;
+}
+
+//-----------------------------------------------------------------------------
+// A waypoint in the form the geodesy engine takes
+const tGEOENG_POINT *ROUTE_GetEnginePoint( tROUTE *ptRoute, int wp )
+{
+	return &GetCache( ptRoute, wp )->tEnginePoint;
+}
+
+//-----------------------------------------------------------------------------
+// A waypoint in the route's local frame, meters from home
+const tENU_POS *ROUTE_GetEnu( tROUTE *ptRoute, int wp )
+{
+	return &GetCache( ptRoute, wp )->tEnu;
+}
+
+//-----------------------------------------------------------------------------
+// The waypoint, home included, closest to a position, and how far it is
+// (cm). -1 without the route's arrays.
+int ROUTE_Nearest( const tROUTE *ptRoute, long lat, long lon, U32 *pu32Dist )
+{
+	tGEO_POINT tBoat;
+
+	if( !ptRoute->plLat )
+	{
+		return -1;
+	}
+
+	GEO_SetPoint( &tBoat, lat, lon );
+
+	return GEO_Nearest( &tBoat, ptRoute->plLat, ptRoute->plLon, ptRoute->count, pu32Dist );
+}
+
+//-----------------------------------------------------------------------------
+// The leg, by the waypoint it goes to, from firstWp on that a position is
+// on: the one it adds least to, going from its start to its end by way of
+// the position. The leg home is only ever its own, legs are never gone
+// back to. firstWp without the route's arrays.
+int ROUTE_Leg( tROUTE *ptRoute, long lat, long lon, int firstWp )
+{
+	const U32 *pu32Range = ptRoute->pu32RangeCm;
+	tGEO_POINT tBoat;
+	long lDetour;
+	long lBest = LONG_MAX;
+	int best = firstWp;
+	int wp;
+
+	if( firstWp == 0 || !ptRoute->plLat )
+	{
+		return firstWp;
+	}
+
+	// Ranges to the waypoints from the one before firstWp on, in one pass
+	GEO_SetPoint( &tBoat, lat, lon );
+	GEO_RangeAndBearingBatch( &tBoat, ptRoute->plLat + firstWp - 1, ptRoute->plLon + firstWp - 1,
+							  ptRoute->count - firstWp + 1, ptRoute->pu32RangeCm + firstWp - 1, NULL );
+
+	for( wp = firstWp; wp < ptRoute->count; wp++ )
+	{
+		lDetour = (long)pu32Range[wp - 1] + (long)pu32Range[wp] - (long)ptRoute->pu32LegCm[wp];
+
+		if( lDetour < lBest )
+		{
+			lBest = lDetour;
+			best = wp;
+		}
+	}
+
+	return best;
+}
+
+//-----------------------------------------------------------------------------
+// The first waypoint from firstWp on within dRadius meters of a position
+// (local frame), -1 if none is, see INDEX_FirstWithin
+int ROUTE_FirstWithin( const tROUTE *ptRoute, const tENU_POS *ptPos, double dRadius, int firstWp )
+{
+	return INDEX_FirstWithin( &ptRoute->tWayPointIndex, ptPos, dRadius, firstWp );
+}
+
+//-----------------------------------------------------------------------------
+// Hazards near the track ptStart -> ptEnd (local frame), see INDEX_NearTrack
+int ROUTE_HazardsNearTrack( const tROUTE *ptRoute, const tENU_POS *ptStart, const tENU_POS *ptEnd, double dClearance,
+							int *pHazards, int maxHazards, double *pdClosest )
+{
+	return INDEX_NearTrack( &ptRoute->tHazardIndex, ptStart, ptEnd, dClearance, pHazards, maxHazards, pdClosest );
+}
+
+//-----------------------------------------------------------------------------
+void Init( tROUTE *ptRoute, const tROUTE_WAY_POINT *ptWayPoints, int count, bool bHomeAtLock )
+{
+	memset( ptRoute, 0, sizeof(tROUTE) );
+
+	ptRoute->ptWayPoints = ptWayPoints;
+	ptRoute->count = count;
+	ptRoute->bHomeAtLock = bHomeAtLock;
+
+	// Home until the GPS locks, (0, 0) if it is taken at lock
+	if( count && !bHomeAtLock )
+	{
+		ROUTE_SetHome( ptRoute, ptWayPoints[0].s32Lat, ptWayPoints[0].s32Lon );
+	}
+	else
+	{
+		ROUTE_SetHome( ptRoute, 0, 0 );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// The cache entry for a waypoint. A miss fills the entry used longest ago.
+const tROUTE_CACHE *GetCache( tROUTE *ptRoute, int wp )
+{
+	tROUTE_CACHE *ptCache = &ptRoute->atCache[0];
+	long lat;
+	long lon;
+	int i;
+
+	for( i = 0; i < ROUTE_CACHE_SIZE && ptRoute->atCache[i].wp != wp; i++ )
+	{
+		if( ptRoute->atCache[i].u32Used < ptCache->u32Used )
+		{
+			ptCache = &ptRoute->atCache[i];
+		}
+	}
+
+	if( i < ROUTE_CACHE_SIZE )
+	{
+		ptCache = &ptRoute->atCache[i];
+	}
+
+	ptCache->u32Used = ++ptRoute->u32CacheUses;
+
+	if( ptCache->wp != wp )
+	{
+		lat = ROUTE_GetLat( ptRoute, wp );
+		lon = ROUTE_GetLon( ptRoute, wp );
+
+		GEOENG_SetPoint( &ptCache->tEnginePoint, lat, lon );
+		ENU_FromGeodetic( &ptRoute->tFrame, lat, lon, &ptCache->tEnu );
+		ptCache->wp = wp;
+	}
+
+	return ptCache;
+}
+
+//-----------------------------------------------------------------------------
+// Projects the hazards into the current frame and indexes them. Without
+// memory for it the index is left empty, nothing is reported near the track.
+void BuildHazardIndex( tROUTE *ptRoute )
+{
+	tENU_POS *ptPos;
+	int i;
+
+	INDEX_Free( &ptRoute->tHazardIndex );
+
+	if( ptRoute->hazardCount == 0 )
+	{
+		return;
+	}
+
+	ptPos = (tENU_POS *)malloc( ptRoute->hazardCount * sizeof(tENU_POS) );
+	if( !ptPos )
+	{
+		fprintf( stderr, "Unable to index %i hazards: out of memory\n", ptRoute->hazardCount );
+		return;
+	}
+
+	for( i = 0; i < ptRoute->hazardCount; i++ )
+	{
+		ENU_FromGeodetic( &ptRoute->tFrame, ptRoute->ptHazards[i].s32Lat, ptRoute->ptHazards[i].s32Lon, &ptPos[i] );
+	}
+
+	INDEX_Build( &ptRoute->tHazardIndex, ptPos, ptRoute->hazardCount );
+	free( ptPos );
+}
+
+//-----------------------------------------------------------------------------
+// Projects the waypoints into the current frame and indexes them, as the
+// hazards are. Without memory for it nothing is found within any radius.
+void BuildWayPointIndex( tROUTE *ptRoute )
+{
+	tENU_POS *ptPos;
+	int wp;
+
+	INDEX_Free( &ptRoute->tWayPointIndex );
+
+	if( ptRoute->count == 0 )
+	{
+		return;
+	}
+
+	ptPos = (tENU_POS *)malloc( ptRoute->count * sizeof(tENU_POS) );
+	if( !ptPos )
+	{
+		fprintf( stderr, "Unable to index %i waypoints: out of memory\n", ptRoute->count );
+		return;
+	}
+
+	for( wp = 0; wp < ptRoute->count; wp++ )
+	{
+		ENU_FromGeodetic( &ptRoute->tFrame, ROUTE_GetLat( ptRoute, wp ), ROUTE_GetLon( ptRoute, wp ), &ptPos[wp] );
+	}
+
+	INDEX_Build( &ptRoute->tWayPointIndex, ptPos, ptRoute->count );
+	free( ptPos );
+}
+
+//-----------------------------------------------------------------------------
+// The waypoints' latitudes and longitudes as two arrays, for the Geodesy
+// batch calls, and the legs' lengths. Without memory for them the route
+// still navigates, ROUTE_Nearest() and ROUTE_Leg() have nothing to go on.
+void BuildArrays( tROUTE *ptRoute )
+{
+	int wp;
+
+	ptRoute->plLat = (long *)malloc( ptRoute->count * sizeof(long) );
+	ptRoute->plLon = (long *)malloc( ptRoute->count * sizeof(long) );
+	ptRoute->pu32LegCm = (U32 *)malloc( ptRoute->count * sizeof(U32) );
+	ptRoute->pu32RangeCm = (U32 *)malloc( ptRoute->count * sizeof(U32) );
+
+	if( !ptRoute->plLat || !ptRoute->plLon || !ptRoute->pu32LegCm || !ptRoute->pu32RangeCm )
+	{
+		fprintf( stderr, "Unable to lay out %i waypoints: out of memory\n", ptRoute->count );
+		free( ptRoute->plLat );
+		free( ptRoute->plLon );
+		free( ptRoute->pu32LegCm );
+		free( ptRoute->pu32RangeCm );
+		ptRoute->plLat = NULL;
+		ptRoute->plLon = NULL;
+		ptRoute->pu32LegCm = NULL;
+		ptRoute->pu32RangeCm = NULL;
+		return;
+	}
+
+	for( wp = 0; wp < ptRoute->count; wp++ )
+	{
+		ptRoute->plLat[wp] = ROUTE_GetLat( ptRoute, wp );
+		ptRoute->plLon[wp] = ROUTE_GetLon( ptRoute, wp );
+	}
+
+	for( wp = 0; wp < ptRoute->count; wp++ )
+	{
+		SetLeg( ptRoute, wp );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Leg wp's length, from the waypoint before it
+void SetLeg( tROUTE *ptRoute, int wp )
+{
+	int from = (wp + ptRoute->count - 1) % ptRoute->count;
+
+	if( wp < ptRoute->count )
+	{
+		ptRoute->pu32LegCm[wp] = GEO_DistanceBetween( ptRoute->plLat[from], ptRoute->plLon[from],
+													  ptRoute->plLat[wp], ptRoute->plLon[wp] );
+	}
+}
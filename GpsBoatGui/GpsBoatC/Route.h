@@ -0,0 +1,132 @@
+// Route.h
+// The list of waypoints to navigate. Waypoint 0 is always home. It anchors
+// the route's local ENU frame.
+//
+// A route comes from the config.h waypoints or from a binary mission file.
+// Mission files are mmap'ed read only and used in place. Loading costs the
+// same for any length, and the waypoints live in the page cache, not on
+// the heap. Trig terms and frame positions are worked out only for the
+// waypoints being navigated, and kept in a small cache.
+//
+// Next to the waypoints the route keeps their latitudes and longitudes as
+// two arrays, home's in place of waypoint 0, and each leg's length. The
+// Geodesy batch calls take them that way, for the queries over the whole
+// route: the nearest waypoint, and which leg the boat is on.
+//
+// Mission file (little-endian, as written by the mission converter):
+//   tROUTE_FILE_HEADER
+//   tROUTE_WAY_POINT[u32Count]		waypoint 0 is home
+//   tROUTE_WAY_POINT[u32HazardCount]	rocks, buoys, etc. to keep clear of
+//
+// Waypoints and hazards are each kept in a spatial index in the local frame,
+// rebuilt whenever home moves.
+
+#ifndef ROUTE_H
+#define ROUTE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "includes.h"
+#include "Geodesy.h"
+#include "GeoEngine.h"
+#include "LocalFrame.h"
+#include "SpatialIndex.h"
+
+//-------------------------------------------
+// Global defines
+
+#define ROUTE_FILE_MAGIC		0x54524247	// "GBRT"
+#define ROUTE_FILE_VERSION		1
+
+// tROUTE_FILE_HEADER u16Flags
+#define ROUTE_FLAG_HOME_AT_LOCK	0x0001		// home is taken from the first stable GPS fix
+
+// Waypoints with cached terms. The nav loop only ever needs the target and
+// the one before it. Any waypoint can go in any entry, the least recently
+// used goes, so the last waypoint and home (the leg back) never push each
+// other out whatever the route's length.
+#define ROUTE_CACHE_SIZE		4
+
+typedef struct
+{
+	uint32_t u32Magic;
+	uint16_t u16Version;
+	uint16_t u16Flags;
+	uint32_t u32Count;
+	uint32_t u32HazardCount;	// 0 in files from before hazards
+} tROUTE_FILE_HEADER;
+
+typedef struct
+{
+	int32_t s32Lat;		// millionths of a degree
+	int32_t s32Lon;
+} tROUTE_WAY_POINT;
+
+typedef struct
+{
+	int wp;					// -1 == empty
+	U32 u32Used;			// tROUTE u32CacheUses when last asked for
+	tGEOENG_POINT tEnginePoint;
+	tENU_POS tEnu;
+} tROUTE_CACHE;
+
+typedef struct
+{
+	int count;
+	const tROUTE_WAY_POINT *ptWayPoints;	// config table or mission file
+
+	// Home overrides waypoint 0, the waypoints themselves may be read only
+	bool bHomeAtLock;
+	long lHomeLat;
+	long lHomeLon;
+
+	// count entries each, NULL without memory for them. Leg wp is from the
+	// waypoint before it, leg 0 the one back home from the last.
+	long *plLat;				// millionths of a degree
+	long *plLon;
+	U32 *pu32LegCm;
+	U32 *pu32RangeCm;			// ROUTE_Leg()'s, from the boat
+
+	// Hazard points, indexed by hazard number
+	int hazardCount;
+	const tROUTE_WAY_POINT *ptHazards;
+	tINDEX tHazardIndex;
+
+	// Waypoints, home at home, by waypoint number
+	tINDEX tWayPointIndex;
+
+	// Mission file mapping, NULL for the config.h route
+	void *pMap;
+	size_t mapLength;
+
+	// Local frame anchored at home
+	tENU_FRAME tFrame;
+
+	tROUTE_CACHE atCache[ROUTE_CACHE_SIZE];
+	U32 u32CacheUses;
+} tROUTE;
+
+//-------------------------------------------
+// Function prototypes
+
+void	ROUTE_LoadConfig( tROUTE *ptRoute );
+bool	ROUTE_LoadFile( tROUTE *ptRoute, const char *pFileName );
+void	ROUTE_Close( tROUTE *ptRoute );
+
+void	ROUTE_SetHome( tROUTE *ptRoute, long lat, long lon );
+long	ROUTE_GetLat( const tROUTE *ptRoute, int wp );
+long	ROUTE_GetLon( const tROUTE *ptRoute, int wp );
+
+// Cached terms for a waypoint. A pointer stays valid while no more than
+// ROUTE_CACHE_SIZE - 1 other waypoints are asked for, and until home moves.
+const tGEOENG_POINT *ROUTE_GetEnginePoint( tROUTE *ptRoute, int wp );
+const tENU_POS *ROUTE_GetEnu( tROUTE *ptRoute, int wp );
+
+int		ROUTE_Nearest( const tROUTE *ptRoute, long lat, long lon, U32 *pu32Dist );
+int		ROUTE_FirstWithin( const tROUTE *ptRoute, const tENU_POS *ptPos, double dRadius, int firstWp );
+int		ROUTE_Leg( tROUTE *ptRoute, long lat, long lon, int firstWp );
+
+int		ROUTE_HazardsNearTrack( const tROUTE *ptRoute, const tENU_POS *ptStart, const tENU_POS *ptEnd, double dClearance,
+								int *pHazards, int maxHazards, double *pdClosest );
+
+#endif
@@ -0,0 +1,78 @@
+// Sched.cpp
+// Fixed rate loop. See Sched.h.
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include "Sched.h"
+#include "Hal.h"
+
+//-----------------------------------------------------------------------------
+// Ticks u32RateHz times a second on the calling thread. Returns false if the
+// SCHED_FIFO priority asked for couldn't be had, the loop runs without it.
+bool SCHED_Init( tSCHED *ptSched, U32 u32RateHz, int priority )
+{
+	struct sched_param tParam;
+	int status;
+
+	memset( ptSched, 0, sizeof(tSCHED) );
+
+	ptSched->u32PeriodUs = 1000000 / max( u32RateHz, 1UL );
+
+	if( priority <= 0 )
+	{
+		return true;
+	}
+
+	memset( &tParam, 0, sizeof(tParam) );
+	tParam.sched_priority = priority;
+
+	if( (status = pthread_setschedparam( pthread_self(), SCHED_FIFO, &tParam )) != 0 )
+	{
+		fprintf (stderr, "Unable to set SCHED_FIFO %i: %s\n", priority, strerror (status)) ;
+		return false;
+	}
+
+	ptSched->bRealTime = true;
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Ends the tick running, if any, and waits for the next one's deadline
+void SCHED_Wait( tSCHED *ptSched )
+{
+	U32 u32Now = HAL_Micros();
+	long over;
+
+	if( ptSched->bStarted )
+	{
+		ptSched->u32RunUs = (uint32_t)(u32Now - ptSched->u32StartUs);
+		ptSched->u32RunMaxUs = max( ptSched->u32RunMaxUs, ptSched->u32RunUs );
+		ptSched->dRunSumUs += ptSched->u32RunUs;
+
+		// Ran past the deadline: the next tick starts now, late, and any
+		// deadlines wholly passed are dropped
+		if( (over = HAL_US_DIFF( u32Now, ptSched->u32DeadlineUs )) > 0 )
+		{
+			ptSched->u32Missed += over / ptSched->u32PeriodUs + 1;
+			ptSched->u32DeadlineUs += (over / ptSched->u32PeriodUs) * ptSched->u32PeriodUs;
+		}
+	}
+	else
+	{
+		ptSched->u32DeadlineUs = u32Now;
+		ptSched->bStarted = true;
+	}
+
+	HAL_DelayUntil( ptSched->u32DeadlineUs );
+
+	ptSched->u32StartUs = HAL_Micros();
+	ptSched->u32LateUs = max( (long)HAL_US_DIFF( ptSched->u32StartUs, ptSched->u32DeadlineUs ), 0L );
+	ptSched->u32LateMaxUs = max( ptSched->u32LateMaxUs, ptSched->u32LateUs );
+	ptSched->dLateSumUs += ptSched->u32LateUs;
+	ptSched->u32Ticks++;
+
+	ptSched->u32DeadlineUs += ptSched->u32PeriodUs;
+}
@@ -0,0 +1,53 @@
+// Sched.h
+// Fixed rate loop for the nav loop: a tick every 1/rate s on absolute
+// deadlines (HAL_DelayUntil()), so the time a tick takes doesn't stretch the
+// period and a late wake doesn't push the ticks after it back.
+//
+//   SCHED_Init( &tSched, CONTROL_RATE_HZ, CONTROL_PRIORITY );
+//   while( ... )
+//   {
+//       SCHED_Wait( &tSched );		// ends a tick, waits for the next deadline
+//       AUTOPILOT_Tick( ... );
+//   }
+//
+// Each tick's run time and how late it started (the jitter) are kept. A tick
+// that runs past the next deadline misses it, and the next starts at once,
+// late. Deadlines run past altogether are counted and dropped, not made up
+// with a burst of ticks.
+//
+// A priority > 0 asks for SCHED_FIFO (root or CAP_SYS_NICE). Without it the
+// loop still runs, on normal scheduling. Threads started before keep theirs.
+
+#ifndef SCHED_H
+#define SCHED_H
+
+#include "includes.h"
+
+//-------------------------------------------
+// Global defines
+
+typedef struct
+{
+	U32 u32PeriodUs;
+	U32 u32DeadlineUs;			// the next tick's, HAL_Micros()
+	U32 u32StartUs;				// this tick's start
+	bool bStarted;				// a tick has been
+	bool bRealTime;				// on SCHED_FIFO
+
+	U32 u32Ticks;
+	U32 u32Missed;				// deadlines ticks ran past
+	U32 u32RunUs;				// the last tick's
+	U32 u32RunMaxUs;
+	U32 u32LateUs;				// the last tick's start after its deadline
+	U32 u32LateMaxUs;
+	double dRunSumUs;			// over u32Ticks - 1, the last tick's still running
+	double dLateSumUs;			// over u32Ticks
+} tSCHED;
+
+//-------------------------------------------
+// Function prototypes
+
+bool	SCHED_Init( tSCHED *ptSched, U32 u32RateHz, int priority );
+void	SCHED_Wait( tSCHED *ptSched );
+
+#endif
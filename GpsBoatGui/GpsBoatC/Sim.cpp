@@ -0,0 +1,675 @@
+// Sim.cpp
+// Headless boat simulator, and the hardware (Hal.h) the boat code uses,
+// answered from it. See Sim.h.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "includes.h"
+#include "config.h"
+#include "Hal.h"
+#include "Sim.h"
+
+//-------------------------------------------
+// Local defines
+
+#define RADIANS_PER_DEGREE		(M_PI / 180.0)
+#define KNOTS_PER_MPS			1.943844
+
+#define SIM_ARDUINO_VERSION		0x5A
+
+//-------------------------------------------
+// Local data
+
+// The HAL calls have no handle to carry it, so one world per thread
+static __thread tSIM *gptSim = NULL;
+
+//-------------------------------------------
+// Local prototypes
+
+static double	WallNow( void );
+static double	Wrap360( double dDegrees );
+static double	Gaussian( tSIM *ptSim, double dSigma );
+static void		Step( tSIM *ptSim, double dt );
+static void		SendFix( tSIM *ptSim );
+static void		SendGps( tSIM *ptSim );
+static int		Sentence( char *pOut, const char *pBody );
+static void		FormatAngle( char *pOut, long millionths, int degreeDigits );
+static void		CompassFrame( tSIM *ptSim );
+static U32		Millis( void );
+static U32		Micros( void );
+static void		Delay( U32 ms );
+
+//-------------------------------------------
+// Global data
+
+// Simulated time, a nav thread's delays run its world
+const tHAL_CLOCK gtHalBackendClock = { Millis, Micros, Delay, NULL, NULL, NULL, NULL, NULL };
+
+//-----------------------------------------------------------------------------
+// Puts the boat at the start, stopped, with the servos centered. The calling
+// thread is the nav thread: its HAL calls go to this world, and its
+// HAL_Delay() calls run it.
+void SIM_Init( tSIM *ptSim, const tSIM_CONFIG *ptConfig )
+{
+	memset( ptSim, 0, sizeof(tSIM) );
+
+	ptSim->tConfig = *ptConfig;
+	ptSim->tBoat.dHeading = Wrap360( ptConfig->dStartHeading );
+	ENU_Init( &ptSim->tFrame, ptConfig->lStartLat, ptConfig->lStartLon );
+
+	// xorshift must not start at 0
+	ptSim->u32Random = ptConfig->u32Seed ? ptConfig->u32Seed : 1;
+
+	ptSim->u32NextFix = SIM_GPS_PERIOD_MS;
+	ptSim->aiGpsPipe[0] = -1;
+	ptSim->aiGpsPipe[1] = -1;
+	ptSim->compassFd = -1;
+	ptSim->arduinoFd = -1;
+
+	ptSim->au8ArduinoReg[ARDUINO_REG_VERSION] = SIM_ARDUINO_VERSION;
+	ptSim->au8ArduinoReg[ARDUINO_REG_STEERING] = RUDDER_CENTER;
+	ptSim->au8ArduinoReg[ARDUINO_REG_ESC] = SPEED_STOP;
+
+	ptSim->dWallStart = WallNow();
+
+	gptSim = ptSim;
+}
+
+//-----------------------------------------------------------------------------
+// pfnPump( pArg ) is called on the nav thread as each GPS sentence is sent, to
+// read it there and then (i.e. AUTOPILOT_ReadGps()) in place of a GPS thread
+void SIM_SetGpsPump( tSIM *ptSim, void (*pfnPump)( void *pArg ), void *pArg )
+{
+	ptSim->pfnGpsPump = pfnPump;
+	ptSim->pGpsPumpArg = pArg;
+}
+
+//-----------------------------------------------------------------------------
+// Closes the simulator's end of the GPS port, the nav code closes its own
+void SIM_Close( tSIM *ptSim )
+{
+	if( ptSim->aiGpsPipe[1] >= 0 )
+	{
+		close( ptSim->aiGpsPipe[1] );
+		ptSim->aiGpsPipe[1] = -1;
+	}
+
+	if( gptSim == ptSim )
+	{
+		gptSim = NULL;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Runs the world forward ms of simulated time, sending GPS fixes as they fall
+// due. Paced to wall time if the config asks for it.
+void SIM_Advance( tSIM *ptSim, U32 ms )
+{
+	U32 u32End = ptSim->u32Now + ms;
+	U32 u32Step;
+	double dAhead;
+
+	while( ptSim->u32Now != u32End )
+	{
+		u32Step = min( (U32)SIM_STEP_MS, u32End - ptSim->u32Now );
+
+		Step( ptSim, u32Step / 1000.0 );
+		ptSim->u32Now += u32Step;
+
+		if( (S32)(ptSim->u32Now - ptSim->u32NextFix) >= 0 )
+		{
+			ptSim->u32NextFix += SIM_GPS_PERIOD_MS;
+			SendFix( ptSim );
+		}
+
+		SendGps( ptSim );
+	}
+
+	if( ptSim->tConfig.dRealTime > 0.0 )
+	{
+		dAhead = ptSim->u32Now / 1000.0 / ptSim->tConfig.dRealTime - SIM_WallSeconds( ptSim );
+
+		if( dAhead > 0.0 )
+		{
+			usleep( (useconds_t)(dAhead * 1e6) );
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// True position, millionths of a degree
+void SIM_GetPosition( const tSIM *ptSim, long *plLat, long *plLon )
+{
+	tENU_POS tPos = { ptSim->tBoat.dEast, ptSim->tBoat.dNorth };
+
+	ENU_ToGeodetic( &ptSim->tFrame, &tPos, plLat, plLon );
+}
+
+//-----------------------------------------------------------------------------
+// Real seconds since SIM_Init()
+double SIM_WallSeconds( const tSIM *ptSim )
+{
+	return WallNow() - ptSim->dWallStart;
+}
+
+//-----------------------------------------------------------------------------
+// xorshift32, the same sequence for the same seed on every host (U32 is
+// 64 bits on a PC). *pu32State must not be 0.
+uint32_t SIM_Random( uint32_t *pu32State )
+{
+	uint32_t x = *pu32State;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	return *pu32State = x;
+}
+
+//-----------------------------------------------------------------------------
+double WallNow( void )
+{
+	struct timespec tNow;
+
+	clock_gettime( CLOCK_MONOTONIC, &tNow );
+
+	return tNow.tv_sec + tNow.tv_nsec / 1e9;
+}
+
+//-----------------------------------------------------------------------------
+double Wrap360( double dDegrees )
+{
+	dDegrees = fmod( dDegrees, 360.0 );
+
+	return (dDegrees < 0.0) ? dDegrees + 360.0 : dDegrees;
+}
+
+
+//-----------------------------------------------------------------------------
+// Box-Muller, one draw per call
+double Gaussian( tSIM *ptSim, double dSigma )
+{
+	double u1;
+	double u2;
+
+	if( dSigma == 0.0 )
+	{
+		return 0.0;
+	}
+
+	u1 = (SIM_Random( &ptSim->u32Random ) + 1.0) / 4294967297.0;
+	u2 = SIM_Random( &ptSim->u32Random ) / 4294967296.0;
+
+	return dSigma * sqrt( -2.0 * log( u1 ) ) * cos( 2.0 * M_PI * u2 );
+}
+
+//-----------------------------------------------------------------------------
+// One physics step of dt seconds from the servo settings the Arduino holds
+void Step( tSIM *ptSim, double dt )
+{
+	tSIM_BOAT *ptBoat = &ptSim->tBoat;
+	const tSIM_CONFIG *ptConfig = &ptSim->tConfig;
+	int steering = ptSim->au8ArduinoReg[ARDUINO_REG_STEERING];
+	double dThrottle;
+	double dRudder;
+	double dTurn;
+	double dSin;
+	double dCos;
+	double dEast;
+	double dNorth;
+
+	// ESC: linear from SPEED_STOP to SPEED_100_PERCENT, reverse down to SPEED_BACKUP
+	dThrottle = (double)(SPEED_STOP - ptSim->au8ArduinoReg[ARDUINO_REG_ESC]) / (SPEED_STOP - SPEED_100_PERCENT);
+	dThrottle = constrain( dThrottle, -(double)(SPEED_BACKUP - SPEED_STOP) / (SPEED_STOP - SPEED_100_PERCENT), 1.0 );
+	ptBoat->dThrottle += (dThrottle - ptBoat->dThrottle) * min( dt / SIM_ESC_TAU, 1.0 );
+
+	// Rudder servo, slew limited. SetRudder() has already applied RUDDER_REVERSE.
+#if RUDDER_REVERSE
+	steering = 180 - steering;
+#endif
+	if( steering >= RUDDER_CENTER )
+	{
+		dRudder = SIM_RUDDER_MAX * (steering - RUDDER_CENTER) / (RUDDER_FULL_RIGHT - RUDDER_CENTER);
+	}
+	else
+	{
+		dRudder = -SIM_RUDDER_MAX * (RUDDER_CENTER - steering) / (RUDDER_CENTER - RUDDER_FULL_LEFT);
+	}
+	dRudder = constrain( dRudder, -SIM_RUDDER_MAX, SIM_RUDDER_MAX );
+	dRudder = constrain( dRudder - ptBoat->dRudder, -SIM_RUDDER_RATE * dt, SIM_RUDDER_RATE * dt );
+	ptBoat->dRudder += dRudder;
+
+	// Battery: the motor, the servo moving, and holding against the water
+	ptBoat->dEnergy += SIM_MOTOR_W * fabs( ptBoat->dThrottle * sq( ptBoat->dThrottle ) ) * dt
+					 + SIM_SERVO_J_PER_DEG * fabs( dRudder )
+					 + SIM_SERVO_HOLD_W * fabs( ptBoat->dRudder / SIM_RUDDER_MAX ) * sq( ptBoat->dSurge / SIM_MAX_SPEED ) * dt;
+
+	// Surge: thrust against quadratic drag, more with the rudder over, SIM_MAX_SPEED
+	// at full throttle and the rudder centered
+	ptBoat->dSurge += SIM_ACCEL * (ptBoat->dThrottle - (1.0 + SIM_RUDDER_DRAG * fabs( ptBoat->dRudder / SIM_RUDDER_MAX ))
+								   * ptBoat->dSurge * fabs( ptBoat->dSurge ) / sq( SIM_MAX_SPEED )) * dt;
+
+	// Yaw: first order (Nomoto), the rudder only bites with water flowing past it
+	dTurn = SIM_TURN_RATE * (ptBoat->dRudder / SIM_RUDDER_MAX) * (ptBoat->dSurge / SIM_MAX_SPEED);
+	ptBoat->dYawRate += (dTurn - ptBoat->dYawRate) * min( dt / SIM_YAW_TAU, 1.0 );
+
+	// Sway: skids outward in a turn
+	dTurn = -SIM_SWAY_GAIN * ptBoat->dSurge * ptBoat->dYawRate * RADIANS_PER_DEGREE;
+	ptBoat->dSway += (dTurn - ptBoat->dSway) * min( dt / SIM_SWAY_TAU, 1.0 );
+
+	ptBoat->dHeading = Wrap360( ptBoat->dHeading + ptBoat->dYawRate * dt );
+
+	// Over the ground: water velocity, plus the current, plus leeway downwind
+	dSin = sin( ptBoat->dHeading * RADIANS_PER_DEGREE );
+	dCos = cos( ptBoat->dHeading * RADIANS_PER_DEGREE );
+	dEast = ptBoat->dSurge * dSin + ptBoat->dSway * dCos
+		  + ptConfig->dCurrentSpeed * sin( ptConfig->dCurrentDir * RADIANS_PER_DEGREE )
+		  - SIM_LEEWAY * ptConfig->dWindSpeed * sin( ptConfig->dWindDir * RADIANS_PER_DEGREE );
+	dNorth = ptBoat->dSurge * dCos - ptBoat->dSway * dSin
+		   + ptConfig->dCurrentSpeed * cos( ptConfig->dCurrentDir * RADIANS_PER_DEGREE )
+		   - SIM_LEEWAY * ptConfig->dWindSpeed * cos( ptConfig->dWindDir * RADIANS_PER_DEGREE );
+
+	ptBoat->dEast += dEast * dt;
+	ptBoat->dNorth += dNorth * dt;
+	ptBoat->dSailed += sqrt( sq( dEast ) + sq( dNorth ) ) * dt;
+}
+
+//-----------------------------------------------------------------------------
+// One second's NMEA from the Pharos: GGA, RMC and GSV where the boat is now,
+// no valid fix until u32GpsLockMs, queued for SendGps(). Nothing is sent until
+// the port is opened.
+void SendFix( tSIM *ptSim )
+{
+	const tSIM_BOAT *ptBoat = &ptSim->tBoat;
+	tENU_POS tPos;
+	long lat;
+	long lon;
+	char acLat[16];
+	char acLon[16];
+	char acTime[16];
+	char acBody[128];
+	char *acBurst = ptSim->acGpsBurst;
+	int len = 0;
+	bool bValid = ptSim->u32Now >= ptSim->tConfig.u32GpsLockMs;
+	U32 u32Seconds = 12 * 3600 + ptSim->u32Now / 1000;
+	double dEast;
+	double dNorth;
+
+	if( ptSim->aiGpsPipe[1] < 0 )
+	{
+		return;
+	}
+
+	tPos.dEast = ptBoat->dEast + Gaussian( ptSim, ptSim->tConfig.dGpsNoise );
+	tPos.dNorth = ptBoat->dNorth + Gaussian( ptSim, ptSim->tConfig.dGpsNoise );
+	ENU_ToGeodetic( &ptSim->tFrame, &tPos, &lat, &lon );
+	FormatAngle( acLat, lat, 2 );
+	FormatAngle( acLon, lon, 3 );
+
+	sprintf( acTime, "%02lu%02lu%02lu.00", (u32Seconds / 3600) % 24, (u32Seconds / 60) % 60, u32Seconds % 60 );
+
+	// Course and speed over the ground from the body velocity
+	dEast = ptBoat->dSurge * sin( ptBoat->dHeading * RADIANS_PER_DEGREE ) + ptBoat->dSway * cos( ptBoat->dHeading * RADIANS_PER_DEGREE );
+	dNorth = ptBoat->dSurge * cos( ptBoat->dHeading * RADIANS_PER_DEGREE ) - ptBoat->dSway * sin( ptBoat->dHeading * RADIANS_PER_DEGREE );
+
+	sprintf( acBody, "GPGGA,%s,%s,%c,%s,%c,%d,%02d,0.9,10.0,M,-33.0,M,,",
+			 acTime, acLat, (lat < 0) ? 'S' : 'N', acLon, (lon < 0) ? 'W' : 'E', bValid ? 1 : 0, bValid ? 8 : 0 );
+	len += Sentence( acBurst + len, acBody );
+
+	sprintf( acBody, "GPRMC,%s,%c,%s,%c,%s,%c,%.2f,%.1f,170826,,,%c",
+			 acTime, bValid ? 'A' : 'V', acLat, (lat < 0) ? 'S' : 'N', acLon, (lon < 0) ? 'W' : 'E',
+			 sqrt( sq( dEast ) + sq( dNorth ) ) * KNOTS_PER_MPS, Wrap360( atan2( dEast, dNorth ) / RADIANS_PER_DEGREE ),
+			 bValid ? 'A' : 'N' );
+	len += Sentence( acBurst + len, acBody );
+
+	sprintf( acBody, "GPGSV,1,1,%02d", bValid ? 8 : 3 );
+	len += Sentence( acBurst + len, acBody );
+
+	// The last burst has all gone by now, it takes about a third of a second
+	// at 4800 baud
+	ptSim->gpsBurstLength = len;
+	ptSim->gpsBurstSent = 0;
+	ptSim->u32GpsBurstStart = ptSim->u32Now + SIM_GPS_LATENCY_MS;
+
+	ptSim->u32Fixes++;
+}
+
+//-----------------------------------------------------------------------------
+// Writes each sentence of the burst once its last character would have come
+// over the serial port, in a write of its own, and has it read. Every
+// sentence parses (GSV too), so each is a publish with the fix's time.
+void SendGps( tSIM *ptSim )
+{
+	const char *pStart;
+	const char *pEol;
+	U32 u32Due;
+	int len;
+
+	if( ptSim->aiGpsPipe[1] < 0 || (S32)(ptSim->u32Now - ptSim->u32GpsBurstStart) < 0 )
+	{
+		return;
+	}
+
+	// 10 bits a character, start and stop included
+	u32Due = min( (ptSim->u32Now - ptSim->u32GpsBurstStart) * GPS_BAUD / 10000, (U32)ptSim->gpsBurstLength );
+
+	while( ptSim->gpsBurstSent < (int)u32Due )
+	{
+		pStart = ptSim->acGpsBurst + ptSim->gpsBurstSent;
+
+		if( !(pEol = (const char *)memchr( pStart, '\n', u32Due - ptSim->gpsBurstSent )) )
+		{
+			break;
+		}
+
+		len = pEol + 1 - pStart;
+		ptSim->gpsBurstSent += len;
+
+		if( write( ptSim->aiGpsPipe[1], pStart, len ) != len )
+		{
+			fprintf (stderr, "Sim GPS write error: %s\n", strerror (errno)) ;
+			return;
+		}
+
+		if( ptSim->pfnGpsPump )
+		{
+			ptSim->pfnGpsPump( ptSim->pGpsPumpArg );
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// "$body*CS\r\n" into pOut, returns its length
+int Sentence( char *pOut, const char *pBody )
+{
+	U8 u8Checksum = 0;
+	const char *p;
+
+	for( p = pBody; *p; p++ )
+	{
+		u8Checksum ^= (U8)*p;
+	}
+
+	return sprintf( pOut, "$%s*%02X\r\n", pBody, u8Checksum );
+}
+
+//-----------------------------------------------------------------------------
+// NMEA dddmm.mmmmm from millionths of a degree, sign dropped
+void FormatAngle( char *pOut, long millionths, int degreeDigits )
+{
+	long v = labs( millionths );
+	long microMinutes = (v % 1000000L) * 60;
+
+	sprintf( pOut, "%0*ld%02ld.%05ld", degreeDigits, v / 1000000L, microMinutes / 1000000L, (microMinutes % 1000000L) / 10 );
+}
+
+//-----------------------------------------------------------------------------
+// A complete SC18IM700 frame arrived from HMC6343.cpp. Write frames run the
+// compass command, read frames make its answer available.
+void CompassFrame( tSIM *ptSim )
+{
+	const U8 *pFrame = ptSim->au8Frame;
+	int reg = pFrame[4];
+	double dHeading;
+	U16 u16Tenths;
+
+	if( pFrame[1] & 0x01 )
+	{
+		ptSim->replyAvail = min( (int)pFrame[2], ptSim->replyLength );
+		ptSim->replyRead = 0;
+		return;
+	}
+
+	ptSim->replyLength = 0;
+	ptSim->replyAvail = 0;
+
+	switch( pFrame[3] )
+	{
+	case HMC6343__GET_HEADING_DATA__CMD:
+		// Magnetic: GetCompassHeading() takes MAG_VAR back off
+		dHeading = Wrap360( ptSim->tBoat.dHeading + MAG_VAR + ptSim->tConfig.dCompassBias
+							+ Gaussian( ptSim, ptSim->tConfig.dCompassNoise ) );
+		u16Tenths = (U16)(dHeading * 10.0 + 0.5) % 3600;
+
+		memset( ptSim->au8Reply, 0, HMC6343__GET_HEADING_DATA__DATA_SIZE );
+		ptSim->au8Reply[0] = u16Tenths >> 8;
+		ptSim->au8Reply[1] = u16Tenths & 0xFF;
+		ptSim->replyLength = HMC6343__GET_HEADING_DATA__DATA_SIZE;
+		ptSim->u32CompassReads++;
+		break;
+
+	case HMC6343__READ_EEPROM__CMD:
+		ptSim->au8Reply[0] = (reg < (int)sizeof(ptSim->au8Eeprom)) ? ptSim->au8Eeprom[reg] : 0;
+		ptSim->replyLength = HMC6343__READ_EEPROM__DATA_SIZE;
+		break;
+
+	case HMC6343__WRITE_EEPROM__CMD:
+		if( reg < (int)sizeof(ptSim->au8Eeprom) )
+		{
+			ptSim->au8Eeprom[reg] = pFrame[5];
+		}
+		break;
+
+	default:
+		// Reset, orientation, modes: nothing to model
+		break;
+	}
+}
+
+//*****************************************************************************
+// The HAL, as the boat code uses it
+//*****************************************************************************
+
+//-----------------------------------------------------------------------------
+bool HAL_Init( void )
+{
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+void HAL_PinMode( int pin, int mode )
+{
+}
+
+//-----------------------------------------------------------------------------
+void HAL_DigitalWrite( int pin, int value )
+{
+}
+
+//-----------------------------------------------------------------------------
+int HAL_DigitalRead( int pin )
+{
+	return HAL_LOW;
+}
+
+//-----------------------------------------------------------------------------
+U32 Millis( void )
+{
+	return gptSim->u32Now;
+}
+
+//-----------------------------------------------------------------------------
+U32 Micros( void )
+{
+	return gptSim->u32Now * 1000;
+}
+
+//-----------------------------------------------------------------------------
+// A nav thread's delays are simulated time, any other thread really sleeps
+void Delay( U32 ms )
+{
+	if( gptSim )
+	{
+		SIM_Advance( gptSim, ms );
+	}
+	else
+	{
+		usleep( ms * 1000 );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// The GPS port is a pipe, the compass port is /dev/null with the bridge
+// answered from HAL_SerialPutchar()
+int HAL_SerialOpen( const char *pDevice, int baud )
+{
+	if( 0 == strcmp( pDevice, SIM_GPS_DEVICE ) )
+	{
+		if( pipe( gptSim->aiGpsPipe ) < 0 )
+		{
+			return -1;
+		}
+
+		return gptSim->aiGpsPipe[0];
+	}
+
+	if( 0 == strcmp( pDevice, SIM_COMPASS_DEVICE ) )
+	{
+		return gptSim->compassFd = open( "/dev/null", O_RDWR );
+	}
+
+	errno = ENOENT;
+	return -1;
+}
+
+//-----------------------------------------------------------------------------
+void HAL_SerialClose( int fd )
+{
+	close( fd );
+}
+
+//-----------------------------------------------------------------------------
+void HAL_SerialFlush( int fd )
+{
+	if( fd == gptSim->compassFd )
+	{
+		gptSim->frameLength = 0;
+		gptSim->replyAvail = 0;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Collects a bridge frame: 'S', address, length, data, 'P'. SendCommand()
+// counts the stop byte in a write's length, a read has no data.
+void HAL_SerialPutchar( int fd, U8 c )
+{
+	tSIM *ptSim = gptSim;
+	int frameSize;
+
+	if( fd != ptSim->compassFd )
+	{
+		return;
+	}
+
+	if( ptSim->frameLength == 0 && c != 'S' )
+	{
+		return;
+	}
+
+	ptSim->au8Frame[ptSim->frameLength++] = c;
+
+	if( ptSim->frameLength < 3 )
+	{
+		return;
+	}
+
+	frameSize = (ptSim->au8Frame[1] & 0x01) ? 4 : ptSim->au8Frame[2] + 3;
+
+	if( frameSize > (int)sizeof(ptSim->au8Frame) )
+	{
+		// Not something HMC6343.cpp sends, resync on the next 'S'
+		ptSim->frameLength = 0;
+	}
+	else if( ptSim->frameLength == frameSize )
+	{
+		CompassFrame( ptSim );
+		ptSim->frameLength = 0;
+	}
+}
+
+//-----------------------------------------------------------------------------
+int HAL_SerialDataAvail( int fd )
+{
+	return (fd == gptSim->compassFd) ? gptSim->replyAvail - gptSim->replyRead : -1;
+}
+
+//-----------------------------------------------------------------------------
+int HAL_SerialGetchar( int fd )
+{
+	tSIM *ptSim = gptSim;
+
+	if( fd != ptSim->compassFd || ptSim->replyRead >= ptSim->replyAvail )
+	{
+		return -1;
+	}
+
+	return ptSim->au8Reply[ptSim->replyRead++];
+}
+
+//-----------------------------------------------------------------------------
+// The only device on the bus is the Arduino servo sketch
+int HAL_I2cOpen( int address )
+{
+	if( address != ARDUINO_I2C_ADDR )
+	{
+		errno = ENODEV;
+		return -1;
+	}
+
+	return gptSim->arduinoFd = open( "/dev/null", O_RDWR );
+}
+
+//-----------------------------------------------------------------------------
+void HAL_I2cClose( int fd )
+{
+	close( fd );
+}
+
+//-----------------------------------------------------------------------------
+int HAL_I2cRead( int fd )
+{
+	if( fd != gptSim->arduinoFd )
+	{
+		errno = EBADF;
+		return -1;
+	}
+
+	return gptSim->au8ArduinoReg[gptSim->arduinoReg];
+}
+
+//-----------------------------------------------------------------------------
+// A register number, 0x80 set for a write, then the value for a write
+int HAL_I2cWrite( int fd, U8 data )
+{
+	tSIM *ptSim = gptSim;
+
+	if( fd != ptSim->arduinoFd )
+	{
+		errno = EBADF;
+		return -1;
+	}
+
+	if( ptSim->bArduinoWrite )
+	{
+		ptSim->au8ArduinoReg[ptSim->arduinoReg] = data;
+		ptSim->bArduinoWrite = false;
+	}
+	else if( (data & 0x7F) < ARDUINO_REG_MAX )
+	{
+		ptSim->arduinoReg = data & 0x7F;
+		ptSim->bArduinoWrite = (data & 0x80) != 0;
+	}
+	else
+	{
+		errno = EIO;
+		return -1;
+	}
+
+	return 0;
+}
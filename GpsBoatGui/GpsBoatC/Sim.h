@@ -0,0 +1,151 @@
+// Sim.h
+// Headless boat simulator. The nav code (Autopilot.cpp) is built unchanged
+// against this backend of the HAL (Hal.h, make simboat) and talks to a
+// simulated world:
+//   GPS      NMEA (GGA, RMC, GSV) at 1 Hz down a pipe to the real GpsReader
+//            and TinyGPS, each fix SIM_GPS_LATENCY_MS after it was taken
+//            and then a sentence at a time at GPS_BAUD, as slow as the
+//            Pharos's serial port
+//   compass  an HMC6343 behind its SC18IM700 I2C bridge, byte for byte on
+//            the serial port HMC6343.cpp opens
+//   servos   the Arduino sketch's I2C registers, ESC and steering
+//
+// Time is virtual. HAL_Millis() is simulated time and HAL_Delay() runs the
+// world forward instead of sleeping, so the nav loop runs as fast as the
+// host allows (or at a set multiple of real time). Each GPS sentence is read on
+// the nav thread as it is sent (SIM_SetGpsPump()), so runs are repeatable.
+//
+// A world belongs to the thread that called SIM_Init() on it, so each thread
+// can run its own boat (simboat's Monte Carlo does).
+//
+// The boat is a 3-DOF (surge, sway, yaw) model driven by the ESC and rudder
+// servo settings in config.h: SPEED_STOP .. SPEED_100_PERCENT is linear in
+// throttle, RUDDER_FULL_LEFT .. RUDDER_FULL_RIGHT in rudder angle. Rudder
+// off center adds drag, and the motor and rudder servo draw on a battery, so
+// steering that weaves costs both time and energy.
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include "includes.h"
+#include "LocalFrame.h"
+#include "Arduino.h"
+#include "HMC6343.h"
+
+//-------------------------------------------
+// Global defines
+
+// Ports as the boat code opens them
+#define SIM_GPS_DEVICE			"/dev/ttyAMA0"
+#define SIM_COMPASS_DEVICE		"/dev/ttyUSB0"
+
+#define SIM_STEP_MS				10			// physics step
+#define SIM_GPS_PERIOD_MS		1000		// Pharos fix rate
+#define SIM_GPS_LATENCY_MS		GPS_FIX_LATENCY_MS	// fix taken to first character sent
+
+// Boat
+#define SIM_MAX_SPEED			2.0			// m/s at SPEED_100_PERCENT
+#define SIM_ACCEL				0.8			// m/s^2 at full throttle from rest
+#define SIM_ESC_TAU				0.3			// s, throttle lag
+#define SIM_RUDDER_MAX			35.0		// degrees at RUDDER_FULL_LEFT/RIGHT
+#define SIM_RUDDER_RATE			200.0		// degrees/s servo slew
+#define SIM_TURN_RATE			40.0		// degrees/s at full rudder and speed
+#define SIM_YAW_TAU				0.6			// s
+#define SIM_SWAY_GAIN			0.2			// outward skid in turns
+#define SIM_SWAY_TAU			0.5			// s
+#define SIM_LEEWAY				0.03		// drift as a fraction of wind speed
+#define SIM_RUDDER_DRAG			0.3			// extra hull drag at full rudder
+
+// Battery
+#define SIM_MOTOR_W				60.0		// at full throttle, goes as throttle cubed
+#define SIM_SERVO_J_PER_DEG		0.02		// rudder servo moving
+#define SIM_SERVO_HOLD_W		1.0			// holding full rudder at full speed
+
+typedef struct
+{
+	long lStartLat;				// millionths of a degree
+	long lStartLon;
+	double dStartHeading;		// degrees true
+
+	// Sensors
+	U32 u32GpsLockMs;			// first valid fix after power on
+	double dGpsNoise;			// meters, 1 sigma per axis
+	double dCompassBias;		// degrees
+	double dCompassNoise;		// degrees, 1 sigma
+
+	// Environment
+	double dCurrentSpeed;		// m/s
+	double dCurrentDir;			// degrees true, flowing toward
+	double dWindSpeed;			// m/s
+	double dWindDir;			// degrees true, blowing from
+
+	double dRealTime;			// times real time, 0 == as fast as possible
+	U32 u32Seed;
+} tSIM_CONFIG;
+
+typedef struct
+{
+	double dEast;				// meters from the start
+	double dNorth;
+	double dHeading;			// degrees true
+	double dSurge;				// m/s, body frame
+	double dSway;				// m/s, + == to starboard
+	double dYawRate;			// degrees/s
+	double dRudder;				// degrees, + == right
+	double dThrottle;			// -1/3 (SPEED_BACKUP) .. 1
+	double dSailed;				// meters over the ground
+	double dEnergy;				// J drawn from the battery
+} tSIM_BOAT;
+
+typedef struct
+{
+	tSIM_CONFIG tConfig;
+	tSIM_BOAT tBoat;
+	tENU_FRAME tFrame;			// anchored at the start
+	U32 u32Now;					// virtual ms since power on
+	U32 u32NextFix;
+	uint32_t u32Random;
+	double dWallStart;
+
+	// GPS port, the nav code reads the other end of the pipe
+	int aiGpsPipe[2];
+	void (*pfnGpsPump)( void *pArg );	// reads each sentence as it is sent
+	void *pGpsPumpArg;
+	U32 u32Fixes;
+	char acGpsBurst[512];		// the last fix's NMEA, going out at GPS_BAUD
+	int gpsBurstLength;
+	int gpsBurstSent;
+	U32 u32GpsBurstStart;		// when its first character goes
+
+	// Compass bridge: the frame being sent, the last command's answer and
+	// how much of it a read frame has made available
+	int compassFd;
+	U8 au8Frame[8];
+	int frameLength;
+	U8 au8Reply[8];
+	int replyLength;
+	int replyAvail;
+	int replyRead;
+	U8 au8Eeprom[HMC6343__HEADING_FILTER_MSB_REG + 1];
+	U32 u32CompassReads;
+
+	// Arduino sketch registers
+	int arduinoFd;
+	U8 au8ArduinoReg[ARDUINO_REG_MAX];
+	int arduinoReg;				// register the next read or write is for
+	bool bArduinoWrite;
+} tSIM;
+
+//-------------------------------------------
+// Function prototypes
+
+void	SIM_Init( tSIM *ptSim, const tSIM_CONFIG *ptConfig );
+void	SIM_SetGpsPump( tSIM *ptSim, void (*pfnPump)( void *pArg ), void *pArg );
+void	SIM_Close( tSIM *ptSim );
+void	SIM_Advance( tSIM *ptSim, U32 ms );
+void	SIM_GetPosition( const tSIM *ptSim, long *plLat, long *plLon );
+double	SIM_WallSeconds( const tSIM *ptSim );
+uint32_t SIM_Random( uint32_t *pu32State );
+
+#endif
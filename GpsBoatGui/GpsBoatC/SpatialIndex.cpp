@@ -0,0 +1,442 @@
+// SpatialIndex.cpp
+// Uniform grid over points in the local ENU frame. See SpatialIndex.h.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include "SpatialIndex.h"
+
+//-------------------------------------------
+// Local defines
+
+#define INDEX_POINTS_PER_CELL	2.0
+
+//-------------------------------------------
+// Local prototypes
+
+static int		Column( const tINDEX *ptIndex, double dEast );
+static int		Row( const tINDEX *ptIndex, double dNorth );
+static double	SegmentDistance2( const tENU_POS *ptStart, double dE, double dN, double dLength2, const tINDEX_POINT *ptPoint );
+
+//-----------------------------------------------------------------------------
+// Bulk loads ptPos[0..count-1], a point's id is its index in ptPos.
+// Returns false if out of memory.
+bool INDEX_Build( tINDEX *ptIndex, const tENU_POS *ptPos, int count )
+{
+	double dMinE = DBL_MAX;
+	double dMaxE = -DBL_MAX;
+	double dMinN = DBL_MAX;
+	double dMaxN = -DBL_MAX;
+	double dWidth;
+	double dHeight;
+	double dCell;
+	int cells;
+	int cell;
+	int i;
+	tINDEX_POINT *ptPoint;
+
+	memset( ptIndex, 0, sizeof(tINDEX) );
+
+	if( count <= 0 )
+	{
+		return true;
+	}
+
+	for( i = 0; i < count; i++ )
+	{
+		dMinE = fmin( dMinE, ptPos[i].dEast );
+		dMaxE = fmax( dMaxE, ptPos[i].dEast );
+		dMinN = fmin( dMinN, ptPos[i].dNorth );
+		dMaxN = fmax( dMaxN, ptPos[i].dNorth );
+	}
+
+	// About INDEX_POINTS_PER_CELL points a cell, never more cells than points
+	dWidth = fmax( dMaxE - dMinE, 1.0 );
+	dHeight = fmax( dMaxN - dMinN, 1.0 );
+	dCell = sqrt( dWidth * dHeight * INDEX_POINTS_PER_CELL / count );
+
+	for( ;; )
+	{
+		ptIndex->columns = (int)(dWidth / dCell) + 1;
+		ptIndex->rows = (int)(dHeight / dCell) + 1;
+
+		if( (double)ptIndex->columns * ptIndex->rows <= count + 16 )
+		{
+			break;
+		}
+		dCell *= 1.25;
+	}
+
+	cells = ptIndex->columns * ptIndex->rows;
+
+	ptIndex->fEast0 = dMinE;
+	ptIndex->fNorth0 = dMinN;
+	ptIndex->fCellSize = dCell;
+	ptIndex->fInvCellSize = 1.0 / dCell;
+
+	ptIndex->ptPoints = (tINDEX_POINT *)malloc( count * sizeof(tINDEX_POINT) );
+	ptIndex->pu32CellStart = (uint32_t *)calloc( cells + 1, sizeof(uint32_t) );
+
+	if( !ptIndex->ptPoints || !ptIndex->pu32CellStart )
+	{
+		fprintf( stderr, "Spatial index: out of memory for %i points\n", count );
+		INDEX_Free( ptIndex );
+		return false;
+	}
+
+	// Counting sort by cell: count, prefix sum, scatter
+	for( i = 0; i < count; i++ )
+	{
+		cell = Row( ptIndex, ptPos[i].dNorth ) * ptIndex->columns + Column( ptIndex, ptPos[i].dEast );
+		ptIndex->pu32CellStart[cell + 1]++;
+	}
+
+	for( i = 0; i < cells; i++ )
+	{
+		ptIndex->pu32CellStart[i + 1] += ptIndex->pu32CellStart[i];
+	}
+
+	for( i = 0; i < count; i++ )
+	{
+		cell = Row( ptIndex, ptPos[i].dNorth ) * ptIndex->columns + Column( ptIndex, ptPos[i].dEast );
+
+		ptPoint = &ptIndex->ptPoints[ptIndex->pu32CellStart[cell]++];
+		ptPoint->fEast = ptPos[i].dEast;
+		ptPoint->fNorth = ptPos[i].dNorth;
+		ptPoint->u32Id = i;
+	}
+
+	// The scatter moved every start to the next cell's start
+	for( i = cells; i > 0; i-- )
+	{
+		ptIndex->pu32CellStart[i] = ptIndex->pu32CellStart[i - 1];
+	}
+	ptIndex->pu32CellStart[0] = 0;
+
+	ptIndex->count = count;
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+void INDEX_Free( tINDEX *ptIndex )
+{
+	free( ptIndex->ptPoints );
+	free( ptIndex->pu32CellStart );
+	memset( ptIndex, 0, sizeof(tINDEX) );
+}
+
+//-----------------------------------------------------------------------------
+// Id of the point nearest ptPos, -1 if none within dMaxRadius (meters,
+// <= 0 for no limit). Searches rings of cells outwards from the query's
+// cell (clamped to the grid), stopping once the next ring can't be closer
+// than the best so far.
+int INDEX_Nearest( const tINDEX *ptIndex, const tENU_POS *ptPos, double dMaxRadius, double *pdDist )
+{
+	double dBest2 = (dMaxRadius > 0.0) ? dMaxRadius * dMaxRadius : DBL_MAX;
+	double dE;
+	double dN;
+	double dRing;
+	double dOffE;
+	double dOffN;
+	int best = -1;
+	int qc;
+	int qr;
+	int r;
+	int rMax;
+	int row;
+	int col;
+	int c0;
+	int c1;
+	int step;
+	uint32_t i;
+
+	if( ptIndex->count == 0 )
+	{
+		return -1;
+	}
+
+	qc = Column( ptIndex, ptPos->dEast );
+	qr = Row( ptIndex, ptPos->dNorth );
+
+	// Ring after which every cell is off the grid
+	rMax = qc;
+	rMax = max( rMax, ptIndex->columns - 1 - qc );
+	rMax = max( rMax, qr );
+	rMax = max( rMax, ptIndex->rows - 1 - qr );
+
+	// How far the query is off the grid, 0 if on it
+	dOffE = fmax( 0.0, fmax( ptIndex->fEast0 - ptPos->dEast,
+							 ptPos->dEast - (ptIndex->fEast0 + ptIndex->columns * (double)ptIndex->fCellSize) ) );
+	dOffN = fmax( 0.0, fmax( ptIndex->fNorth0 - ptPos->dNorth,
+							 ptPos->dNorth - (ptIndex->fNorth0 + ptIndex->rows * (double)ptIndex->fCellSize) ) );
+
+	for( r = 0; r <= rMax; r++ )
+	{
+		// A cell in ring r is r columns or r rows from the query's (clamped)
+		// cell, so at least r - 1 cells further than the grid edge that way
+		if( r > 1 )
+		{
+			dRing = (r - 1) * (double)ptIndex->fCellSize;
+			if( fmin( (dRing + dOffE) * (dRing + dOffE) + dOffN * dOffN,
+					  dOffE * dOffE + (dRing + dOffN) * (dRing + dOffN) ) > dBest2 )
+			{
+				break;
+			}
+		}
+
+		for( row = qr - r; row <= qr + r; row++ )
+		{
+			if( row < 0 || row >= ptIndex->rows )
+			{
+				continue;
+			}
+
+			// Whole row on the ring's top and bottom edge, the two ends otherwise
+			if( row == qr - r || row == qr + r )
+			{
+				c0 = max( qc - r, 0 );
+				c1 = min( qc + r, ptIndex->columns - 1 );
+				step = 1;
+			}
+			else
+			{
+				c0 = qc - r;
+				c1 = qc + r;
+				step = 2 * r;
+			}
+
+			for( col = c0; col <= c1; col += step )
+			{
+				if( col < 0 || col >= ptIndex->columns )
+				{
+					continue;
+				}
+
+				for( i = ptIndex->pu32CellStart[row * ptIndex->columns + col];
+					 i < ptIndex->pu32CellStart[row * ptIndex->columns + col + 1]; i++ )
+				{
+					dE = ptIndex->ptPoints[i].fEast - ptPos->dEast;
+					dN = ptIndex->ptPoints[i].fNorth - ptPos->dNorth;
+
+					if( dE * dE + dN * dN < dBest2 )
+					{
+						dBest2 = dE * dE + dN * dN;
+						best = ptIndex->ptPoints[i].u32Id;
+					}
+				}
+			}
+		}
+	}
+
+	if( best >= 0 && pdDist )
+	{
+		*pdDist = sqrt( dBest2 );
+	}
+
+	return best;
+}
+
+//-----------------------------------------------------------------------------
+// Lowest id >= minId within dRadius of ptPos, -1 if none. With minId the
+// next waypoint to visit this is "next unvisited point within R meters".
+int INDEX_FirstWithin( const tINDEX *ptIndex, const tENU_POS *ptPos, double dRadius, int minId )
+{
+	double dRadius2 = dRadius * dRadius;
+	double dE;
+	double dN;
+	uint32_t u32Best = UINT32_MAX;
+	int c0;
+	int c1;
+	int r0;
+	int r1;
+	int row;
+	uint32_t i;
+	const tINDEX_POINT *ptPoint;
+
+	if( ptIndex->count == 0 || minId < 0 )
+	{
+		return -1;
+	}
+
+	c0 = Column( ptIndex, ptPos->dEast - dRadius );
+	c1 = Column( ptIndex, ptPos->dEast + dRadius );
+	r0 = Row( ptIndex, ptPos->dNorth - dRadius );
+	r1 = Row( ptIndex, ptPos->dNorth + dRadius );
+
+	for( row = r0; row <= r1; row++ )
+	{
+		for( i = ptIndex->pu32CellStart[row * ptIndex->columns + c0];
+			 i < ptIndex->pu32CellStart[row * ptIndex->columns + c1 + 1]; i++ )
+		{
+			ptPoint = &ptIndex->ptPoints[i];
+
+			if( ptPoint->u32Id < (uint32_t)minId || ptPoint->u32Id >= u32Best )
+			{
+				continue;
+			}
+
+			dE = ptPoint->fEast - ptPos->dEast;
+			dN = ptPoint->fNorth - ptPos->dNorth;
+
+			if( dE * dE + dN * dN <= dRadius2 )
+			{
+				u32Best = ptPoint->u32Id;
+			}
+		}
+	}
+
+	return (u32Best == UINT32_MAX) ? -1 : (int)u32Best;
+}
+
+//-----------------------------------------------------------------------------
+// Points within dRadius of the track ptStart -> ptEnd. Up to maxIds of their
+// ids go to pIds, the distance of the closest to *pdClosest (if not NULL).
+// Returns how many there are in all.
+// Each row of cells is only scanned across the columns the track, widened
+// by dRadius, crosses in that row.
+int INDEX_NearTrack( const tINDEX *ptIndex, const tENU_POS *ptStart, const tENU_POS *ptEnd, double dRadius,
+					 int *pIds, int maxIds, double *pdClosest )
+{
+	double dE = ptEnd->dEast - ptStart->dEast;
+	double dN = ptEnd->dNorth - ptStart->dNorth;
+	double dLength2 = dE * dE + dN * dN;
+	double dRadius2 = dRadius * dRadius;
+	double dClosest2 = DBL_MAX;
+	double dBandLo;
+	double dBandHi;
+	double t0;
+	double t1;
+	double t;
+	double d2;
+	int found = 0;
+	int r0;
+	int r1;
+	int c0;
+	int c1;
+	int row;
+	uint32_t i;
+
+	if( ptIndex->count == 0 )
+	{
+		return 0;
+	}
+
+	r0 = Row( ptIndex, fmin( ptStart->dNorth, ptEnd->dNorth ) - dRadius );
+	r1 = Row( ptIndex, fmax( ptStart->dNorth, ptEnd->dNorth ) + dRadius );
+
+	for( row = r0; row <= r1; row++ )
+	{
+		// Part of the track within dRadius of this row's band of north
+		dBandLo = ptIndex->fNorth0 + row * (double)ptIndex->fCellSize - dRadius;
+		dBandHi = dBandLo + ptIndex->fCellSize + 2.0 * dRadius;
+
+		if( fabs( dN ) > 1e-9 )
+		{
+			t0 = (dBandLo - ptStart->dNorth) / dN;
+			t1 = (dBandHi - ptStart->dNorth) / dN;
+			if( t0 > t1 )
+			{
+				t = t0;
+				t0 = t1;
+				t1 = t;
+			}
+			t0 = fmax( t0, 0.0 );
+			t1 = fmin( t1, 1.0 );
+		}
+		else
+		{
+			t0 = 0.0;
+			t1 = 1.0;
+		}
+
+		// Band edges are inclusive of the ends of the track rows, so the first
+		// and last row always overlap it
+		if( t0 > t1 )
+		{
+			if( row != r0 && row != r1 )
+			{
+				continue;
+			}
+			t0 = 0.0;
+			t1 = 1.0;
+		}
+
+		c0 = Column( ptIndex, fmin( ptStart->dEast + t0 * dE, ptStart->dEast + t1 * dE ) - dRadius );
+		c1 = Column( ptIndex, fmax( ptStart->dEast + t0 * dE, ptStart->dEast + t1 * dE ) + dRadius );
+
+		for( i = ptIndex->pu32CellStart[row * ptIndex->columns + c0];
+			 i < ptIndex->pu32CellStart[row * ptIndex->columns + c1 + 1]; i++ )
+		{
+			d2 = SegmentDistance2( ptStart, dE, dN, dLength2, &ptIndex->ptPoints[i] );
+
+			if( d2 <= dRadius2 )
+			{
+				if( found < maxIds )
+				{
+					pIds[found] = ptIndex->ptPoints[i].u32Id;
+				}
+				found++;
+
+				dClosest2 = fmin( dClosest2, d2 );
+			}
+		}
+	}
+
+	if( found && pdClosest )
+	{
+		*pdClosest = sqrt( dClosest2 );
+	}
+
+	return found;
+}
+
+//-----------------------------------------------------------------------------
+// Squared distance from a point to the track starting at ptStart with
+// direction (dE, dN)
+double SegmentDistance2( const tENU_POS *ptStart, double dE, double dN, double dLength2, const tINDEX_POINT *ptPoint )
+{
+	double dPE = ptPoint->fEast - ptStart->dEast;
+	double dPN = ptPoint->fNorth - ptStart->dNorth;
+	double t = 0.0;
+
+	if( dLength2 > 0.0 )
+	{
+		t = (dPE * dE + dPN * dN) / dLength2;
+		t = fmax( 0.0, fmin( 1.0, t ) );
+	}
+
+	dPE -= t * dE;
+	dPN -= t * dN;
+
+	return dPE * dPE + dPN * dPN;
+}
+
+//-----------------------------------------------------------------------------
+// Grid column of an east position, clamped to the grid
+int Column( const tINDEX *ptIndex, double dEast )
+{
+	double c = (dEast - ptIndex->fEast0) * ptIndex->fInvCellSize;
+
+	if( c < 0.0 )
+	{
+		return 0;
+	}
+
+	return (c >= ptIndex->columns) ? ptIndex->columns - 1 : (int)c;
+}
+
+//-----------------------------------------------------------------------------
+int Row( const tINDEX *ptIndex, double dNorth )
+{
+	double r = (dNorth - ptIndex->fNorth0) * ptIndex->fInvCellSize;
+
+	if( r < 0.0 )
+	{
+		return 0;
+	}
+
+	return (r >= ptIndex->rows) ? ptIndex->rows - 1 : (int)r;
+}
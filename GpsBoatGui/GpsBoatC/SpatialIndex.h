@@ -0,0 +1,56 @@
+// SpatialIndex.h
+// Uniform grid over points in the local ENU frame, bulk loaded once, for
+// "nearest point", "first point from id N within R meters" and "points
+// near my track" queries.
+//
+// Points are counting-sorted by cell into flat arrays. Each cell is a
+// contiguous run of {east, north, id}, and a cell table holds the start of
+// each run. The cell size is picked so there are about 2 points per cell
+// over the points' bounding box, capped at one cell per point.
+// Memory: 12 bytes per point plus 4 bytes per cell, so at most 16 bytes per
+// point. Coordinates are floats, ~1 mm resolution 10 km from home.
+
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+#include <stdint.h>
+#include "includes.h"
+#include "LocalFrame.h"
+
+//-------------------------------------------
+// Global defines
+
+typedef struct
+{
+	float fEast;
+	float fNorth;
+	uint32_t u32Id;		// caller's index, i.e. the waypoint number
+} tINDEX_POINT;
+
+typedef struct
+{
+	int count;
+	tINDEX_POINT *ptPoints;		// sorted by cell
+	uint32_t *pu32CellStart;	// cells + 1 entries
+
+	// Grid geometry
+	float fEast0;				// south west corner
+	float fNorth0;
+	float fCellSize;			// meters
+	float fInvCellSize;
+	int columns;
+	int rows;
+} tINDEX;
+
+//-------------------------------------------
+// Function prototypes
+
+bool	INDEX_Build( tINDEX *ptIndex, const tENU_POS *ptPos, int count );
+void	INDEX_Free( tINDEX *ptIndex );
+
+int		INDEX_Nearest( const tINDEX *ptIndex, const tENU_POS *ptPos, double dMaxRadius, double *pdDist );
+int		INDEX_FirstWithin( const tINDEX *ptIndex, const tENU_POS *ptPos, double dRadius, int minId );
+int		INDEX_NearTrack( const tINDEX *ptIndex, const tENU_POS *ptStart, const tENU_POS *ptEnd, double dRadius,
+						 int *pIds, int maxIds, double *pdClosest );
+
+#endif
@@ -0,0 +1,190 @@
+// Status.cpp
+// Status screen. See Status.h.
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include "Status.h"
+#include "Hal.h"
+
+//-------------------------------------------
+// Local defines
+
+#define STATUS_CLEAR			"\033[H\033[2J"		// home, erase the screen
+
+//-------------------------------------------
+// Local prototypes
+
+static void		ShowTerminal( tSTATUS *ptStatus, U32 u32Now );
+static void		ShowLog( tSTATUS *ptStatus, U32 u32Now );
+static void		Put( tSTATUS *ptStatus, const char *pFormat, ... );
+static void		Write( tSTATUS *ptStatus );
+
+//-----------------------------------------------------------------------------
+// Status on fp, stdout say. A terminal is cleared for it.
+void STATUS_Init( tSTATUS *ptStatus, FILE *fp )
+{
+	memset( ptStatus, 0, sizeof(tSTATUS) );
+
+	ptStatus->fp = fp;
+	ptStatus->bTerminal = isatty( fileno( fp ) );
+
+	if( ptStatus->bTerminal )
+	{
+		Put( ptStatus, STATUS_CLEAR );
+		Write( ptStatus );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Adds a line to this pass's status, printf style, no newline
+void STATUS_Line( tSTATUS *ptStatus, const char *pFormat, ... )
+{
+	va_list args;
+
+	if( ptStatus->lines >= STATUS_MAX_LINES )
+	{
+		return;
+	}
+
+	va_start( args, pFormat );
+	vsnprintf( ptStatus->aacLine[ptStatus->lines++], STATUS_LINE_SIZE, pFormat, args );
+	va_end( args );
+}
+
+//-----------------------------------------------------------------------------
+// Puts this pass's lines up, and starts the next pass
+void STATUS_Show( tSTATUS *ptStatus )
+{
+	U32 u32Now = HAL_Millis();
+
+	if( ptStatus->bTerminal )
+	{
+		ShowTerminal( ptStatus, u32Now );
+	}
+	else
+	{
+		ShowLog( ptStatus, u32Now );
+	}
+
+	ptStatus->lines = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Draws what changed, each line from its first changed character
+void ShowTerminal( tSTATUS *ptStatus, U32 u32Now )
+{
+	const char *pLine;
+	const char *pShown;
+	int count = max( ptStatus->lines, ptStatus->shownLines );
+	int col;
+	int i;
+
+	if( ptStatus->shownLines == 0 || u32Now - ptStatus->u32LastMs >= STATUS_REPAINT_MS )
+	{
+		Put( ptStatus, STATUS_CLEAR );
+		memset( ptStatus->aacShown, 0, sizeof(ptStatus->aacShown) );
+		ptStatus->u32LastMs = u32Now;
+	}
+
+	for( i = 0; i < count; i++ )
+	{
+		pLine = (i < ptStatus->lines) ? ptStatus->aacLine[i] : "";
+		pShown = ptStatus->aacShown[i];
+
+		col = 0;
+		while( pLine[col] && pLine[col] == pShown[col] )
+		{
+			col++;
+		}
+
+		if( pLine[col] == pShown[col] )
+		{
+			continue;
+		}
+
+		// Rows and columns count from 1
+		Put( ptStatus, "\033[%i;%iH%s", i + 1, col + 1, pLine + col );
+
+		if( strlen( pShown ) > strlen( pLine ) )
+		{
+			Put( ptStatus, "\033[K" );
+		}
+
+		strcpy( ptStatus->aacShown[i], pLine );
+	}
+
+	// Under the status, where anything else printed goes, wiped each pass
+	Put( ptStatus, "\033[%i;1H\033[J", ptStatus->lines + 1 );
+
+	ptStatus->shownLines = ptStatus->lines;
+
+	Write( ptStatus );
+}
+
+//-----------------------------------------------------------------------------
+// Logs the lines that changed, blank ones left out
+void ShowLog( tSTATUS *ptStatus, U32 u32Now )
+{
+	int i;
+
+	if( ptStatus->shownLines && u32Now - ptStatus->u32LastMs < STATUS_LOG_MS )
+	{
+		return;
+	}
+
+	for( i = 0; i < ptStatus->lines; i++ )
+	{
+		if( ptStatus->aacLine[i][0] && (i >= ptStatus->shownLines || strcmp( ptStatus->aacLine[i], ptStatus->aacShown[i] )) )
+		{
+			Put( ptStatus, "%10.1f s  %s\n", u32Now / 1000.0, ptStatus->aacLine[i] );
+		}
+
+		strcpy( ptStatus->aacShown[i], ptStatus->aacLine[i] );
+	}
+
+	ptStatus->shownLines = ptStatus->lines;
+	ptStatus->u32LastMs = u32Now;
+
+	Write( ptStatus );
+}
+
+//-----------------------------------------------------------------------------
+// Adds to the output, what doesn't fit is left off
+void Put( tSTATUS *ptStatus, const char *pFormat, ... )
+{
+	int room = sizeof(ptStatus->acOut) - ptStatus->outLength;
+	int length;
+	va_list args;
+
+	va_start( args, pFormat );
+	length = vsnprintf( ptStatus->acOut + ptStatus->outLength, room, pFormat, args );
+	va_end( args );
+
+	if( length > 0 )
+	{
+		ptStatus->outLength += min( length, room - 1 );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// The output in one write(), after whatever fp has buffered
+void Write( tSTATUS *ptStatus )
+{
+	if( ptStatus->outLength == 0 )
+	{
+		return;
+	}
+
+	fflush( ptStatus->fp );
+
+	// Nowhere to say it failed, the status is where it would go. All of it
+	// goes next pass instead.
+	if( write( fileno( ptStatus->fp ), ptStatus->acOut, ptStatus->outLength ) != ptStatus->outLength )
+	{
+		ptStatus->shownLines = 0;
+	}
+
+	ptStatus->outLength = 0;
+}
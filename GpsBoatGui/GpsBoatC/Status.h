@@ -0,0 +1,48 @@
+// Status.h
+// Status screen for a main loop, drawn in-process: each pass builds its
+// lines with STATUS_Line(), then STATUS_Show() puts them up.
+//
+// On a terminal only what changed since the last pass is drawn, from the
+// first character that differs, with ANSI cursor moves, all in one write().
+// The screen is cleared and drawn whole every STATUS_REPAINT_MS in case
+// something else printed over it. Anything printed between passes shows
+// under the status until the next one, as it did after system("clear").
+//
+// Anything else (a pipe, a log file, the journal) gets a plain log: the
+// lines that changed, time stamped, at most once a STATUS_LOG_MS.
+
+#ifndef STATUS_H
+#define STATUS_H
+
+#include <stdio.h>
+#include "includes.h"
+
+//-------------------------------------------
+// Global defines
+
+#define STATUS_MAX_LINES		24
+#define STATUS_LINE_SIZE		80			// longer lines are cut short
+#define STATUS_REPAINT_MS		5000
+#define STATUS_LOG_MS			1000
+
+typedef struct tSTATUS
+{
+	FILE *fp;
+	bool bTerminal;
+	int lines;									// built this pass
+	int shownLines;								// on the screen, or logged
+	U32 u32LastMs;								// last repaint, or log
+	char aacLine[STATUS_MAX_LINES][STATUS_LINE_SIZE];
+	char aacShown[STATUS_MAX_LINES][STATUS_LINE_SIZE];
+	int outLength;
+	char acOut[STATUS_MAX_LINES * (STATUS_LINE_SIZE + 16) + 32];
+} tSTATUS;
+
+//-------------------------------------------
+// Function prototypes
+
+void	STATUS_Init( tSTATUS *ptStatus, FILE *fp );
+void	STATUS_Line( tSTATUS *ptStatus, const char *pFormat, ... );
+void	STATUS_Show( tSTATUS *ptStatus );
+
+#endif
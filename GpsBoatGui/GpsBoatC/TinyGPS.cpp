@@ -25,11 +25,9 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include <stdlib.h>
 #include <math.h>
 #include "includes.h"
+#include "Hal.h"
 #include "TinyGPS.h"
 
-#define _GPRMC_TERM   "GPRMC"
-#define _GPGGA_TERM   "GPGGA"
-
 TinyGPS::TinyGPS()
   :  _time(GPS_INVALID_TIME)
   ,  _date(GPS_INVALID_DATE)
@@ -41,6 +39,7 @@ TinyGPS::TinyGPS()
   ,  _mag_var(GPS_INVALID_MAG_VAR)
   ,  _hdop(GPS_INVALID_HDOP)
   ,  _numsats(GPS_INVALID_SATELLITES)
+  ,  _sats_in_view(GPS_INVALID_SATELLITES)
   ,  _last_time_fix(GPS_INVALID_FIX_TIME)
   ,  _last_position_fix(GPS_INVALID_FIX_TIME)
   ,  _parity(0)
@@ -104,6 +103,20 @@ bool TinyGPS::encode(char c)
   return valid_sentence;
 }
 
+// Block version of encode(char), for a whole read() buffer at a time.
+// Returns the number of sentences that passed the checksum test.
+int TinyGPS::encode(const char *buf, size_t len)
+{
+  int valid_sentences = 0;
+  const char *end = buf + len;
+
+  while (buf < end)
+    if (encode(*buf++))
+      ++valid_sentences;
+
+  return valid_sentences;
+}
+
 #ifndef _GPS_NO_STATS
 void TinyGPS::stats(unsigned long *chars, unsigned short *sentences, unsigned short *failed_cs)
 {
@@ -164,7 +177,123 @@ unsigned long TinyGPS::parse_degrees()
   return (left_of_decimal / 100) * 1000000 + (hundred1000ths_of_minute + 3) / 6;
 }
 
-#define COMBINE(sentence_type, term_number) (((unsigned)(sentence_type) << 5) | term_number)
+//
+// Sentence dispatch
+//
+// A sentence address is a two character talker (GP, GN, GL, GA, BD, ...)
+// followed by a three character sentence formatter. The talker is ignored
+// so multi-constellation receivers work, and the formatter is looked up
+// with a perfect hash: every supported formatter lands in its own slot of
+// an 8 entry table, slot 0 is left empty for _GPS_SENTENCE_OTHER. Each
+// table entry lists what each term of the sentence holds, so finishing a
+// term is one table load and one switch no matter how many sentences are
+// supported. Adding a sentence means adding its field list and a slot; the
+// static_assert below refuses to build if the hash ever stops being perfect.
+//
+
+#define _GPS_SENTENCE_SLOTS 8
+
+static constexpr unsigned sentence_hash(const char *id)
+{
+  return ((unsigned char)id[1] + 2 * (unsigned char)id[2]) & (_GPS_SENTENCE_SLOTS - 1);
+}
+
+// What a term holds
+enum
+{
+  _GPS_FIELD_NONE,
+  _GPS_FIELD_TIME,            // hhmmss.cc
+  _GPS_FIELD_STATUS,          // A = valid, V = void (RMC, GLL)
+  _GPS_FIELD_MODE,            // N = not valid (RMC, GLL, VTG - NMEA 2.3 and later)
+  _GPS_FIELD_LATITUDE,
+  _GPS_FIELD_NS,
+  _GPS_FIELD_LONGITUDE,
+  _GPS_FIELD_EW,
+  _GPS_FIELD_SPEED_KNOTS,
+  _GPS_FIELD_COURSE,
+  _GPS_FIELD_DATE,            // ddmmyy
+  _GPS_FIELD_MAG_VAR,
+  _GPS_FIELD_MAG_VAR_EW,
+  _GPS_FIELD_FIX_QUALITY,     // 0 = no fix (GGA)
+  _GPS_FIELD_FIX_TYPE,        // 1 = no fix, 2 = 2D, 3 = 3D (GSA)
+  _GPS_FIELD_SATELLITES,
+  _GPS_FIELD_SATS_IN_VIEW,
+  _GPS_FIELD_HDOP,
+  _GPS_FIELD_ALTITUDE,
+  _GPS_FIELD_DAY,             // ZDA date is split over three terms
+  _GPS_FIELD_MONTH,
+  _GPS_FIELD_YEAR
+};
+
+static constexpr unsigned char _rmc_fields[] = {
+  _GPS_FIELD_NONE, _GPS_FIELD_TIME, _GPS_FIELD_STATUS, _GPS_FIELD_LATITUDE, _GPS_FIELD_NS,
+  _GPS_FIELD_LONGITUDE, _GPS_FIELD_EW, _GPS_FIELD_SPEED_KNOTS, _GPS_FIELD_COURSE,
+  _GPS_FIELD_DATE, _GPS_FIELD_MAG_VAR, _GPS_FIELD_MAG_VAR_EW, _GPS_FIELD_MODE };
+static constexpr unsigned char _gga_fields[] = {
+  _GPS_FIELD_NONE, _GPS_FIELD_TIME, _GPS_FIELD_LATITUDE, _GPS_FIELD_NS, _GPS_FIELD_LONGITUDE,
+  _GPS_FIELD_EW, _GPS_FIELD_FIX_QUALITY, _GPS_FIELD_SATELLITES, _GPS_FIELD_HDOP,
+  _GPS_FIELD_ALTITUDE };
+static constexpr unsigned char _vtg_fields[] = {
+  _GPS_FIELD_NONE, _GPS_FIELD_COURSE, _GPS_FIELD_NONE, _GPS_FIELD_NONE, _GPS_FIELD_NONE,
+  _GPS_FIELD_SPEED_KNOTS, _GPS_FIELD_NONE, _GPS_FIELD_NONE, _GPS_FIELD_NONE, _GPS_FIELD_MODE };
+static constexpr unsigned char _gll_fields[] = {
+  _GPS_FIELD_NONE, _GPS_FIELD_LATITUDE, _GPS_FIELD_NS, _GPS_FIELD_LONGITUDE, _GPS_FIELD_EW,
+  _GPS_FIELD_TIME, _GPS_FIELD_STATUS, _GPS_FIELD_MODE };
+static constexpr unsigned char _gsa_fields[] = {
+  _GPS_FIELD_NONE, _GPS_FIELD_NONE, _GPS_FIELD_FIX_TYPE, _GPS_FIELD_NONE, _GPS_FIELD_NONE,
+  _GPS_FIELD_NONE, _GPS_FIELD_NONE, _GPS_FIELD_NONE, _GPS_FIELD_NONE, _GPS_FIELD_NONE,
+  _GPS_FIELD_NONE, _GPS_FIELD_NONE, _GPS_FIELD_NONE, _GPS_FIELD_NONE, _GPS_FIELD_NONE,
+  _GPS_FIELD_NONE, _GPS_FIELD_HDOP };
+static constexpr unsigned char _gsv_fields[] = {
+  _GPS_FIELD_NONE, _GPS_FIELD_NONE, _GPS_FIELD_NONE, _GPS_FIELD_SATS_IN_VIEW };
+static constexpr unsigned char _zda_fields[] = {
+  _GPS_FIELD_NONE, _GPS_FIELD_TIME, _GPS_FIELD_DAY, _GPS_FIELD_MONTH, _GPS_FIELD_YEAR };
+
+struct gps_sentence_def
+{
+  char id[4];                   // sentence formatter, "" for an empty slot
+  bool good_by_default;         // sentence has no validity term of its own
+  unsigned char term_count;
+  const unsigned char *fields;  // what each term holds, indexed by term number
+};
+
+#define _GPS_SENTENCE_DEF(id, good, fields) { id, good, sizeof(fields), fields }
+
+// Indexed by sentence_hash(), which is also the _GPS_SENTENCE_xxx value
+static constexpr gps_sentence_def _sentence_table[_GPS_SENTENCE_SLOTS] = {
+  { "", false, 0, 0 },                              // _GPS_SENTENCE_OTHER
+  _GPS_SENTENCE_DEF("GGA", false, _gga_fields),     // _GPS_SENTENCE_GGA
+  _GPS_SENTENCE_DEF("VTG", true,  _vtg_fields),     // _GPS_SENTENCE_VTG
+  _GPS_SENTENCE_DEF("RMC", false, _rmc_fields),     // _GPS_SENTENCE_RMC
+  _GPS_SENTENCE_DEF("GLL", false, _gll_fields),     // _GPS_SENTENCE_GLL
+  _GPS_SENTENCE_DEF("GSA", false, _gsa_fields),     // _GPS_SENTENCE_GSA
+  _GPS_SENTENCE_DEF("ZDA", true,  _zda_fields),     // _GPS_SENTENCE_ZDA
+  _GPS_SENTENCE_DEF("GSV", true,  _gsv_fields),     // _GPS_SENTENCE_GSV
+};
+
+static constexpr bool sentence_table_ok(unsigned slot)
+{
+  return slot == _GPS_SENTENCE_SLOTS ||
+    ((slot == 0 || sentence_hash(_sentence_table[slot].id) == slot) && sentence_table_ok(slot + 1));
+}
+
+static_assert(sentence_table_ok(0), "NMEA sentence table is out of order or the hash has a collision");
+
+// Maps the address term (e.g. "GNRMC") to a _GPS_SENTENCE_xxx value
+static char sentence_lookup(const char *term)
+{
+  // Five characters, and not a proprietary ($P...) sentence
+  if (!term[0] || !term[1] || !term[2] || !term[3] || !term[4] || term[5] || term[0] == 'P')
+    return 0;
+
+  const char *id = term + 2;
+  unsigned slot = sentence_hash(id);
+  const char *want = _sentence_table[slot].id;
+  if (id[0] == want[0] && id[1] == want[1] && id[2] == want[2])
+    return slot;
+
+  return 0;
+}
 
 // Processes a just-completed term
 // Returns true if new sentence has just passed checksum test and is validated
@@ -180,12 +309,11 @@ bool TinyGPS::term_complete()
 #ifndef _GPS_NO_STATS
         ++_good_sentences;
 #endif
-        _last_time_fix = _new_time_fix;
-        _last_position_fix = _new_position_fix;
-
         switch(_sentence_type)
         {
-        case _GPS_SENTENCE_GPRMC:
+        case _GPS_SENTENCE_RMC:
+          _last_time_fix = _new_time_fix;
+          _last_position_fix = _new_position_fix;
           _time      = _new_time;
           _date      = _new_date;
           _latitude  = _new_latitude;
@@ -194,7 +322,9 @@ bool TinyGPS::term_complete()
           _course    = _new_course;
           _mag_var   = _new_mag_var;
           break;
-        case _GPS_SENTENCE_GPGGA:
+        case _GPS_SENTENCE_GGA:
+          _last_time_fix = _new_time_fix;
+          _last_position_fix = _new_position_fix;
           _altitude  = _new_altitude;
           _time      = _new_time;
           _latitude  = _new_latitude;
@@ -202,6 +332,28 @@ bool TinyGPS::term_complete()
           _numsats   = _new_numsats;
           _hdop      = _new_hdop;
           break;
+        case _GPS_SENTENCE_GLL:
+          _last_time_fix = _new_time_fix;
+          _last_position_fix = _new_position_fix;
+          _time      = _new_time;
+          _latitude  = _new_latitude;
+          _longitude = _new_longitude;
+          break;
+        case _GPS_SENTENCE_VTG:
+          _speed     = _new_speed;
+          _course    = _new_course;
+          break;
+        case _GPS_SENTENCE_GSA:
+          _hdop      = _new_hdop;
+          break;
+        case _GPS_SENTENCE_GSV:
+          _sats_in_view = _new_sats_in_view;
+          break;
+        case _GPS_SENTENCE_ZDA:
+          _last_time_fix = _new_time_fix;
+          _time      = _new_time;
+          _date      = _new_date;
+          break;
         }
 
         return true;
@@ -218,73 +370,86 @@ bool TinyGPS::term_complete()
   // the first term determines the sentence type
   if (_term_number == 0)
   {
-    if (!gpsstrcmp(_term, _GPRMC_TERM))
-      _sentence_type = _GPS_SENTENCE_GPRMC;
-    else if (!gpsstrcmp(_term, _GPGGA_TERM))
-      _sentence_type = _GPS_SENTENCE_GPGGA;
-    else
-      _sentence_type = _GPS_SENTENCE_OTHER;
+    _sentence_type = sentence_lookup(_term);
+    _gps_data_good = _sentence_table[(unsigned char)_sentence_type].good_by_default;
     return false;
   }
 
-  if (_sentence_type != _GPS_SENTENCE_OTHER && _term[0])
-    switch(COMBINE(_sentence_type, _term_number))
+  const gps_sentence_def &def = _sentence_table[(unsigned char)_sentence_type];
+  if (_term_number >= def.term_count || !_term[0])
+    return false;
+
+  switch(def.fields[(unsigned char)_term_number])
   {
-    case COMBINE(_GPS_SENTENCE_GPRMC, 1): // Time in both sentences
-    case COMBINE(_GPS_SENTENCE_GPGGA, 1):
+    case _GPS_FIELD_TIME:
       _new_time = parse_decimal();
-      _new_time_fix = millis();
+      _new_time_fix = HAL_Millis();
       break;
-    case COMBINE(_GPS_SENTENCE_GPRMC, 2): // GPRMC validity
+    case _GPS_FIELD_STATUS:
       _gps_data_good = _term[0] == 'A';
       break;
-    case COMBINE(_GPS_SENTENCE_GPRMC, 3): // Latitude
-    case COMBINE(_GPS_SENTENCE_GPGGA, 2):
+    case _GPS_FIELD_MODE:
+      if (_term[0] == 'N')
+        _gps_data_good = false;
+      break;
+    case _GPS_FIELD_LATITUDE:
       _new_latitude = parse_degrees();
-      _new_position_fix = millis();
+      _new_position_fix = HAL_Millis();
       break;
-    case COMBINE(_GPS_SENTENCE_GPRMC, 4): // N/S
-    case COMBINE(_GPS_SENTENCE_GPGGA, 3):
+    case _GPS_FIELD_NS:
       if (_term[0] == 'S')
         _new_latitude = -_new_latitude;
       break;
-    case COMBINE(_GPS_SENTENCE_GPRMC, 5): // Longitude
-    case COMBINE(_GPS_SENTENCE_GPGGA, 4):
+    case _GPS_FIELD_LONGITUDE:
       _new_longitude = parse_degrees();
       break;
-    case COMBINE(_GPS_SENTENCE_GPRMC, 6): // E/W
-    case COMBINE(_GPS_SENTENCE_GPGGA, 5):
+    case _GPS_FIELD_EW:
       if (_term[0] == 'W')
         _new_longitude = -_new_longitude;
       break;
-    case COMBINE(_GPS_SENTENCE_GPRMC, 7): // Speed (GPRMC)
+    case _GPS_FIELD_SPEED_KNOTS:
       _new_speed = parse_decimal();
       break;
-    case COMBINE(_GPS_SENTENCE_GPRMC, 8): // Course (GPRMC)
+    case _GPS_FIELD_COURSE:
       _new_course = parse_decimal();
       break;
-    case COMBINE(_GPS_SENTENCE_GPRMC, 9): // Date (GPRMC)
+    case _GPS_FIELD_DATE:
       _new_date = gpsatol(_term);
       break;
-    case COMBINE(_GPS_SENTENCE_GPRMC, 10): // Magnetic Var (GPRMC)
+    case _GPS_FIELD_MAG_VAR:
       _new_mag_var = parse_decimal();
       break;
-    case COMBINE(_GPS_SENTENCE_GPRMC, 11): // Magnetic Var E/W (GPRMC)
+    case _GPS_FIELD_MAG_VAR_EW:
       if (_term[0] == 'W')
         _new_mag_var = -_new_mag_var;
       break;
-    case COMBINE(_GPS_SENTENCE_GPGGA, 6): // Fix data (GPGGA)
+    case _GPS_FIELD_FIX_QUALITY:
       _gps_data_good = _term[0] > '0';
       break;
-    case COMBINE(_GPS_SENTENCE_GPGGA, 7): // Satellites used (GPGGA)
+    case _GPS_FIELD_FIX_TYPE:
+      _gps_data_good = _term[0] > '1';
+      break;
+    case _GPS_FIELD_SATELLITES:
       _new_numsats = (unsigned char)atoi(_term);
       break;
-    case COMBINE(_GPS_SENTENCE_GPGGA, 8): // HDOP
+    case _GPS_FIELD_SATS_IN_VIEW:
+      _new_sats_in_view = (unsigned char)atoi(_term);
+      break;
+    case _GPS_FIELD_HDOP:
       _new_hdop = parse_decimal();
       break;
-    case COMBINE(_GPS_SENTENCE_GPGGA, 9): // Altitude (GPGGA)
+    case _GPS_FIELD_ALTITUDE:
       _new_altitude = parse_decimal();
       break;
+    case _GPS_FIELD_DAY:
+      _new_date = gpsatol(_term) * 10000;
+      break;
+    case _GPS_FIELD_MONTH:
+      _new_date += gpsatol(_term) * 100;
+      break;
+    case _GPS_FIELD_YEAR:
+      _new_date += gpsatol(_term) % 100;
+      break;
   }
 
   return false;
@@ -298,13 +463,6 @@ long TinyGPS::gpsatol(const char *str)
   return ret;
 }
 
-int TinyGPS::gpsstrcmp(const char *str1, const char *str2)
-{
-  while (*str1 && *str1 == *str2)
-    ++str1, ++str2;
-  return *str1;
-}
-
 /* static */
 float TinyGPS::distance_between (float lat1, float long1, float lat2, float long2) 
 {
@@ -366,7 +524,7 @@ void TinyGPS::get_position(long *latitude, long *longitude, unsigned long *fix_a
   if (latitude) *latitude = _latitude;
   if (longitude) *longitude = _longitude;
   if (fix_age) *fix_age = _last_position_fix == GPS_INVALID_FIX_TIME ? 
-   GPS_INVALID_AGE : millis() - _last_position_fix;
+   GPS_INVALID_AGE : HAL_Millis() - _last_position_fix;
 }
 
 // date as ddmmyy, time as hhmmsscc, and age in milliseconds
@@ -375,7 +533,7 @@ void TinyGPS::get_datetime(unsigned long *date, unsigned long *time, unsigned lo
   if (date) *date = _date;
   if (time) *time = _time;
   if (age) *age = _last_time_fix == GPS_INVALID_FIX_TIME ? 
-   GPS_INVALID_AGE : millis() - _last_time_fix;
+   GPS_INVALID_AGE : HAL_Millis() - _last_time_fix;
 }
 
 void TinyGPS::f_get_position(float *latitude, float *longitude, unsigned long *fix_age)
@@ -24,7 +24,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef TinyGPS_h
 #define TinyGPS_h
 
-#include <wiringPi.h>
+#include <stddef.h>
 
 #define _GPS_VERSION 13 // software version of this library
 #define _GPS_MPH_PER_KNOT 1.15077945
@@ -49,12 +49,17 @@ public:
 
   TinyGPS();
   bool encode(char c); // process one character received from GPS
+  int encode(const char *buf, size_t len); // process a block of characters, returns number of valid sentences
   TinyGPS &operator << (char c) {encode(c); return *this;}
 
   // lat/long in MILLIONTHs of a degree and age of fix in milliseconds
   // (note: versions 12 and earlier gave lat/long in 100,000ths of a degree.
   void get_position(long *latitude, long *longitude, unsigned long *fix_age = 0);
 
+  // HAL_Millis() when the last position was taken, GPS_INVALID_FIX_TIME before
+  // the first. Only sentences that carry a position change it.
+  inline unsigned long position_fix_time() { return _last_position_fix; }
+
   // date as ddmmyy, time as hhmmsscc, and age in milliseconds
   void get_datetime(unsigned long *date, unsigned long *time, unsigned long *age = 0);
 
@@ -70,6 +75,9 @@ public:
   // satellites used in last full GPGGA sentence
   inline unsigned short satellites() { return _numsats; }
 
+  // satellites in view from the last GPGSV sentence
+  inline unsigned short satellites_in_view() { return _sats_in_view; }
+
   // horizontal dilution of precision in 100ths
   inline unsigned long hdop() { return _hdop; }
   
@@ -98,7 +106,9 @@ public:
 #endif
 
 private:
-  enum {_GPS_SENTENCE_GPGGA, _GPS_SENTENCE_GPRMC, _GPS_SENTENCE_OTHER};
+  // Values are the sentence's slot in the dispatch table (see TinyGPS.cpp)
+  enum {_GPS_SENTENCE_OTHER, _GPS_SENTENCE_GGA, _GPS_SENTENCE_VTG, _GPS_SENTENCE_RMC,
+        _GPS_SENTENCE_GLL, _GPS_SENTENCE_GSA, _GPS_SENTENCE_ZDA, _GPS_SENTENCE_GSV};
 
   // properties
   unsigned long _time, _new_time;
@@ -111,6 +121,7 @@ private:
   unsigned long  _course, _new_course;
   unsigned long  _hdop, _new_hdop;
   unsigned short _numsats, _new_numsats;
+  unsigned short _sats_in_view, _new_sats_in_view;
 
   unsigned long _last_time_fix, _new_time_fix;
   unsigned long _last_position_fix, _new_position_fix;
@@ -139,7 +150,6 @@ private:
   bool term_complete();
   bool gpsisdigit(char c) { return c >= '0' && c <= '9'; }
   long gpsatol(const char *str);
-  int gpsstrcmp(const char *str1, const char *str2);
 };
 
 #endif
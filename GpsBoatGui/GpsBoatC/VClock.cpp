@@ -0,0 +1,440 @@
+// VClock.cpp
+// Virtual clock for replays. See VClock.h.
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include "VClock.h"
+
+//-------------------------------------------
+// Local types
+
+typedef enum
+{
+	E_VTHREAD_FREE,
+	E_VTHREAD_RUNNING,
+	E_VTHREAD_DELAY,			// until u64WakeUs
+	E_VTHREAD_WAIT_FD,			// until fd is readable, or u64WakeUs if bTimeout
+} E_VTHREAD_STATE;
+
+typedef struct tVTHREAD
+{
+	E_VTHREAD_STATE eState;
+	U32 u32Order;				// start order, breaks ties
+	uint64_t u64WakeUs;
+	int fd;
+	bool bTimeout;
+	bool bReadable;				// woken by fd, not the time
+} tVTHREAD;
+
+typedef struct tVCLOCK
+{
+	pthread_mutex_t tLock;
+	pthread_cond_t tTurn;		// ptRunning changed
+	uint64_t u64NowUs;
+	tVTHREAD *ptRunning;		// NULL: stalled, everyone waits on a descriptor
+	U32 u32NextOrder;
+	U32 u32Switches;
+	double dPace;				// times real time, 0 == as fast as it goes
+	uint64_t u64PaceUs;			// virtual time when the pace was set
+	struct timespec tPaceWall;	// and CLOCK_MONOTONIC
+	tVTHREAD atThread[VCLOCK_MAX_THREADS];
+} tVCLOCK;
+
+//-------------------------------------------
+// Local prototypes
+
+static U32			Millis( void );
+static U32			Micros( void );
+static void			Delay( U32 ms );
+static int			WaitFd( int fd, int timeout_ms );
+static void			*ThreadAdd( void );
+static void			ThreadBegin( void *pThread );
+static void			ThreadEnd( void *pThread );
+static tVTHREAD		*NewThread( E_VTHREAD_STATE eState );
+static void			Schedule( void );
+static void			WaitTurn( tVTHREAD *ptSelf );
+static void			Pace( uint64_t u64NowUs );
+static void			Unlock( void *pArg );
+
+//-------------------------------------------
+// Local data
+
+static tVCLOCK gtClock = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER };
+
+// The thread's own entry, NULL for threads the clock doesn't run
+static __thread tVTHREAD *gptSelf = NULL;
+
+static const tHAL_CLOCK gtVClock = { Millis, Micros, Delay, NULL, WaitFd, ThreadAdd, ThreadBegin, ThreadEnd };
+
+//-----------------------------------------------------------------------------
+// Takes over the HAL clock at u32StartMs, with the calling thread running.
+// Returns false if it's already started.
+bool VCLOCK_Start( U32 u32StartMs )
+{
+	pthread_mutex_lock( &gtClock.tLock );
+
+	if( gptSelf || gtClock.ptRunning )
+	{
+		pthread_mutex_unlock( &gtClock.tLock );
+		fprintf( stderr, "VClock already started\n" );
+		return false;
+	}
+
+	memset( gtClock.atThread, 0, sizeof(gtClock.atThread) );
+	gtClock.u64NowUs = (uint64_t)u32StartMs * 1000;
+	gtClock.u32NextOrder = 0;
+	gtClock.u32Switches = 0;
+	gtClock.dPace = 0.0;
+	gtClock.ptRunning = gptSelf = NewThread( E_VTHREAD_RUNNING );
+
+	pthread_mutex_unlock( &gtClock.tLock );
+
+	HAL_SetClock( &gtVClock );
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Gives the backend its clock back. From the thread that started it, once
+// the others have been stopped.
+void VCLOCK_Stop( void )
+{
+	HAL_SetClock( NULL );
+
+	pthread_mutex_lock( &gtClock.tLock );
+
+	if( gptSelf )
+	{
+		gptSelf->eState = E_VTHREAD_FREE;
+		gptSelf = NULL;
+	}
+
+	gtClock.ptRunning = NULL;
+
+	pthread_mutex_unlock( &gtClock.tLock );
+}
+
+//-----------------------------------------------------------------------------
+// From now on virtual time runs dFactor times real time at most, 0 == as
+// fast as the threads go
+void VCLOCK_SetPace( double dFactor )
+{
+	pthread_mutex_lock( &gtClock.tLock );
+
+	gtClock.dPace = dFactor;
+	gtClock.u64PaceUs = gtClock.u64NowUs;
+	clock_gettime( CLOCK_MONOTONIC, &gtClock.tPaceWall );
+
+	pthread_mutex_unlock( &gtClock.tLock );
+}
+
+//-----------------------------------------------------------------------------
+// Times one thread has handed over to another
+U32 VCLOCK_Switches( void )
+{
+	U32 u32Switches;
+
+	pthread_mutex_lock( &gtClock.tLock );
+	u32Switches = gtClock.u32Switches;
+	pthread_mutex_unlock( &gtClock.tLock );
+
+	return u32Switches;
+}
+
+//-----------------------------------------------------------------------------
+U32 Millis( void )
+{
+	U32 u32Now;
+
+	pthread_mutex_lock( &gtClock.tLock );
+	u32Now = (U32)(gtClock.u64NowUs / 1000);
+	pthread_mutex_unlock( &gtClock.tLock );
+
+	return u32Now;
+}
+
+//-----------------------------------------------------------------------------
+U32 Micros( void )
+{
+	U32 u32Now;
+
+	pthread_mutex_lock( &gtClock.tLock );
+	u32Now = (U32)gtClock.u64NowUs;
+	pthread_mutex_unlock( &gtClock.tLock );
+
+	return u32Now;
+}
+
+//-----------------------------------------------------------------------------
+void Delay( U32 ms )
+{
+	tVTHREAD *ptSelf = gptSelf;
+	uint64_t u64NowUs;
+
+	if( !ptSelf )
+	{
+		gtHalBackendClock.pfnDelay( ms );
+		return;
+	}
+
+	pthread_mutex_lock( &gtClock.tLock );
+
+	ptSelf->eState = E_VTHREAD_DELAY;
+	ptSelf->u64WakeUs = gtClock.u64NowUs + (uint64_t)ms * 1000;
+
+	Schedule();
+	WaitTurn( ptSelf );
+
+	u64NowUs = gtClock.u64NowUs;
+
+	pthread_mutex_unlock( &gtClock.tLock );
+
+	Pace( u64NowUs );
+}
+
+//-----------------------------------------------------------------------------
+int WaitFd( int fd, int timeout_ms )
+{
+	tVTHREAD *ptSelf = gptSelf;
+	struct pollfd tPoll;
+	bool bReadable;
+	uint64_t u64NowUs;
+
+	if( !ptSelf )
+	{
+		tPoll.fd = fd;
+		tPoll.events = POLLIN;
+		return poll( &tPoll, 1, timeout_ms );
+	}
+
+	pthread_mutex_lock( &gtClock.tLock );
+
+	ptSelf->eState = E_VTHREAD_WAIT_FD;
+	ptSelf->fd = fd;
+	ptSelf->bTimeout = (timeout_ms >= 0);
+	ptSelf->u64WakeUs = gtClock.u64NowUs + (uint64_t)max( timeout_ms, 0 ) * 1000;
+
+	Schedule();
+	WaitTurn( ptSelf );
+
+	bReadable = ptSelf->bReadable;
+	u64NowUs = gtClock.u64NowUs;
+
+	pthread_mutex_unlock( &gtClock.tLock );
+
+	Pace( u64NowUs );
+
+	return bReadable ? 1 : 0;
+}
+
+//-----------------------------------------------------------------------------
+// A new thread is ready at once, it runs when the creator next waits
+void *ThreadAdd( void )
+{
+	tVTHREAD *ptThread;
+
+	pthread_mutex_lock( &gtClock.tLock );
+
+	if( (ptThread = NewThread( E_VTHREAD_DELAY )) )
+	{
+		ptThread->u64WakeUs = gtClock.u64NowUs;
+	}
+
+	pthread_mutex_unlock( &gtClock.tLock );
+
+	return ptThread;
+}
+
+//-----------------------------------------------------------------------------
+void ThreadBegin( void *pThread )
+{
+	gptSelf = (tVTHREAD *)pThread;
+
+	pthread_mutex_lock( &gtClock.tLock );
+	WaitTurn( gptSelf );
+	pthread_mutex_unlock( &gtClock.tLock );
+}
+
+//-----------------------------------------------------------------------------
+// The thread returned or was cancelled (waiting, as the canceller is the one
+// running), or never started
+void ThreadEnd( void *pThread )
+{
+	tVTHREAD *ptThread = (tVTHREAD *)pThread;
+
+	pthread_mutex_lock( &gtClock.tLock );
+
+	ptThread->eState = E_VTHREAD_FREE;
+
+	if( gtClock.ptRunning == ptThread )
+	{
+		Schedule();
+	}
+
+	pthread_mutex_unlock( &gtClock.tLock );
+
+	if( gptSelf == ptThread )
+	{
+		gptSelf = NULL;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// A free entry, NULL if there's none. Lock held.
+tVTHREAD *NewThread( E_VTHREAD_STATE eState )
+{
+	int i;
+
+	for( i = 0; i < VCLOCK_MAX_THREADS; i++ )
+	{
+		if( gtClock.atThread[i].eState == E_VTHREAD_FREE )
+		{
+			memset( &gtClock.atThread[i], 0, sizeof(tVTHREAD) );
+			gtClock.atThread[i].eState = eState;
+			gtClock.atThread[i].u32Order = gtClock.u32NextOrder++;
+			gtClock.atThread[i].fd = -1;
+			return &gtClock.atThread[i];
+		}
+	}
+
+	fprintf( stderr, "VClock: more than %i threads\n", VCLOCK_MAX_THREADS );
+	return NULL;
+}
+
+//-----------------------------------------------------------------------------
+// The running thread has just started waiting (or ended): picks the next.
+// Lock held.
+void Schedule( void )
+{
+	tVTHREAD *ptNext = NULL;
+	tVTHREAD *ptThread;
+	struct pollfd tPoll;
+	int i;
+
+	// Data waiting wakes its reader without time moving
+	for( i = 0; i < VCLOCK_MAX_THREADS; i++ )
+	{
+		ptThread = &gtClock.atThread[i];
+
+		if( ptThread->eState != E_VTHREAD_WAIT_FD || (ptNext && ptNext->u32Order < ptThread->u32Order) )
+		{
+			continue;
+		}
+
+		tPoll.fd = ptThread->fd;
+		tPoll.events = POLLIN;
+
+		if( poll( &tPoll, 1, 0 ) > 0 )
+		{
+			ptNext = ptThread;
+		}
+	}
+
+	if( ptNext )
+	{
+		ptNext->bReadable = true;
+	}
+	else
+	{
+		// Otherwise the earliest wake up
+		for( i = 0; i < VCLOCK_MAX_THREADS; i++ )
+		{
+			ptThread = &gtClock.atThread[i];
+
+			if( !(ptThread->eState == E_VTHREAD_DELAY || (ptThread->eState == E_VTHREAD_WAIT_FD && ptThread->bTimeout)) )
+			{
+				continue;
+			}
+
+			if( !ptNext || ptThread->u64WakeUs < ptNext->u64WakeUs
+				|| (ptThread->u64WakeUs == ptNext->u64WakeUs && ptThread->u32Order < ptNext->u32Order) )
+			{
+				ptNext = ptThread;
+			}
+		}
+
+		if( ptNext )
+		{
+			ptNext->bReadable = false;
+			gtClock.u64NowUs = max( gtClock.u64NowUs, ptNext->u64WakeUs );
+		}
+		else
+		{
+			fprintf( stderr, "VClock: every thread is waiting on a descriptor nothing will fill\n" );
+		}
+	}
+
+	if( ptNext )
+	{
+		ptNext->eState = E_VTHREAD_RUNNING;
+	}
+
+	if( ptNext != gtClock.ptRunning )
+	{
+		gtClock.u32Switches++;
+	}
+
+	gtClock.ptRunning = ptNext;
+	pthread_cond_broadcast( &gtClock.tTurn );
+}
+
+//-----------------------------------------------------------------------------
+// Lock held, and held again on return. A cancellation point: the lock is
+// let go on the way out.
+void WaitTurn( tVTHREAD *ptSelf )
+{
+	pthread_cleanup_push( Unlock, NULL );
+
+	while( gtClock.ptRunning != ptSelf )
+	{
+		pthread_cond_wait( &gtClock.tTurn, &gtClock.tLock );
+	}
+
+	pthread_cleanup_pop( 0 );
+}
+
+//-----------------------------------------------------------------------------
+// A thread just woken at u64NowUs waits for the wall clock, if paced. The
+// others are all waiting, so time stands still meanwhile.
+void Pace( uint64_t u64NowUs )
+{
+	struct timespec tWake;
+	uint64_t u64PaceUs;
+	double dPace;
+	double dWall;
+
+	pthread_mutex_lock( &gtClock.tLock );
+	dPace = gtClock.dPace;
+	u64PaceUs = gtClock.u64PaceUs;
+	tWake = gtClock.tPaceWall;
+	pthread_mutex_unlock( &gtClock.tLock );
+
+	if( dPace <= 0.0 || u64NowUs < u64PaceUs )
+	{
+		return;
+	}
+
+	dWall = (u64NowUs - u64PaceUs) / 1e6 / dPace;
+	tWake.tv_sec += (time_t)dWall;
+	tWake.tv_nsec += (long)((dWall - (time_t)dWall) * 1e9);
+	if( tWake.tv_nsec >= 1000000000L )
+	{
+		tWake.tv_sec++;
+		tWake.tv_nsec -= 1000000000L;
+	}
+
+	while( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &tWake, NULL ) == EINTR )
+	{
+	}
+}
+
+//-----------------------------------------------------------------------------
+void Unlock( void *pArg )
+{
+	pthread_mutex_unlock( &gtClock.tLock );
+}
@@ -0,0 +1,39 @@
+// VClock.h
+// Virtual clock for replays. VCLOCK_Start() makes it the HAL clock (Hal.h):
+// HAL_Millis() is virtual time, and the calling thread plus every thread
+// started with HAL_ThreadCreate() from then on are run one at a time.
+//
+// A thread runs until it waits, in HAL_Delay() or HAL_WaitFd(). Then the
+// next one runs: the first waiting on a descriptor that is now readable, or
+// if there is none, time jumps straight to the earliest wake up. Time only
+// moves when every thread is waiting, so an hour's log replays as fast as
+// the code can take it, and the same input always runs the threads in the
+// same order. Ties go to the thread started first.
+//
+// A descriptor has to be filled by a thread the clock runs (a pipe or
+// socket written by a player thread), or its data can't be seen coming.
+// Threads the clock doesn't run see virtual time but really sleep.
+//
+// VCLOCK_SetPace() holds time back to a multiple of real time instead, a
+// thread woken sleeps until the wall clock has caught up with it.
+
+#ifndef VCLOCK_H
+#define VCLOCK_H
+
+#include "includes.h"
+#include "Hal.h"
+
+//-------------------------------------------
+// Global defines
+
+#define VCLOCK_MAX_THREADS		16
+
+//-------------------------------------------
+// Function prototypes
+
+bool	VCLOCK_Start( U32 u32StartMs );
+void	VCLOCK_Stop( void );
+void	VCLOCK_SetPace( double dFactor );
+U32		VCLOCK_Switches( void );
+
+#endif
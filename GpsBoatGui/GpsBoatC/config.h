@@ -25,6 +25,7 @@
 // Number of waypoints to navigate to.
 // Minimum is 2 and max is 10
 // Include USE_HOME_POSITION above. Example, starting location plus 4 other waypoints (A, B, C, D) would mean NUM_WAY_POINTS = 5
+// Longer routes: pass a mission file to gpsboat instead (see mission.cpp)
 #define NUM_WAY_POINTS        2
 
 // Way points to navigate to
@@ -64,8 +65,39 @@
 // Set this to the maximum distance to a waypoint before we switch to the next waypoint
 #define SWITCH_WAYPOINT_DISTANCE        2.0
 
+// Follow the leg from the last waypoint to the next (1), rather than steering
+// straight for the next (0). The boat steers for a point NAV_LOOKAHEAD_M
+// ahead on the leg, and NAV_CROSS_TRACK_KI (per second) of the time it's
+// been held off it moves that point over to make up for current and wind.
+#define NAV_PATH_FOLLOWING              1
+#define NAV_LOOKAHEAD_M                 16.0
+#define NAV_CROSS_TRACK_KI              0.05
+
+// Between fixes, carry the last one forward on the compass heading at the GPS
+// speed (1), so range and arrival are worked out where the boat is now and
+// not where it was when the fix was taken (0). See DeadReckon.h. It's carried
+// NAV_PREDICT_MAX_MS at most, a GPS that's gone quiet doesn't send the boat off.
+#define NAV_DEAD_RECKONING              1
+#define NAV_PREDICT_MAX_MS              2500
+
+// Largest position error (meters) allowed from range and bearing math. The
+// geodesy engine uses the cheapest formula that stays inside it for each leg.
+#define GEO_ERROR_BOUND_M               0.01
+
+// Hazards from the mission file closer than this (meters) to the track from
+// the boat to the waypoint are reported
+#define HAZARD_CLEARANCE_M              25.0
+
+// Distance (meters) to a geofence edge shown on the status screen, nearer
+// edges are found by each check (see Geofence.h)
+#define FENCE_MARGIN_M                  20.0
+
 #define PRINT_MSGS            0
 
+// Flight recording (see Recorder.h) gpsboat makes unless given -r file,
+// "" == none
+#define RECORDER_FILE         "gpsboat.rec"
+
 // COMPASS --------------------------
 #define USE_COMPASS_CALIBRATION			0
 #define USE_COMPASS_TILT_COMPENSATION	1
@@ -84,8 +116,14 @@
 #define GPS_BAUD		 		4800
 #endif
 
+// ms from the fix being taken to the GPS sending the first character of it.
+// The time the rest takes to come over the serial port is measured.
+#define GPS_FIX_LATENCY_MS		100
+
 // Arduino ---------------------------
-#define USE_ARDUINO				0
+#ifndef USE_ARDUINO
+#define USE_ARDUINO				0		// make simboat sets it, the simulator has one
+#endif
 #define ARDUINO_I2C_ADDR		(0x04)
 
 // GPS Data input Pins will always be the Arduino's own Rx/Tx pins. Disconnect before programming!
@@ -94,6 +132,13 @@
 // How many seconds to wait after GPS locks before starting navigation
 #define GPS_STABALIZE_LOCK_TIME    1    // seconds
 
+// How long a turn towards the next waypoint is held before checking the heading again
+#define START_TURN_MS              100  // milliseconds
+
+// Nav loop rate (see Sched.h), and its SCHED_FIFO priority, 0 == normal scheduling
+#define CONTROL_RATE_HZ            20
+#define CONTROL_PRIORITY           0
+
 // *******************************************************************
 // ESC "servo"
 
@@ -123,4 +168,14 @@
 // If rudder is going wrong way, set this to true
 #define RUDDER_REVERSE      false
 
+// Helm (see Helm.h), in fractions of full rudder. HELM_BANG_BANG steers full
+// left/right/center as before instead.
+#define HELM_BANG_BANG      0
+#define HELM_KP             0.02    // per degree off the bearing
+#define HELM_KI             0.002   // per degree second
+#define HELM_KD             0.01    // per degree/s of turn
+#define HELM_INTEGRAL_MAX   0.3
+#define HELM_SLEW           4.0     // per second
+#define HELM_RATE_TAU       0.3     // seconds, compass turn rate filter
+
 #endif
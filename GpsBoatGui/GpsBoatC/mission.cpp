@@ -0,0 +1,337 @@
+// mission.cpp
+// Converts a CSV or GPX route to the binary mission file gpsboat maps at
+// startup (see Route.h). Runs on the Pi or a PC:
+//
+//   mission [-l] route.csv|route.gpx mission.route
+//   gpsboat mission.route
+//
+// CSV: one "lat,lon" per line in decimal degrees. Lines that don't start
+//      with a number (headers, # comments) are skipped. A third column of
+//      "hazard" makes the point a hazard to keep clear of rather than a
+//      waypoint, other extra columns are ignored.
+// GPX: the <rtept> points, or if there are none the <wpt> points, or the
+//      <trkpt> points.
+// The first point is home. With -l home is taken at GPS lock instead and
+// every point is a waypoint.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+#include "includes.h"
+#include "Route.h"
+
+//-------------------------------------------
+// Local data
+
+typedef struct
+{
+	tROUTE_WAY_POINT *ptPoints;
+	U32 u32Count;
+	U32 u32Size;
+} tPOINT_LIST;
+
+static tPOINT_LIST gtWayPoints;
+static tPOINT_LIST gtHazards;
+
+//-------------------------------------------
+// Local prototypes
+
+static char	*ReadFile( const char *pFileName );
+static bool	AddPoint( tPOINT_LIST *ptList, double lat, double lon );
+static bool	ParseCsv( char *pText );
+static void	ParseGpx( const char *pText, const char *pTag );
+static bool	WriteList( FILE *fp, const tPOINT_LIST *ptList );
+static bool	GetAttribute( const char *pTag, const char *pEnd, const char *pName, double *pdValue );
+
+//------------------------------------------------------------------------------
+int main( int argc, char **argv )
+{
+	tROUTE_FILE_HEADER tHeader;
+	const char *pIn;
+	const char *pOut;
+	const char *pExt;
+	bool bHomeAtLock = false;
+	char *pText;
+	FILE *fp;
+
+	if( argc > 1 && 0 == strcmp( argv[1], "-l" ) )
+	{
+		bHomeAtLock = true;
+		argc--;
+		argv++;
+	}
+
+	if( argc != 3 )
+	{
+		fprintf( stderr, "usage: mission [-l] route.csv|route.gpx mission.route\n" );
+		fprintf( stderr, "  -l  home is taken at GPS lock, all points are waypoints\n" );
+		return 1;
+	}
+
+	pIn = argv[1];
+	pOut = argv[2];
+
+	pText = ReadFile( pIn );
+	if( !pText )
+	{
+		return 1;
+	}
+
+	// Placeholder home, set at lock
+	if( bHomeAtLock )
+	{
+		AddPoint( &gtWayPoints, 0.0, 0.0 );
+	}
+
+	pExt = strrchr( pIn, '.' );
+	if( pExt && 0 == strcasecmp( pExt, ".gpx" ) )
+	{
+		ParseGpx( pText, "<rtept" );
+		if( gtWayPoints.u32Count <= (U32)bHomeAtLock )
+		{
+			ParseGpx( pText, "<wpt" );
+		}
+		if( gtWayPoints.u32Count <= (U32)bHomeAtLock )
+		{
+			ParseGpx( pText, "<trkpt" );
+		}
+	}
+	else if( !ParseCsv( pText ) )
+	{
+		return 1;
+	}
+
+	free( pText );
+
+	if( gtWayPoints.u32Count < 2 )
+	{
+		fprintf( stderr, "%s: need home and at least one waypoint\n", pIn );
+		return 1;
+	}
+
+	memset( &tHeader, 0, sizeof(tHeader) );
+	tHeader.u32Magic = ROUTE_FILE_MAGIC;
+	tHeader.u16Version = ROUTE_FILE_VERSION;
+	tHeader.u16Flags = bHomeAtLock ? ROUTE_FLAG_HOME_AT_LOCK : 0;
+	tHeader.u32Count = gtWayPoints.u32Count;
+	tHeader.u32HazardCount = gtHazards.u32Count;
+
+	// Written in host order, the Pi and PCs are both little-endian
+	fp = fopen( pOut, "wb" );
+	if( !fp ||
+		1 != fwrite( &tHeader, sizeof(tHeader), 1, fp ) ||
+		!WriteList( fp, &gtWayPoints ) ||
+		!WriteList( fp, &gtHazards ) ||
+		0 != fclose( fp ) )
+	{
+		perror( pOut );
+		return 1;
+	}
+
+	printf( "%s: %lu waypoints, %lu hazards%s\n", pOut, (unsigned long)gtWayPoints.u32Count,
+			(unsigned long)gtHazards.u32Count, bHomeAtLock ? ", home at GPS lock" : "" );
+
+	return 0;
+}
+
+//------------------------------------------------------------------------------
+// Whole file as a string, NULL on error
+char *ReadFile( const char *pFileName )
+{
+	FILE *fp = fopen( pFileName, "rb" );
+	char *pText;
+	long length;
+
+	if( !fp )
+	{
+		perror( pFileName );
+		return NULL;
+	}
+
+	fseek( fp, 0, SEEK_END );
+	length = ftell( fp );
+	fseek( fp, 0, SEEK_SET );
+
+	pText = (char *)malloc( length + 1 );
+	if( !pText || (long)fread( pText, 1, length, fp ) != length )
+	{
+		perror( pFileName );
+		fclose( fp );
+		free( pText );
+		return NULL;
+	}
+
+	pText[length] = 0;
+	fclose( fp );
+
+	return pText;
+}
+
+//------------------------------------------------------------------------------
+// Decimal degrees to the end of a list
+bool AddPoint( tPOINT_LIST *ptList, double lat, double lon )
+{
+	if( lat < -90.0 || lat > 90.0 || lon < -180.0 || lon > 180.0 )
+	{
+		return false;
+	}
+
+	if( ptList->u32Count == ptList->u32Size )
+	{
+		ptList->u32Size = ptList->u32Size ? ptList->u32Size * 2 : 1024;
+		ptList->ptPoints = (tROUTE_WAY_POINT *)realloc( ptList->ptPoints, ptList->u32Size * sizeof(tROUTE_WAY_POINT) );
+		if( !ptList->ptPoints )
+		{
+			fprintf( stderr, "Out of memory\n" );
+			exit( 1 );
+		}
+	}
+
+	ptList->ptPoints[ptList->u32Count].s32Lat = (int32_t)lround( lat * 1000000.0 );
+	ptList->ptPoints[ptList->u32Count].s32Lon = (int32_t)lround( lon * 1000000.0 );
+	ptList->u32Count++;
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+bool WriteList( FILE *fp, const tPOINT_LIST *ptList )
+{
+	return ptList->u32Count == fwrite( ptList->ptPoints, sizeof(tROUTE_WAY_POINT), ptList->u32Count, fp );
+}
+
+//------------------------------------------------------------------------------
+bool ParseCsv( char *pText )
+{
+	char *pLine = pText;
+	char *pNext;
+	char *pEnd;
+	double lat;
+	double lon;
+	tPOINT_LIST *ptList;
+	int line = 0;
+
+	for( ; *pLine; pLine = pNext )
+	{
+		line++;
+
+		pNext = strchr( pLine, '\n' );
+		if( pNext )
+		{
+			*pNext++ = 0;
+		}
+		else
+		{
+			pNext = pLine + strlen( pLine );
+		}
+
+		while( isspace( (unsigned char)*pLine ) )
+		{
+			pLine++;
+		}
+
+		// Headers, comments, blank lines
+		if( !isdigit( (unsigned char)*pLine ) && *pLine != '-' && *pLine != '+' && *pLine != '.' )
+		{
+			continue;
+		}
+
+		lat = strtod( pLine, &pEnd );
+		while( isspace( (unsigned char)*pEnd ) )
+		{
+			pEnd++;
+		}
+
+		if( *pEnd != ',' && *pEnd != ';' )
+		{
+			fprintf( stderr, "line %i: expected lat,lon\n", line );
+			return false;
+		}
+
+		lon = strtod( pEnd + 1, &pEnd );
+		while( isspace( (unsigned char)*pEnd ) )
+		{
+			pEnd++;
+		}
+
+		ptList = &gtWayPoints;
+		if( *pEnd == ',' || *pEnd == ';' )
+		{
+			pEnd++;
+			while( isspace( (unsigned char)*pEnd ) )
+			{
+				pEnd++;
+			}
+			if( 0 == strncasecmp( pEnd, "hazard", 6 ) )
+			{
+				ptList = &gtHazards;
+			}
+		}
+
+		if( !AddPoint( ptList, lat, lon ) )
+		{
+			fprintf( stderr, "line %i: lat/lon out of range\n", line );
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Every pTag element (i.e. "<wpt") with lat and lon attributes, in order
+void ParseGpx( const char *pText, const char *pTag )
+{
+	const char *p = pText;
+	const char *pEnd;
+	size_t length = strlen( pTag );
+	double lat;
+	double lon;
+
+	while( (p = strstr( p, pTag )) != NULL )
+	{
+		p += length;
+
+		// Not a longer tag name, i.e. <wpt vs <wptExtension
+		if( !isspace( (unsigned char)*p ) )
+		{
+			continue;
+		}
+
+		pEnd = strchr( p, '>' );
+		if( !pEnd )
+		{
+			break;
+		}
+
+		if( GetAttribute( p, pEnd, "lat", &lat ) && GetAttribute( p, pEnd, "lon", &lon ) )
+		{
+			AddPoint( &gtWayPoints, lat, lon );
+		}
+
+		p = pEnd;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Value of name="..." (or '...') between pTag and pEnd
+bool GetAttribute( const char *pTag, const char *pEnd, const char *pName, double *pdValue )
+{
+	size_t length = strlen( pName );
+	const char *p;
+
+	for( p = pTag; p + length + 2 < pEnd; p++ )
+	{
+		if( isspace( (unsigned char)p[-1] ) && 0 == strncmp( p, pName, length ) &&
+			p[length] == '=' && (p[length + 1] == '"' || p[length + 1] == '\'') )
+		{
+			*pdValue = strtod( p + length + 2, NULL );
+			return true;
+		}
+	}
+
+	return false;
+}
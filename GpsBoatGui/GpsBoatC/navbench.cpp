@@ -0,0 +1,712 @@
+// navbench.cpp
+// Timings of the navigation code on the machine it's built on:
+//
+//   make bench
+//
+//   Geodesy      fixed point distance, course, and the two from a preset
+//                point, the batch and nearest waypoint over BENCH_LEGS
+//                points per point, against single precision
+//                TinyGPS::distance_between and course_to on the same legs
+//   GeoEngine    a leg each tier answers at GEO_ERROR_BOUND_M, and Vincenty
+//                on the short one, with the engine's own clock reads
+//   TinyGPS      each sentence type on its own, then streams that mix in one
+//                type more at a time, to show the cost per sentence doesn't
+//                grow with the types the dispatch table knows, and the mix
+//                a char at a time through encode( c ) against one buffer
+//   SpatialIndex build, memory, and nearest, first within and near track
+//                queries, over 1k, 10k and 100k points laid out uniformly
+//                and on survey lines, against a scan of every point
+//   Geofence     build, memory and check over fences of 20 to 125k edges,
+//                smooth shorelines and jagged rings, against a scan of every
+//                edge
+//
+// Times are per call, best of BENCH_RUNS, so a busy machine reads slow
+// rather than noisy. How accurate each is, navcheck.cpp checks.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "includes.h"
+#include "Geodesy.h"
+#include "GeoEngine.h"
+#include "TinyGPS.h"
+#include "SpatialIndex.h"
+#include "config.h"
+#include "Geofence.h"
+
+//-------------------------------------------
+// Local defines
+
+#define BENCH_RUNS				5
+#define BENCH_LEGS				1024
+#define BENCH_CALLS				2000000
+#define BENCH_SITE_LAT			33714740L		// sq.csv, the boat's lake
+#define BENCH_SITE_LON			-117802270L
+#define BENCH_SENTENCES			100000			// in a stream
+#define BENCH_SENTENCE_MAX		100				// $, body, *hh and CR LF
+#define BENCH_QUERIES			20000
+#define BENCH_SCANS				200
+#define BENCH_LINE_POINTS		400				// survey line layout: 5 m apart, lines 20 m apart
+#define BENCH_FENCE_LAT			33700000L		// the fences' center
+#define BENCH_FENCE_LON			-117800000L
+
+#define METERS_PER_DEGREE		111000.0		// near enough to place fence vertices
+#define RADIANS_PER_MILLIONTH	(M_PI / 180.0e6)
+
+//-------------------------------------------
+// Local data
+
+static long			galLat[BENCH_LEGS];			// within a couple of km of the site
+static long			galLon[BENCH_LEGS];
+static volatile U32	gu32Sink;					// keeps the calls from being optimized out
+static volatile float	gfSink;
+
+// One of each type TinyGPS parses, as a multi-constellation receiver talks,
+// and a proprietary one it skips
+static const char *gapBody[] =
+{
+	"GNRMC,123519.00,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W,A",
+	"GNGGA,123520,4807.040,N,01131.002,E,1,08,0.9,545.4,M,46.9,M,,",
+	"GNVTG,054.7,T,034.4,M,005.5,N,010.2,K,A",
+	"GNGLL,4807.050,N,01131.010,E,123521,A,A",
+	"GNGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1",
+	"GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00",
+	"GNZDA,123522.00,17,10,2026,00,00",
+	"PGRME,15.0,M,45.0,M,25.0,M",
+};
+
+#define BENCH_TYPES				(int)(sizeof(gapBody) / sizeof(gapBody[0]))
+
+//-------------------------------------------
+// Local prototypes
+
+static void		BenchGeodesy( void );
+static void		BenchEngine( void );
+static double	EngineLeg( tGEO_ENGINE *ptEngine, long lat, long lon );
+static void		BenchTinyGps( void );
+static double	EncodeStream( const int *pType, int types, bool bPerChar );
+static void		BenchIndex( void );
+static void		LayOut( bool bLines, int count, tENU_POS *ptPos );
+static void		BenchFence( void );
+static bool		MakeFence( tFENCE *ptFence, bool bJagged, int edges );
+static bool		ScanFence( const tFENCE *ptFence, const float *pfEast, const float *pfNorth, float fEast, float fNorth,
+						   float *pfMargin );
+static double	Now( void );
+static void		Show( const char *pName, double dSeconds, double dCalls );
+
+//------------------------------------------------------------------------------
+int main( int argc, char **argv )
+{
+	int i;
+
+	srand48( 4 );
+
+	for( i = 0; i < BENCH_LEGS; i++ )
+	{
+		galLat[i] = BENCH_SITE_LAT + (long)((drand48() - 0.5) * 20000.0);
+		galLon[i] = BENCH_SITE_LON + (long)((drand48() - 0.5) * 20000.0);
+	}
+
+	BenchGeodesy();
+	BenchEngine();
+	BenchTinyGps();
+	BenchIndex();
+	BenchFence();
+
+	return 0;
+}
+
+//------------------------------------------------------------------------------
+// Legs from each point to the next
+void BenchGeodesy( void )
+{
+	tGEO_POINT atPoint[BENCH_LEGS];
+	U32 au32Dist[BENCH_LEGS];
+	U32 au32Course[BENCH_LEGS];
+	double dBest[7] = { 1e9, 1e9, 1e9, 1e9, 1e9, 1e9, 1e9 };
+	double t;
+	U32 u32Dist;
+	U32 u32Course;
+	int run;
+	int i;
+	int j;
+	int k;
+
+	for( i = 0; i < BENCH_LEGS; i++ )
+	{
+		GEO_SetPoint( &atPoint[i], galLat[i], galLon[i] );
+	}
+
+	for( run = 0; run < BENCH_RUNS; run++ )
+	{
+		t = Now();
+		for( i = 0; i < BENCH_CALLS; i++ )
+		{
+			j = i % BENCH_LEGS;
+			k = (i + 1) % BENCH_LEGS;
+			gu32Sink += GEO_DistanceBetween( galLat[j], galLon[j], galLat[k], galLon[k] );
+		}
+		dBest[0] = min( dBest[0], Now() - t );
+
+		t = Now();
+		for( i = 0; i < BENCH_CALLS; i++ )
+		{
+			j = i % BENCH_LEGS;
+			k = (i + 1) % BENCH_LEGS;
+			gu32Sink += GEO_CourseTo( galLat[j], galLon[j], galLat[k], galLon[k] );
+		}
+		dBest[1] = min( dBest[1], Now() - t );
+
+		t = Now();
+		for( i = 0; i < BENCH_CALLS; i++ )
+		{
+			GEO_RangeAndBearing( &atPoint[i % BENCH_LEGS], &atPoint[(i + 1) % BENCH_LEGS], &u32Dist, &u32Course );
+			gu32Sink += u32Dist + u32Course;
+		}
+		dBest[2] = min( dBest[2], Now() - t );
+
+		t = Now();
+		for( i = 0; i < BENCH_CALLS; i++ )
+		{
+			j = i % BENCH_LEGS;
+			k = (i + 1) % BENCH_LEGS;
+			gfSink += TinyGPS::distance_between( galLat[j] / 1e6, galLon[j] / 1e6, galLat[k] / 1e6, galLon[k] / 1e6 );
+		}
+		dBest[3] = min( dBest[3], Now() - t );
+
+		t = Now();
+		for( i = 0; i < BENCH_CALLS; i++ )
+		{
+			j = i % BENCH_LEGS;
+			k = (i + 1) % BENCH_LEGS;
+			gfSink += TinyGPS::course_to( galLat[j] / 1e6, galLon[j] / 1e6, galLat[k] / 1e6, galLon[k] / 1e6 );
+		}
+		dBest[4] = min( dBest[4], Now() - t );
+
+		t = Now();
+		for( i = 0; i < BENCH_CALLS / BENCH_LEGS; i++ )
+		{
+			GEO_RangeAndBearingBatch( &atPoint[i % BENCH_LEGS], galLat, galLon, BENCH_LEGS, au32Dist, au32Course );
+			gu32Sink += au32Dist[i % BENCH_LEGS] + au32Course[i % BENCH_LEGS];
+		}
+		dBest[5] = min( dBest[5], Now() - t );
+
+		t = Now();
+		for( i = 0; i < BENCH_CALLS / BENCH_LEGS; i++ )
+		{
+			gu32Sink += GEO_Nearest( &atPoint[i % BENCH_LEGS], galLat, galLon, BENCH_LEGS, &u32Dist ) + u32Dist;
+		}
+		dBest[6] = min( dBest[6], Now() - t );
+	}
+
+	Show( "GEO_DistanceBetween", dBest[0], BENCH_CALLS );
+	Show( "GEO_CourseTo", dBest[1], BENCH_CALLS );
+	Show( "GEO_RangeAndBearing, both", dBest[2], BENCH_CALLS );
+	Show( "GEO_RangeAndBearingBatch, a point", dBest[5], BENCH_CALLS / BENCH_LEGS * BENCH_LEGS );
+	Show( "GEO_Nearest, a point", dBest[6], BENCH_CALLS / BENCH_LEGS * BENCH_LEGS );
+	Show( "TinyGPS::distance_between, float", dBest[3], BENCH_CALLS );
+	Show( "TinyGPS::course_to, float", dBest[4], BENCH_CALLS );
+}
+
+//------------------------------------------------------------------------------
+// From the site to a waypoint 28 m, 20 km and 1000 km off to the north east.
+// Not due north: Vincenty takes a couple of iterations fewer along a meridian.
+void BenchEngine( void )
+{
+	tGEO_ENGINE tEngine;
+	tGEO_ENGINE tVincenty;
+
+	GEOENG_Init( &tEngine, GEO_ERROR_BOUND_M );
+	GEOENG_Init( &tVincenty, -1.0 );
+
+	Show( "GEOENG 28 m, flat", EngineLeg( &tEngine, 33714953L, -117802114L ), BENCH_CALLS );
+	Show( "GEOENG 20 km, sphere", EngineLeg( &tEngine, 33841740L, -117649270L ), BENCH_CALLS );
+	Show( "GEOENG 1000 km, ellipsoid", EngineLeg( &tEngine, 40064740L, -110152270L ), BENCH_CALLS );
+	Show( "GEOENG 28 m, Vincenty", EngineLeg( &tVincenty, 33714953L, -117802114L ), BENCH_CALLS );
+}
+
+//------------------------------------------------------------------------------
+// Best time of BENCH_RUNS for BENCH_CALLS legs from the site to lat, lon
+double EngineLeg( tGEO_ENGINE *ptEngine, long lat, long lon )
+{
+	tGEOENG_POINT tFrom;
+	tGEOENG_POINT tTo;
+	tGEOENG_RESULT tResult;
+	double dBest = 1e9;
+	double t;
+	int run;
+	int i;
+
+	GEOENG_SetPoint( &tFrom, BENCH_SITE_LAT, BENCH_SITE_LON );
+	GEOENG_SetPoint( &tTo, lat, lon );
+
+	for( run = 0; run < BENCH_RUNS; run++ )
+	{
+		t = Now();
+		for( i = 0; i < BENCH_CALLS; i++ )
+		{
+			gu32Sink += GEOENG_RangeAndBearing( ptEngine, &tFrom, &tTo, &tResult );
+		}
+		dBest = min( dBest, Now() - t );
+	}
+
+	return dBest;
+}
+
+//------------------------------------------------------------------------------
+// Per sentence, through encode() a buffer at a time as GpsReader hands it on
+void BenchTinyGps( void )
+{
+	char name[48];
+	int aType[BENCH_TYPES];
+	int i;
+
+	for( i = 0; i < BENCH_TYPES; i++ )
+	{
+		aType[0] = i;
+		sprintf( name, "TinyGPS %.5s", gapBody[i] );
+		Show( name, EncodeStream( aType, 1, false ), BENCH_SENTENCES );
+	}
+
+	// The parsed ones, RMC alone, then RMC and GGA in turn, and so on
+	strcpy( name, "TinyGPS mix" );
+
+	for( i = 0; i < BENCH_TYPES - 1; i++ )
+	{
+		aType[i] = i;
+		sprintf( name + strlen( name ), " %.3s", gapBody[i] + 2 );
+		Show( name, EncodeStream( aType, i + 1, false ), BENCH_SENTENCES );
+	}
+
+	// What handing encode() whole read() buffers is worth
+	Show( "TinyGPS mix, encode( c ) each char", EncodeStream( aType, BENCH_TYPES - 1, true ), BENCH_SENTENCES );
+}
+
+//------------------------------------------------------------------------------
+// Best time of BENCH_RUNS to encode a stream of BENCH_SENTENCES, the types
+// in pType taking turns, in one buffer or a char at a time
+double EncodeStream( const int *pType, int types, bool bPerChar )
+{
+	char *pStream = (char *)malloc( BENCH_SENTENCES * BENCH_SENTENCE_MAX );
+	char *pEnd = pStream;
+	const char *pBody;
+	U8 checksum;
+	double dBest = 1e9;
+	double t;
+	int run;
+	int i;
+	const char *p;
+
+	for( i = 0; i < BENCH_SENTENCES; i++ )
+	{
+		pBody = gapBody[pType[i % types]];
+		checksum = 0;
+
+		while( *pBody != '\0' )
+		{
+			checksum ^= *pBody++;
+		}
+
+		pEnd += sprintf( pEnd, "$%s*%02X\r\n", gapBody[pType[i % types]], checksum );
+	}
+
+	for( run = 0; run < BENCH_RUNS; run++ )
+	{
+		TinyGPS tGps;
+
+		t = Now();
+		if( bPerChar )
+		{
+			for( p = pStream; p < pEnd; p++ )
+			{
+				gu32Sink += tGps.encode( *p );
+			}
+		}
+		else
+		{
+			gu32Sink += tGps.encode( pStream, pEnd - pStream );
+		}
+		dBest = min( dBest, Now() - t );
+	}
+
+	free( pStream );
+
+	return dBest;
+}
+
+//------------------------------------------------------------------------------
+// Queries over the points' own area, 300 m tracks with 10 m either side
+void BenchIndex( void )
+{
+	static const int aCount[] = { 1000, 10000, 100000 };
+	tENU_POS *ptPos = (tENU_POS *)malloc( aCount[2] * sizeof(tENU_POS) );
+	tENU_POS *ptQuery = (tENU_POS *)malloc( BENCH_QUERIES * sizeof(tENU_POS) );
+	tENU_POS tEnd;
+	tINDEX tIndex;
+	char name[48];
+	int aIds[64];
+	double dBest[5];
+	double dWidth;
+	double dHeight;
+	double dDist;
+	double t;
+	int count;
+	int lines;
+	int run;
+	int c;
+	int i;
+	int j;
+
+	srand48( 11 );
+
+	for( c = 0; c < (int)(sizeof(aCount) / sizeof(aCount[0])); c++ )
+	{
+		count = aCount[c];
+
+		for( lines = 0; lines < 2; lines++ )
+		{
+			LayOut( lines, count, ptPos );
+
+			dWidth = lines ? BENCH_LINE_POINTS * 5.0 : 20000.0;
+			dHeight = lines ? count / BENCH_LINE_POINTS * 20.0 : 20000.0;
+
+			for( i = 0; i < BENCH_QUERIES; i++ )
+			{
+				ptQuery[i].dEast = drand48() * dWidth - (lines ? 0.0 : 10000.0);
+				ptQuery[i].dNorth = drand48() * dHeight - (lines ? 0.0 : 10000.0);
+			}
+
+			for( i = 0; i < 5; i++ )
+			{
+				dBest[i] = 1e9;
+			}
+
+			for( run = 0; run < BENCH_RUNS; run++ )
+			{
+				t = Now();
+				INDEX_Build( &tIndex, ptPos, count );
+				dBest[0] = min( dBest[0], Now() - t );
+
+				t = Now();
+				for( i = 0; i < BENCH_QUERIES; i++ )
+				{
+					gu32Sink += INDEX_Nearest( &tIndex, &ptQuery[i], 0.0, &dDist );
+				}
+				dBest[1] = min( dBest[1], Now() - t );
+
+				t = Now();
+				for( i = 0; i < BENCH_QUERIES; i++ )
+				{
+					gu32Sink += INDEX_FirstWithin( &tIndex, &ptQuery[i], 50.0, i % count );
+				}
+				dBest[2] = min( dBest[2], Now() - t );
+
+				t = Now();
+				for( i = 0; i < BENCH_QUERIES; i++ )
+				{
+					tEnd.dEast = ptQuery[i].dEast + 300.0 * cos( i );
+					tEnd.dNorth = ptQuery[i].dNorth + 300.0 * sin( i );
+					gu32Sink += INDEX_NearTrack( &tIndex, &ptQuery[i], &tEnd, 10.0, aIds, 64, &dDist );
+				}
+				dBest[3] = min( dBest[3], Now() - t );
+
+				// What the index saves: nearest by looking at every point
+				t = Now();
+				for( i = 0; i < BENCH_SCANS; i++ )
+				{
+					dDist = 1e300;
+					for( j = 0; j < count; j++ )
+					{
+						dDist = fmin( dDist, sq( ptPos[j].dEast - ptQuery[i].dEast ) + sq( ptPos[j].dNorth - ptQuery[i].dNorth ) );
+					}
+					gu32Sink += (U32)dDist;
+				}
+				dBest[4] = min( dBest[4], Now() - t );
+
+				if( run < BENCH_RUNS - 1 )
+				{
+					INDEX_Free( &tIndex );
+				}
+			}
+
+			sprintf( name, "INDEX %d %s", count, lines ? "survey lines" : "uniform" );
+			printf( "%s, %d x %d cells\n", name, tIndex.columns, tIndex.rows );
+			printf( "  %-36s %12.1f B\n", "memory, per point",
+					(count * sizeof(tINDEX_POINT) + (tIndex.columns * tIndex.rows + 1) * sizeof(uint32_t)) / (double)count );
+			Show( "  build, per point", dBest[0], count );
+			Show( "  INDEX_Nearest", dBest[1], BENCH_QUERIES );
+			Show( "  INDEX_FirstWithin 50 m", dBest[2], BENCH_QUERIES );
+			Show( "  INDEX_NearTrack 300 m by 10 m", dBest[3], BENCH_QUERIES );
+			Show( "  nearest by scanning them all", dBest[4], BENCH_SCANS );
+
+			INDEX_Free( &tIndex );
+		}
+	}
+
+	free( ptQuery );
+	free( ptPos );
+}
+
+//------------------------------------------------------------------------------
+// count points 10 km either way of home, or on survey lines north from home
+void LayOut( bool bLines, int count, tENU_POS *ptPos )
+{
+	int line;
+	int k;
+	int i;
+
+	for( i = 0; i < count; i++ )
+	{
+		if( bLines )
+		{
+			// Mown back and forth
+			line = i / BENCH_LINE_POINTS;
+			k = i % BENCH_LINE_POINTS;
+			ptPos[i].dEast = ((line & 1) ? BENCH_LINE_POINTS - 1 - k : k) * 5.0;
+			ptPos[i].dNorth = line * 20.0;
+		}
+		else
+		{
+			ptPos[i].dEast = drand48() * 20000.0 - 10000.0;
+			ptPos[i].dNorth = drand48() * 20000.0 - 10000.0;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Checks anywhere over the fence, as the boat's would be if it roamed
+void BenchFence( void )
+{
+	static const int aEdges[] = { 16, 1000, 10000, 100000 };
+	tFENCE tFence;
+	tENU_FRAME tFrame;
+	tENU_POS tPos;
+	tENU_POS *ptQuery = (tENU_POS *)malloc( BENCH_QUERIES * sizeof(tENU_POS) );
+	tFENCE_STATUS tStatus;
+	char name[48];
+	float *pfEast;
+	float *pfNorth;
+	float fMargin;
+	double dBest[3];
+	double t;
+	size_t bytes;
+	int edges;
+	int jagged;
+	int run;
+	int e;
+	int i;
+	int v;
+
+	ENU_Init( &tFrame, BENCH_FENCE_LAT, BENCH_FENCE_LON );
+	srand48( 12 );
+
+	for( i = 0; i < BENCH_QUERIES; i++ )
+	{
+		ptQuery[i].dEast = (drand48() - 0.5) * 3600.0;
+		ptQuery[i].dNorth = (drand48() - 0.5) * 3600.0;
+	}
+
+	for( jagged = 0; jagged < 2; jagged++ )
+	{
+		for( e = 0; e < (int)(sizeof(aEdges) / sizeof(aEdges[0])); e++ )
+		{
+			if( !MakeFence( &tFence, jagged, aEdges[e] ) )
+			{
+				return;
+			}
+
+			pfEast = (float *)malloc( tFence.vertexCount * sizeof(float) );
+			pfNorth = (float *)malloc( tFence.vertexCount * sizeof(float) );
+
+			for( v = 0; v < tFence.vertexCount; v++ )
+			{
+				ENU_FromGeodetic( &tFrame, tFence.ptVertices[v].s32Lat, tFence.ptVertices[v].s32Lon, &tPos );
+				pfEast[v] = tPos.dEast;
+				pfNorth[v] = tPos.dNorth;
+			}
+
+			for( i = 0; i < 3; i++ )
+			{
+				dBest[i] = 1e9;
+			}
+
+			for( run = 0; run < BENCH_RUNS; run++ )
+			{
+				t = Now();
+				FENCE_SetFrame( &tFence, &tFrame );
+				dBest[0] = min( dBest[0], Now() - t );
+
+				t = Now();
+				for( i = 0; i < BENCH_QUERIES; i++ )
+				{
+					gu32Sink += FENCE_Check( &tFence, &ptQuery[i], &tStatus );
+				}
+				dBest[1] = min( dBest[1], Now() - t );
+
+				t = Now();
+				for( i = 0; i < BENCH_SCANS; i++ )
+				{
+					gu32Sink += ScanFence( &tFence, pfEast, pfNorth, ptQuery[i].dEast, ptQuery[i].dNorth, &fMargin );
+				}
+				dBest[2] = min( dBest[2], Now() - t );
+			}
+
+			edges = tFence.vertexCount;
+			bytes = 0;
+
+			for( i = 0; i < tFence.polygonCount; i++ )
+			{
+				bytes += tFence.ptPolygons[i].pu32BandStart[tFence.ptPolygons[i].bands] * sizeof(tFENCE_BLOCK)
+					   + (tFence.ptPolygons[i].bands + 1) * sizeof(uint32_t);
+			}
+
+			sprintf( name, "FENCE %d edges %s", edges, jagged ? "jagged" : "shoreline" );
+			printf( "%s\n", name );
+			printf( "  %-36s %12.1f B\n", "memory, per edge", bytes / (double)edges );
+			Show( "  build, per edge", dBest[0], edges );
+			Show( "  FENCE_Check", dBest[1], BENCH_QUERIES );
+			Show( "  by scanning every edge", dBest[2], BENCH_SCANS );
+
+			free( pfEast );
+			free( pfNorth );
+			FENCE_Close( &tFence );
+		}
+	}
+
+	free( ptQuery );
+}
+
+//------------------------------------------------------------------------------
+// A keep-in ring of edges, about 3 km across, around a keep-out island of a
+// quarter as many. The ring is a shoreline, smooth but for 1 m of noise, or
+// jagged, every edge some 300 m tall: the worst case for the bands.
+bool MakeFence( tFENCE *ptFence, bool bJagged, int edges )
+{
+	char name[] = "/tmp/navbenchXXXXXX";
+	FILE *pFile;
+	double dAngle;
+	double dRadius;
+	double dCosLat = cos( BENCH_FENCE_LAT * RADIANS_PER_MILLIONTH );
+	bool bLoaded;
+	int island = max( edges / 4, 4 );
+	int i;
+
+	pFile = fdopen( mkstemp( name ), "w" );
+	if( pFile == NULL )
+	{
+		return false;
+	}
+
+	fprintf( pFile, "keepin\n" );
+
+	for( i = 0; i < edges; i++ )
+	{
+		dAngle = 2.0 * M_PI * i / edges;
+		dRadius = bJagged ? 1500.0 * (1.0 + 0.2 * (drand48() - 0.5))
+						  : 1500.0 + 150.0 * sin( 5.0 * dAngle ) + 60.0 * sin( 23.0 * dAngle + 1.0 )
+								   + 20.0 * sin( 97.0 * dAngle ) + drand48() - 0.5;
+		fprintf( pFile, "%.6f,%.6f\n", BENCH_FENCE_LAT / 1e6 + dRadius * cos( dAngle ) / METERS_PER_DEGREE,
+				 BENCH_FENCE_LON / 1e6 + dRadius * sin( dAngle ) / (METERS_PER_DEGREE * dCosLat) );
+	}
+
+	fprintf( pFile, "keepout\n" );
+
+	for( i = 0; i < island; i++ )
+	{
+		dAngle = 2.0 * M_PI * i / island;
+		dRadius = 300.0 * (1.0 + 0.3 * (drand48() - 0.5));
+		fprintf( pFile, "%.6f,%.6f\n", BENCH_FENCE_LAT / 1e6 + dRadius * cos( dAngle ) / METERS_PER_DEGREE,
+				 BENCH_FENCE_LON / 1e6 + dRadius * sin( dAngle ) / (METERS_PER_DEGREE * dCosLat) );
+	}
+
+	fclose( pFile );
+
+	bLoaded = FENCE_LoadFile( ptFence, name );
+	unlink( name );
+
+	return bLoaded;
+}
+
+//------------------------------------------------------------------------------
+// Breach by crossings and margin by the distance to every edge of every
+// polygon, the way Geofence.h describes them
+bool ScanFence( const tFENCE *ptFence, const float *pfEast, const float *pfNorth, float fEast, float fNorth,
+				float *pfMargin )
+{
+	const tFENCE_POLYGON *ptPolygon;
+	float fNearest2 = FENCE_MARGIN_M * FENCE_MARGIN_M;
+	float fE0, fN0, fE1, fN1;
+	float fDE, fDN, fLength2, fT;
+	bool bInKeepIn = false;
+	bool bBreach = false;
+	int crossings;
+	int a;
+	int b;
+	int i;
+	int v;
+
+	for( i = 0; i < ptFence->polygonCount; i++ )
+	{
+		ptPolygon = &ptFence->ptPolygons[i];
+		crossings = 0;
+
+		for( v = 0; v < ptPolygon->vertexCount; v++ )
+		{
+			a = ptPolygon->firstVertex + v;
+			b = ptPolygon->firstVertex + (v + 1) % ptPolygon->vertexCount;
+			fE0 = pfEast[a];
+			fN0 = pfNorth[a];
+			fE1 = pfEast[b];
+			fN1 = pfNorth[b];
+
+			if( (fN0 > fNorth) != (fN1 > fNorth) && fEast < fE0 + (fNorth - fN0) * ((fE1 - fE0) / (fN1 - fN0)) )
+			{
+				crossings++;
+			}
+
+			fDE = fE1 - fE0;
+			fDN = fN1 - fN0;
+			fLength2 = fDE * fDE + fDN * fDN;
+			fT = (fLength2 > 0.0f) ? ((fEast - fE0) * fDE + (fNorth - fN0) * fDN) / fLength2 : 0.0f;
+			fT = fmaxf( 0.0f, fminf( 1.0f, fT ) );
+			fNearest2 = fminf( fNearest2, sq( fEast - fE0 - fT * fDE ) + sq( fNorth - fN0 - fT * fDN ) );
+		}
+
+		if( crossings & 1 )
+		{
+			if( ptPolygon->bKeepOut )
+			{
+				bBreach = true;
+			}
+			else
+			{
+				bInKeepIn = true;
+			}
+		}
+	}
+
+	*pfMargin = sqrtf( fNearest2 );
+
+	return bBreach || (ptFence->keepInCount && !bInKeepIn);
+}
+
+//------------------------------------------------------------------------------
+// Seconds, monotonic
+double Now( void )
+{
+	struct timespec tNow;
+
+	clock_gettime( CLOCK_MONOTONIC, &tNow );
+
+	return tNow.tv_sec + tNow.tv_nsec / 1e9;
+}
+
+//------------------------------------------------------------------------------
+void Show( const char *pName, double dSeconds, double dCalls )
+{
+	printf( "%-38s %12.1f ns\n", pName, dSeconds / dCalls * 1e9 );
+}
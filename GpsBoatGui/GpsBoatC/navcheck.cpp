@@ -0,0 +1,1049 @@
+// navcheck.cpp
+// Accuracy checks for the navigation math, each against a double precision
+// reference worked out here, on a PC:
+//
+//   make check
+//
+//   LocalFrame   projection against trig ECEF -> ENU, the round trip back to
+//                millionths of a degree, and plane range and bearing against
+//                Vincenty, for point pairs within ENU_MAX_RADIUS_M of the
+//                anchor
+//   GeoEngine    each tier's range and bearing at GEO_ERROR_BOUND_M against
+//                Vincenty, for legs from 1 m to 15000 km up to 85 degrees:
+//                the far end error, and that against the tier's own bound
+//   Geodesy      sine table and CORDIC atan2 against libm, and distance and
+//                course against a double precision haversine on the same
+//                sphere, for legs from 1 m to 1000 km anywhere up to 80
+//                degrees; the batch range and bearing and nearest waypoint
+//                against the same one at a time
+//   SpatialIndex nearest, first within and near track queries against a scan
+//                of every point, over uniform and survey line layouts, with
+//                queries inside the points and up to 3 km outside them
+//   Geofence     breach and margin against every edge of the fence tested,
+//                for smooth shorelines and jagged rings of up to 1250 edges,
+//                with half the points within 30 m of an edge
+//   TinyGPS      encode( buf, len ) against encode( c ) a char at a time,
+//                over a stream with bad checksums and cut off sentences,
+//                handed over in random blocks of 0 to 36 chars
+//   GpsReader    the same stream written into a pty in bursts of 1 to 600
+//                chars, sentences split across them and run together, read
+//                off the other end: sentences and fixes against encode( c ),
+//                and a hang up seen as one
+//
+// Every check prints its worst error next to the bound it's held to (the one
+// its header documents). The draws are seeded, so a run always checks the
+// same points. Exit status 1 if any error is over its bound.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+#include <string.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "includes.h"
+#include "LocalFrame.h"
+#include "GeoEngine.h"
+#include "Geodesy.h"
+#include "SpatialIndex.h"
+#include "config.h"
+#include "Geofence.h"
+#include "TinyGPS.h"
+#include "GpsReader.h"
+#include "Hal.h"
+
+//-------------------------------------------
+// Local defines
+
+#define CHECK_PAIRS				200000
+#define CHECK_ENGINE_LEGS		200000
+#define CHECK_LEGS				20000			// per range
+#define CHECK_ANGLES			1000000
+#define CHECK_BATCH_POINTS		2000
+#define CHECK_BATCHES			200
+#define CHECK_INDEX_POINTS		10000
+#define CHECK_INDEX_QUERIES		2000
+#define CHECK_LINE_POINTS		400				// survey line layout: 5 m apart, lines 20 m apart
+#define CHECK_FENCE_POINTS		100000			// per fence
+#define CHECK_FENCE_LAT			33700000L		// the fences' center
+#define CHECK_FENCE_LON			-117800000L
+#define CHECK_SENTENCES			60000
+#define CHECK_BLOCK_MAX			36
+#define CHECK_READER_SENTENCES	6000
+#define CHECK_BURST_MAX			600
+#define CHECK_READ_MS			1000
+#define CHECK_SITE_LAT			33714740L		// sq.csv, the boat's lake
+#define CHECK_SITE_LON			-117802270L
+
+#define WGS84_A					6378137.0
+#define WGS84_F					(1.0 / 298.257223563)
+#define METERS_PER_DEGREE		111000.0		// near enough to place test points
+#define RADIANS_PER_MILLIONTH	(M_PI / 180.0e6)
+#define RADIANS_PER_ANGLE		(M_PI / 2147483648.0)	// binary angle, 2^32 == 360 degrees
+#define Q30						1073741824.0
+
+//-------------------------------------------
+// Local prototypes
+
+static bool		CheckLocalFrame( void );
+static bool		CheckEngine( void );
+static bool		CheckGeodesy( void );
+static bool		CheckBatch( void );
+static bool		CheckIndex( void );
+static void		LayOut( bool bLines, int count, tENU_POS *ptPos );
+static bool		CheckFence( void );
+static bool		MakeFence( tFENCE *ptFence, bool bJagged, int edges );
+static bool		CheckEncode( void );
+static int		Sentence( char *pBuf, int i );
+static bool		SameState( TinyGPS *ptA, TinyGPS *ptB );
+static bool		CheckReader( void );
+static int		OpenPty( int *pSlave );
+static bool		ScanFence( const tFENCE *ptFence, const float *pfEast, const float *pfNorth, float fEast, float fNorth,
+						   float *pfMargin );
+static void		RandomNear( long lat0, long lon0, double dRadius, long *plLat, long *plLon );
+static void		TrigEnu( long lat0, long lon0, long lat, long lon, tENU_POS *ptPos );
+static void		Ecef( long lat, long lon, double *pdX, double *pdY, double *pdZ );
+static void		Haversine( long lat1, long lon1, long lat2, long lon2, double *pdDist, double *pdCourse );
+static double	BearingError( double dA, double dB );
+static bool		Report( const char *pName, double dWorst, double dBound );
+
+//------------------------------------------------------------------------------
+int main( int argc, char **argv )
+{
+	bool bOk = true;
+
+	HAL_Init();
+
+	printf( "%-38s %12s %12s\n", "", "worst", "bound" );
+
+	bOk &= CheckLocalFrame();
+	bOk &= CheckEngine();
+	bOk &= CheckGeodesy();
+	bOk &= CheckBatch();
+	bOk &= CheckIndex();
+	bOk &= CheckFence();
+	bOk &= CheckEncode();
+	bOk &= CheckReader();
+
+	printf( "\n%s\n", bOk ? "all within bounds" : "OVER BOUND" );
+
+	return bOk ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
+// A quarter of the pairs about the boat's own site, the rest about anchors
+// anywhere up to 80 degrees of latitude
+bool CheckLocalFrame( void )
+{
+	tGEO_ENGINE tVincenty;
+	tENU_FRAME tFrame;
+	tENU_POS atPos[2];
+	tENU_POS tRef;
+	tGEOENG_POINT atPoint[2];
+	tGEOENG_RESULT tResult;
+	long alLat[2];
+	long alLon[2];
+	long lat0;
+	long lon0;
+	long lat;
+	long lon;
+	double dProjection = 0.0;
+	double dRoundTrip = 0.0;
+	double dRange = 0.0;
+	double dBearingSite = 0.0;
+	double dBearing80 = 0.0;
+	double dError;
+	bool bSite;
+	bool bOk = true;
+	int i;
+	int k;
+
+	// No error bound is small enough for the flat or sphere tiers
+	GEOENG_Init( &tVincenty, -1.0 );
+	srand48( 9 );
+
+	for( i = 0; i < CHECK_PAIRS; i++ )
+	{
+		bSite = i < CHECK_PAIRS / 4;
+		lat0 = bSite ? CHECK_SITE_LAT : (long)((drand48() * 160.0 - 80.0) * 1e6);
+		lon0 = bSite ? CHECK_SITE_LON : (long)((drand48() * 360.0 - 180.0) * 1e6);
+		ENU_Init( &tFrame, lat0, lon0 );
+
+		for( k = 0; k < 2; k++ )
+		{
+			RandomNear( lat0, lon0, ENU_MAX_RADIUS_M, &alLat[k], &alLon[k] );
+
+			ENU_FromGeodetic( &tFrame, alLat[k], alLon[k], &atPos[k] );
+			TrigEnu( lat0, lon0, alLat[k], alLon[k], &tRef );
+			dProjection = max( dProjection, ENU_Distance( &atPos[k], &tRef ) );
+
+			ENU_ToGeodetic( &tFrame, &atPos[k], &lat, &lon );
+			dRoundTrip = max( dRoundTrip, (double)max( labs( lat - alLat[k] ), labs( lon - alLon[k] ) ) );
+
+			GEOENG_SetPoint( &atPoint[k], alLat[k], alLon[k] );
+		}
+
+		GEOENG_RangeAndBearing( &tVincenty, &atPoint[0], &atPoint[1], &tResult );
+
+		dRange = max( dRange, fabs( ENU_Distance( &atPos[0], &atPos[1] ) - tResult.dDist ) );
+
+		// Bearings are only held to beyond 10 m
+		if( tResult.dDist > 10.0 )
+		{
+			dError = BearingError( ENU_Bearing( &tFrame, &atPos[0], &atPos[1] ), tResult.dCourse );
+
+			if( bSite )
+			{
+				dBearingSite = max( dBearingSite, dError );
+			}
+			else
+			{
+				dBearing80 = max( dBearing80, dError );
+			}
+		}
+	}
+
+	bOk &= Report( "ENU projection vs trig, m", dProjection, 1e-6 );
+	bOk &= Report( "ENU round trip, millionths", dRoundTrip, 0.0 );
+	bOk &= Report( "ENU range vs Vincenty, m", dRange, 0.01 );
+	bOk &= Report( "ENU bearing at 34N, deg", dBearingSite, 0.0002 );
+	bOk &= Report( "ENU bearing up to 80N, deg", dBearing80, 0.003 );
+
+	return bOk;
+}
+
+//------------------------------------------------------------------------------
+// Leg lengths spread evenly over their logarithm, so every tier gets its
+// share. Legs Vincenty itself can't do, nearly antipodal, are left out.
+bool CheckEngine( void )
+{
+	tGEO_ENGINE tEngine;
+	tGEO_ENGINE tVincenty;
+	tGEOENG_POINT tFrom;
+	tGEOENG_POINT tTo;
+	tGEOENG_RESULT tResult;
+	tGEOENG_RESULT tRef;
+	double adWorst[E_GEO_TIER_MAX] = { 0.0 };
+	double adRatio[E_GEO_TIER_MAX] = { 0.0 };
+	double dRange;
+	double dBearing;
+	double dError;
+	long lat1;
+	long lon1;
+	long lat2;
+	long lon2;
+	bool bOk = true;
+	int i;
+
+	GEOENG_Init( &tEngine, GEO_ERROR_BOUND_M );
+	GEOENG_Init( &tVincenty, -1.0 );
+	srand48( 8 );
+
+	for( i = 0; i < CHECK_ENGINE_LEGS; i++ )
+	{
+		lat1 = (long)((drand48() * 170.0 - 85.0) * 1e6);
+		lon1 = (long)((drand48() * 360.0 - 180.0) * 1e6);
+		dRange = pow( 10.0, drand48() * log10( 1.5e7 ) );
+		dBearing = drand48() * 2.0 * M_PI;
+		lat2 = lat1 + (long)(dRange * cos( dBearing ) / METERS_PER_DEGREE * 1e6);
+		lon2 = lon1 + (long)(dRange * sin( dBearing ) / (METERS_PER_DEGREE * cos( lat1 * RADIANS_PER_MILLIONTH )) * 1e6);
+
+		if( labs( lat2 ) > 85000000L )
+		{
+			continue;
+		}
+		lon2 = (lon2 > 180000000L) ? lon2 - 360000000L : (lon2 < -180000000L) ? lon2 + 360000000L : lon2;
+
+		GEOENG_SetPoint( &tFrom, lat1, lon1 );
+		GEOENG_SetPoint( &tTo, lat2, lon2 );
+		GEOENG_RangeAndBearing( &tEngine, &tFrom, &tTo, &tResult );
+
+		if( GEOENG_RangeAndBearing( &tVincenty, &tFrom, &tTo, &tRef ) != E_GEO_TIER_ELLIPSOID )
+		{
+			continue;
+		}
+
+		// Where the answer puts the far end against where it is
+		dError = hypot( tResult.dDist - tRef.dDist, BearingError( tResult.dCourse, tRef.dCourse ) * DEG_TO_RAD * tRef.dDist );
+		adWorst[tResult.eTier] = max( adWorst[tResult.eTier], dError );
+
+		// The bound is the formula's. Less 0.01 mm: Vincenty only converges to
+		// ~0.006 mm, so can't judge finer than that.
+		adRatio[tResult.eTier] = max( adRatio[tResult.eTier], (dError - 1e-5) / tResult.dError );
+	}
+
+	bOk &= Report( "GEOENG flat vs Vincenty, m", adWorst[E_GEO_TIER_FLAT], GEO_ERROR_BOUND_M );
+	bOk &= Report( "GEOENG flat, of its own bound", adRatio[E_GEO_TIER_FLAT], 1.0 );
+	bOk &= Report( "GEOENG sphere vs Vincenty, m", adWorst[E_GEO_TIER_SPHERE], GEO_ERROR_BOUND_M );
+	bOk &= Report( "GEOENG sphere, of its own bound", adRatio[E_GEO_TIER_SPHERE], 1.0 );
+	bOk &= Report( "GEOENG Vincenty fallbacks", tEngine.tStats.u32Fallbacks, 0.0 );
+
+	return bOk;
+}
+
+//------------------------------------------------------------------------------
+// Legs of each range on a random bearing, both ends rounded to millionths
+// before either side works them out. The bounds are the ones in Geodesy.h.
+bool CheckGeodesy( void )
+{
+	static const double adRange[] = { 1.0, 10.0, 100.0, 1e3, 1e4, 1e5, 1e6 };
+	char name[40];
+	double dSin = 0.0;
+	double dAtan2 = 0.0;
+	double dDist;
+	double dCourse;
+	double dWorstDist;
+	double dWorstCourse;
+	double dRange;
+	double dBearing;
+	double dAngle;
+	int64_t y;
+	int64_t x;
+	long lat1;
+	long lon1;
+	long lat2;
+	long lon2;
+	U32 angle;
+	bool bOk = true;
+	int i;
+	int r;
+
+	srand48( 5 );
+
+	for( i = 0; i < CHECK_ANGLES; i++ )
+	{
+		angle = (U32)(drand48() * 4294967296.0);
+		dSin = max( dSin, fabs( GEO_Sin( angle ) / Q30 - sin( angle * RADIANS_PER_ANGLE ) ) );
+
+		// Any scale: the nav loop hands it Q30 terms and whole centimeters
+		dAngle = ldexp( 1.0, (int)(drand48() * 40.0) );
+		y = (int64_t)((drand48() * 2.0 - 1.0) * dAngle);
+		x = (int64_t)((drand48() * 2.0 - 1.0) * dAngle);
+		if( x != 0 || y != 0 )
+		{
+			dAngle = GEO_Atan2( y, x ) * RADIANS_PER_ANGLE - atan2( (double)y, (double)x );
+			dAtan2 = max( dAtan2, fabs( remainder( dAngle, 2.0 * M_PI ) ) );
+		}
+	}
+
+	bOk &= Report( "GEO sine table", dSin, 1.2e-6 );
+	bOk &= Report( "GEO CORDIC atan2, rad", dAtan2, 2e-9 );
+
+	for( r = 0; r < (int)(sizeof(adRange) / sizeof(adRange[0])); r++ )
+	{
+		dWorstDist = 0.0;
+		dWorstCourse = 0.0;
+
+		for( i = 0; i < CHECK_LEGS; i++ )
+		{
+			lat1 = (long)((drand48() * 160.0 - 80.0) * 1e6);
+			lon1 = (long)((drand48() * 360.0 - 180.0) * 1e6);
+			dRange = adRange[r];
+			dBearing = drand48() * 2.0 * M_PI;
+			lat2 = lat1 + (long)lround( dRange * cos( dBearing ) / GEO_EARTH_RADIUS_M / RADIANS_PER_MILLIONTH );
+			lon2 = lon1 + (long)lround( dRange * sin( dBearing ) / GEO_EARTH_RADIUS_M / RADIANS_PER_MILLIONTH
+										/ cos( lat1 * RADIANS_PER_MILLIONTH ) );
+
+			Haversine( lat1, lon1, lat2, lon2, &dDist, &dCourse );
+
+			dWorstDist = max( dWorstDist, fabs( GEO_DistanceBetween( lat1, lon1, lat2, lon2 ) - dDist * 100.0 ) );
+
+			// Rounding to millionths can all but close up a 1 m leg
+			if( dDist >= dRange / 2.0 )
+			{
+				dWorstCourse = max( dWorstCourse, BearingError( GEO_CourseTo( lat1, lon1, lat2, lon2 ) / 100.0, dCourse ) );
+			}
+		}
+
+		sprintf( name, "GEO distance at %.0f m, cm", adRange[r] );
+		bOk &= Report( name, dWorstDist, 2.0 + 3.5e-4 * adRange[r] );
+		sprintf( name, "GEO course at %.0f m, deg", adRange[r] );
+		bOk &= Report( name, dWorstCourse, adRange[r] < 10.0 ? 0.2 : adRange[r] < 100.0 ? 0.03 : 0.01 );
+	}
+
+	return bOk;
+}
+
+//------------------------------------------------------------------------------
+// Routes of points within 20 km of the boat's site, from a random point
+// near it: the batch has to give what one at a time does, and the nearest
+// has to be as near as the nearest of those
+bool CheckBatch( void )
+{
+	static long alLat[CHECK_BATCH_POINTS];
+	static long alLon[CHECK_BATCH_POINTS];
+	static U32 au32Dist[CHECK_BATCH_POINTS];
+	static U32 au32Course[CHECK_BATCH_POINTS];
+	tGEO_POINT tFrom;
+	tGEO_POINT tTo;
+	long lat;
+	long lon;
+	U32 u32Dist;
+	U32 u32Course;
+	U32 u32Nearest;
+	U32 u32Least;
+	int mismatches = 0;
+	int batch;
+	int i;
+
+	srand48( 6 );
+
+	for( batch = 0; batch < CHECK_BATCHES; batch++ )
+	{
+		for( i = 0; i < CHECK_BATCH_POINTS; i++ )
+		{
+			RandomNear( CHECK_SITE_LAT, CHECK_SITE_LON, 20000.0, &alLat[i], &alLon[i] );
+		}
+
+		RandomNear( CHECK_SITE_LAT, CHECK_SITE_LON, 20000.0, &lat, &lon );
+		GEO_SetPoint( &tFrom, lat, lon );
+		GEO_RangeAndBearingBatch( &tFrom, alLat, alLon, CHECK_BATCH_POINTS, au32Dist, au32Course );
+
+		u32Least = ~0UL;
+		for( i = 0; i < CHECK_BATCH_POINTS; i++ )
+		{
+			GEO_SetPoint( &tTo, alLat[i], alLon[i] );
+			GEO_RangeAndBearing( &tFrom, &tTo, &u32Dist, &u32Course );
+			mismatches += au32Dist[i] != u32Dist || au32Course[i] != u32Course;
+			u32Least = min( u32Least, u32Dist );
+		}
+
+		i = GEO_Nearest( &tFrom, alLat, alLon, CHECK_BATCH_POINTS, &u32Nearest );
+		mismatches += i < 0 || u32Nearest != u32Least || au32Dist[i] != u32Least;
+	}
+
+	return Report( "GEO batch and nearest, mismatches", mismatches, 0.0 );
+}
+
+//------------------------------------------------------------------------------
+// Every query's answer against the one a scan of all the points gives. The
+// scan works on the points as the index holds them, floats.
+bool CheckIndex( void )
+{
+	tENU_POS *ptPos = (tENU_POS *)malloc( CHECK_INDEX_POINTS * sizeof(tENU_POS) );
+	tINDEX tIndex;
+	tENU_POS tQuery;
+	tENU_POS tEnd;
+	int aIds[64];
+	double dWidth;
+	double dHeight;
+	double dDist;
+	double dBest;
+	double dE;
+	double dN;
+	double dLength2;
+	double dT;
+	double dClosest;
+	int nearest = 0;
+	int within = 0;
+	int track = 0;
+	int first;
+	int count;
+	int lines;
+	bool bOk = true;
+	int i;
+	int j;
+
+	srand48( 11 );
+
+	for( lines = 0; lines < 2; lines++ )
+	{
+		LayOut( lines, CHECK_INDEX_POINTS, ptPos );
+		INDEX_Build( &tIndex, ptPos, CHECK_INDEX_POINTS );
+
+		dWidth = lines ? CHECK_LINE_POINTS * 5.0 : 20000.0;
+		dHeight = lines ? CHECK_INDEX_POINTS / CHECK_LINE_POINTS * 20.0 : 20000.0;
+
+		for( i = 0; i < CHECK_INDEX_QUERIES; i++ )
+		{
+			// Half inside the points, half anywhere to 3 km outside them
+			dE = (i & 1) ? drand48() * (dWidth + 6000.0) - 3000.0 : drand48() * dWidth;
+			dN = (i & 1) ? drand48() * (dHeight + 6000.0) - 3000.0 : drand48() * dHeight;
+			tQuery.dEast = dE - (lines ? 0.0 : 10000.0);
+			tQuery.dNorth = dN - (lines ? 0.0 : 10000.0);
+			tEnd.dEast = tQuery.dEast + 300.0 * cos( i );
+			tEnd.dNorth = tQuery.dNorth + 300.0 * sin( i );
+			dLength2 = 300.0 * 300.0;
+
+			dBest = DBL_MAX;
+			first = -1;
+			count = 0;
+
+			for( j = 0; j < CHECK_INDEX_POINTS; j++ )
+			{
+				dE = (float)ptPos[j].dEast - tQuery.dEast;
+				dN = (float)ptPos[j].dNorth - tQuery.dNorth;
+				dBest = fmin( dBest, dE * dE + dN * dN );
+
+				if( first < 0 && j >= i % CHECK_INDEX_POINTS && dE * dE + dN * dN <= 50.0 * 50.0 )
+				{
+					first = j;
+				}
+
+				dT = fmax( 0.0, fmin( 1.0, (dE * (tEnd.dEast - tQuery.dEast) + dN * (tEnd.dNorth - tQuery.dNorth)) / dLength2 ) );
+				dE -= dT * (tEnd.dEast - tQuery.dEast);
+				dN -= dT * (tEnd.dNorth - tQuery.dNorth);
+				count += dE * dE + dN * dN <= 10.0 * 10.0;
+			}
+
+			INDEX_Nearest( &tIndex, &tQuery, 0.0, &dDist );
+			nearest += fabs( dDist - sqrt( dBest ) ) > 1e-6;
+			within += INDEX_FirstWithin( &tIndex, &tQuery, 50.0, i % CHECK_INDEX_POINTS ) != first;
+			track += INDEX_NearTrack( &tIndex, &tQuery, &tEnd, 10.0, aIds, 64, &dClosest ) != count;
+		}
+
+		INDEX_Free( &tIndex );
+	}
+
+	free( ptPos );
+
+	bOk &= Report( "INDEX nearest vs scan, mismatches", nearest, 0.0 );
+	bOk &= Report( "INDEX first within vs scan, mismatches", within, 0.0 );
+	bOk &= Report( "INDEX near track vs scan, mismatches", track, 0.0 );
+
+	return bOk;
+}
+
+//------------------------------------------------------------------------------
+// count points 10 km either way of home, or on survey lines north from home
+void LayOut( bool bLines, int count, tENU_POS *ptPos )
+{
+	int line;
+	int k;
+	int i;
+
+	for( i = 0; i < count; i++ )
+	{
+		if( bLines )
+		{
+			// Mown back and forth
+			line = i / CHECK_LINE_POINTS;
+			k = i % CHECK_LINE_POINTS;
+			ptPos[i].dEast = ((line & 1) ? CHECK_LINE_POINTS - 1 - k : k) * 5.0;
+			ptPos[i].dNorth = line * 20.0;
+		}
+		else
+		{
+			ptPos[i].dEast = drand48() * 20000.0 - 10000.0;
+			ptPos[i].dNorth = drand48() * 20000.0 - 10000.0;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// FENCE_Check() against a scan of every edge, in floats as the fence works.
+// On an edge, within a centimeter, either answer is a right one.
+bool CheckFence( void )
+{
+	static const int aEdges[] = { 16, 100, 1000 };
+	tFENCE tFence;
+	tENU_FRAME tFrame;
+	tENU_POS tPos;
+	tFENCE_STATUS tStatus;
+	float *pfEast;
+	float *pfNorth;
+	float fMargin;
+	double dMargin = 0.0;
+	bool bBreach;
+	int breach = 0;
+	int jagged;
+	int e;
+	int i;
+	int v;
+	bool bOk = true;
+
+	ENU_Init( &tFrame, CHECK_FENCE_LAT, CHECK_FENCE_LON );
+	srand48( 12 );
+
+	for( jagged = 0; jagged < 2; jagged++ )
+	{
+		for( e = 0; e < (int)(sizeof(aEdges) / sizeof(aEdges[0])); e++ )
+		{
+			if( !MakeFence( &tFence, jagged, aEdges[e] ) || !FENCE_SetFrame( &tFence, &tFrame ) )
+			{
+				return Report( "FENCE could not be made", 1.0, 0.0 );
+			}
+
+			// The vertices as FENCE_SetFrame() projects them
+			pfEast = (float *)malloc( tFence.vertexCount * sizeof(float) );
+			pfNorth = (float *)malloc( tFence.vertexCount * sizeof(float) );
+
+			for( v = 0; v < tFence.vertexCount; v++ )
+			{
+				ENU_FromGeodetic( &tFrame, tFence.ptVertices[v].s32Lat, tFence.ptVertices[v].s32Lon, &tPos );
+				pfEast[v] = tPos.dEast;
+				pfNorth[v] = tPos.dNorth;
+			}
+
+			for( i = 0; i < CHECK_FENCE_POINTS; i++ )
+			{
+				// Half anywhere over the fence, half near one of its vertices
+				if( i & 1 )
+				{
+					v = lrand48() % tFence.vertexCount;
+					tPos.dEast = pfEast[v] + (drand48() - 0.5) * 60.0;
+					tPos.dNorth = pfNorth[v] + (drand48() - 0.5) * 60.0;
+				}
+				else
+				{
+					tPos.dEast = (drand48() - 0.5) * 3600.0;
+					tPos.dNorth = (drand48() - 0.5) * 3600.0;
+				}
+
+				FENCE_Check( &tFence, &tPos, &tStatus );
+				bBreach = ScanFence( &tFence, pfEast, pfNorth, tPos.dEast, tPos.dNorth, &fMargin );
+
+				breach += tStatus.bBreach != bBreach && fMargin > 0.01f;
+				dMargin = max( dMargin, fabs( tStatus.fMargin - fMargin ) );
+			}
+
+			free( pfEast );
+			free( pfNorth );
+			FENCE_Close( &tFence );
+		}
+	}
+
+	bOk &= Report( "FENCE breach vs scan, mismatches", breach, 0.0 );
+	bOk &= Report( "FENCE margin vs scan, m", dMargin, 1e-3 );
+
+	return bOk;
+}
+
+//------------------------------------------------------------------------------
+// A keep-in ring of edges, about 3 km across, around a keep-out island of a
+// quarter as many. The ring is a shoreline, smooth but for 1 m of noise, or
+// jagged, every edge some 300 m tall: the worst case for the bands.
+bool MakeFence( tFENCE *ptFence, bool bJagged, int edges )
+{
+	char name[] = "/tmp/navcheckXXXXXX";
+	FILE *pFile;
+	double dAngle;
+	double dRadius;
+	double dCosLat = cos( CHECK_FENCE_LAT * RADIANS_PER_MILLIONTH );
+	bool bLoaded;
+	int island = max( edges / 4, 4 );
+	int i;
+
+	pFile = fdopen( mkstemp( name ), "w" );
+	if( pFile == NULL )
+	{
+		return false;
+	}
+
+	fprintf( pFile, "keepin\n" );
+
+	for( i = 0; i < edges; i++ )
+	{
+		dAngle = 2.0 * M_PI * i / edges;
+		dRadius = bJagged ? 1500.0 * (1.0 + 0.2 * (drand48() - 0.5))
+						  : 1500.0 + 150.0 * sin( 5.0 * dAngle ) + 60.0 * sin( 23.0 * dAngle + 1.0 )
+								   + 20.0 * sin( 97.0 * dAngle ) + drand48() - 0.5;
+		fprintf( pFile, "%.6f,%.6f\n", CHECK_FENCE_LAT / 1e6 + dRadius * cos( dAngle ) / METERS_PER_DEGREE,
+				 CHECK_FENCE_LON / 1e6 + dRadius * sin( dAngle ) / (METERS_PER_DEGREE * dCosLat) );
+	}
+
+	fprintf( pFile, "keepout\n" );
+
+	for( i = 0; i < island; i++ )
+	{
+		dAngle = 2.0 * M_PI * i / island;
+		dRadius = 300.0 * (1.0 + 0.3 * (drand48() - 0.5));
+		fprintf( pFile, "%.6f,%.6f\n", CHECK_FENCE_LAT / 1e6 + dRadius * cos( dAngle ) / METERS_PER_DEGREE,
+				 CHECK_FENCE_LON / 1e6 + dRadius * sin( dAngle ) / (METERS_PER_DEGREE * dCosLat) );
+	}
+
+	fclose( pFile );
+
+	bLoaded = FENCE_LoadFile( ptFence, name );
+	unlink( name );
+
+	return bLoaded;
+}
+
+//------------------------------------------------------------------------------
+// Breach by crossings and margin by the distance to every edge of every
+// polygon, the way Geofence.h describes them
+bool ScanFence( const tFENCE *ptFence, const float *pfEast, const float *pfNorth, float fEast, float fNorth,
+				float *pfMargin )
+{
+	const tFENCE_POLYGON *ptPolygon;
+	float fNearest2 = FENCE_MARGIN_M * FENCE_MARGIN_M;
+	float fE0, fN0, fE1, fN1;
+	float fDE, fDN, fLength2, fT;
+	bool bInKeepIn = false;
+	bool bBreach = false;
+	int crossings;
+	int a;
+	int b;
+	int i;
+	int v;
+
+	for( i = 0; i < ptFence->polygonCount; i++ )
+	{
+		ptPolygon = &ptFence->ptPolygons[i];
+		crossings = 0;
+
+		for( v = 0; v < ptPolygon->vertexCount; v++ )
+		{
+			a = ptPolygon->firstVertex + v;
+			b = ptPolygon->firstVertex + (v + 1) % ptPolygon->vertexCount;
+			fE0 = pfEast[a];
+			fN0 = pfNorth[a];
+			fE1 = pfEast[b];
+			fN1 = pfNorth[b];
+
+			if( (fN0 > fNorth) != (fN1 > fNorth) && fEast < fE0 + (fNorth - fN0) * ((fE1 - fE0) / (fN1 - fN0)) )
+			{
+				crossings++;
+			}
+
+			fDE = fE1 - fE0;
+			fDN = fN1 - fN0;
+			fLength2 = fDE * fDE + fDN * fDN;
+			fT = (fLength2 > 0.0f) ? ((fEast - fE0) * fDE + (fNorth - fN0) * fDN) / fLength2 : 0.0f;
+			fT = fmaxf( 0.0f, fminf( 1.0f, fT ) );
+			fNearest2 = fminf( fNearest2, sq( fEast - fE0 - fT * fDE ) + sq( fNorth - fN0 - fT * fDN ) );
+		}
+
+		if( crossings & 1 )
+		{
+			if( ptPolygon->bKeepOut )
+			{
+				bBreach = true;
+			}
+			else
+			{
+				bInKeepIn = true;
+			}
+		}
+	}
+
+	*pfMargin = sqrtf( fNearest2 );
+
+	return bBreach || (ptFence->keepInCount && !bInKeepIn);
+}
+
+//------------------------------------------------------------------------------
+// Two parsers fed the same stream, one a char at a time, one a block at a
+// time, compared after every block
+bool CheckEncode( void )
+{
+	char *pStream = (char *)malloc( CHECK_SENTENCES * 100 );
+	char *pEnd = pStream;
+	const char *p;
+	TinyGPS tChars;
+	TinyGPS tBlocks;
+	int charsValid = 0;
+	int blocksValid = 0;
+	int mismatches = 0;
+	int block;
+	int i;
+
+	srand48( 1 );
+
+	for( i = 0; i < CHECK_SENTENCES; i++ )
+	{
+		pEnd += Sentence( pEnd, i );
+	}
+
+	for( p = pStream; p < pEnd; p += block )
+	{
+		block = min( (int)(lrand48() % (CHECK_BLOCK_MAX + 1)), (int)(pEnd - p) );
+
+		for( i = 0; i < block; i++ )
+		{
+			charsValid += tChars.encode( p[i] );
+		}
+		blocksValid += tBlocks.encode( p, block );
+
+		mismatches += charsValid != blocksValid || !SameState( &tChars, &tBlocks );
+	}
+
+	free( pStream );
+
+	// Or it proved nothing
+	if( charsValid < CHECK_SENTENCES / 2 )
+	{
+		return Report( "TinyGPS valid sentences, short by", CHECK_SENTENCES / 2 - charsValid, 0.0 );
+	}
+
+	return Report( "TinyGPS bulk vs per char, mismatches", mismatches, 0.0 );
+}
+
+//------------------------------------------------------------------------------
+// Sentence i of a boat heading north east, RMC, GGA and GSV in turn. One in
+// 20 has a char changed, so fails its checksum, one in 50 is cut off.
+int Sentence( char *pBuf, int i )
+{
+	double dMinutes = 42.8844 + i * 1e-4;
+	int second = i / 3;
+	int time = (second / 3600 % 24) * 10000 + (second / 60 % 60) * 100 + second % 60;
+	int length;
+	U8 checksum = 0;
+	int k;
+
+	switch( i % 3 )
+	{
+		case 0:
+			length = sprintf( pBuf, "$GPRMC,%06d.00,A,33%07.4f,N,117%07.4f,W,%.1f,%.1f,170126,,,A",
+							  time, dMinutes, 48.1362 - i * 1e-4, 2.0 + i % 7 * 0.1, 45.0 + i % 11 );
+			break;
+
+		case 1:
+			length = sprintf( pBuf, "$GNGGA,%06d.00,33%07.4f,N,117%07.4f,W,1,%02d,%.1f,%.1f,M,-33.0,M,,",
+							  time, dMinutes, 48.1362 - i * 1e-4, 4 + i % 9, 0.8 + i % 5 * 0.1, 10.0 + i % 13 );
+			break;
+
+		default:
+			length = sprintf( pBuf, "$GPGSV,3,1,%d,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00", 9 + i % 4 );
+			break;
+	}
+
+	if( lrand48() % 50 == 0 )
+	{
+		return length - lrand48() % (length / 2);
+	}
+
+	for( k = 1; k < length; k++ )
+	{
+		checksum ^= pBuf[k];
+	}
+
+	if( lrand48() % 20 == 0 )
+	{
+		pBuf[1 + lrand48() % (length - 1)] ^= 0x01;
+	}
+
+	return length + sprintf( pBuf + length, "*%02X\r\n", checksum );
+}
+
+//------------------------------------------------------------------------------
+// Everything the parser has taken from the stream so far. Fix ages aren't,
+// they come from the clock.
+bool SameState( TinyGPS *ptA, TinyGPS *ptB )
+{
+	long alLat[2];
+	long alLon[2];
+	unsigned long au32Date[2];
+	unsigned long au32Time[2];
+	unsigned long au32Chars[2];
+	unsigned short au16Good[2];
+	unsigned short au16Failed[2];
+
+	ptA->get_position( &alLat[0], &alLon[0] );
+	ptB->get_position( &alLat[1], &alLon[1] );
+	ptA->get_datetime( &au32Date[0], &au32Time[0] );
+	ptB->get_datetime( &au32Date[1], &au32Time[1] );
+	ptA->stats( &au32Chars[0], &au16Good[0], &au16Failed[0] );
+	ptB->stats( &au32Chars[1], &au16Good[1], &au16Failed[1] );
+
+	return alLat[0] == alLat[1] && alLon[0] == alLon[1]
+		&& au32Date[0] == au32Date[1] && au32Time[0] == au32Time[1]
+		&& ptA->speed() == ptB->speed() && ptA->course() == ptB->course()
+		&& ptA->altitude() == ptB->altitude() && ptA->hdop() == ptB->hdop()
+		&& ptA->satellites() == ptB->satellites() && ptA->satellites_in_view() == ptB->satellites_in_view()
+		&& au32Chars[0] == au32Chars[1] && au16Good[0] == au16Good[1] && au16Failed[0] == au16Failed[1];
+}
+
+//------------------------------------------------------------------------------
+// A GpsReader on a pty's slave end, bursts written into the master, against
+// a parser fed the same chars one at a time. Each burst is read until the
+// reader has taken all of it, then the two are compared.
+bool CheckReader( void )
+{
+	char *pStream = (char *)malloc( CHECK_READER_SENTENCES * 100 );
+	char *pEnd = pStream;
+	const char *p;
+	GpsReader cReader;
+	TinyGPS tChars;
+	TinyGPS tRead;
+	unsigned long u32Chars = 0;
+	unsigned long u32Had;
+	unsigned long u32Want;
+	unsigned short u16Good;
+	unsigned short u16Failed;
+	int charsValid = 0;
+	int readValid = 0;
+	int mismatches = 0;
+	int master;
+	int slave;
+	int burst;
+	int status;
+	int i;
+
+	if( (master = OpenPty( &slave )) < 0 || !cReader.Attach( slave ) )
+	{
+		return Report( "GpsReader pty, unable to open", 1.0, 0.0 );
+	}
+
+	srand48( 2 );
+
+	for( i = 0; i < CHECK_READER_SENTENCES; i++ )
+	{
+		pEnd += Sentence( pEnd, i );
+	}
+
+	// Nothing written yet: a timeout
+	mismatches += cReader.Read( &tRead, 0 ) != 0;
+
+	for( p = pStream; p < pEnd; p += burst )
+	{
+		burst = min( (int)(1 + lrand48() % CHECK_BURST_MAX), (int)(pEnd - p) );
+
+		if( write( master, p, burst ) != burst )
+		{
+			mismatches++;
+			break;
+		}
+
+		for( i = 0; i < burst; i++ )
+		{
+			charsValid += tChars.encode( p[i] );
+		}
+
+		// A burst can come out in more than one read, a read need not end a
+		// sentence. Until all of it's taken, or a read times out taking none.
+		u32Want = p + burst - pStream;
+		do
+		{
+			u32Had = u32Chars;
+			if( (status = cReader.Read( &tRead, CHECK_READ_MS )) < 0 )
+			{
+				break;
+			}
+			readValid += status;
+			tRead.stats( &u32Chars, &u16Good, &u16Failed );
+		} while( u32Chars < u32Want && u32Chars > u32Had );
+
+		if( u32Chars != u32Want )
+		{
+			mismatches++;
+			break;
+		}
+
+		mismatches += charsValid != readValid || !SameState( &tChars, &tRead );
+	}
+
+	// The GPS end going away is an error, not a timeout
+	close( master );
+	mismatches += cReader.Read( &tRead, CHECK_READ_MS ) >= 0;
+
+	cReader.Close();
+	free( pStream );
+
+	// Or it proved nothing, unless it stopped early
+	if( mismatches == 0 && charsValid < CHECK_READER_SENTENCES / 2 )
+	{
+		return Report( "GpsReader valid sentences, short by", CHECK_READER_SENTENCES / 2 - charsValid, 0.0 );
+	}
+
+	return Report( "GpsReader pty vs per char, mismatches", mismatches, 0.0 );
+}
+
+//------------------------------------------------------------------------------
+// A pty pair, raw so line endings come through as they were written.
+// Returns the master, -1 if there isn't one.
+int OpenPty( int *pSlave )
+{
+	struct termios tOptions;
+	const char *pName;
+	int fd;
+
+	if( (fd = posix_openpt( O_RDWR | O_NOCTTY )) < 0 )
+	{
+		return -1;
+	}
+
+	if( grantpt( fd ) < 0 || unlockpt( fd ) < 0 || !(pName = ptsname( fd ))
+		|| (*pSlave = open( pName, O_RDWR | O_NOCTTY )) < 0 )
+	{
+		close( fd );
+		return -1;
+	}
+
+	if( tcgetattr( *pSlave, &tOptions ) == 0 )
+	{
+		cfmakeraw( &tOptions );
+		tcsetattr( *pSlave, TCSANOW, &tOptions );
+	}
+
+	return fd;
+}
+
+//------------------------------------------------------------------------------
+// A point uniformly within dRadius meters (roughly) of lat0, lon0
+void RandomNear( long lat0, long lon0, double dRadius, long *plLat, long *plLon )
+{
+	double dRange = dRadius * sqrt( drand48() );
+	double dBearing = drand48() * 2.0 * M_PI;
+
+	*plLat = lat0 + (long)(dRange * cos( dBearing ) / METERS_PER_DEGREE * 1e6);
+	*plLon = lon0 + (long)(dRange * sin( dBearing ) / (METERS_PER_DEGREE * cos( lat0 * RADIANS_PER_MILLIONTH )) * 1e6);
+}
+
+//------------------------------------------------------------------------------
+// The textbook local tangent plane: both points to ECEF with libm trig, and
+// the difference rotated to the anchor
+void TrigEnu( long lat0, long lon0, long lat, long lon, tENU_POS *ptPos )
+{
+	double dPhi = lat0 * RADIANS_PER_MILLIONTH;
+	double dLambda = lon0 * RADIANS_PER_MILLIONTH;
+	double x0, y0, z0;
+	double x, y, z;
+
+	Ecef( lat0, lon0, &x0, &y0, &z0 );
+	Ecef( lat, lon, &x, &y, &z );
+
+	x -= x0;
+	y -= y0;
+	z -= z0;
+
+	ptPos->dEast = -sin( dLambda ) * x + cos( dLambda ) * y;
+	ptPos->dNorth = -sin( dPhi ) * cos( dLambda ) * x - sin( dPhi ) * sin( dLambda ) * y + cos( dPhi ) * z;
+}
+
+//------------------------------------------------------------------------------
+void Ecef( long lat, long lon, double *pdX, double *pdY, double *pdZ )
+{
+	double e2 = WGS84_F * (2.0 - WGS84_F);
+	double dPhi = lat * RADIANS_PER_MILLIONTH;
+	double dLambda = lon * RADIANS_PER_MILLIONTH;
+	double n = WGS84_A / sqrt( 1.0 - e2 * sin( dPhi ) * sin( dPhi ) );
+
+	*pdX = n * cos( dPhi ) * cos( dLambda );
+	*pdY = n * cos( dPhi ) * sin( dLambda );
+	*pdZ = n * (1.0 - e2) * sin( dPhi );
+}
+
+//------------------------------------------------------------------------------
+// Distance (m) and initial course (degrees) on the sphere Geodesy uses
+void Haversine( long lat1, long lon1, long lat2, long lon2, double *pdDist, double *pdCourse )
+{
+	double dPhi1 = lat1 * RADIANS_PER_MILLIONTH;
+	double dPhi2 = lat2 * RADIANS_PER_MILLIONTH;
+	double dLambda = (lon2 - lon1) * RADIANS_PER_MILLIONTH;
+	double dHav = sq( sin( (dPhi2 - dPhi1) / 2.0 ) ) + cos( dPhi1 ) * cos( dPhi2 ) * sq( sin( dLambda / 2.0 ) );
+
+	*pdDist = 2.0 * GEO_EARTH_RADIUS_M * atan2( sqrt( dHav ), sqrt( 1.0 - dHav ) );
+	*pdCourse = atan2( sin( dLambda ) * cos( dPhi2 ),
+					   cos( dPhi1 ) * sin( dPhi2 ) - sin( dPhi1 ) * cos( dPhi2 ) * cos( dLambda ) ) / DEG_TO_RAD;
+}
+
+//------------------------------------------------------------------------------
+// Degrees between two bearings the shortest way round
+double BearingError( double dA, double dB )
+{
+	return fabs( remainder( dA - dB, 360.0 ) );
+}
+
+//------------------------------------------------------------------------------
+bool Report( const char *pName, double dWorst, double dBound )
+{
+	bool bOk = dWorst <= dBound;
+
+	printf( "%-38s %12.3g %12.3g%s\n", pName, dWorst, dBound, bOk ? "" : "  OVER" );
+
+	return bOk;
+}
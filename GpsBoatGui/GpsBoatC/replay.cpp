@@ -0,0 +1,1013 @@
+// replay.cpp
+// Plays a recorded NMEA log, or a flight recording, through the boat's own
+// GPS thread and nav loop, Autopilot.cpp as gpsboat runs them, on a PC on
+// virtual time (see VClock.h):
+//
+//   make replay
+//   replay [-v] [-x factor] [-r flight.rec] [-f fence.csv] track.nmea|run.rec [mission.route]
+//     -v             show the nav loop's own output
+//     -x factor      times real time, 0 == as fast as it goes (0)
+//     -r file        flight recording of the replay (see Recorder.h)
+//
+// A log's sentences go down a pipe to the GPS thread a second apart by their
+// GGA/RMC time, as the GPS sent them, and the compass answers with the log's
+// RMC course. Nothing really waits, so an hour's log takes seconds. Every
+// state change is printed with its time into the log, then a checksum of
+// them all: the same log and route always give the same one.
+//
+// A flight recording from gpsboat -r is played as it was recorded: its
+// sentences when they were read, the compass answering with the readings
+// taken (or not answering, where they failed) and the nav loop ticking when
+// it ticked. The rudder and speed settings the replay makes are then checked
+// against the recorded ones and the first that differs is shown, so a run
+// from the water makes a regression test for the parser and the steering.
+// Exit status 2 if they differ. Give the route and fence the boat had.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "includes.h"
+#include "config.h"
+#include "Hal.h"
+#include "VClock.h"
+#include "Route.h"
+#include "Geofence.h"
+#include "Autopilot.h"
+#include "Recorder.h"
+#include "Sched.h"
+#include "HMC6343.h"
+
+//-------------------------------------------
+// Local defines
+
+#define REPLAY_GPS_DEVICE		"/dev/ttyAMA0"
+#define REPLAY_COMPASS_DEVICE	"/dev/ttyUSB0"
+#define REPLAY_TAIL_MS			5000		// run on after the log ends
+#define REPLAY_LINE_SIZE		256
+#define REPLAY_FRAME_SIZE		32
+#define REPLAY_COMPASS_MS		6			// into a tick its compass reading is taken
+#define REPLAY_TEMP_FILE		"/tmp/replayXXXXXX"
+
+#define REPLAY_TYPE(e)			(1u << (e))
+#define REPLAY_SETTINGS			(REPLAY_TYPE( E_REC_RUDDER ) | REPLAY_TYPE( E_REC_SPEED ))
+
+#define FNV_OFFSET				2166136261u
+#define FNV_PRIME				16777619u
+
+//-------------------------------------------
+// Local types
+
+// A flight recording, read whole
+typedef struct
+{
+	const U8 *pData;
+	uint64_t u64TimeUs;
+	U16 u16Size;
+	U8 u8Type;
+} tREC_EVENT;
+
+typedef struct
+{
+	U8 *pFile;
+	tREC_EVENT *ptEvents;		// in file order
+	int count;
+} tRECORDING;
+
+// Log player, feeds the GPS pipe
+typedef struct
+{
+	FILE *fp;					// an NMEA log, or
+	const tRECORDING *ptRecording;
+	int64_t s64OffsetUs;		// recording time to virtual time
+	int fd;						// write end of the GPS pipe
+	U32 u32Sentences;
+	U32 u32LogMs;				// log time played, first sentence to last
+	float fCourse;				// last RMC course, true
+	bool bDone;
+} tPLAYER;
+
+// SC18IM700 bridge, in front of a compass that reads the player's course
+typedef struct
+{
+	int fd;						// our end of the compass socket
+	const tPLAYER *ptPlayer;
+	U8 au8Frame[REPLAY_FRAME_SIZE];
+	int frameLength;
+	U8 au8Reply[HMC6343__GET_HEADING_DATA__DATA_SIZE];
+	int replyLength;
+	int compass;				// recorded reading last answered with
+	U32 u32Reads;
+} tBRIDGE;
+
+//-------------------------------------------
+// Local prototypes
+
+static void		*Player( void *pArg );
+static void		*RecordingPlayer( void *pArg );
+static void		*Bridge( void *pArg );
+static void		BridgeFrame( tBRIDGE *ptBridge );
+static S16		RecordedHeading( tBRIDGE *ptBridge );
+static bool		WaitForTick( const tPLAYER *ptPlayer, int *pTick );
+static bool		IsRecording( const char *pFileName );
+static bool		LoadRecording( tRECORDING *ptRecording, const char *pFileName );
+static void		FreeRecording( tRECORDING *ptRecording );
+static int		FindEvent( const tRECORDING *ptRecording, int from, U32 u32Types );
+static bool		CompareSettings( FILE *fp, const tRECORDING *ptRecorded, const tRECORDING *ptReplayed,
+								 const tPLAYER *ptPlayer, U32 u32Start );
+static bool		SentenceSeconds( const char *pLine, long *plSeconds );
+static bool		GetField( const char *pLine, int field, char *pOut, int size );
+static bool		LoadMission( tROUTE *ptRoute, tFENCE *ptFence );
+static U32		Transition( FILE *fp, U32 u32Hash, const char *pFormat, ... );
+static double	WallNow( void );
+static void		Usage( void );
+
+//-------------------------------------------
+// Local data
+
+static const char *gpRouteFile = NULL;
+static const char *gpFenceFile = NULL;
+static const char *gpRecording = NULL;
+
+//------------------------------------------------------------------------------
+int main( int argc, char **argv )
+{
+	tAUTOPILOT_CONFIG tConfig;
+	tAUTOPILOT tAp;
+	tPLAYER tPlayer;
+	tBRIDGE tBridge;
+	tSCHED tSched;
+	tRECORDING tRecorded;
+	tRECORDING tReplayed;
+	tHAL_THREAD tPlayerThread;
+	tHAL_THREAD tBridgeThread;
+	E_NAV_STATE eLastState;
+	char acTempFile[] = REPLAY_TEMP_FILE;
+	const char *pRecordTo;
+	int lastWP;
+	int tick = -1;
+	int aiGps[2];
+	int aiCompass[2];
+	int fd;
+	bool bVerbose = false;
+	bool bLocked = false;
+	bool bSame = true;
+	U32 u32Hash = FNV_OFFSET;
+	U32 u32Transitions = 0;
+	U32 u32Start;
+	U32 u32End = 0;
+	double dPace = 0.0;
+	double dWall;
+	FILE *fpOut;
+	int opt;
+
+	while( (opt = getopt( argc, argv, "f:r:vx:" )) != -1 )
+	{
+		switch( opt )
+		{
+		case 'f':	gpFenceFile = optarg;		break;
+		case 'r':	gpRecording = optarg;		break;
+		case 'v':	bVerbose = true;			break;
+		case 'x':	dPace = atof( optarg );		break;
+		default:	Usage();					return 1;
+		}
+	}
+
+	if( optind >= argc )
+	{
+		Usage();
+		return 1;
+	}
+
+	memset( &tPlayer, 0, sizeof(tPlayer) );
+	memset( &tBridge, 0, sizeof(tBridge) );
+	memset( &tRecorded, 0, sizeof(tRecorded) );
+	memset( &tReplayed, 0, sizeof(tReplayed) );
+
+	if( IsRecording( argv[optind] ) )
+	{
+		if( !LoadRecording( &tRecorded, argv[optind] ) )
+		{
+			return 1;
+		}
+		tPlayer.ptRecording = &tRecorded;
+	}
+	else if( !(tPlayer.fp = fopen( argv[optind], "r" )) )
+	{
+		fprintf (stderr, "Unable to open %s: %s\n", argv[optind], strerror (errno)) ;
+		return 1;
+	}
+
+	if( optind + 1 < argc )
+	{
+		gpRouteFile = argv[optind + 1];
+	}
+
+	// A recording's replay is recorded too, to check it against
+	pRecordTo = gpRecording;
+	if( tPlayer.ptRecording && !pRecordTo )
+	{
+		if( (fd = mkstemp( acTempFile )) < 0 )
+		{
+			fprintf (stderr, "Unable to make %s: %s\n", acTempFile, strerror (errno)) ;
+			return 1;
+		}
+		close( fd );
+		pRecordTo = acTempFile;
+	}
+
+	// The GPS reads a pipe, the compass bridge is a socket, both filled by
+	// threads the virtual clock runs
+	if( pipe( aiGps ) < 0 || socketpair( AF_UNIX, SOCK_STREAM, 0, aiCompass ) < 0 )
+	{
+		fprintf (stderr, "Unable to make the ports: %s\n", strerror (errno)) ;
+		return 1;
+	}
+
+	HAL_HostSerialBind( REPLAY_GPS_DEVICE, aiGps[0] );
+	HAL_HostSerialBind( REPLAY_COMPASS_DEVICE, aiCompass[0] );
+
+	tPlayer.fd = aiGps[1];
+	tBridge.fd = aiCompass[1];
+	tBridge.ptPlayer = &tPlayer;
+	tBridge.compass = -1;
+
+	// The drivers' printing goes to /dev/null, and the nav loop's own unless
+	// asked for
+	fpOut = fdopen( dup( fileno( stdout ) ), "w" );
+	setvbuf( fpOut, NULL, _IOLBF, 0 );
+
+	AUTOPILOT_DefaultConfig( &tConfig );
+	tConfig.pGpsDevice = REPLAY_GPS_DEVICE;
+	tConfig.pCompassDevice = REPLAY_COMPASS_DEVICE;
+	tConfig.bGpsThread = true;
+
+	if( bVerbose )
+	{
+		tConfig.fpLog = stdout;
+	}
+	else if( !freopen( "/dev/null", "w", stdout ) )
+	{
+		return 1;
+	}
+
+	dWall = WallNow();
+
+	if( !HAL_Init() || !VCLOCK_Start( 0 ) )
+	{
+		return 1;
+	}
+
+	AUTOPILOT_Init( &tAp, &tConfig );
+
+	if( !HAL_ThreadCreate( &tBridgeThread, Bridge, &tBridge ) )
+	{
+		VCLOCK_Stop();
+		return 1;
+	}
+
+	if( !LoadMission( &tAp.tRoute, &tAp.tFence ) || !AUTOPILOT_Setup( &tAp )
+		|| (pRecordTo && !RECORDER_Open( pRecordTo )) )
+	{
+		AUTOPILOT_Close( &tAp );
+		HAL_ThreadStop( tBridgeThread );
+		VCLOCK_Stop();
+		if( pRecordTo == acTempFile )
+		{
+			unlink( acTempFile );
+		}
+		return 1;
+	}
+
+	fprintf( fpOut, "replay: %s, %i waypoints\n", argv[optind], tAp.tRoute.count );
+
+	// The log starts once the boat is up, as gpsboat's loop does
+	VCLOCK_SetPace( dPace );
+	u32Start = HAL_Millis();
+
+	// A recording's first tick lands where gpsboat's first would, 3 s in
+	if( tPlayer.ptRecording )
+	{
+		if( (tick = FindEvent( &tRecorded, 0, REPLAY_TYPE( E_REC_COMPASS ) )) >= 0 )
+		{
+			tPlayer.s64OffsetUs = (u32Start + 3000 + REPLAY_COMPASS_MS) * 1000LL - (int64_t)tRecorded.ptEvents[tick].u64TimeUs;
+		}
+		else
+		{
+			tPlayer.s64OffsetUs = u32Start * 1000LL - (int64_t)tRecorded.ptEvents[0].u64TimeUs;
+		}
+	}
+
+	if( !HAL_ThreadCreate( &tPlayerThread, tPlayer.ptRecording ? RecordingPlayer : Player, &tPlayer ) )
+	{
+		RECORDER_Close();
+		AUTOPILOT_Close( &tAp );
+		HAL_ThreadStop( tBridgeThread );
+		VCLOCK_Stop();
+		if( pRecordTo == acTempFile )
+		{
+			unlink( acTempFile );
+		}
+		return 1;
+	}
+
+	if( !tPlayer.ptRecording )
+	{
+		HAL_Delay( 3000 );
+	}
+
+	eLastState = tAp.eNavState;
+	lastWP = tAp.targetWP;
+
+	SCHED_Init( &tSched, CONTROL_RATE_HZ, 0 );
+
+	// A recording's ticks come when they came and stop where it did, a log's
+	// come at gpsboat's rate until a while after it ends
+	while( tPlayer.ptRecording ? WaitForTick( &tPlayer, &tick ) : (!tPlayer.bDone || HAL_Millis() < u32End) )
+	{
+		if( !tPlayer.ptRecording )
+		{
+			SCHED_Wait( &tSched );
+		}
+
+		AUTOPILOT_Tick( &tAp );
+
+		if( tAp.tGpsInfo.bGpsLocked && !bLocked )
+		{
+			u32Hash = Transition( fpOut, u32Hash, "%10.1f s  GPS lock\n", (HAL_Millis() - u32Start) / 1000.0 );
+			bLocked = true;
+			u32Transitions++;
+		}
+
+		if( tAp.eNavState != eLastState || tAp.targetWP != lastWP )
+		{
+			u32Hash = Transition( fpOut, u32Hash, "%10.1f s  %-26s waypoint %i\n", (HAL_Millis() - u32Start) / 1000.0,
+								  AUTOPILOT_StateName( tAp.eNavState ), tAp.targetWP );
+			eLastState = tAp.eNavState;
+			lastWP = tAp.targetWP;
+			u32Transitions++;
+		}
+
+		if( tPlayer.bDone && !u32End )
+		{
+			u32End = HAL_Millis() + REPLAY_TAIL_MS;
+		}
+	}
+
+	// Sentences after a recording's last tick are never read
+	if( tPlayer.ptRecording )
+	{
+		tPlayer.u32LogMs = HAL_Millis() - u32Start;
+	}
+
+	AUTOPILOT_Close( &tAp );
+	HAL_ThreadStop( tPlayerThread );
+	HAL_ThreadStop( tBridgeThread );
+	RECORDER_Close();
+
+	dWall = WallNow() - dWall;
+
+	fprintf( fpOut, "\n%lu sentences, %.1f s of log replayed in %.3f s wall, %.1fx real time\n", tPlayer.u32Sentences,
+			 tPlayer.u32LogMs / 1000.0, dWall, tPlayer.u32LogMs / 1000.0 / dWall );
+	fprintf( fpOut, "%lu state changes, checksum %08lx; %lu compass reads, %lu thread switches\n", u32Transitions,
+			 u32Hash, tBridge.u32Reads, VCLOCK_Switches() );
+	fprintf( fpOut, "\n" );
+	AUTOPILOT_PrintProfile( &tAp, fpOut );
+
+	if( tPlayer.ptRecording )
+	{
+		bSame = LoadRecording( &tReplayed, pRecordTo )
+				&& CompareSettings( fpOut, &tRecorded, &tReplayed, &tPlayer, u32Start );
+
+		FreeRecording( &tReplayed );
+		FreeRecording( &tRecorded );
+
+		if( pRecordTo == acTempFile )
+		{
+			unlink( acTempFile );
+		}
+	}
+
+	VCLOCK_Stop();
+
+	close( aiGps[1] );
+	close( aiCompass[1] );
+
+	if( tPlayer.fp )
+	{
+		fclose( tPlayer.fp );
+	}
+
+	return bSame ? 0 : 2;
+}
+
+//------------------------------------------------------------------------------
+// Writes the log to the GPS pipe, each second's sentences when their time
+// comes. The pipe stays open after the last, an EOF would wake the GPS
+// thread for good.
+void *Player( void *pArg )
+{
+	tPLAYER *ptPlayer = (tPLAYER *)pArg;
+	char acLine[REPLAY_LINE_SIZE];
+	char acField[16];
+	long lSeconds;
+	long lLast = -1;
+	long lDelta;
+	U32 u32Due = HAL_Millis();
+	U32 u32First = u32Due;
+	U32 u32Now;
+	int length;
+
+	while( fgets( acLine, sizeof(acLine), ptPlayer->fp ) )
+	{
+		// A new second starts a new burst
+		if( SentenceSeconds( acLine, &lSeconds ) )
+		{
+			if( lLast >= 0 && lSeconds != lLast )
+			{
+				lDelta = lSeconds - lLast;
+				if( lDelta < 0 )
+				{
+					lDelta += 24 * 3600;		// past midnight
+				}
+				u32Due += lDelta * 1000;
+			}
+			lLast = lSeconds;
+
+			if( (u32Now = HAL_Millis()) < u32Due )
+			{
+				HAL_Delay( u32Due - u32Now );
+			}
+		}
+
+		if( !strncmp( acLine + 3, "RMC,", 4 ) && GetField( acLine, 8, acField, sizeof(acField) ) && acField[0] )
+		{
+			ptPlayer->fCourse = atof( acField );
+		}
+
+		length = strlen( acLine );
+		if( write( ptPlayer->fd, acLine, length ) != length )
+		{
+			fprintf (stderr, "Unable to write the GPS pipe: %s\n", strerror (errno)) ;
+			break;
+		}
+
+		ptPlayer->u32Sentences++;
+	}
+
+	ptPlayer->u32LogMs = u32Due - u32First;
+	ptPlayer->bDone = true;
+
+	return NULL;
+}
+
+//------------------------------------------------------------------------------
+// Writes a recording's sentences to the GPS pipe at the times they were read,
+// the same reads together. The pipe stays open after the last, as Player()'s.
+void *RecordingPlayer( void *pArg )
+{
+	tPLAYER *ptPlayer = (tPLAYER *)pArg;
+	const tRECORDING *ptRecording = ptPlayer->ptRecording;
+	const tREC_EVENT *ptEvent;
+	int64_t s64DueUs;
+	int64_t s64NowUs;
+	int i;
+
+	for( i = FindEvent( ptRecording, 0, REPLAY_TYPE( E_REC_NMEA ) ); i >= 0;
+		 i = FindEvent( ptRecording, i + 1, REPLAY_TYPE( E_REC_NMEA ) ) )
+	{
+		ptEvent = &ptRecording->ptEvents[i];
+		s64DueUs = (int64_t)ptEvent->u64TimeUs + ptPlayer->s64OffsetUs;
+
+		if( (s64NowUs = HAL_Micros()) < s64DueUs )
+		{
+			HAL_Delay( (s64DueUs - s64NowUs + 999) / 1000 );
+		}
+
+		if( write( ptPlayer->fd, ptEvent->pData, ptEvent->u16Size ) != ptEvent->u16Size )
+		{
+			fprintf (stderr, "Unable to write the GPS pipe: %s\n", strerror (errno)) ;
+			break;
+		}
+
+		ptPlayer->u32Sentences++;
+	}
+
+	ptPlayer->bDone = true;
+
+	return NULL;
+}
+
+//------------------------------------------------------------------------------
+// Answers HMC6343.cpp's frames on the compass socket
+void *Bridge( void *pArg )
+{
+	tBRIDGE *ptBridge = (tBRIDGE *)pArg;
+	U8 au8Buffer[64];
+	int count;
+	int frameSize;
+	int i;
+
+	while( true )
+	{
+		if( HAL_WaitFd( ptBridge->fd, -1 ) <= 0 )
+		{
+			continue;
+		}
+
+		if( (count = read( ptBridge->fd, au8Buffer, sizeof(au8Buffer) )) <= 0 )
+		{
+			break;
+		}
+
+		for( i = 0; i < count; i++ )
+		{
+			// Resync on the start byte
+			if( ptBridge->frameLength == 0 && au8Buffer[i] != 'S' )
+			{
+				continue;
+			}
+
+			ptBridge->au8Frame[ptBridge->frameLength++] = au8Buffer[i];
+
+			if( ptBridge->frameLength < 3 )
+			{
+				continue;
+			}
+
+			// Read frames are S addr len P, write frames S addr len data... P
+			frameSize = (ptBridge->au8Frame[1] & 0x01) ? 4 : ptBridge->au8Frame[2] + 3;
+
+			if( frameSize > REPLAY_FRAME_SIZE )
+			{
+				ptBridge->frameLength = 0;
+			}
+			else if( ptBridge->frameLength >= frameSize )
+			{
+				BridgeFrame( ptBridge );
+				ptBridge->frameLength = 0;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+//------------------------------------------------------------------------------
+// A whole frame: write frames run the command, read frames get its answer
+void BridgeFrame( tBRIDGE *ptBridge )
+{
+	const U8 *pFrame = ptBridge->au8Frame;
+	U16 u16Tenths;
+	S16 s16Raw;
+	int length;
+
+	if( pFrame[1] & 0x01 )
+	{
+		length = min( (int)pFrame[2], ptBridge->replyLength );
+
+		if( length > 0 && write( ptBridge->fd, ptBridge->au8Reply, length ) != length )
+		{
+			fprintf (stderr, "Unable to write the compass socket: %s\n", strerror (errno)) ;
+		}
+		return;
+	}
+
+	memset( ptBridge->au8Reply, 0, sizeof(ptBridge->au8Reply) );
+	ptBridge->replyLength = 0;
+
+	switch( pFrame[3] )
+	{
+	case HMC6343__GET_HEADING_DATA__CMD:
+		if( ptBridge->ptPlayer->ptRecording )
+		{
+			// A reading that failed on the boat fails here too, unanswered
+			if( (s16Raw = RecordedHeading( ptBridge )) < 0 )
+			{
+				break;
+			}
+			u16Tenths = s16Raw;
+		}
+		else
+		{
+			// Magnetic: GetCompassHeading() takes MAG_VAR back off
+			u16Tenths = (U16)(fmod( ptBridge->ptPlayer->fCourse + MAG_VAR + 360.0, 360.0 ) * 10.0 + 0.5) % 3600;
+		}
+		ptBridge->au8Reply[0] = u16Tenths >> 8;
+		ptBridge->au8Reply[1] = u16Tenths & 0xFF;
+		ptBridge->replyLength = HMC6343__GET_HEADING_DATA__DATA_SIZE;
+		ptBridge->u32Reads++;
+		break;
+
+	case HMC6343__READ_EEPROM__CMD:
+		ptBridge->replyLength = HMC6343__READ_EEPROM__DATA_SIZE;
+		break;
+
+	default:
+		break;
+	}
+}
+
+//------------------------------------------------------------------------------
+// The recorded compass reading nearest now, -1 if there's none or it failed
+S16 RecordedHeading( tBRIDGE *ptBridge )
+{
+	const tPLAYER *ptPlayer = ptBridge->ptPlayer;
+	const tRECORDING *ptRecording = ptPlayer->ptRecording;
+	const U32 u32Types = REPLAY_TYPE( E_REC_COMPASS );
+	tREC_COMPASS tCompass;
+	int64_t s64NowUs = (int64_t)HAL_Micros() - ptPlayer->s64OffsetUs;
+	int next;
+
+	if( ptBridge->compass < 0 && (ptBridge->compass = FindEvent( ptRecording, 0, u32Types )) < 0 )
+	{
+		return -1;
+	}
+
+	// Time only goes forward, so does the reading
+	while( (next = FindEvent( ptRecording, ptBridge->compass + 1, u32Types )) >= 0
+		   && llabs( (int64_t)ptRecording->ptEvents[next].u64TimeUs - s64NowUs )
+			  <= llabs( (int64_t)ptRecording->ptEvents[ptBridge->compass].u64TimeUs - s64NowUs ) )
+	{
+		ptBridge->compass = next;
+	}
+
+	if( ptRecording->ptEvents[ptBridge->compass].u16Size < sizeof(tCompass) )
+	{
+		return -1;
+	}
+
+	memcpy( &tCompass, ptRecording->ptEvents[ptBridge->compass].pData, sizeof(tCompass) );
+
+	return tCompass.s16Raw;
+}
+
+//------------------------------------------------------------------------------
+// Waits for the recording's tick at *pTick, which moves on to the next.
+// Returns false once they're all done.
+bool WaitForTick( const tPLAYER *ptPlayer, int *pTick )
+{
+	const tRECORDING *ptRecording = ptPlayer->ptRecording;
+	int64_t s64DueUs;
+	int64_t s64NowUs;
+
+	if( *pTick < 0 )
+	{
+		return false;
+	}
+
+	// The tick started a compass read before it was recorded
+	s64DueUs = (int64_t)ptRecording->ptEvents[*pTick].u64TimeUs + ptPlayer->s64OffsetUs - REPLAY_COMPASS_MS * 1000;
+	*pTick = FindEvent( ptRecording, *pTick + 1, REPLAY_TYPE( E_REC_COMPASS ) );
+
+	if( (s64NowUs = HAL_Micros()) < s64DueUs )
+	{
+		HAL_Delay( (s64DueUs - s64NowUs + 999) / 1000 );
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// True if the file starts like a flight recording
+bool IsRecording( const char *pFileName )
+{
+	tREC_FILE_HEADER tHeader;
+	FILE *fp;
+	bool bRecording;
+
+	if( !(fp = fopen( pFileName, "rb" )) )
+	{
+		return false;
+	}
+
+	bRecording = fread( &tHeader, sizeof(tHeader), 1, fp ) == 1 && tHeader.u32Magic == REC_FILE_MAGIC;
+
+	fclose( fp );
+
+	return bRecording;
+}
+
+//------------------------------------------------------------------------------
+// Reads a whole flight recording and indexes its records. A record cut short
+// at the end, as a boat losing power leaves it, is left off.
+bool LoadRecording( tRECORDING *ptRecording, const char *pFileName )
+{
+	tREC_FILE_HEADER tFileHeader;
+	tREC_HEADER tHeader;
+	tREC_EVENT *ptEvents;
+	FILE *fp;
+	long size;
+	long offset;
+	int capacity = 0;
+
+	memset( ptRecording, 0, sizeof(tRECORDING) );
+
+	if( !(fp = fopen( pFileName, "rb" )) )
+	{
+		fprintf (stderr, "Unable to open %s: %s\n", pFileName, strerror (errno)) ;
+		return false;
+	}
+
+	if( fseek( fp, 0, SEEK_END ) < 0 || (size = ftell( fp )) < 0 || fseek( fp, 0, SEEK_SET ) < 0
+		|| !(ptRecording->pFile = (U8 *)malloc( size + 1 ))
+		|| (long)fread( ptRecording->pFile, 1, size, fp ) != size )
+	{
+		fprintf (stderr, "Unable to read %s: %s\n", pFileName, strerror (errno)) ;
+		fclose( fp );
+		FreeRecording( ptRecording );
+		return false;
+	}
+
+	fclose( fp );
+
+	if( size < (long)sizeof(tFileHeader) )
+	{
+		fprintf( stderr, "%s is not a flight recording\n", pFileName );
+		FreeRecording( ptRecording );
+		return false;
+	}
+
+	memcpy( &tFileHeader, ptRecording->pFile, sizeof(tFileHeader) );
+
+	if( tFileHeader.u32Magic != REC_FILE_MAGIC || tFileHeader.u16Version != REC_FILE_VERSION
+		|| tFileHeader.u16HeaderSize != sizeof(tREC_HEADER) )
+	{
+		fprintf( stderr, "%s is not a version %i flight recording\n", pFileName, REC_FILE_VERSION );
+		FreeRecording( ptRecording );
+		return false;
+	}
+
+	// Records aren't aligned in the file, so headers are copied out
+	for( offset = sizeof(tFileHeader); offset + (long)sizeof(tHeader) <= size; offset += sizeof(tHeader) + tHeader.u16Size )
+	{
+		memcpy( &tHeader, ptRecording->pFile + offset, sizeof(tHeader) );
+
+		if( offset + (long)sizeof(tHeader) + tHeader.u16Size > size )
+		{
+			break;
+		}
+
+		if( ptRecording->count == capacity )
+		{
+			capacity = capacity ? capacity * 2 : 1024;
+
+			if( !(ptEvents = (tREC_EVENT *)realloc( ptRecording->ptEvents, capacity * sizeof(tREC_EVENT) )) )
+			{
+				fprintf (stderr, "Unable to index %s: %s\n", pFileName, strerror (errno)) ;
+				FreeRecording( ptRecording );
+				return false;
+			}
+			ptRecording->ptEvents = ptEvents;
+		}
+
+		ptEvents = &ptRecording->ptEvents[ptRecording->count++];
+		ptEvents->pData = ptRecording->pFile + offset + sizeof(tHeader);
+		ptEvents->u64TimeUs = tHeader.u64TimeUs;
+		ptEvents->u16Size = tHeader.u16Size;
+		ptEvents->u8Type = tHeader.u8Type;
+	}
+
+	if( ptRecording->count == 0 )
+	{
+		fprintf( stderr, "%s has nothing recorded\n", pFileName );
+		FreeRecording( ptRecording );
+		return false;
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+void FreeRecording( tRECORDING *ptRecording )
+{
+	free( ptRecording->ptEvents );
+	free( ptRecording->pFile );
+	memset( ptRecording, 0, sizeof(tRECORDING) );
+}
+
+//------------------------------------------------------------------------------
+// Index of the first record from 'from' on of one of the REPLAY_TYPE()s
+// given, -1 if there's none. Each type's records are in time order.
+int FindEvent( const tRECORDING *ptRecording, int from, U32 u32Types )
+{
+	for( ; from < ptRecording->count; from++ )
+	{
+		if( u32Types & REPLAY_TYPE( ptRecording->ptEvents[from].u8Type ) )
+		{
+			return from;
+		}
+	}
+
+	return -1;
+}
+
+//------------------------------------------------------------------------------
+// Checks the rudder and speed settings replayed against those recorded, one
+// for one in order, and prints how they went. Returns true if they're the
+// same.
+bool CompareSettings( FILE *fp, const tRECORDING *ptRecorded, const tRECORDING *ptReplayed,
+					  const tPLAYER *ptPlayer, U32 u32Start )
+{
+	static const char *apNames[E_REC_MAX] = { NULL, NULL, NULL, NULL, NULL, "rudder", "speed" };
+	const tREC_EVENT *ptWas;
+	const tREC_EVENT *ptNow;
+	tREC_SETTING tWas;
+	tREC_SETTING tNow;
+	int was = FindEvent( ptRecorded, 0, REPLAY_SETTINGS );
+	int now = FindEvent( ptReplayed, 0, REPLAY_SETTINGS );
+	int recorded = 0;
+	int replayed = 0;
+	int same = 0;
+	bool bSame = true;
+	double dSkew;
+	double dSkewMax = 0.0;
+
+	while( was >= 0 || now >= 0 )
+	{
+		if( bSame )
+		{
+			ptWas = was >= 0 ? &ptRecorded->ptEvents[was] : NULL;
+			ptNow = now >= 0 ? &ptReplayed->ptEvents[now] : NULL;
+
+			memset( &tWas, 0, sizeof(tWas) );
+			memset( &tNow, 0, sizeof(tNow) );
+
+			if( ptWas )
+			{
+				memcpy( &tWas, ptWas->pData, min( (int)ptWas->u16Size, (int)sizeof(tWas) ) );
+			}
+			if( ptNow )
+			{
+				memcpy( &tNow, ptNow->pData, min( (int)ptNow->u16Size, (int)sizeof(tNow) ) );
+			}
+
+			if( ptWas && ptNow && ptWas->u8Type == ptNow->u8Type && tWas.s16Setting == tNow.s16Setting )
+			{
+				dSkew = fabs( ((int64_t)ptWas->u64TimeUs + ptPlayer->s64OffsetUs - (int64_t)ptNow->u64TimeUs) / 1000.0 );
+				dSkewMax = max( dSkewMax, dSkew );
+				same++;
+			}
+			else
+			{
+				bSame = false;
+
+				fprintf( fp, "\nsetting %i differs at %.3f s: ", same + 1,
+						 ((int64_t)(ptWas ? ptWas : ptNow)->u64TimeUs + (ptWas ? ptPlayer->s64OffsetUs : 0)) / 1e6 - u32Start / 1000.0 );
+
+				if( ptWas )
+				{
+					fprintf( fp, "recorded %s %i, ", apNames[ptWas->u8Type], tWas.s16Setting );
+				}
+				else
+				{
+					fprintf( fp, "recorded nothing more, " );
+				}
+
+				if( ptNow )
+				{
+					fprintf( fp, "replayed %s %i\n", apNames[ptNow->u8Type], tNow.s16Setting );
+				}
+				else
+				{
+					fprintf( fp, "replayed nothing more\n" );
+				}
+			}
+		}
+
+		if( was >= 0 )
+		{
+			recorded++;
+			was = FindEvent( ptRecorded, was + 1, REPLAY_SETTINGS );
+		}
+		if( now >= 0 )
+		{
+			replayed++;
+			now = FindEvent( ptReplayed, now + 1, REPLAY_SETTINGS );
+		}
+	}
+
+	fprintf( fp, "%i settings recorded, %i replayed, %i the same%s, at most %.1f ms apart\n", recorded, replayed,
+			 same, bSame ? "" : " before that", dSkewMax );
+
+	return bSame;
+}
+
+//------------------------------------------------------------------------------
+// hhmmss of a GGA or RMC sentence, in seconds of the day
+bool SentenceSeconds( const char *pLine, long *plSeconds )
+{
+	int hours;
+	int minutes;
+	int seconds;
+
+	if( pLine[0] != '$' || (strncmp( pLine + 3, "GGA,", 4 ) && strncmp( pLine + 3, "RMC,", 4 )) )
+	{
+		return false;
+	}
+
+	if( 3 != sscanf( pLine + 7, "%2d%2d%2d", &hours, &minutes, &seconds ) )
+	{
+		return false;
+	}
+
+	*plSeconds = (hours * 60L + minutes) * 60L + seconds;
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Comma separated field of a sentence, 0 == the talker and type
+bool GetField( const char *pLine, int field, char *pOut, int size )
+{
+	int length = 0;
+
+	for( ; field > 0 && *pLine; pLine++ )
+	{
+		if( *pLine == ',' )
+		{
+			field--;
+		}
+	}
+
+	if( field > 0 )
+	{
+		return false;
+	}
+
+	while( *pLine && *pLine != ',' && *pLine != '*' && length < size - 1 )
+	{
+		pOut[length++] = *pLine++;
+	}
+	pOut[length] = '\0';
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// The route and fence given, as gpsboat loads them
+bool LoadMission( tROUTE *ptRoute, tFENCE *ptFence )
+{
+	if( gpFenceFile && !FENCE_LoadFile( ptFence, gpFenceFile ) )
+	{
+		return false;
+	}
+
+	if( gpRouteFile )
+	{
+		if( !ROUTE_LoadFile( ptRoute, gpRouteFile ) )
+		{
+			return false;
+		}
+	}
+	else
+	{
+		ROUTE_LoadConfig( ptRoute );
+	}
+
+	// The fence lives in the route's frame, so waits for home like it does
+	return ptRoute->bHomeAtLock || FENCE_SetFrame( ptFence, &ptRoute->tFrame );
+}
+
+//------------------------------------------------------------------------------
+// Prints a state change and folds it into the running FNV-1a hash
+U32 Transition( FILE *fp, U32 u32Hash, const char *pFormat, ... )
+{
+	char acLine[REPLAY_LINE_SIZE];
+	va_list args;
+	char *p;
+
+	va_start( args, pFormat );
+	vsnprintf( acLine, sizeof(acLine), pFormat, args );
+	va_end( args );
+
+	fputs( acLine, fp );
+
+	for( p = acLine; *p; p++ )
+	{
+		u32Hash = ((u32Hash ^ (U8)*p) * FNV_PRIME) & 0xFFFFFFFF;
+	}
+
+	return u32Hash;
+}
+
+//------------------------------------------------------------------------------
+double WallNow( void )
+{
+	struct timespec tNow;
+
+	clock_gettime( CLOCK_MONOTONIC, &tNow );
+
+	return tNow.tv_sec + tNow.tv_nsec / 1e9;
+}
+
+//------------------------------------------------------------------------------
+void Usage( void )
+{
+	fprintf( stderr, "usage: replay [-v] [-x factor] [-r flight.rec] [-f fence.csv] track.nmea|run.rec [mission.route]\n" );
+}
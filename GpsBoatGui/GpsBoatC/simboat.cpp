@@ -0,0 +1,872 @@
+// simboat.cpp
+// Runs the boat's own nav loop, Autopilot.cpp as gpsboat runs it, against
+// the simulator (see Sim.h) on a PC, faster than real time:
+//
+//   make simboat
+//   simboat [options] [-f fence.csv] [mission.route]
+//     -t seconds     simulated time to run (600)
+//     -x factor      times real time, 0 == as fast as possible (0)
+//     -p lat,lon     start, default home or 50 m south of waypoint 1
+//     -h degrees     start heading, true (0)
+//     -l seconds     GPS lock after power on (5)
+//     -g meters      GPS noise, 1 sigma (0)
+//     -b degrees     compass bias (0)
+//     -n degrees     compass noise, 1 sigma (0)
+//     -c m/s,deg     current, flowing toward
+//     -w m/s,deg     wind, blowing from
+//     -s seed        noise seed (1)
+//     -T degrees     DEGREES_TO_BEARING_TOLERANCE to steer with
+//     -D meters      SWITCH_WAYPOINT_DISTANCE to steer with
+//     -H steering    pid (the helm, Helm.h) or bangbang, as config.h has it
+//     -G guidance    path (along the leg) or point (at the waypoint), ditto
+//     -P position    predict (dead reckoned to now) or fix, ditto
+//     -v             show the nav loop's own output
+// Prints each waypoint reached with the true miss distance and the leg's time
+// and energy, then a summary, which has how far the position the nav loop
+// steered from was off the boat's true one.
+//
+// Monte Carlo, -m missions [-j jobs] [-o results.csv] [-S]:
+// Each mission sails the route once, from a random start heading, with
+// every condition drawn afresh: GPS noise, compass noise, current and wind
+// speed uniform from 0 to the value given, compass bias uniform +/- the
+// value given, current and wind directions uniform. -s seeds the draws, so
+// the same seed gives the same missions: run twice with different -T or -D
+// to compare them on identical conditions (or with -H, -G or -P, two ways
+// of steering, guidance or taking the position). -t limits each mission.
+//
+// Every mission has its own tAUTOPILOT and simulated world, loaded fresh,
+// so missions run side by side on -j threads (one per core by default) that
+// claim them off a shared counter until none are left. -S runs the batch on
+// 1, 2, 4 ... -j threads and shows how missions/s scales with them.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "includes.h"
+#include "config.h"
+#include "Hal.h"
+#include "Route.h"
+#include "Geofence.h"
+#include "LocalFrame.h"
+#include "Autopilot.h"
+#include "Sched.h"
+#include "Sim.h"
+
+//-------------------------------------------
+// Local defines
+
+#define SIM_DEFAULT_SECONDS		600
+#define SIM_START_SOUTH_M		50.0
+
+typedef struct
+{
+	bool bFinished;				// every waypoint reached before the time ran out
+	bool bFailed;				// the route, fence or ports couldn't be set up
+	int reached;				// waypoints reached
+	float fArrival;				// seconds from leaving for waypoint 1 to the last one reached
+	float fMissMean;			// meters, true distance from the waypoint when it was reached
+	float fMissMax;
+	float fTrackRms;			// meters, true distance off the leg, every pass
+	float fTrackMax;
+	float fPositionRms;			// meters, the nav loop's position off the true one, every pass
+	float fPositionMax;
+	float fSailed;				// meters over the ground
+	float fEnergy;				// J drawn, the whole run
+	float fLegTime;				// s a leg, mean of the legs sailed
+	float fLegEnergy;			// J a leg
+	tSIM_CONFIG tConfig;		// as drawn
+} tMISSION_RESULT;
+
+// Shared between the workers
+typedef struct
+{
+	const tSIM_CONFIG *ptRange;
+	int missions;
+	U32 u32EndMs;
+	U32 u32Next;					// next mission to claim
+	tMISSION_RESULT *ptResults;		// one per mission
+} tBATCH;
+
+//-------------------------------------------
+// Local data
+
+// Options, only read once parsed
+static const char *gpRouteFile = NULL;		// NULL == the config.h waypoints
+static const char *gpFenceFile = NULL;
+static tAUTOPILOT_CONFIG gtApConfig;
+
+//-------------------------------------------
+// Local prototypes
+
+static bool		LoadMission( tROUTE *ptRoute, tFENCE *ptFence );
+static bool		RunMission( const tSIM_CONFIG *ptConfig, U32 u32EndMs, bool bStopWhenDone, FILE *fpLog, tSIM *ptSim, tMISSION_RESULT *ptResult );
+static void		PumpGps( void *pArg );
+static void		GetWaypoint( const tSIM *ptSim, const tROUTE *ptRoute, int wp, tENU_POS *ptPos );
+static bool		RunBatch( const tSIM_CONFIG *ptRange, int missions, int jobs, bool bScaling, U32 u32EndMs, FILE *fpOut, const char *pCsv );
+static double	RunJobs( tBATCH *ptBatch, int jobs );
+static void		*Worker( void *pArg );
+static bool		SameResults( const tMISSION_RESULT *ptA, const tMISSION_RESULT *ptB, int missions );
+static void		DrawMission( const tSIM_CONFIG *ptRange, int mission, tSIM_CONFIG *ptConfig );
+static double	Uniform( uint32_t *pu32State );
+static double	WallNow( void );
+static void		Summarise( FILE *fp, const char *pName, float *pfValues, int count, const char *pUnits );
+static int		CompareFloat( const void *pA, const void *pB );
+static bool		WriteCsv( const char *pFileName, const tMISSION_RESULT *ptResults, int missions );
+static bool		ParsePair( const char *pArg, double *pdA, double *pdB );
+static void		Usage( void );
+
+//------------------------------------------------------------------------------
+int main( int argc, char **argv )
+{
+	tSIM_CONFIG tConfig;
+	tMISSION_RESULT tResult;
+	tSIM tSim;
+	tROUTE tRoute;
+	tFENCE tFence;
+	tENU_FRAME tFrame;
+	tENU_POS tPos;
+	double dSeconds = SIM_DEFAULT_SECONDS;
+	double dLat;
+	double dLon;
+	double dWall;
+	bool bStart = false;
+	bool bVerbose = false;
+	bool bScaling = false;
+	const char *pCsv = NULL;
+	int missions = 0;
+	int jobs = sysconf( _SC_NPROCESSORS_ONLN );
+	FILE *fpOut;
+	int opt;
+	int i;
+
+	memset( &tConfig, 0, sizeof(tConfig) );
+	tConfig.u32GpsLockMs = 5000;
+	tConfig.u32Seed = 1;
+
+	// The simulator hands over each GPS sentence as it sends it, no GPS thread
+	AUTOPILOT_DefaultConfig( &gtApConfig );
+	gtApConfig.pGpsDevice = SIM_GPS_DEVICE;
+	gtApConfig.pCompassDevice = SIM_COMPASS_DEVICE;
+	gtApConfig.bGpsThread = false;
+	gtApConfig.fpLog = NULL;
+
+	while( (opt = getopt( argc, argv, "t:x:p:h:l:g:b:n:c:w:s:T:D:H:G:P:m:j:o:Sf:v" )) != -1 )
+	{
+		switch( opt )
+		{
+		case 't': dSeconds = atof( optarg ); break;
+		case 'x': tConfig.dRealTime = atof( optarg ); break;
+		case 'h': tConfig.dStartHeading = atof( optarg ); break;
+		case 'l': tConfig.u32GpsLockMs = (U32)(atof( optarg ) * 1000.0); break;
+		case 'g': tConfig.dGpsNoise = atof( optarg ); break;
+		case 'b': tConfig.dCompassBias = atof( optarg ); break;
+		case 'n': tConfig.dCompassNoise = atof( optarg ); break;
+		case 's': tConfig.u32Seed = (U32)strtoul( optarg, NULL, 0 ); break;
+		case 'T': gtApConfig.fBearingTolerance = atof( optarg ); break;
+		case 'D': gtApConfig.fSwitchDistance = atof( optarg ); break;
+		case 'm': missions = atoi( optarg ); break;
+		case 'j': jobs = atoi( optarg ); break;
+		case 'o': pCsv = optarg; break;
+		case 'S': bScaling = true; break;
+		case 'f': gpFenceFile = optarg; break;
+		case 'v': bVerbose = true; break;
+		case 'p':
+			if( !ParsePair( optarg, &dLat, &dLon ) )
+			{
+				Usage();
+				return 1;
+			}
+			tConfig.lStartLat = (long)round( dLat * 1000000.0 );
+			tConfig.lStartLon = (long)round( dLon * 1000000.0 );
+			bStart = true;
+			break;
+		case 'c':
+			if( !ParsePair( optarg, &tConfig.dCurrentSpeed, &tConfig.dCurrentDir ) )
+			{
+				Usage();
+				return 1;
+			}
+			break;
+		case 'w':
+			if( !ParsePair( optarg, &tConfig.dWindSpeed, &tConfig.dWindDir ) )
+			{
+				Usage();
+				return 1;
+			}
+			break;
+		case 'H':
+			for( i = 0; i < E_STEER_MAX && strcmp( optarg, AUTOPILOT_SteeringName( (E_STEERING)i ) ); i++ )
+			{
+			}
+			if( i == E_STEER_MAX )
+			{
+				Usage();
+				return 1;
+			}
+			gtApConfig.eSteering = (E_STEERING)i;
+			break;
+		case 'G':
+			for( i = 0; i < E_GUIDE_MAX && strcmp( optarg, AUTOPILOT_GuidanceName( (E_GUIDANCE)i ) ); i++ )
+			{
+			}
+			if( i == E_GUIDE_MAX )
+			{
+				Usage();
+				return 1;
+			}
+			gtApConfig.eGuidance = (E_GUIDANCE)i;
+			break;
+		case 'P':
+			for( i = 0; i < E_POS_MAX && strcmp( optarg, AUTOPILOT_PositionName( (E_POSITION)i ) ); i++ )
+			{
+			}
+			if( i == E_POS_MAX )
+			{
+				Usage();
+				return 1;
+			}
+			gtApConfig.ePosition = (E_POSITION)i;
+			break;
+		default:
+			Usage();
+			return 1;
+		}
+	}
+
+	jobs = max( jobs, 1 );
+
+	// Once for every mission's autopilot
+	HAL_Init();
+
+	if( optind < argc )
+	{
+		gpRouteFile = argv[optind];
+	}
+
+	//-----------------------
+	// Route and fence, loaded once here to check them and find the start.
+	// Each mission's autopilot loads its own.
+	//-----------------------
+	memset( &tRoute, 0, sizeof(tRoute) );
+	memset( &tFence, 0, sizeof(tFence) );
+
+	if( !LoadMission( &tRoute, &tFence ) )
+	{
+		return 1;
+	}
+
+	// Start at home if the route fixes it, otherwise short of waypoint 1
+	if( !bStart && !tRoute.bHomeAtLock )
+	{
+		tConfig.lStartLat = ROUTE_GetLat( &tRoute, 0 );
+		tConfig.lStartLon = ROUTE_GetLon( &tRoute, 0 );
+	}
+	else if( !bStart )
+	{
+		ENU_Init( &tFrame, ROUTE_GetLat( &tRoute, 1 % tRoute.count ), ROUTE_GetLon( &tRoute, 1 % tRoute.count ) );
+		tPos.dEast = 0.0;
+		tPos.dNorth = -SIM_START_SOUTH_M;
+		ENU_ToGeodetic( &tFrame, &tPos, &tConfig.lStartLat, &tConfig.lStartLon );
+	}
+
+	// The drivers' printing goes to /dev/null, and the nav loop's own unless
+	// asked for
+	fpOut = fdopen( dup( fileno( stdout ) ), "w" );
+	setvbuf( fpOut, NULL, _IOLBF, 0 );
+	if( bVerbose && !missions )
+	{
+		gtApConfig.fpLog = stdout;
+	}
+	else if( !freopen( "/dev/null", "w", stdout ) )
+	{
+		return 1;
+	}
+
+	fprintf( fpOut, "simboat: %i waypoints, start %.6f,%.6f, bearing tolerance %.1f, switch distance %.1f, steering %s, guidance %s, position %s\n",
+			 tRoute.count, tConfig.lStartLat / 1000000.0, tConfig.lStartLon / 1000000.0,
+			 gtApConfig.fBearingTolerance, gtApConfig.fSwitchDistance, AUTOPILOT_SteeringName( gtApConfig.eSteering ),
+			 AUTOPILOT_GuidanceName( gtApConfig.eGuidance ), AUTOPILOT_PositionName( gtApConfig.ePosition ) );
+
+	ROUTE_Close( &tRoute );
+	FENCE_Close( &tFence );
+
+	if( missions > 0 )
+	{
+		return RunBatch( &tConfig, missions, jobs, bScaling, (U32)(dSeconds * 1000.0), fpOut, pCsv ) ? 0 : 1;
+	}
+
+	if( !RunMission( &tConfig, (U32)(dSeconds * 1000.0), false, fpOut, &tSim, &tResult ) )
+	{
+		return 1;
+	}
+
+	dWall = SIM_WallSeconds( &tSim );
+
+	fprintf( fpOut, "\n%.1f s simulated in %.3f s, %.0fx real time\n", tSim.u32Now / 1000.0, dWall,
+			 tSim.u32Now / 1000.0 / dWall );
+	fprintf( fpOut, "%i waypoints reached, %.1f m sailed, %lu fixes, %lu compass reads\n",
+			 tResult.reached, tResult.fSailed, tSim.u32Fixes, tSim.u32CompassReads );
+	fprintf( fpOut, "off track %.1f m rms, %.1f m max; waypoints reached %.1f m off on average, %.1f m max\n",
+			 tResult.fTrackRms, tResult.fTrackMax, tResult.fMissMean, tResult.fMissMax );
+	fprintf( fpOut, "%.0f J used; legs %.1f s and %.0f J on average\n", tResult.fEnergy, tResult.fLegTime, tResult.fLegEnergy );
+	fprintf( fpOut, "nav position %.2f m rms off the boat's, %.2f m max\n", tResult.fPositionRms, tResult.fPositionMax );
+
+	return 0;
+}
+
+//------------------------------------------------------------------------------
+// The route and fence given, as gpsboat loads them
+bool LoadMission( tROUTE *ptRoute, tFENCE *ptFence )
+{
+	if( gpFenceFile && !FENCE_LoadFile( ptFence, gpFenceFile ) )
+	{
+		return false;
+	}
+
+	if( gpRouteFile )
+	{
+		if( !ROUTE_LoadFile( ptRoute, gpRouteFile ) )
+		{
+			return false;
+		}
+	}
+	else
+	{
+		ROUTE_LoadConfig( ptRoute );
+	}
+
+	// The fence lives in the route's frame, so waits for home like it does
+	return ptRoute->bHomeAtLock || FENCE_SetFrame( ptFence, &ptRoute->tFrame );
+}
+
+//------------------------------------------------------------------------------
+// Powers a boat up in a fresh world and runs gpsboat's main loop, less the
+// status screen, until u32EndMs of simulated time, or with bStopWhenDone
+// until the whole route has been sailed once. Waypoints reached, and the nav
+// state machine's profile at the end, are logged to fpLog if given. Everything lives in ptSim and on the stack, so any number
+// of threads can be running missions at once.
+bool RunMission( const tSIM_CONFIG *ptConfig, U32 u32EndMs, bool bStopWhenDone, FILE *fpLog, tSIM *ptSim, tMISSION_RESULT *ptResult )
+{
+	tAUTOPILOT tAp;
+	tSCHED tSched;
+	tENU_POS tBoat;
+	tENU_POS tLegStart;
+	tENU_POS tLegEnd;
+	tENU_POS tTrue;
+	long lLat;
+	long lLon;
+	bool bLocked = false;
+	bool bDeparted = false;
+	U32 u32Departed = 0;
+	U32 u32LegStart = 0;
+	U32 u32Passes = 0;
+	double dDepartedEnergy = 0.0;
+	double dLegEnergy = 0.0;
+	double dTrack2 = 0.0;
+	double dPosition2 = 0.0;
+	double dMiss = 0.0;
+	double dOff;
+	int lastWP;
+
+	memset( ptResult, 0, sizeof(tMISSION_RESULT) );
+	ptResult->tConfig = *ptConfig;
+
+	SIM_Init( ptSim, ptConfig );
+	AUTOPILOT_Init( &tAp, &gtApConfig );
+	SIM_SetGpsPump( ptSim, PumpGps, &tAp );
+
+	if( !LoadMission( &tAp.tRoute, &tAp.tFence ) || !AUTOPILOT_Setup( &tAp ) )
+	{
+		ptResult->bFailed = true;
+		AUTOPILOT_Close( &tAp );
+		SIM_Close( ptSim );
+		return false;
+	}
+
+	HAL_Delay( 3000 );
+
+	lastWP = tAp.targetWP;
+
+	SCHED_Init( &tSched, CONTROL_RATE_HZ, 0 );
+
+	while( ptSim->u32Now < u32EndMs )
+	{
+		SCHED_Wait( &tSched );
+		AUTOPILOT_Tick( &tAp );
+
+		tBoat.dEast = ptSim->tBoat.dEast;
+		tBoat.dNorth = ptSim->tBoat.dNorth;
+
+		if( fpLog && tAp.tGpsInfo.bGpsLocked && !bLocked )
+		{
+			fprintf( fpLog, "%8.1f s  GPS lock\n", ptSim->u32Now / 1000.0 );
+			bLocked = true;
+		}
+
+		// A new target means the last one was reached, bar the first
+		if( tAp.targetWP != lastWP )
+		{
+			if( bDeparted )
+			{
+				dOff = ENU_Distance( &tLegEnd, &tBoat );
+				dMiss += dOff;
+				ptResult->fMissMax = max( ptResult->fMissMax, (float)dOff );
+				ptResult->reached++;
+
+				if( fpLog )
+				{
+					fprintf( fpLog, "%8.1f s  waypoint %i reached, %.1f m off, %.1f s, %.0f J\n", ptSim->u32Now / 1000.0,
+							 lastWP, dOff, (ptSim->u32Now - u32LegStart) / 1000.0, ptSim->tBoat.dEnergy - dLegEnergy );
+				}
+
+				ptResult->fLegTime = (ptSim->u32Now - u32Departed) / 1000.0 / ptResult->reached;
+				ptResult->fLegEnergy = (ptSim->tBoat.dEnergy - dDepartedEnergy) / ptResult->reached;
+				tLegStart = tLegEnd;
+			}
+			else
+			{
+				bDeparted = true;
+				u32Departed = ptSim->u32Now;
+				dDepartedEnergy = ptSim->tBoat.dEnergy;
+				tLegStart = tBoat;
+			}
+
+			u32LegStart = ptSim->u32Now;
+			dLegEnergy = ptSim->tBoat.dEnergy;
+
+			if( fpLog )
+			{
+				fprintf( fpLog, "%8.1f s  heading for waypoint %i\n", ptSim->u32Now / 1000.0, tAp.targetWP );
+			}
+
+			GetWaypoint( ptSim, &tAp.tRoute, tAp.targetWP, &tLegEnd );
+			lastWP = tAp.targetWP;
+
+			// Back home, the route's been sailed
+			if( !ptResult->bFinished && ptResult->reached >= tAp.tRoute.count )
+			{
+				ptResult->bFinished = true;
+				ptResult->fArrival = (ptSim->u32Now - u32Departed) / 1000.0;
+
+				if( bStopWhenDone )
+				{
+					break;
+				}
+			}
+		}
+
+		if( bDeparted )
+		{
+			dOff = fabs( ENU_CrossTrack( &tLegStart, &tLegEnd, &tBoat ) );
+			dTrack2 += dOff * dOff;
+			ptResult->fTrackMax = max( ptResult->fTrackMax, (float)dOff );
+
+			// In the route's frame, as the nav loop has it
+			SIM_GetPosition( ptSim, &lLat, &lLon );
+			ENU_FromGeodetic( &tAp.tRoute.tFrame, lLat, lLon, &tTrue );
+			dOff = ENU_Distance( &tAp.tNavInfo.tEstimate, &tTrue );
+			dPosition2 += dOff * dOff;
+			ptResult->fPositionMax = max( ptResult->fPositionMax, (float)dOff );
+			u32Passes++;
+		}
+	}
+
+	ptResult->fMissMean = ptResult->reached ? dMiss / ptResult->reached : 0.0;
+	ptResult->fTrackRms = u32Passes ? sqrt( dTrack2 / u32Passes ) : 0.0;
+	ptResult->fPositionRms = u32Passes ? sqrt( dPosition2 / u32Passes ) : 0.0;
+	ptResult->fSailed = ptSim->tBoat.dSailed;
+	ptResult->fEnergy = ptSim->tBoat.dEnergy;
+
+	if( fpLog )
+	{
+		fprintf( fpLog, "\n" );
+		AUTOPILOT_PrintProfile( &tAp, fpLog );
+	}
+
+	AUTOPILOT_Close( &tAp );
+	SIM_Close( ptSim );
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// The GPS thread's work, done on the nav thread as each sentence is sent
+void PumpGps( void *pArg )
+{
+	AUTOPILOT_ReadGps( (tAUTOPILOT *)pArg, 0 );
+}
+
+//------------------------------------------------------------------------------
+// Waypoint in the simulator's frame
+void GetWaypoint( const tSIM *ptSim, const tROUTE *ptRoute, int wp, tENU_POS *ptPos )
+{
+	ENU_FromGeodetic( &ptSim->tFrame, ROUTE_GetLat( ptRoute, wp ), ROUTE_GetLon( ptRoute, wp ), ptPos );
+}
+
+//------------------------------------------------------------------------------
+// Runs the missions on jobs threads, or with bScaling on 1, 2, 4 ... jobs
+// threads in turn, then summarises them
+bool RunBatch( const tSIM_CONFIG *ptRange, int missions, int jobs, bool bScaling, U32 u32EndMs, FILE *fpOut, const char *pCsv )
+{
+	tBATCH tBatch;
+	tMISSION_RESULT *ptFirst;
+	float *pfArrival;
+	float *pfTrackRms;
+	float *pfTrackMax;
+	float *pfMiss;
+	float *pfMissMax;
+	float *pfPosition;
+	float *pfLegTime;
+	float *pfLegEnergy;
+	int finished = 0;
+	int legged = 0;
+	int failed = 0;
+	int reached = 0;
+	double dWall;
+	double dSingle = 0.0;
+	int threads;
+	int i;
+
+	// Room for two sets, the scaling runs check each one against the first
+	tBatch.ptRange = ptRange;
+	tBatch.missions = missions;
+	tBatch.u32EndMs = u32EndMs;
+	tBatch.ptResults = (tMISSION_RESULT *)malloc( 2 * missions * sizeof(tMISSION_RESULT) );
+	if( !tBatch.ptResults )
+	{
+		fprintf (stderr, "Unable to allocate mission results: %s\n", strerror (errno)) ;
+		return false;
+	}
+	ptFirst = tBatch.ptResults + missions;
+
+	jobs = min( jobs, missions );
+
+	if( !bScaling )
+	{
+		fprintf( fpOut, "%i missions on %i jobs\n", missions, jobs );
+
+		if( (dWall = RunJobs( &tBatch, jobs )) < 0.0 )
+		{
+			return false;
+		}
+
+		fprintf( fpOut, "%.2f s wall, %.0f missions/s\n\n", dWall, missions / dWall );
+	}
+	else
+	{
+		fprintf( fpOut, "%i missions, %li cores online\n\n", missions, sysconf( _SC_NPROCESSORS_ONLN ) );
+		fprintf( fpOut, "jobs   wall s  missions/s  speedup  per job\n" );
+
+		for( threads = 1; ; threads = min( threads * 2, jobs ) )
+		{
+			if( (dWall = RunJobs( &tBatch, threads )) < 0.0 )
+			{
+				return false;
+			}
+
+			if( threads == 1 )
+			{
+				dSingle = dWall;
+				memcpy( ptFirst, tBatch.ptResults, missions * sizeof(tMISSION_RESULT) );
+			}
+
+			fprintf( fpOut, "%4i %8.2f %11.0f %8.2f %7.0f%%%s\n", threads, dWall, missions / dWall, dSingle / dWall,
+					 100.0 * dSingle / dWall / threads,
+					 SameResults( ptFirst, tBatch.ptResults, missions ) ? "" : "  results differ" );
+
+			if( threads == jobs )
+			{
+				break;
+			}
+		}
+
+		fprintf( fpOut, "\n" );
+	}
+
+	//-----------------------
+	// Aggregate
+	//-----------------------
+	pfArrival = (float *)malloc( 8 * missions * sizeof(float) );
+	if( !pfArrival )
+	{
+		return false;
+	}
+	pfTrackRms = pfArrival + missions;
+	pfTrackMax = pfTrackRms + missions;
+	pfMiss = pfTrackMax + missions;
+	pfMissMax = pfMiss + missions;
+	pfPosition = pfMissMax + missions;
+	pfLegTime = pfPosition + missions;
+	pfLegEnergy = pfLegTime + missions;
+
+	for( i = 0; i < missions; i++ )
+	{
+		const tMISSION_RESULT *ptResult = &tBatch.ptResults[i];
+
+		if( ptResult->bFailed )
+		{
+			failed++;
+			continue;
+		}
+
+		if( ptResult->bFinished )
+		{
+			pfArrival[finished++] = ptResult->fArrival;
+		}
+
+		pfTrackRms[i - failed] = ptResult->fTrackRms;
+		pfTrackMax[i - failed] = ptResult->fTrackMax;
+		pfMiss[i - failed] = ptResult->fMissMean;
+		pfMissMax[i - failed] = ptResult->fMissMax;
+		pfPosition[i - failed] = ptResult->fPositionRms;
+
+		if( ptResult->reached )
+		{
+			pfLegTime[legged] = ptResult->fLegTime;
+			pfLegEnergy[legged++] = ptResult->fLegEnergy;
+		}
+		reached += ptResult->reached;
+	}
+
+	fprintf( fpOut, "finished     %5.1f%%  (%i, %i timed out, %i failed)\n", 100.0 * finished / missions, finished,
+			 missions - finished - failed, failed );
+	fprintf( fpOut, "reached      %7.2f waypoints per mission\n\n", (double)reached / max( missions - failed, 1 ) );
+	fprintf( fpOut, "                 mean      p50      p95      max\n" );
+	Summarise( fpOut, "arrival", pfArrival, finished, "s" );
+	Summarise( fpOut, "track rms", pfTrackRms, missions - failed, "m" );
+	Summarise( fpOut, "track max", pfTrackMax, missions - failed, "m" );
+	Summarise( fpOut, "miss mean", pfMiss, missions - failed, "m" );
+	Summarise( fpOut, "miss max", pfMissMax, missions - failed, "m" );
+	Summarise( fpOut, "position rms", pfPosition, missions - failed, "m" );
+	Summarise( fpOut, "leg time", pfLegTime, legged, "s" );
+	Summarise( fpOut, "leg energy", pfLegEnergy, legged, "J" );
+
+	free( pfArrival );
+
+	if( pCsv && !WriteCsv( pCsv, tBatch.ptResults, missions ) )
+	{
+		return false;
+	}
+
+	free( tBatch.ptResults );
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// The whole batch on jobs threads. Returns the wall seconds it took, -1 if
+// no thread could be started.
+double RunJobs( tBATCH *ptBatch, int jobs )
+{
+	pthread_t *ptThreads;
+	int started = 0;
+	int status;
+	double dWall;
+	int i;
+
+	if( !(ptThreads = (pthread_t *)malloc( jobs * sizeof(pthread_t) )) )
+	{
+		return -1.0;
+	}
+
+	ptBatch->u32Next = 0;
+
+	dWall = WallNow();
+
+	for( i = 0; i < jobs; i++ )
+	{
+		if( (status = pthread_create( &ptThreads[started], NULL, Worker, ptBatch )) != 0 )
+		{
+			// The workers already running take the rest
+			fprintf (stderr, "Unable to start worker: %s\n", strerror (status)) ;
+			break;
+		}
+
+		started++;
+	}
+
+	for( i = 0; i < started; i++ )
+	{
+		pthread_join( ptThreads[i], NULL );
+	}
+
+	dWall = WallNow() - dWall;
+
+	free( ptThreads );
+
+	return started ? dWall : -1.0;
+}
+
+//------------------------------------------------------------------------------
+// Claims missions until there are none left, each sailed by its own
+// autopilot in its own world
+void *Worker( void *pArg )
+{
+	tBATCH *ptBatch = (tBATCH *)pArg;
+	tSIM_CONFIG tConfig;
+	tSIM tSim;
+	U32 mission;
+
+	while( (mission = __atomic_fetch_add( &ptBatch->u32Next, 1, __ATOMIC_RELAXED )) < (U32)ptBatch->missions )
+	{
+		DrawMission( ptBatch->ptRange, mission, &tConfig );
+		RunMission( &tConfig, ptBatch->u32EndMs, true, NULL, &tSim, &ptBatch->ptResults[mission] );
+	}
+
+	return NULL;
+}
+
+//------------------------------------------------------------------------------
+// Every mission came out the same
+bool SameResults( const tMISSION_RESULT *ptA, const tMISSION_RESULT *ptB, int missions )
+{
+	int i;
+
+	for( i = 0; i < missions; i++, ptA++, ptB++ )
+	{
+		if( ptA->bFinished != ptB->bFinished || ptA->reached != ptB->reached || ptA->fArrival != ptB->fArrival ||
+			ptA->fTrackRms != ptB->fTrackRms || ptA->fMissMean != ptB->fMissMean || ptA->fSailed != ptB->fSailed ||
+			ptA->fEnergy != ptB->fEnergy || ptA->fPositionRms != ptB->fPositionRms )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Conditions for one mission, from the -s seed and the mission number alone
+void DrawMission( const tSIM_CONFIG *ptRange, int mission, tSIM_CONFIG *ptConfig )
+{
+	uint32_t u32State = (ptRange->u32Seed ^ ((mission + 1) * 0x9E3779B9u)) | 1;
+	int i;
+
+	// Neighbouring seeds start out alike
+	for( i = 0; i < 8; i++ )
+	{
+		SIM_Random( &u32State );
+	}
+
+	*ptConfig = *ptRange;
+	ptConfig->dStartHeading = 360.0 * Uniform( &u32State );
+	ptConfig->dGpsNoise = ptRange->dGpsNoise * Uniform( &u32State );
+	ptConfig->dCompassBias = ptRange->dCompassBias * (2.0 * Uniform( &u32State ) - 1.0);
+	ptConfig->dCompassNoise = ptRange->dCompassNoise * Uniform( &u32State );
+	ptConfig->dCurrentSpeed = ptRange->dCurrentSpeed * Uniform( &u32State );
+	ptConfig->dCurrentDir = 360.0 * Uniform( &u32State );
+	ptConfig->dWindSpeed = ptRange->dWindSpeed * Uniform( &u32State );
+	ptConfig->dWindDir = 360.0 * Uniform( &u32State );
+	ptConfig->dRealTime = 0.0;
+	ptConfig->u32Seed = SIM_Random( &u32State );
+}
+
+//------------------------------------------------------------------------------
+// [0, 1)
+double Uniform( uint32_t *pu32State )
+{
+	return SIM_Random( pu32State ) / 4294967296.0;
+}
+
+//------------------------------------------------------------------------------
+double WallNow( void )
+{
+	struct timespec tNow;
+
+	clock_gettime( CLOCK_MONOTONIC, &tNow );
+
+	return tNow.tv_sec + tNow.tv_nsec / 1e9;
+}
+
+//------------------------------------------------------------------------------
+// One line of mean and percentiles, sorts pfValues
+void Summarise( FILE *fp, const char *pName, float *pfValues, int count, const char *pUnits )
+{
+	double dSum = 0.0;
+	int i;
+
+	if( count == 0 )
+	{
+		fprintf( fp, "%-12s        -\n", pName );
+		return;
+	}
+
+	qsort( pfValues, count, sizeof(float), CompareFloat );
+
+	for( i = 0; i < count; i++ )
+	{
+		dSum += pfValues[i];
+	}
+
+	fprintf( fp, "%-12s %8.2f %8.2f %8.2f %8.2f  %s\n", pName, dSum / count, pfValues[(count - 1) / 2],
+			 pfValues[(int)((count - 1) * 0.95)], pfValues[count - 1], pUnits );
+}
+
+//------------------------------------------------------------------------------
+int CompareFloat( const void *pA, const void *pB )
+{
+	float a = *(const float *)pA;
+	float b = *(const float *)pB;
+
+	return (a > b) - (a < b);
+}
+
+//------------------------------------------------------------------------------
+// One line per mission: conditions drawn, then results
+bool WriteCsv( const char *pFileName, const tMISSION_RESULT *ptResults, int missions )
+{
+	FILE *fp;
+	int i;
+
+	if( !(fp = fopen( pFileName, "w" )) )
+	{
+		fprintf (stderr, "Unable to create %s: %s\n", pFileName, strerror (errno)) ;
+		return false;
+	}
+
+	fprintf( fp, "mission,heading,gps_noise,compass_bias,compass_noise,current,current_dir,wind,wind_dir,"
+				 "finished,failed,reached,arrival,track_rms,track_max,miss_mean,miss_max,position_rms,position_max,sailed,energy,leg_time,leg_energy\n" );
+
+	for( i = 0; i < missions; i++ )
+	{
+		const tMISSION_RESULT *ptResult = &ptResults[i];
+		const tSIM_CONFIG *ptConfig = &ptResult->tConfig;
+
+		fprintf( fp, "%i,%.1f,%.2f,%.2f,%.2f,%.2f,%.1f,%.2f,%.1f,%i,%i,%i,%.1f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.1f,%.0f,%.2f,%.1f\n", i,
+				 ptConfig->dStartHeading, ptConfig->dGpsNoise, ptConfig->dCompassBias, ptConfig->dCompassNoise,
+				 ptConfig->dCurrentSpeed, ptConfig->dCurrentDir, ptConfig->dWindSpeed, ptConfig->dWindDir,
+				 ptResult->bFinished, ptResult->bFailed, ptResult->reached, ptResult->fArrival,
+				 ptResult->fTrackRms, ptResult->fTrackMax, ptResult->fMissMean, ptResult->fMissMax,
+				 ptResult->fPositionRms, ptResult->fPositionMax, ptResult->fSailed,
+				 ptResult->fEnergy, ptResult->fLegTime, ptResult->fLegEnergy );
+	}
+
+	if( fclose( fp ) != 0 )
+	{
+		fprintf (stderr, "Unable to write %s: %s\n", pFileName, strerror (errno)) ;
+		return false;
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// "a,b" into two doubles
+bool ParsePair( const char *pArg, double *pdA, double *pdB )
+{
+	return 2 == sscanf( pArg, "%lf,%lf", pdA, pdB );
+}
+
+//------------------------------------------------------------------------------
+void Usage( void )
+{
+	fprintf( stderr, "usage: simboat [-t secs] [-x factor] [-p lat,lon] [-h deg] [-l secs] [-g m] [-b deg] [-n deg]\n"
+					 "               [-c m/s,deg] [-w m/s,deg] [-s seed] [-T deg] [-D m] [-H pid|bangbang]\n"
+					 "               [-G path|point] [-P predict|fix] [-v]\n"
+					 "               [-m missions [-j jobs] [-o results.csv] [-S]] [-f fence.csv] [mission.route]\n" );
+}
@@ -3,50 +3,57 @@
 #include <string.h>
 #include <math.h>       /* sin */
 
-#include <wiringPi.h>
-#include <wiringSerial.h>
-
 #include "includes.h"
+#include "Hal.h"
 #include "HMC6343.h"
+#include "Status.h"
 
-float GetCompassHeading( float declination );
+float GetCompassHeading( int fd, float declination );
 
 //------------------------------------------------------------------------------
 int main ()
 {
 	char id_str[3];
 	unsigned int counter = 0;
+	int compassFd;
+	tSTATUS tStatus;
 
 	printf("sizeof float: %i\n", sizeof(float) );
 	printf("sizeof int: %i\n", sizeof(int) );
 
 	//-----------------------
-	printf("WireingPi ... ");
-	wiringPiSetup();
+	printf("HAL ... ");
+	HAL_Init();
 	printf("OK\n");
 
     // Init compass
 	printf("Compass ... ");
-	HMC6343_Setup();
+	compassFd = HMC6343_Setup( "/dev/ttyUSB0" );
+	if( compassFd < 0 )
+	{
+		return 1;
+	}
 	printf("OK\n");
 
+	STATUS_Init( &tStatus, stdout );
+
 	while(1)
 	{
-		system("clear");
-		printf("Counter: %i\n", counter++);
-		printf("True Heading (with deviation): %.1f\n", GetCompassHeading( -13.0 ) );
-//		printf("Heading (without deviation): %.1f\n", GetCompassHeading( 0.0 ) );
+		STATUS_Line( &tStatus, "Counter: %i", counter++ );
+		STATUS_Line( &tStatus, "True Heading (with deviation): %.1f", GetCompassHeading( compassFd, -13.0 ) );
+//		STATUS_Line( &tStatus, "Heading (without deviation): %.1f", GetCompassHeading( compassFd, 0.0 ) );
+		STATUS_Show( &tStatus );
 
-		delay( 250 );
+		HAL_Delay( 250 );
 	}
 
 	return 0;
 }
 
 //------------------------------------------------------------------------------
-float GetCompassHeading( float declination )
+float GetCompassHeading( int fd, float declination )
 {
-	float heading = (float)(HMC6343_GetHeading()) / 10.0;
+	float heading = (float)(HMC6343_GetHeading( fd )) / 10.0;
 
     // If you have an EAST declination, use + declinationAngle, if you
     // have a WEST declination, use - declinationAngle 
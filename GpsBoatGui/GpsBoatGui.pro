@@ -11,13 +11,27 @@ greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 TARGET = GpsBoatGui
 TEMPLATE = app
 
-INCLUDEPATH += /usr/local/include
-LIBS += -L/usr/local/lib -lwiringPi -lwiringPiDev -lpthread -lm
+CONFIG += c++11
 
 SOURCES += main.cpp\
         mainwindow.cpp \
     GpsBoatC/TinyGPS.cpp \
-    GpsBoatC/Arduino.cpp
+    GpsBoatC/GpsReader.cpp \
+    GpsBoatC/GpsInfo.cpp \
+    GpsBoatC/Recorder.cpp \
+    GpsBoatC/Geodesy.cpp \
+    GpsBoatC/Arduino.cpp \
+    GpsBoatC/Hal.cpp
+
+# Hardware layer backend (see GpsBoatC/Hal.h), qmake CONFIG+=host on a PC
+host {
+    SOURCES += GpsBoatC/HalHost.cpp
+    LIBS += -lpthread -lm
+} else {
+    INCLUDEPATH += /usr/local/include
+    SOURCES += GpsBoatC/HalPi.cpp
+    LIBS += -L/usr/local/lib -lwiringPi -lwiringPiDev -lpthread -lm
+}
 
 HEADERS  += mainwindow.h
 
@@ -7,42 +7,28 @@
 
 #include <QDebug>
 
-// Wiring Pi library
-#include <wiringPi.h>
-#include <wiringPiI2C.h>
-#include <wiringSerial.h>
-
 // Project includes
 #include "GpsBoatC/includes.h"
+#include "GpsBoatC/Hal.h"
 #include "GpsBoatC/config.h"
 #include "GpsBoatC/TinyGPS.h"
+#include "GpsBoatC/GpsReader.h"
+#include "GpsBoatC/GpsInfo.h"
 #include "GpsBoatC/Arduino.h"
 
 //-----------------------------------------------------------------------------
 // local function prototypes
 
 // Threads
-PI_THREAD 	(THREAD_UpdateGps);
+static void *THREAD_UpdateGps( void *pArg );
 
 //-----------------------------------------------------------------------------
 // local data
-typedef struct
-{
-    float flat;
-    float flon;
-    float fmph;
-    float fcourse;
-    U8 hour;
-    U8 minute;
-    U8 second;
-    bool bGpsLocked;
-} tGPS_INFO;
-
-tGPS_INFO gtGpsInfo;
+// Published by THREAD_UpdateGps
+tGPS_SNAPSHOT gtGpsSnapshot;
 
-#define GPS_DATA_KEY	0
-
-int gSerial_fd;
+GpsReader cGpsReader;
+tHAL_THREAD tGpsThread;
 
 // Arduino on I2C bus
 Arduino cArduino;
@@ -59,10 +45,15 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(&timer_GpsUpdate, SIGNAL(timeout()), this, SLOT(GpsUpdate()));
     this->timer_GpsUpdate.start(1000);
 
+    //-----------------------
+    printf("HAL ...\n");
+
+    HAL_Init();
+
     //-----------------------
     printf("GPS ...\n");
 
-    if ((gSerial_fd = serialOpen ("/dev/ttyAMA0", GPS_BAUD)) < 0)
+    if (!cGpsReader.Open ("/dev/ttyAMA0", GPS_BAUD))
     {
        std::cerr << "Unable to open serial device\n";
        return;
@@ -72,7 +63,7 @@ MainWindow::MainWindow(QWidget *parent) :
        std::cout << "Comm port to GPS opened. GPS Baud: " << GPS_BAUD << std::endl;
 
        // Start the GPS thread
-       piThreadCreate( THREAD_UpdateGps );
+       HAL_ThreadCreate( &tGpsThread, THREAD_UpdateGps, NULL );
     }
 
     //-----------------------
@@ -148,8 +139,11 @@ void MainWindow::on_pushButton_Ard_ToggleLed_clicked()
 void MainWindow::GpsUpdate()
 {
     static float flat=0, flong=0;
+    tGPS_INFO tGpsInfo;
+
+    GPSINFO_Read( &gtGpsSnapshot, &tGpsInfo );
 
-    if( gtGpsInfo.bGpsLocked )
+    if( tGpsInfo.bGpsLocked )
     {
         ui->label_GpsStatus->setText(QString("Locked"));
     }
@@ -158,8 +152,8 @@ void MainWindow::GpsUpdate()
         ui->label_GpsStatus->setText(QString("Not Locked"));
     }
 
-    flat = gtGpsInfo.flat;
-    flong = gtGpsInfo.flon;
+    flat = tGpsInfo.flat;
+    flong = tGpsInfo.flon;
 
     ui->lineEdit_Lat->setText(QString::number(flat, 'f', 6));
 
@@ -168,11 +162,13 @@ void MainWindow::GpsUpdate()
 
 //-----------------------------------------------------------------------------------
 // Returns valid cGps data if GPS has a Fix
-PI_THREAD (THREAD_UpdateGps )
+void *THREAD_UpdateGps( void *pArg )
 {
     //static bool bLocked = false;
     bool bNewGpsData = false;
+    tGPS_INFO tGpsInfo = {0};
     unsigned long fix_age;
+    unsigned long u32FixTime = TinyGPS::GPS_INVALID_FIX_TIME;
     //int year;
     //U8 month, day, hundredths;void MainWindow::on_pushButton_ServoCenter_clicked()
     {
@@ -186,24 +182,20 @@ PI_THREAD (THREAD_UpdateGps )
 
     while( true )
     {
-        delay( 200 );
-
         // *******************************
-        // Grab GPS data from serial input
+        // Wait for GPS data on the serial input
         // *******************************
-        while( serialDataAvail(gSerial_fd) )
+        switch( cGpsReader.Read( &cGps, -1 ) )
         {
-            char c;
-            c = serialGetchar(gSerial_fd);
-
-#if DO_GPS_TEST
-            printf("%c", c);
-            fflush( stdout );
-#endif
-            if (cGps.encode(c))
-            {
-                bNewGpsData = true;
-            }
+        case -1:
+            // Port error, don't spin on it
+            HAL_Delay( 1000 );
+            break;
+        case 0:
+            break;
+        default:
+            bNewGpsData = true;
+            break;
         }
 
         // ********************
@@ -211,34 +203,33 @@ PI_THREAD (THREAD_UpdateGps )
         // ********************
         if( bNewGpsData )
         {
-            // Lock the GPS data for updating
-            piLock( GPS_DATA_KEY );
-
             // GPS Position
             // retrieves +/- lat/long in 100000ths of a degree
-            cGps.f_get_position( &gtGpsInfo.flat, &gtGpsInfo.flon, &fix_age);
+            cGps.f_get_position( &tGpsInfo.flat, &tGpsInfo.flon, &fix_age);
+            cGps.get_position( &tGpsInfo.lat, &tGpsInfo.lon );
 
             if (fix_age == TinyGPS::GPS_INVALID_AGE)
             {
-                gtGpsInfo.bGpsLocked = false;
+                tGpsInfo.bGpsLocked = false;
             }
             else
             {
-                gtGpsInfo.bGpsLocked = true;
+                tGpsInfo.bGpsLocked = true;
             }
 
 #if USE_GPS_TIME_INFO
             // GPS Time
-            cGps.crack_datetime(&year, &month, &day, &gtGpsInfo.hour, &gtGpsInfo.minute, &gtGpsInfo.second, &hundredths, &fix_age);
+            cGps.crack_datetime(&year, &month, &day, &tGpsInfo.hour, &tGpsInfo.minute, &tGpsInfo.second, &hundredths, &fix_age);
 #endif // USE_GPS_TIME_INFO
 
             // GPS Speed
-            gtGpsInfo.fmph = cGps.f_speed_mph(); // speed in miles/hr
+            tGpsInfo.fmph = cGps.f_speed_mph(); // speed in miles/hr
             // course in 100ths of a degree
-            gtGpsInfo.fcourse = cGps.f_course();
+            tGpsInfo.fcourse = cGps.f_course();
 
-            // Unlock the GPS data for updating
-            piUnlock( GPS_DATA_KEY );
+            // Hand it to the readers, as a new fix only if a sentence brought a position
+            GPSINFO_Publish( &gtGpsSnapshot, &tGpsInfo, cGps.position_fix_time() != u32FixTime );
+            u32FixTime = cGps.position_fix_time();
 
             // reset new data flag
             bNewGpsData = false;